@@ -151,6 +151,9 @@ void maxavro_map_free(MAXAVRO_MAP *value);
 /** Reading and seeking records */
 json_t* maxavro_record_read_json(MAXAVRO_FILE *file);
 GWBUF* maxavro_record_read_binary(MAXAVRO_FILE *file);
+GWBUF* maxavro_record_read_batch(MAXAVRO_FILE *file, uint64_t *records);
+long maxavro_record_tell(MAXAVRO_FILE *file);
+bool maxavro_record_unread(MAXAVRO_FILE *file, long pos);
 bool maxavro_record_seek(MAXAVRO_FILE *file, uint64_t offset);
 bool maxavro_record_set_pos(MAXAVRO_FILE *file, long pos);
 bool maxavro_next_block(MAXAVRO_FILE *file);
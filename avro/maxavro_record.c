@@ -360,3 +360,113 @@ GWBUF* maxavro_record_read_binary(MAXAVRO_FILE *file)
     }
     return rval;
 }
+
+/**
+ * @brief Read the unread records of the current data block
+ *
+ * The records are returned in their native Avro binary encoding without the
+ * data block header and the sync marker. After this call the file is positioned
+ * at the end of the data block and maxavro_next_block() can be called.
+ *
+ * @param file File to read from
+ * @param records Number of records in the returned buffer
+ * @return Buffer with the records or NULL if no records were available or an
+ * error occurred. Consult maxavro_get_error for more details.
+ */
+GWBUF* maxavro_record_read_batch(MAXAVRO_FILE *file, uint64_t *records)
+{
+    GWBUF *rval = NULL;
+    *records = 0;
+
+    if (file->last_error == MAXAVRO_ERR_NONE)
+    {
+        if (!file->metadata_read && !maxavro_read_datablock_start(file))
+        {
+            return NULL;
+        }
+
+        long pos = ftell(file->file);
+        long data_size = file->data_start_pos + (long)file->block_size - pos;
+        uint64_t count = file->records_in_block - file->records_read_from_block;
+
+        if (count > 0 && data_size > 0)
+        {
+            if ((rval = gwbuf_alloc(data_size)))
+            {
+                if (fread(GWBUF_DATA(rval), 1, data_size, file->file) == data_size)
+                {
+                    file->records_read_from_block += count;
+                    file->records_read += count;
+                    *records = count;
+                }
+                else
+                {
+                    if (ferror(file->file))
+                    {
+                        char err[MXS_STRERROR_BUFLEN];
+                        MXS_ERROR("Failed to read %ld bytes: %d, %s", data_size, errno,
+                                  strerror_r(errno, err, sizeof(err)));
+                        file->last_error = MAXAVRO_ERR_IO;
+                    }
+                    fseek(file->file, pos, SEEK_SET);
+                    gwbuf_free(rval);
+                    rval = NULL;
+                }
+            }
+            else
+            {
+                MXS_ERROR("Failed to allocate %ld bytes for data block.", data_size);
+                file->last_error = MAXAVRO_ERR_MEMORY;
+            }
+        }
+    }
+    else
+    {
+        MXS_ERROR("Attempting to read from a failed Avro file '%s', error is: %s",
+                  file->filename, maxavro_get_error_string(file));
+    }
+
+    return rval;
+}
+
+/**
+ * @brief Get the position of the next record
+ *
+ * @param file File to inspect
+ * @return File offset of the next record or -1 if the data block header of
+ * the next record has not been read yet
+ */
+long maxavro_record_tell(MAXAVRO_FILE *file)
+{
+    return file->metadata_read ? ftell(file->file) : -1;
+}
+
+/**
+ * @brief Move back to the start of the last record that was read
+ *
+ * The record must be in the current data block.
+ *
+ * @param file File to move
+ * @param pos The value maxavro_record_tell returned before the record was read
+ * @return True if the file was positioned at the start of the record
+ */
+bool maxavro_record_unread(MAXAVRO_FILE *file, long pos)
+{
+    bool rval = false;
+
+    if (pos == -1)
+    {
+        /** The record was the first record of the block */
+        pos = file->data_start_pos;
+    }
+
+    if (file->records_read_from_block > 0 && pos >= file->data_start_pos &&
+        fseek(file->file, pos, SEEK_SET) == 0)
+    {
+        file->records_read_from_block--;
+        file->records_read--;
+        rval = true;
+    }
+
+    return rval;
+}
@@ -159,6 +159,18 @@ int config_get_integer(const MXS_CONFIG_PARAMETER *params, const char *key);
  */
 uint64_t config_get_size(const MXS_CONFIG_PARAMETER *params, const char *key);
 
+/**
+ * @brief Convert a string to a size in bytes
+ *
+ * The suffixes are the same as with config_get_size(). This can be used
+ * for values that are not configuration parameters, e.g. router options.
+ *
+ * @param value String to convert
+ *
+ * @return Number of bytes
+ */
+uint64_t config_parse_size(const char *value);
+
 /**
  * @brief Get a string value
  *
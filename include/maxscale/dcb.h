@@ -192,6 +192,7 @@ typedef struct dcb
     dcb_role_t      dcb_role;
     DCBEVENTQ       evq;            /**< The event queue for this DCB */
     int             fd;             /**< The descriptor */
+    int             *listener_fds;  /**< Per-thread SO_REUSEPORT sockets of a listener or NULL */
     dcb_state_t     state;          /**< Current descriptor state */
     SSL_STATE       ssl_state;      /**< Current state of SSL if in use */
     int             flags;          /**< DCB flags */
@@ -225,6 +226,7 @@ typedef struct dcb
     int             low_water;      /**< Low water mark */
     struct server   *server;        /**< The associated backend server */
     SSL*            ssl;            /*< SSL struct for connection */
+    uint64_t        ssl_handshake_start; /*< When the SSL handshake started, in microseconds */
     bool            ssl_read_want_read;    /*< Flag */
     bool            ssl_read_want_write;    /*< Flag */
     bool            ssl_write_want_read;    /*< Flag */
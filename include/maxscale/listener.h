@@ -45,6 +45,7 @@ typedef struct servlistener
     struct dcb *listener;       /**< The DCB for the listener */
     struct users *users;        /**< The user data for this listener */
     struct service* service;    /**< The service which used by this listener */
+    bool reuseport;             /**< Open a SO_REUSEPORT socket for each thread */
     SPINLOCK lock;
     struct  servlistener *next; /**< Next service protocol */
 } SERV_LISTENER;
@@ -0,0 +1,176 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file logsink.h - Asynchronous log file writing for modules
+ *
+ * A log sink is a file that is written by a background thread. The records
+ * are copied into a buffer of the calling thread without any locking and the
+ * background thread writes the buffered records of all threads with large
+ * writes. Modules that write a record for each query use log sinks so that
+ * slow file writes do not show up as query latency.
+ *
+ * The records written by one thread are written to the file in the same order
+ * they were added. The records of different threads are not interleaved
+ * inside a record but their relative order is not preserved.
+ */
+
+#include <maxscale/cdefs.h>
+#include <maxscale/config.h>
+#include <maxscale/dcb.h>
+#include <maxscale/modinfo.h>
+
+MXS_BEGIN_DECLS
+
+/** What to do when the buffer of a thread is full */
+typedef enum logsink_policy
+{
+    LOGSINK_BLOCK, /**< The calling thread writes the buffered records itself */
+    LOGSINK_DROP   /**< The record is discarded */
+} logsink_policy_t;
+
+/** The names of the policies, for module parameters */
+extern const MXS_ENUM_VALUE logsink_policy_values[];
+
+/**
+ * The module parameters that configure a log sink. A module that uses a log
+ * sink declares these parameters with the default values below and reads
+ * them with logsink_config_get().
+ */
+#define LOGSINK_PARAM_BUFFER_SIZE    "log_buffer_size"
+#define LOGSINK_PARAM_BATCH_SIZE     "log_batch_size"
+#define LOGSINK_PARAM_FLUSH_INTERVAL "log_flush_interval"
+#define LOGSINK_PARAM_POLICY         "log_full_policy"
+
+#define LOGSINK_DEFAULT_BUFFER_SIZE    "1Mi"
+#define LOGSINK_DEFAULT_BATCH_SIZE     "64Ki"
+#define LOGSINK_DEFAULT_FLUSH_INTERVAL "1000"
+#define LOGSINK_DEFAULT_POLICY         "block"
+
+/** Log sink configuration */
+typedef struct logsink_config
+{
+    size_t           buffer_size;    /**< Size of the buffer of each thread */
+    size_t           batch_size;     /**< Buffered bytes that wake up the writer */
+    int              flush_interval; /**< Milliseconds between writes, 0 writes immediately */
+    logsink_policy_t policy;         /**< What to do when a buffer is full */
+} LOGSINK_CONFIG;
+
+/** Log sink statistics */
+typedef struct logsink_stats
+{
+    uint64_t records; /**< Records added */
+    uint64_t bytes;   /**< Bytes added */
+    uint64_t dropped; /**< Records dropped because a buffer was full */
+    uint64_t blocked; /**< Times a thread had to write the buffered records itself */
+    uint64_t writes;  /**< Write system calls done */
+    uint64_t errors;  /**< Failed writes */
+} LOGSINK_STATS;
+
+typedef struct logsink LOGSINK;
+
+/**
+ * @brief Read the log sink configuration from module parameters
+ *
+ * @param params Module parameters that contain the LOGSINK_PARAM_ parameters
+ * @param config The configuration to fill
+ */
+void logsink_config_get(const MXS_CONFIG_PARAMETER *params, LOGSINK_CONFIG *config);
+
+/**
+ * @brief Open a log sink
+ *
+ * @param filename The file to write to
+ * @param append   If true, the records are appended to an existing file.
+ *                 Otherwise the file is truncated.
+ * @param config   The log sink configuration
+ *
+ * @return The log sink or NULL if the file could not be opened
+ */
+LOGSINK* logsink_open(const char *filename, bool append, const LOGSINK_CONFIG *config);
+
+/**
+ * @brief Close a log sink
+ *
+ * The buffered records are written and the file is closed by the background
+ * thread. The log sink must not be used after this call.
+ *
+ * @param sink The log sink to close
+ */
+void logsink_close(LOGSINK *sink);
+
+/**
+ * @brief Add a record to a log sink
+ *
+ * @param sink The log sink
+ * @param data The record
+ * @param len  Length of the record
+ *
+ * @return True if the record was added, false if it was dropped or
+ *         writing it failed
+ */
+bool logsink_write(LOGSINK *sink, const char *data, size_t len);
+
+/**
+ * @brief Add a formatted record to a log sink
+ *
+ * @param sink   The log sink
+ * @param format Printf format string
+ *
+ * @return True if the record was added
+ *
+ * @see logsink_write
+ */
+bool logsink_printf(LOGSINK *sink, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Write all buffered records of a log sink
+ *
+ * The calling thread writes the records that have been added to the log sink
+ * before this call.
+ *
+ * @param sink The log sink
+ *
+ * @return True if the records were written
+ */
+bool logsink_flush(LOGSINK *sink);
+
+/**
+ * @brief Discard the contents of a log sink
+ *
+ * The buffered records are discarded and the file is truncated.
+ *
+ * @param sink The log sink
+ *
+ * @return True if the file was truncated
+ */
+bool logsink_truncate(LOGSINK *sink);
+
+/**
+ * @brief Get log sink statistics
+ *
+ * @param sink  The log sink
+ * @param stats The statistics to fill
+ */
+void logsink_get_stats(LOGSINK *sink, LOGSINK_STATS *stats);
+
+/**
+ * @brief Print log sink diagnostics
+ *
+ * @param sink The log sink
+ * @param dcb  DCB where the diagnostics are printed
+ */
+void logsink_diagnostics(LOGSINK *sink, DCB *dcb);
+
+MXS_END_DECLS
@@ -138,6 +138,10 @@ typedef struct monitor_servers
     int mon_err_count;
     unsigned int mon_prev_status;
     unsigned int pending_status;  /**< Pending Status flag bitmap */
+    uint64_t probe_last;          /**< Duration of the latest probe in microseconds */
+    uint64_t probe_max;           /**< Duration of the slowest probe in microseconds */
+    uint64_t probe_total;         /**< Total duration of all probes in microseconds */
+    uint64_t probe_count;         /**< Number of probes */
     struct monitor_servers *next; /**< The next server in the list */
 } MXS_MONITOR_SERVERS;
 
@@ -222,6 +226,23 @@ void mon_log_connect_error(MXS_MONITOR_SERVERS* database, mxs_connect_result_t r
 void lock_monitor_servers(MXS_MONITOR *monitor);
 void release_monitor_servers(MXS_MONITOR *monitor);
 
+/** Function that probes a single monitored server */
+typedef void (*mxs_monitor_probe_t)(MXS_MONITOR *monitor, MXS_MONITOR_SERVERS *database);
+
+/**
+ * @brief Probe all monitored servers concurrently
+ *
+ * Each server is probed in a thread of its own, so that the duration of the
+ * round is that of the slowest probe instead of the sum of all of them. The
+ * function returns when all servers have been probed. The probe function must
+ * only modify the state of the server it is given. The duration of each probe
+ * is recorded in the monitored server.
+ *
+ * @param monitor Monitor object
+ * @param probe   Function called for each monitored server
+ */
+void mon_probe_servers(MXS_MONITOR *monitor, mxs_monitor_probe_t probe);
+
 /**
  * @brief Handle state change events
  *
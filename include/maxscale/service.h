@@ -73,6 +73,7 @@ typedef struct
 {
     int nloads;
     time_t last;
+    int pending;  /**< Non-zero if an asynchronous refresh has been scheduled */
 } SERVICE_REFRESH_RATE;
 
 typedef struct server_ref_t
@@ -262,6 +263,7 @@ int   serviceEnableLocalhostMatchWildcardHost(SERVICE *service, int action);
 int   serviceStripDbEsc(SERVICE* service, int action);
 int   serviceAuthAllServers(SERVICE *service, int action);
 int   service_refresh_users(SERVICE *service);
+void  service_refresh_users_async(SERVICE *service);
 
 /**
  * Diagnostics
@@ -20,6 +20,8 @@
 
 #include <maxscale/cdefs.h>
 #include <maxscale/protocol.h>
+#include <maxscale/spinlock.h>
+#include <time.h>
 #include <openssl/crypto.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
@@ -48,6 +50,29 @@ typedef enum ssl_method_type
 #define SSL_ERROR_CLIENT_NOT_SSL 1
 #define SSL_ERROR_ACCEPT_FAILED 2
 
+/** The number of sessions kept in the session cache of a listener */
+#define SSL_SESSION_CACHE_SIZE 20480
+
+/** How long a session can be resumed, in seconds */
+#define SSL_SESSION_TIMEOUT 3600
+
+/** How long a session ticket key is used for new tickets, in seconds */
+#define SSL_TICKET_KEY_LIFETIME 3600
+
+/** The number of session ticket keys that are accepted, including the current one */
+#define SSL_TICKET_KEYS 2
+
+/**
+ * A key used for encrypting and authenticating session tickets
+ */
+typedef struct ssl_ticket_key
+{
+    unsigned char name[16];             /*< Name of the key, stored in the tickets */
+    unsigned char aes_key[32];          /*< Key for encrypting the tickets */
+    unsigned char hmac_key[32];         /*< Key for authenticating the tickets */
+    time_t created;                     /*< When the key was created, 0 if unused */
+} SSL_TICKET_KEY;
+
 /**
  * The ssl_listener structure is used to aggregate the SSL configuration items
  * and data for a particular listener
@@ -63,6 +88,12 @@ typedef struct ssl_listener
     char *ssl_key;                      /*< SSL private key */
     char *ssl_ca_cert;                  /*< SSL CA certificate */
     bool ssl_init_done;                 /*< If SSL has already been initialized for this service */
+    SPINLOCK lock;                      /*< Protects the session and the ticket keys */
+    SSL_SESSION *session;               /*< Latest session with a server, resumed by new connections */
+    SSL_TICKET_KEY ticket_keys[SSL_TICKET_KEYS]; /*< Session ticket keys, the current one first */
+    int64_t n_full_handshakes;          /*< Number of full handshakes */
+    int64_t n_resumed_handshakes;       /*< Number of handshakes that resumed a session */
+    int64_t handshake_time;             /*< Total time spent in handshakes, in microseconds */
     struct ssl_listener
         *next;          /*< Next SSL configuration, currently used to store obsolete configurations */
 } SSL_LISTENER;
@@ -74,4 +105,34 @@ bool ssl_required_by_dcb(struct dcb *dcb);
 bool ssl_required_but_not_negotiated(struct dcb *dcb);
 const char* ssl_method_type_to_string(ssl_method_type_t method_type);
 
+/**
+ * @brief Called when the SSL handshake of a DCB is started
+ *
+ * Stores the start time of the handshake. For connections to servers, the
+ * latest session with the server is offered for resumption.
+ *
+ * @param dcb DCB whose SSL structure has just been created
+ * @param ssl SSL configuration of the listener or the server
+ */
+void ssl_handshake_started(struct dcb *dcb, SSL_LISTENER *ssl);
+
+/**
+ * @brief Called when the SSL handshake of a DCB has been completed
+ *
+ * Updates the handshake statistics. For connections to servers, the session
+ * is stored so that the next connection to the same server can resume it.
+ *
+ * @param dcb DCB whose handshake was completed
+ * @param ssl SSL configuration of the listener or the server
+ */
+void ssl_handshake_completed(struct dcb *dcb, SSL_LISTENER *ssl);
+
+/**
+ * @brief Print the handshake statistics of an SSL configuration
+ *
+ * @param dcb DCB where the statistics are printed
+ * @param ssl SSL configuration of a listener or a server
+ */
+void ssl_print_handshake_stats(struct dcb *dcb, const SSL_LISTENER *ssl);
+
 MXS_END_DECLS
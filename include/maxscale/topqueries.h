@@ -0,0 +1,112 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file topqueries.h - Service-wide statistics of the heaviest statements
+ *
+ * The statistics are kept per canonical statement in fixed-size tables, one
+ * for each worker thread. Each table holds at most a configured number of
+ * statements and uses the space-saving algorithm to decide which statement
+ * is replaced when a new one arrives: the statement with the smallest count
+ * is replaced and the new statement inherits its count. This keeps the most
+ * frequent statements in the table while the memory use stays fixed.
+ *
+ * A worker thread only updates its own table so the threads do not contend.
+ * The tables are merged when the statistics are read.
+ *
+ * Every set of statistics is registered with a name and all of them can be
+ * listed with maxinfo.
+ */
+
+#include <maxscale/cdefs.h>
+
+MXS_BEGIN_DECLS
+
+typedef struct top_queries TOP_QUERIES;
+
+/** The statistics of one canonical statement */
+typedef struct top_query
+{
+    char    *canonical; /**< The canonical form of the statement */
+    uint64_t count;     /**< Number of executions, an upper bound */
+    uint64_t error;     /**< How much the count may be overestimated */
+    uint64_t samples;   /**< Executions whose durations are included below */
+    uint64_t total;     /**< Total duration in microseconds */
+    uint64_t max;       /**< Longest duration in microseconds */
+    uint64_t p50;       /**< Median duration in microseconds */
+    uint64_t p95;       /**< 95th percentile of the durations in microseconds */
+    uint64_t p99;       /**< 99th percentile of the durations in microseconds */
+} TOP_QUERY;
+
+/**
+ * @brief Create statement statistics
+ *
+ * @param name     The name of the statistics, e.g. the name of a filter
+ * @param size     The number of statements that are reported
+ * @param capacity The number of statements each thread keeps
+ *
+ * @return The statistics or NULL if the size or the capacity is less than one
+ *         or memory allocation failed
+ */
+TOP_QUERIES* top_queries_create(const char *name, int size, int capacity);
+
+/**
+ * @brief Destroy statement statistics
+ *
+ * @param top The statistics to destroy
+ */
+void top_queries_destroy(TOP_QUERIES *top);
+
+/**
+ * @brief Add an execution of a statement
+ *
+ * @param top       The statistics
+ * @param thread_id The ID of the calling worker thread
+ * @param canonical The canonical form of the statement
+ * @param duration  The duration of the execution in microseconds
+ */
+void top_queries_add(TOP_QUERIES *top, int thread_id, const char *canonical, uint64_t duration);
+
+/**
+ * @brief Get the heaviest statements
+ *
+ * The statistics of all threads are merged and the statements with the
+ * largest total duration are returned.
+ *
+ * @param top    The statistics
+ * @param result Pointer where the array of statements is stored. The array
+ *               is freed with top_queries_free_result().
+ *
+ * @return Number of statements in the array, -1 if memory allocation failed
+ */
+int top_queries_get(TOP_QUERIES *top, TOP_QUERY **result);
+
+/**
+ * @brief Free the statements returned by top_queries_get()
+ *
+ * @param result The statements
+ * @param n      Number of statements
+ */
+void top_queries_free_result(TOP_QUERY *result, int n);
+
+/**
+ * @brief Get the name of statement statistics
+ *
+ * @param top The statistics
+ *
+ * @return The name given to top_queries_create()
+ */
+const char* top_queries_get_name(const TOP_QUERIES *top);
+
+MXS_END_DECLS
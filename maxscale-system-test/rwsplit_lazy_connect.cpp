@@ -0,0 +1,126 @@
+/**
+ * @file rwsplit_lazy_connect.cpp Test of the lazy_connect and backend_idle_timeout parameters of readwritesplit
+ *
+ * - connect to readwritesplit and check that no slaves are connected
+ * - execute a session command and a read, check that one slave is connected
+ *   and that the session command history was executed on it
+ * - execute more session commands, wait for the slave to become idle and
+ *   check that it is closed
+ * - read the session variables and check that the slave is connected again
+ *   and that the read waited for the whole history to be executed
+ * - check that idle slaves are not closed inside a transaction
+ * - with disable_sescmd_history=true, check that the slave is not closed
+ *   after a session command and that it keeps the session state
+ */
+
+
+#include <iostream>
+#include "testconnections.h"
+
+using namespace std;
+
+/** Value of backend_idle_timeout in the configuration */
+#define IDLE_TIMEOUT 3
+
+int slave_connections(TestConnections* Test)
+{
+    int total = 0;
+
+    for (int i = 1; i < Test->repl->N; i++)
+    {
+        total += get_conn_num(Test->repl->nodes[i], Test->maxscale_ip(),
+                              Test->maxscale_hostname, (char *) "lazy_test");
+    }
+
+    return total;
+}
+
+void check_slaves(TestConnections* Test, int expected, const char* message)
+{
+    sleep(1);
+    int n = slave_connections(Test);
+    Test->add_result(n != expected, "%s: expected %d slave connections, found %d\n",
+                     message, expected, n);
+}
+
+int main(int argc, char *argv[])
+{
+    TestConnections * Test = new TestConnections(argc, argv);
+    Test->set_timeout(60);
+
+    Test->repl->connect();
+    execute_query(Test->repl->nodes[0], "DROP DATABASE IF EXISTS lazy_test");
+    execute_query(Test->repl->nodes[0], "CREATE DATABASE lazy_test");
+    Test->repl->sync_slaves();
+
+    Test->tprintf("Connecting to readwritesplit with the session command history\n");
+    MYSQL* conn = open_conn_db(Test->rwsplit_port, Test->maxscale_IP, "lazy_test",
+                               Test->maxscale_user, Test->maxscale_password, Test->ssl);
+    Test->add_result(conn == NULL || mysql_errno(conn) != 0, "Connection should succeed\n");
+    check_slaves(Test, 0, "New session");
+
+    Test->try_query(conn, "SET @a = 1");
+    Test->add_result(execute_query_check_one(conn, "SELECT @a", "1"),
+                     "Session command history should be executed on a lazily connected slave\n");
+    check_slaves(Test, 1, "After the first read");
+
+    Test->tprintf("Executing session commands and waiting for the slave to become idle\n");
+    for (int i = 0; i < 100; i++)
+    {
+        Test->try_query(conn, "SET @b = %d", i);
+    }
+
+    Test->stop_timeout();
+    sleep(IDLE_TIMEOUT + 2);
+    Test->set_timeout(60);
+
+    /** Idle slaves are closed when the next statement is routed */
+    Test->try_query(conn, "SET @c = 3");
+    check_slaves(Test, 0, "After the idle timeout");
+
+    Test->add_result(execute_query_check_one(conn, "SELECT CONCAT(@a, @b, @c)", "1993"),
+                     "The read should be routed after the history is executed on the reconnected slave\n");
+    check_slaves(Test, 1, "After reading from a reconnected slave");
+
+    Test->tprintf("Checking that slaves are not closed inside a transaction\n");
+    Test->try_query(conn, "START TRANSACTION");
+    Test->try_query(conn, "SELECT 1");
+    Test->stop_timeout();
+    sleep(IDLE_TIMEOUT + 2);
+    Test->set_timeout(60);
+    Test->try_query(conn, "SELECT 2");
+    check_slaves(Test, 1, "Inside a transaction");
+    Test->try_query(conn, "COMMIT");
+    mysql_close(conn);
+    sleep(1);
+
+    Test->tprintf("Connecting to readwritesplit without the session command history\n");
+    conn = open_conn_db(Test->readconn_master_port, Test->maxscale_IP, "lazy_test",
+                        Test->maxscale_user, Test->maxscale_password, Test->ssl);
+    Test->add_result(conn == NULL || mysql_errno(conn) != 0, "Connection should succeed\n");
+    check_slaves(Test, 0, "New session without history");
+
+    Test->add_result(execute_query_check_one(conn, "SELECT 1", "1"), "Read should succeed\n");
+    check_slaves(Test, 1, "After the first read without history");
+
+    Test->try_query(conn, "SET @d = 4");
+    Test->stop_timeout();
+    sleep(IDLE_TIMEOUT + 2);
+    Test->set_timeout(60);
+
+    Test->add_result(execute_query_check_one(conn, "SELECT @d", "4"),
+                     "The slave should keep the session state when the history is disabled\n");
+    check_slaves(Test, 1, "After the idle timeout without history");
+    mysql_close(conn);
+
+    execute_query(Test->repl->nodes[0], "DROP DATABASE IF EXISTS lazy_test");
+    Test->tprintf("Checking that MaxScale is alive\n");
+    conn = open_conn(Test->rwsplit_port, Test->maxscale_IP, Test->maxscale_user,
+                     Test->maxscale_password, Test->ssl);
+    Test->try_query(conn, "SELECT 1");
+    mysql_close(conn);
+
+    int rval = Test->global_result;
+    delete Test;
+    return rval;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file schemarouter_lazy_connect.cpp Test of the lazy_connect and backend_idle_timeout parameters of schemarouter
+ *
+ * - stop all slaves and create the database lazy_db%d on node %d
+ * - restart MaxScale and wait for the shared shard map to be loaded
+ * - connect with lazy_db0 as the default database and check that only node 0 is connected
+ * - execute a session command and read from lazy_db1, check that node 1 is
+ *   connected and that the session command history was executed on it
+ * - wait for node 1 to become idle and check that it is closed but node 0 is not
+ * - read from lazy_db1 again and check that the history is executed on the
+ *   reconnected server
+ * - check that idle servers are not closed inside a transaction and that the
+ *   transaction is committed on them
+ * - with disable_sescmd_history=true, check that all servers are connected by
+ *   the first session command and that nothing is closed after it
+ */
+
+
+#include <iostream>
+#include "testconnections.h"
+
+using namespace std;
+
+/** Value of backend_idle_timeout in the configuration */
+#define IDLE_TIMEOUT 3
+
+int connections(TestConnections* Test, int node)
+{
+    char query[1024 + 256];
+    char value[100] = "-1";
+
+    sprintf(query, "SELECT COUNT(*) AS c FROM information_schema.processlist WHERE user = '%s' "
+            "AND (host LIKE '%s:%%' OR host LIKE '%s:%%') AND id <> CONNECTION_ID()",
+            Test->maxscale_user, Test->maxscale_ip(), Test->maxscale_hostname);
+    find_field(Test->repl->nodes[node], query, "c", value);
+
+    return atoi(value);
+}
+
+/**
+ * Check the number of client connections MaxScale has to each node
+ *
+ * @param expected String of '0' and '1' characters, one for each node
+ */
+void check_connections(TestConnections* Test, const char* expected, const char* message)
+{
+    sleep(1);
+
+    for (int i = 0; i < Test->repl->N && expected[i]; i++)
+    {
+        int n = connections(Test, i);
+        Test->add_result(n != expected[i] - '0', "%s: expected %c connections to node %d, found %d\n",
+                         message, expected[i], i, n);
+    }
+}
+
+void wait_idle_timeout(TestConnections* Test)
+{
+    Test->stop_timeout();
+    sleep(IDLE_TIMEOUT + 2);
+    Test->set_timeout(60);
+}
+
+int main(int argc, char *argv[])
+{
+    TestConnections * Test = new TestConnections(argc, argv);
+    Test->set_timeout(60);
+
+    Test->repl->stop_slaves();
+    Test->repl->connect();
+
+    for (int i = 0; i < Test->repl->N; i++)
+    {
+        execute_query(Test->repl->nodes[i], "DROP DATABASE IF EXISTS lazy_db%d", i);
+        execute_query(Test->repl->nodes[i], "CREATE DATABASE lazy_db%d", i);
+        execute_query(Test->repl->nodes[i], "CREATE TABLE lazy_db%d.t1 (id INT)", i);
+        execute_query(Test->repl->nodes[i], "INSERT INTO lazy_db%d.t1 VALUES (1)", i);
+    }
+
+    Test->restart_maxscale();
+
+    /** The shared shard map is loaded in the background */
+    Test->stop_timeout();
+    sleep(10);
+    Test->set_timeout(60);
+
+    Test->tprintf("Connecting to schemarouter with the session command history\n");
+    MYSQL* conn = open_conn_db(Test->rwsplit_port, Test->maxscale_IP, "lazy_db0",
+                               Test->maxscale_user, Test->maxscale_password, Test->ssl);
+    Test->add_result(conn == NULL || mysql_errno(conn) != 0, "Connection should succeed\n");
+    check_connections(Test, "1000", "New session");
+
+    Test->try_query(conn, "SET @a = 1");
+    Test->add_result(execute_query_check_one(conn, "SELECT @a FROM lazy_db1.t1", "1"),
+                     "Session command history should be executed on a lazily connected server\n");
+    check_connections(Test, "1100", "After reading from lazy_db1");
+
+    wait_idle_timeout(Test);
+
+    /** Idle servers are closed when the next query is routed */
+    Test->try_query(conn, "SELECT id FROM lazy_db0.t1");
+    check_connections(Test, "1000", "After the idle timeout");
+
+    Test->add_result(execute_query_check_one(conn, "SELECT @a FROM lazy_db1.t1", "1"),
+                     "Session command history should be executed on a reconnected server\n");
+    check_connections(Test, "1100", "After reading from a reconnected server");
+
+    Test->tprintf("Checking that servers are not closed inside a transaction\n");
+    Test->try_query(conn, "START TRANSACTION");
+    Test->try_query(conn, "INSERT INTO lazy_db1.t1 VALUES (2)");
+    wait_idle_timeout(Test);
+    Test->try_query(conn, "SELECT id FROM lazy_db0.t1");
+    check_connections(Test, "1100", "Inside a transaction");
+    Test->try_query(conn, "COMMIT");
+    Test->add_result(execute_query_check_one(Test->repl->nodes[1], "SELECT COUNT(*) FROM lazy_db1.t1", "2"),
+                     "The transaction should be committed on node 1\n");
+    mysql_close(conn);
+    sleep(1);
+
+    Test->tprintf("Connecting to schemarouter without the session command history\n");
+    conn = open_conn_db(Test->readconn_master_port, Test->maxscale_IP, "lazy_db0",
+                        Test->maxscale_user, Test->maxscale_password, Test->ssl);
+    Test->add_result(conn == NULL || mysql_errno(conn) != 0, "Connection should succeed\n");
+    check_connections(Test, "1000", "New session without history");
+
+    Test->add_result(execute_query_check_one(conn, "SELECT id FROM lazy_db1.t1 WHERE id = 1", "1"),
+                     "Read should succeed\n");
+    check_connections(Test, "1100", "After reading from lazy_db1 without history");
+
+    /** The first session command connects the remaining servers */
+    Test->try_query(conn, "SET @b = 2");
+    check_connections(Test, "1111", "After the first session command");
+
+    wait_idle_timeout(Test);
+    Test->add_result(execute_query_check_one(conn, "SELECT @b FROM lazy_db2.t1", "2"),
+                     "The session state should be kept when the history is disabled\n");
+    check_connections(Test, "1111", "After the idle timeout without history");
+    mysql_close(conn);
+
+    for (int i = 0; i < Test->repl->N; i++)
+    {
+        execute_query(Test->repl->nodes[i], "DROP DATABASE IF EXISTS lazy_db%d", i);
+    }
+
+    Test->tprintf("Checking that MaxScale is alive\n");
+    conn = open_conn(Test->rwsplit_port, Test->maxscale_IP, Test->maxscale_user,
+                     Test->maxscale_password, Test->ssl);
+    Test->try_query(conn, "SELECT 1");
+    mysql_close(conn);
+
+    int rval = Test->global_result;
+    delete Test;
+    return rval;
+}
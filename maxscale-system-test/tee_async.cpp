@@ -0,0 +1,117 @@
+/**
+ * @file tee_async.cpp Test of the async mode of the tee filter
+ *
+ * - stop all slaves and create the table tee_db.t1 on node 0 and node 1, the
+ *   tee filters route to node 0 and mirror the statements to node 1
+ * - insert rows through the async tee filter and keep the connection open,
+ *   check that all copies are executed on node 1 without further client
+ *   activity and that the queue of the filter is empty
+ * - insert rows and close the connection at once, check that the copies that
+ *   were still queued are executed on node 1
+ * - insert rows through a tee filter with queue_size=0 and async=false and
+ *   check that they are mirrored
+ */
+
+
+#include <iostream>
+#include "testconnections.h"
+
+using namespace std;
+
+/** Number of rows inserted by each step of the test */
+#define N_ROWS 500
+
+int count_rows(TestConnections* Test, int node)
+{
+    char value[100] = "-1";
+    find_field(Test->repl->nodes[node], "SELECT COUNT(*) AS c FROM tee_db.t1", "c", value);
+    return atoi(value);
+}
+
+void check_rows(TestConnections* Test, int expected, const char* message)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        int n = count_rows(Test, i);
+        Test->add_result(n != expected, "%s: expected %d rows on node %d, found %d\n",
+                         message, expected, i, n);
+    }
+}
+
+void insert_rows(TestConnections* Test, MYSQL* conn)
+{
+    for (int i = 0; i < N_ROWS; i++)
+    {
+        Test->try_query(conn, "INSERT INTO tee_db.t1 VALUES (%d)", i);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    TestConnections * Test = new TestConnections(argc, argv);
+    Test->set_timeout(120);
+
+    Test->repl->stop_slaves();
+    Test->repl->connect();
+
+    for (int i = 0; i < 2; i++)
+    {
+        execute_query(Test->repl->nodes[i], "DROP DATABASE IF EXISTS tee_db");
+        execute_query(Test->repl->nodes[i], "CREATE DATABASE tee_db");
+        execute_query(Test->repl->nodes[i], "CREATE TABLE tee_db.t1 (id INT)");
+    }
+
+    Test->tprintf("Inserting rows through the async tee filter\n");
+    MYSQL* conn = open_conn_db(Test->rwsplit_port, Test->maxscale_IP, "tee_db",
+                               Test->maxscale_user, Test->maxscale_password, Test->ssl);
+    Test->add_result(conn == NULL || mysql_errno(conn) != 0, "Connection should succeed\n");
+    insert_rows(Test, conn);
+
+    /** The queue is drained by the replies of the mirror, not by the client */
+    Test->stop_timeout();
+    sleep(5);
+    Test->set_timeout(120);
+    check_rows(Test, N_ROWS, "With an idle client");
+
+    char result[1024] = "";
+    Test->get_maxadmin_param((char *) "show filter AsyncTee", (char *) "No. of queued statements:", result);
+    Test->add_result(atoi(result) != 0, "No statements should be queued, found: %s\n", result);
+    Test->get_maxadmin_param((char *) "show filter AsyncTee", (char *) "Current lag:", result);
+    Test->add_result(atoi(result) != 0, "Lag should be zero, found: %s\n", result);
+
+    Test->tprintf("Closing the connection while copies are queued\n");
+    insert_rows(Test, conn);
+    mysql_close(conn);
+
+    Test->stop_timeout();
+    sleep(5);
+    Test->set_timeout(120);
+    check_rows(Test, 2 * N_ROWS, "After closing the connection");
+
+    Test->tprintf("Inserting rows through the tee filter with queue_size=0\n");
+    conn = open_conn_db(Test->readconn_master_port, Test->maxscale_IP, "tee_db",
+                        Test->maxscale_user, Test->maxscale_password, Test->ssl);
+    Test->add_result(conn == NULL || mysql_errno(conn) != 0, "Connection should succeed\n");
+    insert_rows(Test, conn);
+    mysql_close(conn);
+
+    Test->stop_timeout();
+    sleep(2);
+    Test->set_timeout(120);
+    check_rows(Test, 3 * N_ROWS, "Without async");
+
+    for (int i = 0; i < 2; i++)
+    {
+        execute_query(Test->repl->nodes[i], "DROP DATABASE IF EXISTS tee_db");
+    }
+
+    Test->tprintf("Checking that MaxScale is alive\n");
+    conn = open_conn(Test->rwsplit_port, Test->maxscale_IP, Test->maxscale_user,
+                     Test->maxscale_password, Test->ssl);
+    Test->try_query(conn, "SELECT 1");
+    mysql_close(conn);
+
+    int rval = Test->global_result;
+    delete Test;
+    return rval;
+}
@@ -154,6 +154,7 @@ static const char *listener_params[] =
     "ssl_key",
     "ssl_version",
     "ssl_cert_verify_depth",
+    "reuseport",
     NULL
 };
 
@@ -954,7 +955,11 @@ int config_get_integer(const MXS_CONFIG_PARAMETER *params, const char *key)
 
 uint64_t config_get_size(const MXS_CONFIG_PARAMETER *params, const char *key)
 {
-    const char *value = config_get_value_string(params, key);
+    return config_parse_size(config_get_value_string(params, key));
+}
+
+uint64_t config_parse_size(const char *value)
+{
     char *end;
     uint64_t size = strtoll(value, &end, 10);
 
@@ -1402,6 +1407,12 @@ free_ssl_structure(SSL_LISTENER *ssl)
     if (ssl)
     {
         SSL_CTX_free(ssl->ctx);
+
+        if (ssl->session)
+        {
+            SSL_SESSION_free(ssl->session);
+        }
+
         MXS_FREE(ssl->ssl_key);
         MXS_FREE(ssl->ssl_cert);
         MXS_FREE(ssl->ssl_ca_cert);
@@ -3060,6 +3071,7 @@ int create_new_listener(CONFIG_CONTEXT *obj)
     char *socket = config_get_value(obj->parameters, "socket");
     char *authenticator = config_get_value(obj->parameters, "authenticator");
     char *authenticator_options = config_get_value(obj->parameters, "authenticator_options");
+    char *reuseport = config_get_value(obj->parameters, "reuseport");
 
     if (service_name && protocol && (socket || port))
     {
@@ -3094,8 +3106,14 @@ int create_new_listener(CONFIG_CONTEXT *obj)
                 }
                 else
                 {
-                    serviceCreateListener(service, obj->object, protocol, address, atoi(port),
-                                          authenticator, authenticator_options, ssl_info);
+                    SERV_LISTENER *listener = serviceCreateListener(service, obj->object, protocol,
+                                                                    address, atoi(port), authenticator,
+                                                                    authenticator_options, ssl_info);
+
+                    if (listener && reuseport)
+                    {
+                        listener->reuseport = config_truth_value(reuseport);
+                    }
                 }
             }
 
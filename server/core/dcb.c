@@ -94,6 +94,7 @@
 #include <maxscale/utils.h>
 #include <maxscale/platform.h>
 
+#include "maxscale/poll.h"
 #include "maxscale/session.h"
 #include "maxscale/modules.h"
 #include "maxscale/queuemanager.h"
@@ -153,7 +154,8 @@ static int gw_write(DCB *dcb, GWBUF *writeq, bool *stop_writing);
 static int gw_write_SSL(DCB *dcb, GWBUF *writeq, bool *stop_writing);
 static int dcb_log_errors_SSL (DCB *dcb, const char *called_by, int ret);
 static int dcb_accept_one_connection(DCB *listener, struct sockaddr *client_conn);
-static int dcb_listen_create_socket_inet(const char *host, uint16_t port);
+static int dcb_listen_create_socket_inet(const char *host, uint16_t port, bool reuseport);
+static int *dcb_listen_create_thread_sockets(int first, const char *host, uint16_t port);
 static int dcb_listen_create_socket_unix(const char *path);
 static int dcb_set_socket_option(int sockfd, int level, int optname, void *optval, socklen_t optlen);
 static void dcb_add_to_all_list(DCB *dcb);
@@ -416,6 +418,8 @@ dcb_free_all_memory(DCB *dcb)
         SSL_free(dcb->ssl);
     }
 
+    MXS_FREE(dcb->listener_fds);
+
     /* We never free the actual DCB, it is available for reuse*/
     MXS_FREE(dcb);
 
@@ -531,6 +535,15 @@ dcb_process_victim_queue(int threadid)
             atomic_add(&dcb->server->stats.n_current, -1);
         }
 
+        if (dcb->listener_fds)
+        {
+            /** The first one is the same as dcb->fd */
+            for (int i = 1; i < config_threadcount(); i++)
+            {
+                close(dcb->listener_fds[i]);
+            }
+        }
+
         if (dcb->fd > 0)
         {
             /*<
@@ -2639,6 +2652,8 @@ dcb_create_SSL(DCB* dcb, SSL_LISTENER *ssl)
         return -1;
     }
 
+    ssl_handshake_started(dcb, ssl);
+
     return 0;
 }
 
@@ -2672,6 +2687,7 @@ int dcb_accept_SSL(DCB* dcb)
         MXS_DEBUG("SSL_accept done for %s@%s", user, remote);
         dcb->ssl_state = SSL_ESTABLISHED;
         dcb->ssl_read_want_write = false;
+        ssl_handshake_completed(dcb, dcb->listener->ssl);
         return 1;
 
     case SSL_ERROR_WANT_READ:
@@ -2746,6 +2762,7 @@ int dcb_connect_SSL(DCB* dcb)
         MXS_DEBUG("SSL_connect done for %s", dcb->remote);
         dcb->ssl_state = SSL_ESTABLISHED;
         dcb->ssl_read_want_write = false;
+        ssl_handshake_completed(dcb, dcb->server->server_ssl);
         return_code = 1;
         break;
 
@@ -2818,35 +2835,18 @@ dcb_accept(DCB *listener)
     DCB *client_dcb = NULL;
     MXS_PROTOCOL *protocol_funcs = &listener->func;
     int c_sock;
-    int sendbuf;
     struct sockaddr_storage client_conn;
-    socklen_t optlen = sizeof(sendbuf);
-    char errbuf[MXS_STRERROR_BUFLEN];
 
     if ((c_sock = dcb_accept_one_connection(listener, (struct sockaddr *)&client_conn)) >= 0)
     {
         listener->stats.n_accepts++;
+        poll_count_accept();
         MXS_DEBUG("%lu [gw_MySQLAccept] Accepted fd %d.",
                   pthread_self(),
                   c_sock);
-        /* set nonblocking  */
-        sendbuf = MXS_CLIENT_SO_SNDBUF;
-
-        if (setsockopt(c_sock, SOL_SOCKET, SO_SNDBUF, &sendbuf, optlen) != 0)
-        {
-            MXS_ERROR("Failed to set socket options. Error %d: %s",
-                      errno, strerror_r(errno, errbuf, sizeof(errbuf)));
-        }
-
-        sendbuf = MXS_CLIENT_SO_RCVBUF;
-
-        if (setsockopt(c_sock, SOL_SOCKET, SO_RCVBUF, &sendbuf, optlen) != 0)
-        {
-            MXS_ERROR("Failed to set socket options. Error %d: %s",
-                      errno, strerror_r(errno, errbuf, sizeof(errbuf)));
-        }
-        setnonblocking(c_sock);
 
+        /** The socket is non-blocking and the buffer sizes are inherited
+         * from the listener socket */
         client_dcb = dcb_alloc(DCB_ROLE_CLIENT_HANDLER, listener->listener);
 
         if (client_dcb == NULL)
@@ -2958,6 +2958,7 @@ static int
 dcb_accept_one_connection(DCB *listener, struct sockaddr *client_conn)
 {
     int c_sock;
+    int fd = listener->listener_fds ? listener->listener_fds[poll_current_thread_id()] : listener->fd;
 
     /* Try up to 10 times to get a file descriptor by use of accept */
     for (int i = 0; i < 10; i++)
@@ -2966,9 +2967,7 @@ dcb_accept_one_connection(DCB *listener, struct sockaddr *client_conn)
         int eno = 0;
 
         /* new connection from client */
-        c_sock = accept(listener->fd,
-                        client_conn,
-                        &client_len);
+        c_sock = accept4(fd, client_conn, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
         eno = errno;
         errno = 0;
 
@@ -3059,14 +3058,25 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
     }
 
     int listener_socket = -1;
+    bool reuseport = listener->listener && listener->listener->reuseport;
+
+#ifndef SO_REUSEPORT
+    if (reuseport)
+    {
+        MXS_WARNING("SO_REUSEPORT is not supported, listening on '[%s]:%u' "
+                    "with a single socket.", host, port);
+        reuseport = false;
+    }
+#endif
 
     if (strchr(host, '/'))
     {
         listener_socket = dcb_listen_create_socket_unix(host);
+        reuseport = false;
     }
     else if (port > 0)
     {
-        listener_socket = dcb_listen_create_socket_inet(host, port);
+        listener_socket = dcb_listen_create_socket_inet(host, port, reuseport);
 
         if (listener_socket == -1 && strcmp(host, "::") == 0)
         {
@@ -3074,7 +3084,7 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
             MXS_WARNING("Failed to bind on default IPv6 host '::', attempting "
                         "to bind on IPv4 version '0.0.0.0'");
             strcpy(host, "0.0.0.0");
-            listener_socket = dcb_listen_create_socket_inet(host, port);
+            listener_socket = dcb_listen_create_socket_inet(host, port, reuseport);
         }
     }
     else
@@ -3104,6 +3114,19 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
         return -1;
     }
 
+    if (reuseport)
+    {
+        if ((listener->listener_fds = dcb_listen_create_thread_sockets(listener_socket, host, port)))
+        {
+            MXS_NOTICE("Listening at [%s]:%u with a socket for each thread.", host, port);
+        }
+        else
+        {
+            MXS_WARNING("Failed to create a socket for each thread, listening "
+                        "at [%s]:%u with a single socket.", host, port);
+        }
+    }
+
     MXS_NOTICE("Listening for connections at [%s]:%u with protocol %s", host, port, protocol_name);
 
     // assign listener_socket to dcb
@@ -3122,15 +3145,27 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
 /**
  * @brief Create a network listener socket
  *
- * @param host The network address to listen on
- * @param port The port to listen on
+ * @param host      The network address to listen on
+ * @param port      The port to listen on
+ * @param reuseport Whether SO_REUSEPORT is set on the socket
  * @return     The opened socket or -1 on error
  */
-static int dcb_listen_create_socket_inet(const char *host, uint16_t port)
+static int dcb_listen_create_socket_inet(const char *host, uint16_t port, bool reuseport)
 {
     struct sockaddr_storage server_address = {};
     int listener_socket = open_network_socket(MXS_SOCKET_LISTENER, &server_address, host, port);
 
+#ifdef SO_REUSEPORT
+    int one = 1;
+
+    if (listener_socket != -1 && reuseport &&
+        dcb_set_socket_option(listener_socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0)
+    {
+        close(listener_socket);
+        listener_socket = -1;
+    }
+#endif
+
     if (listener_socket != -1)
     {
         if (bind(listener_socket, (struct sockaddr*)&server_address, sizeof(server_address)) < 0)
@@ -3145,6 +3180,57 @@ static int dcb_listen_create_socket_inet(const char *host, uint16_t port)
     return listener_socket;
 }
 
+/**
+ * @brief Create the listener sockets of the polling threads
+ *
+ * All the sockets have SO_REUSEPORT set, so the kernel distributes the new
+ * connections between them and each thread accepts connections from its own
+ * socket.
+ *
+ * @param first The socket of the first thread, already listening
+ * @param host  The network address to listen on
+ * @param port  The port to listen on
+ * @return      Array of sockets, one for each thread, or NULL on error
+ */
+static int *dcb_listen_create_thread_sockets(int first, const char *host, uint16_t port)
+{
+    int n_threads = config_threadcount();
+    int *fds = (int*)MXS_MALLOC(n_threads * sizeof(int));
+
+    if (fds)
+    {
+        fds[0] = first;
+
+        for (int i = 1; i < n_threads; i++)
+        {
+            fds[i] = dcb_listen_create_socket_inet(host, port, true);
+
+            if (fds[i] == -1 || listen(fds[i], INT_MAX) != 0)
+            {
+                if (fds[i] != -1)
+                {
+                    MXS_ERROR("Failed to start listening on '[%s]:%u': %d, %s",
+                              host, port, errno, mxs_strerror(errno));
+                }
+
+                for (int j = 1; j <= i; j++)
+                {
+                    if (fds[j] != -1)
+                    {
+                        close(fds[j]);
+                    }
+                }
+
+                MXS_FREE(fds);
+                fds = NULL;
+                break;
+            }
+        }
+    }
+
+    return fds;
+}
+
 /**
  * @brief Create a Unix domain socket
  *
@@ -3156,6 +3242,8 @@ static int dcb_listen_create_socket_unix(const char *path)
     int listener_socket;
     struct sockaddr_un local_addr;
     int one = 1;
+    int sndbuf = MXS_CLIENT_SO_SNDBUF;
+    int rcvbuf = MXS_CLIENT_SO_RCVBUF;
 
     if (strlen(path) > sizeof(local_addr.sun_path) - 1)
     {
@@ -3172,8 +3260,11 @@ static int dcb_listen_create_socket_unix(const char *path)
     }
 
     // socket options
-    if (dcb_set_socket_option(listener_socket, SOL_SOCKET, SO_REUSEADDR, (char *)&one, sizeof(one)) != 0)
+    if (dcb_set_socket_option(listener_socket, SOL_SOCKET, SO_REUSEADDR, (char *)&one, sizeof(one)) != 0 ||
+        dcb_set_socket_option(listener_socket, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) != 0 ||
+        dcb_set_socket_option(listener_socket, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) != 0)
     {
+        close(listener_socket);
         return -1;
     }
 
@@ -70,6 +70,7 @@
 #include <maxscale/random_jkiss.h>
 
 #include "maxscale/config.h"
+#include "maxscale/logsink.h"
 #include "maxscale/maxscale.h"
 #include "maxscale/modules.h"
 #include "maxscale/monitor.h"
@@ -2056,6 +2057,11 @@ int main(int argc, char **argv)
      */
     service_destroy_instances();
 
+    /*<
+     * Write the buffered records of the log sinks.
+     */
+    logsink_finish();
+
     /*<
      * Wait the flush thread.
      */
@@ -39,11 +39,16 @@
 #include <maxscale/alloc.h>
 #include <maxscale/users.h>
 #include <maxscale/service.h>
+#include <openssl/rand.h>
+#include <openssl/hmac.h>
 
 static RSA *rsa_512 = NULL;
 static RSA *rsa_1024 = NULL;
 
 static RSA *tmp_rsa_callback(SSL *s, int is_export, int keylength);
+static bool create_ticket_key(SSL_TICKET_KEY *key);
+static int ticket_key_callback(SSL *s, unsigned char *key_name, unsigned char *iv,
+                               EVP_CIPHER_CTX *ectx, HMAC_CTX *hctx, int enc);
 
 /**
  * Create a new listener structure
@@ -130,6 +135,7 @@ listener_alloc(struct service* service, const char* name, const char *protocol,
     proto->ssl = ssl;
     proto->users = NULL;
     proto->next = NULL;
+    proto->reuseport = false;
     proto->auth_instance = auth_instance;
     spinlock_init(&proto->lock);
 
@@ -229,6 +235,8 @@ listener_init_SSL(SSL_LISTENER *ssl_listener)
 
     if (!ssl_listener->ssl_init_done)
     {
+        spinlock_init(&ssl_listener->lock);
+
         switch (ssl_listener->ssl_method_type)
         {
         case SERVICE_TLS10:
@@ -271,6 +279,29 @@ listener_init_SSL(SSL_LISTENER *ssl_listener)
         /** Disable SSLv3 */
         SSL_CTX_set_options(ssl_listener->ctx, SSL_OP_NO_SSLv3);
 
+        /**
+         * Cache the sessions of the clients so that a reconnecting client can
+         * resume its session instead of doing a full handshake. The cache is
+         * shared by all threads. Clients that support session tickets store
+         * the session themselves, encrypted with a key that is rotated.
+         */
+        SSL_CTX_set_app_data(ssl_listener->ctx, ssl_listener);
+        SSL_CTX_set_session_cache_mode(ssl_listener->ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ssl_listener->ctx, SSL_SESSION_CACHE_SIZE);
+        SSL_CTX_set_timeout(ssl_listener->ctx, SSL_SESSION_TIMEOUT);
+        SSL_CTX_set_session_id_context(ssl_listener->ctx, (const unsigned char*)"MaxScale",
+                                       strlen("MaxScale"));
+
+        if (create_ticket_key(&ssl_listener->ticket_keys[0]))
+        {
+            SSL_CTX_set_tlsext_ticket_key_cb(ssl_listener->ctx, ticket_key_callback);
+        }
+        else
+        {
+            MXS_WARNING("Failed to create a session ticket key, session tickets are disabled.");
+            SSL_CTX_set_options(ssl_listener->ctx, SSL_OP_NO_TICKET);
+        }
+
         /** Generate the 512-bit and 1024-bit RSA keys */
         if (rsa_512 == NULL)
         {
@@ -386,6 +417,127 @@ tmp_rsa_callback(SSL *s, int is_export, int keylength)
     return (rsa_tmp);
 }
 
+/**
+ * Create a new random session ticket key
+ *
+ * @param key Key to fill
+ * @return True if enough random data was available
+ */
+static bool
+create_ticket_key(SSL_TICKET_KEY *key)
+{
+    key->created = time(NULL);
+
+    return RAND_bytes(key->name, sizeof(key->name)) == 1 &&
+           RAND_bytes(key->aes_key, sizeof(key->aes_key)) == 1 &&
+           RAND_bytes(key->hmac_key, sizeof(key->hmac_key)) == 1;
+}
+
+/**
+ * Find a session ticket key
+ *
+ * When the key for a new ticket is requested and the current key has expired,
+ * a new key is created and the older keys are shifted down.
+ *
+ * @param ssl_listener Listener whose keys are searched
+ * @param name         Name of the key or NULL for the current key
+ * @param key          The found key is copied here
+ * @return Index of the found key or -1 if no key was found
+ */
+static int
+get_ticket_key(SSL_LISTENER *ssl_listener, const unsigned char *name, SSL_TICKET_KEY *key)
+{
+    SSL_TICKET_KEY *keys = ssl_listener->ticket_keys;
+    time_t now = time(NULL);
+    int rval = -1;
+
+    spinlock_acquire(&ssl_listener->lock);
+
+    if (name == NULL)
+    {
+        SSL_TICKET_KEY new_key;
+
+        if (now - keys[0].created >= SSL_TICKET_KEY_LIFETIME && create_ticket_key(&new_key))
+        {
+            memmove(&keys[1], &keys[0], (SSL_TICKET_KEYS - 1) * sizeof(SSL_TICKET_KEY));
+            keys[0] = new_key;
+        }
+
+        OPENSSL_cleanse(&new_key, sizeof(new_key));
+        rval = 0;
+    }
+    else
+    {
+        for (int i = 0; i < SSL_TICKET_KEYS && rval == -1; i++)
+        {
+            if (keys[i].created && memcmp(keys[i].name, name, sizeof(keys[i].name)) == 0)
+            {
+                rval = i;
+            }
+        }
+    }
+
+    if (rval != -1)
+    {
+        *key = keys[rval];
+    }
+
+    spinlock_release(&ssl_listener->lock);
+
+    return rval;
+}
+
+/**
+ * The session ticket key callback for OpenSSL.
+ *
+ * @param s        SSL structure
+ * @param key_name Name of the key, set when encrypting and read when decrypting
+ * @param iv       Initialization vector, set when encrypting
+ * @param ectx     Cipher context to initialize
+ * @param hctx     HMAC context to initialize
+ * @param enc      Non-zero when a new ticket is encrypted
+ * @return 1 on success, 2 if the ticket should be renewed, 0 if the key was not
+ * found and -1 on error
+ */
+static int
+ticket_key_callback(SSL *s, unsigned char *key_name, unsigned char *iv,
+                    EVP_CIPHER_CTX *ectx, HMAC_CTX *hctx, int enc)
+{
+    SSL_LISTENER *ssl_listener = (SSL_LISTENER*)SSL_CTX_get_app_data(SSL_get_SSL_CTX(s));
+    SSL_TICKET_KEY key;
+    int rval = 0;
+
+    if (enc)
+    {
+        rval = -1;
+
+        if (get_ticket_key(ssl_listener, NULL, &key) == 0 &&
+            RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) == 1)
+        {
+            memcpy(key_name, key.name, sizeof(key.name));
+            EVP_EncryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, key.aes_key, iv);
+            HMAC_Init_ex(hctx, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), NULL);
+            rval = 1;
+        }
+    }
+    else
+    {
+        int index = get_ticket_key(ssl_listener, key_name, &key);
+
+        if (index != -1)
+        {
+            HMAC_Init_ex(hctx, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), NULL);
+            EVP_DecryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, key.aes_key, iv);
+            /** Tickets encrypted with an older key are replaced with new ones */
+            rval = index == 0 ? 1 : 2;
+        }
+    }
+
+    OPENSSL_cleanse(&key, sizeof(key));
+
+    return rval;
+}
+
 /**
  * Creates a listener configuration at the location pointed by @c filename
  *
@@ -419,6 +571,11 @@ static bool create_listener_config(const SERV_LISTENER *listener, const char *fi
         dprintf(file, "authenticator_options=%s\n", listener->auth_options);
     }
 
+    if (listener->reuseport)
+    {
+        dprintf(file, "reuseport=true\n");
+    }
+
     if (listener->ssl)
     {
         dprintf(file, "ssl=required\n");
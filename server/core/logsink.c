@@ -0,0 +1,860 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file logsink.c - Asynchronous log file writing for modules
+ *
+ * Each thread that writes to a log sink has a ring buffer of its own. The
+ * thread is the only producer of the ring and it adds records to it without
+ * any locking. The rings are consumed by whoever holds the lock of the log
+ * sink, usually the log sink writer thread. The consumer collects the
+ * buffered records of all rings into one writev() call.
+ *
+ * Threads are numbered on their first write. Threads whose number is larger
+ * than the number of per-thread rings share a ring that is protected by a
+ * mutex. A spinlock would not do as a full ring is drained by the producer.
+ */
+
+#include "maxscale/logsink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/platform.h>
+#include <maxscale/thread.h>
+
+/** Per-thread rings in addition to one for each worker thread */
+#define LOGSINK_EXTRA_THREADS 4
+
+/** The initial size of a ring, it grows up to the configured buffer size */
+#define LOGSINK_INITIAL_RING_SIZE (16 * 1024)
+
+/** The longest time the writer sleeps, in milliseconds */
+#define LOGSINK_MAX_SLEEP 1000
+
+const MXS_ENUM_VALUE logsink_policy_values[] =
+{
+    {"block", LOGSINK_BLOCK},
+    {"drop",  LOGSINK_DROP},
+    {NULL}
+};
+
+/**
+ * A single producer, single consumer ring buffer. The head and the tail grow
+ * without wrapping and the position in the buffer is the value masked with
+ * the size of the buffer.
+ */
+typedef struct logsink_ring
+{
+    char     *data;    /**< The buffer */
+    size_t    size;    /**< Size of the buffer, a power of two */
+    uint64_t  head;    /**< Bytes added, only changed by the producer */
+    uint64_t  tail;    /**< Bytes consumed, only changed by the consumer */
+    uint64_t  records; /**< Statistics, only changed by the producer */
+    uint64_t  bytes;
+    uint64_t  dropped;
+    uint64_t  blocked;
+} LOGSINK_RING;
+
+struct logsink
+{
+    char            *filename;
+    int              fd;
+    LOGSINK_CONFIG   config;
+    size_t           max_ring_size;  /**< Buffer size rounded up to a power of two */
+    int              n_rings;        /**< Number of per-thread rings */
+    LOGSINK_RING   **rings;          /**< Per-thread rings, created on the first write */
+    LOGSINK_RING    *shared;         /**< The ring of the threads without a ring of their own */
+    pthread_mutex_t  shared_lock;    /**< Protects the producer side of the shared ring */
+    pthread_mutex_t  lock;           /**< Held by the consumer of the rings */
+    uint64_t         writes;         /**< Write calls, protected by the lock */
+    uint64_t         errors;         /**< Failed writes, protected by the lock */
+    bool             write_error;    /**< Whether the last write failed */
+    int64_t          last_write;     /**< When the writer last wrote the records */
+    bool             closing;        /**< Set by logsink_close() */
+    struct logsink  *next;
+};
+
+/** The log sink writer */
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    LOGSINK        *sinks;    /**< All open log sinks, protected by the lock */
+    bool            wakeup;   /**< Set by the threads that want the writer to write */
+    bool            running;  /**< Whether the writer thread was started */
+    bool            shutdown; /**< Tells the writer thread to stop */
+    THREAD          thread;
+} this_unit =
+{
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER
+};
+
+static int next_thread_id = 0;
+static thread_local int current_thread_id = -1;
+
+static inline int get_current_thread_id()
+{
+    if (current_thread_id == -1)
+    {
+        current_thread_id = atomic_add(&next_thread_id, 1);
+    }
+
+    return current_thread_id;
+}
+
+static int64_t time_in_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static size_t round_up_to_pow2(size_t size)
+{
+    size_t rval = 1;
+
+    while (rval < size)
+    {
+        rval *= 2;
+    }
+
+    return rval;
+}
+
+void logsink_config_get(const MXS_CONFIG_PARAMETER *params, LOGSINK_CONFIG *config)
+{
+    config->buffer_size = config_get_size(params, LOGSINK_PARAM_BUFFER_SIZE);
+    config->batch_size = config_get_size(params, LOGSINK_PARAM_BATCH_SIZE);
+    config->flush_interval = config_get_integer(params, LOGSINK_PARAM_FLUSH_INTERVAL);
+    config->policy = config_get_enum(params, LOGSINK_PARAM_POLICY, logsink_policy_values);
+}
+
+static LOGSINK_RING* ring_alloc(size_t size)
+{
+    LOGSINK_RING *ring = MXS_CALLOC(1, sizeof(LOGSINK_RING));
+    char *data = MXS_MALLOC(size);
+
+    if (ring && data)
+    {
+        ring->data = data;
+        ring->size = size;
+    }
+    else
+    {
+        MXS_FREE(ring);
+        MXS_FREE(data);
+        ring = NULL;
+    }
+
+    return ring;
+}
+
+static void ring_free(LOGSINK_RING *ring)
+{
+    if (ring)
+    {
+        MXS_FREE(ring->data);
+        MXS_FREE(ring);
+    }
+}
+
+/**
+ * Copy data into a buffer at a ring position
+ *
+ * @param data Ring buffer
+ * @param size Size of the ring buffer
+ * @param pos  The position, not masked
+ * @param src  Data to copy
+ * @param len  Length of the data, at most @c size
+ */
+static void ring_copy(char *data, size_t size, uint64_t pos, const char *src, size_t len)
+{
+    size_t offset = pos & (size - 1);
+    size_t first = MXS_MIN(len, size - offset);
+
+    memcpy(data + offset, src, first);
+    memcpy(data, src + first, len - first);
+}
+
+/**
+ * Get the buffered data of a ring as at most two iovecs
+ *
+ * @param ring The ring
+ * @param head The head of the ring read by the consumer
+ * @param iov  Where to store the iovecs
+ * @return Number of iovecs used
+ */
+static int ring_iov(LOGSINK_RING *ring, uint64_t head, struct iovec *iov)
+{
+    size_t len = head - ring->tail;
+    size_t offset = ring->tail & (ring->size - 1);
+    size_t first = MXS_MIN(len, ring->size - offset);
+    int n = 0;
+
+    if (first)
+    {
+        iov[n].iov_base = ring->data + offset;
+        iov[n++].iov_len = first;
+    }
+
+    if (len - first)
+    {
+        iov[n].iov_base = ring->data;
+        iov[n++].iov_len = len - first;
+    }
+
+    return n;
+}
+
+/**
+ * Write iovecs to the file of a log sink, the caller must hold the lock of the sink
+ *
+ * @param sink   The log sink
+ * @param iov    The iovecs, modified by partial writes
+ * @param iovcnt Number of iovecs
+ * @return True if everything was written
+ */
+static bool write_iov(LOGSINK *sink, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t rc = writev(sink->fd, iov, MXS_MIN(iovcnt, IOV_MAX));
+        sink->writes++;
+
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (!sink->write_error)
+            {
+                char errbuf[MXS_STRERROR_BUFLEN];
+                MXS_ERROR("Failed to write to '%s': %d, %s", sink->filename,
+                          errno, strerror_r(errno, errbuf, sizeof(errbuf)));
+            }
+
+            sink->errors++;
+            sink->write_error = true;
+            return false;
+        }
+
+        size_t written = rc;
+
+        while (iovcnt > 0 && written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    sink->write_error = false;
+    return true;
+}
+
+/**
+ * Write the buffered records of all rings, the caller must hold the lock of
+ * the sink. The records are discarded if the write fails.
+ *
+ * @param sink The log sink
+ * @return True if the records were written
+ */
+static bool drain(LOGSINK *sink)
+{
+    int n_rings = sink->n_rings + 1;
+    LOGSINK_RING *rings[n_rings];
+    uint64_t heads[n_rings];
+    struct iovec iov[2 * n_rings];
+    int iovcnt = 0;
+
+    for (int i = 0; i < n_rings; i++)
+    {
+        rings[i] = i < sink->n_rings ?
+                   __atomic_load_n(&sink->rings[i], __ATOMIC_ACQUIRE) : sink->shared;
+
+        if (rings[i])
+        {
+            heads[i] = __atomic_load_n(&rings[i]->head, __ATOMIC_ACQUIRE);
+            iovcnt += ring_iov(rings[i], heads[i], iov + iovcnt);
+        }
+    }
+
+    bool rval = write_iov(sink, iov, iovcnt);
+
+    for (int i = 0; i < n_rings; i++)
+    {
+        if (rings[i])
+        {
+            __atomic_store_n(&rings[i]->tail, heads[i], __ATOMIC_RELEASE);
+        }
+    }
+
+    return rval;
+}
+
+/**
+ * Check whether the buffered records of a log sink should be written
+ *
+ * @param sink The log sink
+ * @param now  Current time in milliseconds
+ * @return True if the records should be written
+ */
+static bool should_write(LOGSINK *sink, int64_t now)
+{
+    size_t pending = 0;
+
+    for (int i = 0; i <= sink->n_rings; i++)
+    {
+        LOGSINK_RING *ring = i < sink->n_rings ?
+                             __atomic_load_n(&sink->rings[i], __ATOMIC_ACQUIRE) : sink->shared;
+
+        if (ring)
+        {
+            pending += __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+                       __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    return pending > 0 && (pending >= sink->config.batch_size ||
+                           now - sink->last_write >= sink->config.flush_interval);
+}
+
+static void free_sink(LOGSINK *sink)
+{
+    if (sink->rings)
+    {
+        for (int i = 0; i < sink->n_rings; i++)
+        {
+            ring_free(sink->rings[i]);
+        }
+    }
+
+    ring_free(sink->shared);
+
+    if (sink->fd != -1)
+    {
+        close(sink->fd);
+    }
+
+    pthread_mutex_destroy(&sink->shared_lock);
+    pthread_mutex_destroy(&sink->lock);
+    MXS_FREE(sink->rings);
+    MXS_FREE(sink->filename);
+    MXS_FREE(sink);
+}
+
+/**
+ * Wake up the writer thread
+ */
+static void wake_writer()
+{
+    if (!__atomic_exchange_n(&this_unit.wakeup, true, __ATOMIC_ACQ_REL))
+    {
+        pthread_mutex_lock(&this_unit.lock);
+        pthread_cond_signal(&this_unit.cond);
+        pthread_mutex_unlock(&this_unit.lock);
+    }
+}
+
+/**
+ * The writer thread. The sinks are only removed from the list by this thread
+ * so the list can be traversed without holding the lock.
+ */
+static void writer_main(void *data)
+{
+    pthread_mutex_lock(&this_unit.lock);
+
+    while (!this_unit.shutdown)
+    {
+        LOGSINK *sinks = this_unit.sinks;
+        pthread_mutex_unlock(&this_unit.lock);
+
+        int64_t now = time_in_ms();
+        int sleep_ms = LOGSINK_MAX_SLEEP;
+        LOGSINK *closed = NULL;
+
+        for (LOGSINK *sink = sinks; sink; sink = sink->next)
+        {
+            if (__atomic_load_n(&sink->closing, __ATOMIC_ACQUIRE))
+            {
+                closed = sink;
+            }
+            else if (should_write(sink, now))
+            {
+                pthread_mutex_lock(&sink->lock);
+                drain(sink);
+                sink->last_write = now;
+                pthread_mutex_unlock(&sink->lock);
+            }
+
+            if (sink->config.flush_interval > 0)
+            {
+                sleep_ms = MXS_MIN(sleep_ms, sink->config.flush_interval);
+            }
+        }
+
+        pthread_mutex_lock(&this_unit.lock);
+
+        if (closed)
+        {
+            // Remove the closed sinks, they are written after the lock is released
+            LOGSINK **prev = &this_unit.sinks;
+            closed = NULL;
+
+            while (*prev)
+            {
+                LOGSINK *sink = *prev;
+
+                if (__atomic_load_n(&sink->closing, __ATOMIC_ACQUIRE))
+                {
+                    *prev = sink->next;
+                    sink->next = closed;
+                    closed = sink;
+                }
+                else
+                {
+                    prev = &sink->next;
+                }
+            }
+
+            pthread_mutex_unlock(&this_unit.lock);
+
+            while (closed)
+            {
+                LOGSINK *sink = closed;
+                closed = sink->next;
+                drain(sink);
+                free_sink(sink);
+            }
+
+            pthread_mutex_lock(&this_unit.lock);
+        }
+
+        if (!__atomic_load_n(&this_unit.wakeup, __ATOMIC_ACQUIRE) && !this_unit.shutdown)
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += sleep_ms / 1000;
+            ts.tv_nsec += (sleep_ms % 1000) * 1000000;
+
+            if (ts.tv_nsec >= 1000000000)
+            {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+
+            pthread_cond_timedwait(&this_unit.cond, &this_unit.lock, &ts);
+        }
+
+        __atomic_store_n(&this_unit.wakeup, false, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&this_unit.lock);
+}
+
+LOGSINK* logsink_open(const char *filename, bool append, const LOGSINK_CONFIG *config)
+{
+    LOGSINK *sink = MXS_CALLOC(1, sizeof(LOGSINK));
+
+    if (sink == NULL)
+    {
+        return NULL;
+    }
+
+    sink->fd = -1;
+    sink->config = *config;
+    sink->max_ring_size = round_up_to_pow2(MXS_MAX(config->buffer_size, 1));
+    sink->n_rings = config_threadcount() + LOGSINK_EXTRA_THREADS;
+    sink->rings = MXS_CALLOC(sink->n_rings, sizeof(LOGSINK_RING*));
+    sink->shared = ring_alloc(MXS_MIN(LOGSINK_INITIAL_RING_SIZE, sink->max_ring_size));
+    sink->filename = MXS_STRDUP(filename);
+    sink->last_write = time_in_ms();
+    pthread_mutex_init(&sink->shared_lock, NULL);
+    pthread_mutex_init(&sink->lock, NULL);
+
+    if (sink->rings == NULL || sink->shared == NULL || sink->filename == NULL)
+    {
+        free_sink(sink);
+        return NULL;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_APPEND | (append ? 0 : O_TRUNC);
+
+    if ((sink->fd = open(filename, flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) == -1)
+    {
+        char errbuf[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to open file '%s': %d, %s", filename, errno,
+                  strerror_r(errno, errbuf, sizeof(errbuf)));
+        free_sink(sink);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&this_unit.lock);
+
+    if (!this_unit.running && !this_unit.shutdown)
+    {
+        if (thread_start(&this_unit.thread, writer_main, NULL))
+        {
+            this_unit.running = true;
+        }
+        else
+        {
+            MXS_ERROR("Failed to start the log sink writer thread.");
+        }
+    }
+
+    if (this_unit.running)
+    {
+        sink->next = this_unit.sinks;
+        this_unit.sinks = sink;
+    }
+
+    pthread_mutex_unlock(&this_unit.lock);
+
+    if (!this_unit.running)
+    {
+        free_sink(sink);
+        sink = NULL;
+    }
+
+    return sink;
+}
+
+void logsink_close(LOGSINK *sink)
+{
+    __atomic_store_n(&sink->closing, true, __ATOMIC_RELEASE);
+    wake_writer();
+}
+
+/**
+ * Get the ring of the calling thread
+ *
+ * @param sink The log sink
+ * @return The ring of this thread or NULL if the shared ring must be used
+ */
+static LOGSINK_RING* get_ring(LOGSINK *sink)
+{
+    int id = get_current_thread_id();
+    LOGSINK_RING *ring = NULL;
+
+    if (id < sink->n_rings)
+    {
+        // Only this thread stores a ring into its slot
+        ring = sink->rings[id];
+
+        if (ring == NULL &&
+            (ring = ring_alloc(MXS_MIN(LOGSINK_INITIAL_RING_SIZE, sink->max_ring_size))))
+        {
+            __atomic_store_n(&sink->rings[id], ring, __ATOMIC_RELEASE);
+        }
+    }
+
+    return ring;
+}
+
+/**
+ * Grow a ring so that a record fits into it, called by the producer
+ *
+ * @param sink The log sink
+ * @param ring The ring
+ * @param len  Length of the record
+ * @return True if the record now fits into the ring
+ */
+static bool ring_grow(LOGSINK *sink, LOGSINK_RING *ring, size_t len)
+{
+    bool rval = false;
+
+    // The consumer does not read the buffer while the lock is held
+    pthread_mutex_lock(&sink->lock);
+
+    uint64_t pending = ring->head - ring->tail;
+    size_t size = ring->size;
+
+    while (size < sink->max_ring_size && size - pending < len)
+    {
+        size *= 2;
+    }
+
+    char *data;
+
+    if (size - pending >= len && (data = MXS_MALLOC(size)))
+    {
+        struct iovec iov[2];
+        int n = ring_iov(ring, ring->head, iov);
+        uint64_t pos = ring->tail;
+
+        for (int i = 0; i < n; i++)
+        {
+            ring_copy(data, size, pos, iov[i].iov_base, iov[i].iov_len);
+            pos += iov[i].iov_len;
+        }
+
+        MXS_FREE(ring->data);
+        ring->data = data;
+        ring->size = size;
+        rval = true;
+    }
+
+    pthread_mutex_unlock(&sink->lock);
+
+    return rval;
+}
+
+/**
+ * Add a record to a ring, called by the producer
+ *
+ * @param sink The log sink
+ * @param ring The ring of this thread
+ * @param data The record
+ * @param len  Length of the record
+ * @return True if the record was added
+ */
+static bool ring_write(LOGSINK *sink, LOGSINK_RING *ring, const char *data, size_t len)
+{
+    uint64_t head = ring->head;
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (ring->size - (head - tail) < len && !ring_grow(sink, ring, len))
+    {
+        if (sink->config.policy == LOGSINK_DROP)
+        {
+            ring->dropped++;
+            return false;
+        }
+
+        // Write the buffered records in this thread. A record that does not
+        // fit into an empty buffer is written directly.
+        bool rval;
+        ring->blocked++;
+        pthread_mutex_lock(&sink->lock);
+        rval = drain(sink);
+
+        if (len > ring->size)
+        {
+            struct iovec iov = {(void*)data, len};
+            rval = write_iov(sink, &iov, 1) && rval;
+            ring->records++;
+            ring->bytes += len;
+            pthread_mutex_unlock(&sink->lock);
+            return rval;
+        }
+
+        pthread_mutex_unlock(&sink->lock);
+        tail = ring->tail;
+    }
+
+    ring_copy(ring->data, ring->size, head, data, len);
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+    ring->records++;
+    ring->bytes += len;
+
+    size_t pending = head + len - tail;
+
+    if (sink->config.flush_interval == 0 ||
+        (pending >= sink->config.batch_size && pending - len < sink->config.batch_size))
+    {
+        wake_writer();
+    }
+
+    return true;
+}
+
+bool logsink_write(LOGSINK *sink, const char *data, size_t len)
+{
+    bool rval = true;
+
+    if (len > 0)
+    {
+        LOGSINK_RING *ring = get_ring(sink);
+
+        if (ring)
+        {
+            rval = ring_write(sink, ring, data, len);
+        }
+        else
+        {
+            pthread_mutex_lock(&sink->shared_lock);
+            rval = ring_write(sink, sink->shared, data, len);
+            pthread_mutex_unlock(&sink->shared_lock);
+        }
+    }
+
+    return rval;
+}
+
+bool logsink_printf(LOGSINK *sink, const char *format, ...)
+{
+    char buffer[1024];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (len < 0)
+    {
+        return false;
+    }
+    else if ((size_t)len < sizeof(buffer))
+    {
+        return logsink_write(sink, buffer, len);
+    }
+
+    char *str = MXS_MALLOC(len + 1);
+    bool rval = false;
+
+    if (str)
+    {
+        va_start(args, format);
+        vsnprintf(str, len + 1, format, args);
+        va_end(args);
+        rval = logsink_write(sink, str, len);
+        MXS_FREE(str);
+    }
+
+    return rval;
+}
+
+bool logsink_flush(LOGSINK *sink)
+{
+    pthread_mutex_lock(&sink->lock);
+    bool rval = drain(sink);
+    pthread_mutex_unlock(&sink->lock);
+
+    return rval;
+}
+
+bool logsink_truncate(LOGSINK *sink)
+{
+    pthread_mutex_lock(&sink->lock);
+
+    for (int i = 0; i <= sink->n_rings; i++)
+    {
+        LOGSINK_RING *ring = i < sink->n_rings ?
+                             __atomic_load_n(&sink->rings[i], __ATOMIC_ACQUIRE) : sink->shared;
+
+        if (ring)
+        {
+            __atomic_store_n(&ring->tail, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE),
+                             __ATOMIC_RELEASE);
+        }
+    }
+
+    bool rval = ftruncate(sink->fd, 0) == 0;
+
+    if (!rval)
+    {
+        char errbuf[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to truncate '%s': %d, %s", sink->filename, errno,
+                  strerror_r(errno, errbuf, sizeof(errbuf)));
+    }
+
+    pthread_mutex_unlock(&sink->lock);
+
+    return rval;
+}
+
+void logsink_get_stats(LOGSINK *sink, LOGSINK_STATS *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    for (int i = 0; i <= sink->n_rings; i++)
+    {
+        LOGSINK_RING *ring = i < sink->n_rings ?
+                             __atomic_load_n(&sink->rings[i], __ATOMIC_ACQUIRE) : sink->shared;
+
+        if (ring)
+        {
+            stats->records += __atomic_load_n(&ring->records, __ATOMIC_RELAXED);
+            stats->bytes += __atomic_load_n(&ring->bytes, __ATOMIC_RELAXED);
+            stats->dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+            stats->blocked += __atomic_load_n(&ring->blocked, __ATOMIC_RELAXED);
+        }
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    stats->writes = sink->writes;
+    stats->errors = sink->errors;
+    pthread_mutex_unlock(&sink->lock);
+}
+
+void logsink_diagnostics(LOGSINK *sink, DCB *dcb)
+{
+    LOGSINK_STATS stats;
+    logsink_get_stats(sink, &stats);
+
+    dcb_printf(dcb, "\t\tLog records:                %lu\n", stats.records);
+    dcb_printf(dcb, "\t\tLog bytes:                  %lu\n", stats.bytes);
+    dcb_printf(dcb, "\t\tLog writes:                 %lu\n", stats.writes);
+    dcb_printf(dcb, "\t\tLog records dropped:        %lu\n", stats.dropped);
+    dcb_printf(dcb, "\t\tLog buffer full, blocked:   %lu\n", stats.blocked);
+    dcb_printf(dcb, "\t\tLog write errors:           %lu\n", stats.errors);
+}
+
+void logsink_finish()
+{
+    pthread_mutex_lock(&this_unit.lock);
+    bool running = this_unit.running;
+    this_unit.shutdown = true;
+    pthread_cond_signal(&this_unit.cond);
+    pthread_mutex_unlock(&this_unit.lock);
+
+    if (running)
+    {
+        thread_wait(this_unit.thread);
+    }
+
+    // Write what is left, the sinks that are still open are not freed
+    LOGSINK **prev = &this_unit.sinks;
+
+    while (*prev)
+    {
+        LOGSINK *sink = *prev;
+
+        pthread_mutex_lock(&sink->lock);
+        drain(sink);
+        pthread_mutex_unlock(&sink->lock);
+
+        if (sink->closing)
+        {
+            *prev = sink->next;
+            free_sink(sink);
+        }
+        else
+        {
+            prev = &sink->next;
+        }
+    }
+}
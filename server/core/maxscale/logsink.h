@@ -0,0 +1,34 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file
+ *
+ * Internal code for the log sinks.
+ */
+
+#include <maxscale/logsink.h>
+
+MXS_BEGIN_DECLS
+
+/**
+ * @brief Stop the log sink writer
+ *
+ * The buffered records of all log sinks are written and the log sinks that
+ * have been closed are freed. This function should only be called once by
+ * the MaxScale core, when the filter instances have been destroyed.
+ */
+void logsink_finish();
+
+MXS_END_DECLS
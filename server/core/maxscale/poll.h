@@ -62,4 +62,16 @@ RESULTSET       *eventTimesGetList();
 
 void            poll_send_message(enum poll_message msg, void *data);
 
+/**
+ * @brief Get the ID of the calling polling thread
+ *
+ * @return The ID of the thread
+ */
+int             poll_current_thread_id();
+
+/**
+ * @brief Count a connection accepted by the calling polling thread
+ */
+void            poll_count_accept();
+
 MXS_END_DECLS
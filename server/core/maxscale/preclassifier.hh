@@ -0,0 +1,965 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/cppdefs.hh>
+#include <ctype.h>
+#include <maxscale/modutil.h>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/query_classifier.h>
+#include "trxboundaryparser.hh"
+
+namespace maxscale
+{
+
+#define PC_WORD(string_literal) string_literal, (sizeof(string_literal) - 1)
+
+/**
+ * @class PreClassifier
+ *
+ * PreClassifier is a class capable of returning the type mask and the
+ * operation of the most common simple statements, without the statement
+ * having to be parsed by the query classifier plugin:
+ *
+ * - SELECT without variables, function calls, sub-queries, FOR UPDATE,
+ *   LOCK IN SHARE MODE or INTO,
+ * - INSERT, REPLACE, UPDATE and DELETE without variables, sub-queries or
+ *   LAST_INSERT_ID(),
+ * - SET of user and system variables to literal values,
+ * - USE,
+ * - the most common SHOW statements, and
+ * - the statements recognized by TrxBoundaryParser.
+ *
+ * The returned type mask and operation are identical to what qc_sqlite
+ * would return. Whenever the statement is not recognized, the classifier
+ * declines and the statement must be classified using the query classifier.
+ *
+ * Like TrxBoundaryParser, the class is defined in its entirety in the
+ * header to allow for aggressive inlining.
+ */
+class PreClassifier
+{
+public:
+    enum token_t
+    {
+        TK_COMMA,
+        TK_DOT,
+        TK_EQ,
+        TK_LP,
+        TK_NUMBER,
+        TK_OPERATOR,
+        TK_QUOTED_ID,
+        TK_RP,
+        TK_STRING,
+        TK_VARIABLE,
+        TK_WORD,
+
+        PARSER_UNKNOWN_TOKEN,
+        PARSER_EXHAUSTED,
+    };
+
+    /**
+     * PreClassifier is not thread-safe. As a very lightweight class,
+     * the intention is that an instance is created on the stack whenever
+     * classification needs to be performed.
+     *
+     * @code
+     *     void f(GWBUF *pBuf)
+     *     {
+     *         PreClassifier pc;
+     *         uint32_t type_mask;
+     *         qc_query_op_t op;
+     *
+     *         if (pc.classify(pBuf, &type_mask, &op))
+     *         {
+     *             ...
+     *         }
+     *     }
+     * @endcode
+     */
+    PreClassifier()
+        : m_pSql(NULL)
+        , m_len(0)
+        , m_pI(NULL)
+        , m_pEnd(NULL)
+        , m_pToken(NULL)
+        , m_token_len(0)
+    {
+    }
+
+    /**
+     * Classify a statement.
+     *
+     * @param pSql        SQL statement.
+     * @param len         Length of pSql.
+     * @param pType_mask  On successful return, the type mask of the statement.
+     * @param pOp         On successful return, the operation of the statement.
+     *
+     * @return True, if the statement could be classified, false otherwise.
+     */
+    bool classify(const char* pSql, size_t len, uint32_t* pType_mask, qc_query_op_t* pOp)
+    {
+        m_pSql = pSql;
+        m_len = len;
+
+        m_pI = m_pSql;
+        m_pEnd = m_pI + m_len;
+
+        return parse(pType_mask, pOp);
+    }
+
+    /**
+     * Classify a statement.
+     *
+     * @param pBuf        A COM_QUERY. Other packets are never classified.
+     * @param pType_mask  On successful return, the type mask of the statement.
+     * @param pOp         On successful return, the operation of the statement.
+     *
+     * @return True, if the statement could be classified, false otherwise.
+     */
+    bool classify(GWBUF* pBuf, uint32_t* pType_mask, qc_query_op_t* pOp)
+    {
+        bool rv = false;
+
+        char* pSql;
+        if (modutil_extract_SQL(pBuf, &pSql, &m_len) &&
+            ((size_t)GWBUF_LENGTH(pBuf) >= (size_t)(MYSQL_HEADER_LEN + 1 + m_len)))
+        {
+            m_pSql = pSql;
+            m_pI = m_pSql;
+            m_pEnd = m_pI + m_len;
+
+            rv = parse(pType_mask, pOp);
+        }
+
+        return rv;
+    }
+
+private:
+    bool parse(uint32_t* pType_mask, qc_query_op_t* pOp)
+    {
+        bool rv = false;
+        uint32_t type_mask = QUERY_TYPE_UNKNOWN;
+        qc_query_op_t op = QUERY_OP_UNDEFINED;
+
+        if (next_token() == TK_WORD)
+        {
+            switch (*m_pToken)
+            {
+            case 'b':
+            case 'B':
+            case 'c':
+            case 'C':
+                rv = parse_trx(&type_mask);
+                break;
+
+            case 'd':
+            case 'D':
+                if (is_word(PC_WORD("DELETE")))
+                {
+                    op = QUERY_OP_DELETE;
+                    rv = parse_dml(&type_mask);
+                }
+                break;
+
+            case 'i':
+            case 'I':
+                if (is_word(PC_WORD("INSERT")))
+                {
+                    op = QUERY_OP_INSERT;
+                    rv = parse_dml(&type_mask);
+                }
+                break;
+
+            case 'r':
+            case 'R':
+                if (is_word(PC_WORD("REPLACE")))
+                {
+                    op = QUERY_OP_INSERT;
+                    rv = parse_dml(&type_mask);
+                }
+                else
+                {
+                    rv = parse_trx(&type_mask);
+                }
+                break;
+
+            case 's':
+            case 'S':
+                if (is_word(PC_WORD("SELECT")))
+                {
+                    op = QUERY_OP_SELECT;
+                    rv = parse_select(&type_mask);
+                }
+                else if (is_word(PC_WORD("SET")))
+                {
+                    rv = parse_set(&type_mask);
+                }
+                else if (is_word(PC_WORD("SHOW")))
+                {
+                    rv = parse_show(&type_mask);
+                }
+                else
+                {
+                    rv = parse_trx(&type_mask);
+                }
+                break;
+
+            case 'u':
+            case 'U':
+                if (is_word(PC_WORD("UPDATE")))
+                {
+                    op = QUERY_OP_UPDATE;
+                    rv = parse_dml(&type_mask);
+                }
+                else if (is_word(PC_WORD("USE")))
+                {
+                    op = QUERY_OP_CHANGE_DB;
+                    rv = parse_use(&type_mask);
+                }
+                break;
+
+            default:
+                ;
+            }
+        }
+
+        if (rv)
+        {
+            *pType_mask = type_mask;
+            *pOp = op;
+        }
+
+        return rv;
+    }
+
+    /**
+     * BEGIN, COMMIT, ROLLBACK and START TRANSACTION. qc_sqlite reports only
+     * the transaction related bits for them, so TrxBoundaryParser provides
+     * the complete type mask.
+     */
+    bool parse_trx(uint32_t* pType_mask)
+    {
+        bool rv = false;
+
+        // Multi-statements are left to the query classifier.
+        if (!memchr(m_pSql, ';', m_len))
+        {
+            TrxBoundaryParser parser;
+
+            uint32_t type_mask = parser.type_mask_of(m_pSql, m_len);
+
+            if (type_mask != 0)
+            {
+                *pType_mask = type_mask;
+                rv = true;
+            }
+        }
+
+        return rv;
+    }
+
+    bool parse_select(uint32_t* pType_mask)
+    {
+        bool rv = true;
+        bool lp_allowed = false;
+        token_t token;
+
+        while (rv && ((token = next_token()) != PARSER_EXHAUSTED))
+        {
+            switch (token)
+            {
+            case TK_WORD:
+                // FOR UPDATE, LOCK IN SHARE MODE, INTO, sub-selects and unions, and
+                // all keywords that the parser turns into function calls.
+                rv = !is_word(PC_WORD("FOR")) &&
+                    !is_word(PC_WORD("INTO")) &&
+                    !is_word(PC_WORD("LOCK")) &&
+                    !is_word(PC_WORD("PROCEDURE")) &&
+                    !is_word(PC_WORD("SELECT")) &&
+                    !is_word(PC_WORD("GLOB")) &&
+                    !is_word(PC_WORD("REGEXP")) &&
+                    !is_word(PC_WORD("RLIKE")) &&
+                    !is_word(PC_WORD("MATCH")) &&
+                    !is_word(PC_WORD("DIV")) &&
+                    !is_word(PC_WORD("MOD")) &&
+                    !is_word(PC_WORD("INTERVAL")) &&
+                    !is_prefix(PC_WORD("CURRENT_")) &&
+                    !is_prefix(PC_WORD("LOCALTIME")) &&
+                    !is_prefix(PC_WORD("UTC_"));
+
+                // A parenthesis following a name is a function call, whose
+                // type cannot be known without the query classifier.
+                lp_allowed = is_condition_word();
+                break;
+
+            case TK_QUOTED_ID:
+                lp_allowed = false;
+                break;
+
+            case TK_LP:
+                rv = lp_allowed;
+                break;
+
+            case TK_VARIABLE:
+            case PARSER_UNKNOWN_TOKEN:
+                rv = false;
+                break;
+
+            default:
+                lp_allowed = true;
+            }
+        }
+
+        if (rv)
+        {
+            *pType_mask = QUERY_TYPE_READ;
+        }
+
+        return rv;
+    }
+
+    bool parse_dml(uint32_t* pType_mask)
+    {
+        bool rv = true;
+        token_t token;
+
+        while (rv && ((token = next_token()) != PARSER_EXHAUSTED))
+        {
+            switch (token)
+            {
+            case TK_WORD:
+                // Any function call makes the statement a write, which it already
+                // is, except for LAST_INSERT_ID() that adds a master read.
+                rv = !is_word(PC_WORD("SELECT")) && !is_word(PC_WORD("LAST_INSERT_ID"));
+                break;
+
+            case TK_VARIABLE:
+            case PARSER_UNKNOWN_TOKEN:
+                rv = false;
+                break;
+
+            default:
+                ;
+            }
+        }
+
+        if (rv)
+        {
+            *pType_mask = QUERY_TYPE_WRITE;
+        }
+
+        return rv;
+    }
+
+    bool parse_set(uint32_t* pType_mask)
+    {
+        bool rv = true;
+        bool has_user_var = false;
+        bool has_word_value = false;
+        uint32_t type_mask = 0;
+        token_t token;
+
+        do
+        {
+            token = next_token();
+
+            if ((token == TK_WORD) &&
+                (is_word(PC_WORD("GLOBAL")) || is_word(PC_WORD("SESSION")) || is_word(PC_WORD("LOCAL"))))
+            {
+                token = next_token();
+            }
+
+            if (token == TK_WORD && is_word(PC_WORD("NAMES")))
+            {
+                type_mask |= QUERY_TYPE_GSYSVAR_WRITE;
+                rv = parse_set_names();
+                token = next_token();
+            }
+            else if (token == TK_WORD && is_word(PC_WORD("CHARACTER")))
+            {
+                type_mask |= QUERY_TYPE_GSYSVAR_WRITE;
+                rv = (next_token() == TK_WORD) && is_word(PC_WORD("SET")) && parse_set_names();
+                token = next_token();
+            }
+            else if (token == TK_VARIABLE || token == TK_WORD)
+            {
+                bool is_user_var = (token == TK_VARIABLE) && (m_pToken[1] != '@');
+                bool is_autocommit = false;
+
+                if (is_user_var)
+                {
+                    has_user_var = true;
+                    type_mask |= QUERY_TYPE_USERVAR_WRITE;
+                    token = next_token();
+                }
+                else
+                {
+                    type_mask |= QUERY_TYPE_GSYSVAR_WRITE;
+                    token = parse_system_variable(token, &is_autocommit);
+                }
+
+                if (token == TK_EQ)
+                {
+                    token = next_token();
+
+                    if (token == TK_OPERATOR && (*m_pToken == '-' || *m_pToken == '+'))
+                    {
+                        token = (next_token() == TK_NUMBER) ? TK_NUMBER : PARSER_UNKNOWN_TOKEN;
+                    }
+
+                    switch (token)
+                    {
+                    case TK_NUMBER:
+                    case TK_STRING:
+                        break;
+
+                    case TK_VARIABLE:
+                        // "@@session.var" and alike.
+                        if ((m_pToken[1] == '@') && is_scope_variable())
+                        {
+                            rv = (next_token() == TK_DOT) && (next_token() == TK_WORD);
+                        }
+                        break;
+
+                    case TK_WORD:
+                        // NULL is an expression also for a user variable, other words may
+                        // be keywords that makes qc_sqlite fall back to treating the entire
+                        // statement as a system variable write.
+                        if (!is_word(PC_WORD("NULL")))
+                        {
+                            has_word_value = true;
+                        }
+                        break;
+
+                    default:
+                        rv = false;
+                    }
+
+                    if (rv && is_autocommit)
+                    {
+                        rv = add_autocommit_bits(token, &type_mask);
+                    }
+
+                    token = next_token();
+                }
+                else
+                {
+                    rv = false;
+                }
+            }
+            else
+            {
+                rv = false;
+            }
+        }
+        while (rv && (token == TK_COMMA));
+
+        rv = rv && (token == PARSER_EXHAUSTED) && !(has_user_var && has_word_value);
+
+        if (rv)
+        {
+            *pType_mask = type_mask;
+        }
+
+        return rv;
+    }
+
+    bool parse_set_names()
+    {
+        token_t token = next_token();
+        bool rv = (token == TK_WORD || token == TK_STRING);
+
+        if (rv)
+        {
+            const char* pI = m_pI;
+
+            if ((next_token() == TK_WORD) && is_word(PC_WORD("COLLATE")))
+            {
+                token = next_token();
+                rv = (token == TK_WORD || token == TK_STRING);
+            }
+            else
+            {
+                m_pI = pI;
+            }
+        }
+
+        return rv;
+    }
+
+    /**
+     * Parse the name of a system variable, e.g. "var", "@@var" or "@@global.var".
+     *
+     * @return The token following the name.
+     */
+    token_t parse_system_variable(token_t token, bool* pIs_autocommit)
+    {
+        if ((token == TK_VARIABLE) && is_scope_variable())
+        {
+            if (next_token() == TK_DOT && next_token() == TK_WORD)
+            {
+                token = TK_WORD;
+            }
+            else
+            {
+                token = PARSER_UNKNOWN_TOKEN;
+            }
+        }
+
+        if (token != PARSER_UNKNOWN_TOKEN)
+        {
+            *pIs_autocommit = (token == TK_WORD) ?
+                is_word(PC_WORD("AUTOCOMMIT")) :
+                is_word(PC_WORD("@@AUTOCOMMIT"));
+
+            token = next_token();
+        }
+
+        return token;
+    }
+
+    bool add_autocommit_bits(token_t token, uint32_t* pType_mask)
+    {
+        int enable = -1;
+
+        if ((token == TK_NUMBER) && (m_token_len == 1) && (*m_pToken == '0' || *m_pToken == '1'))
+        {
+            enable = *m_pToken - '0';
+        }
+        else if (token == TK_WORD)
+        {
+            if (is_word(PC_WORD("ON")) || is_word(PC_WORD("TRUE")))
+            {
+                enable = 1;
+            }
+            else if (is_word(PC_WORD("OFF")) || is_word(PC_WORD("FALSE")))
+            {
+                enable = 0;
+            }
+        }
+
+        switch (enable)
+        {
+        case 0:
+            *pType_mask |= (QUERY_TYPE_BEGIN_TRX | QUERY_TYPE_DISABLE_AUTOCOMMIT);
+            break;
+
+        case 1:
+            *pType_mask |= (QUERY_TYPE_ENABLE_AUTOCOMMIT | QUERY_TYPE_COMMIT);
+            break;
+
+        default:
+            ;
+        }
+
+        return enable != -1;
+    }
+
+    bool parse_show(uint32_t* pType_mask)
+    {
+        bool rv = false;
+        uint32_t type_mask = QUERY_TYPE_UNKNOWN;
+        bool scope = false;
+        bool global = false;
+        bool full = false;
+
+        token_t token = next_token();
+
+        if (token == TK_WORD)
+        {
+            if (is_word(PC_WORD("GLOBAL")))
+            {
+                scope = true;
+                global = true;
+                token = next_token();
+            }
+            else if (is_word(PC_WORD("SESSION")) || is_word(PC_WORD("LOCAL")))
+            {
+                scope = true;
+                token = next_token();
+            }
+            else if (is_word(PC_WORD("FULL")))
+            {
+                full = true;
+                token = next_token();
+            }
+        }
+
+        if (token == TK_WORD)
+        {
+            if (is_word(PC_WORD("DATABASES")))
+            {
+                type_mask = QUERY_TYPE_SHOW_DATABASES;
+                rv = !scope && !full && parse_like_opt();
+            }
+            else if (is_word(PC_WORD("TABLES")))
+            {
+                type_mask = QUERY_TYPE_SHOW_TABLES;
+                rv = !scope && parse_from_opt() && parse_like_opt();
+            }
+            else if (is_word(PC_WORD("VARIABLES")))
+            {
+                type_mask = global ? QUERY_TYPE_GSYSVAR_READ : QUERY_TYPE_SYSVAR_READ;
+                rv = !full && parse_like_opt();
+            }
+            else if (is_word(PC_WORD("STATUS")))
+            {
+                // qc_sqlite does not report any type for SHOW STATUS.
+                type_mask = QUERY_TYPE_UNKNOWN;
+                rv = !full && parse_like_opt();
+            }
+            else if (is_word(PC_WORD("WARNINGS")))
+            {
+                type_mask = QUERY_TYPE_WRITE;
+                rv = !scope && !full && (next_token() == PARSER_EXHAUSTED);
+            }
+            else if (is_word(PC_WORD("SLAVE")) || is_word(PC_WORD("MASTER")))
+            {
+                type_mask = is_word(PC_WORD("SLAVE")) ? QUERY_TYPE_READ : QUERY_TYPE_WRITE;
+                rv = !scope && !full &&
+                    (next_token() == TK_WORD) && is_word(PC_WORD("STATUS")) &&
+                    (next_token() == PARSER_EXHAUSTED);
+            }
+        }
+
+        if (rv)
+        {
+            *pType_mask = type_mask;
+        }
+
+        return rv;
+    }
+
+    bool parse_from_opt()
+    {
+        bool rv = true;
+        const char* pI = m_pI;
+
+        if ((next_token() == TK_WORD) && (is_word(PC_WORD("FROM")) || is_word(PC_WORD("IN"))))
+        {
+            token_t token = next_token();
+            rv = (token == TK_WORD || token == TK_QUOTED_ID);
+        }
+        else
+        {
+            m_pI = pI;
+        }
+
+        return rv;
+    }
+
+    bool parse_like_opt()
+    {
+        bool rv = true;
+        token_t token = next_token();
+
+        if (token == TK_WORD && is_word(PC_WORD("LIKE")))
+        {
+            rv = (next_token() == TK_STRING) && (next_token() == PARSER_EXHAUSTED);
+        }
+        else
+        {
+            rv = (token == PARSER_EXHAUSTED);
+        }
+
+        return rv;
+    }
+
+    bool parse_use(uint32_t* pType_mask)
+    {
+        token_t token = next_token();
+
+        bool rv = (token == TK_WORD || token == TK_QUOTED_ID) && (next_token() == PARSER_EXHAUSTED);
+
+        if (rv)
+        {
+            *pType_mask = QUERY_TYPE_SESSION_WRITE;
+        }
+
+        return rv;
+    }
+
+    /**
+     * @return True, if the current word may precede a parenthesis that
+     *         starts an expression and not a function call.
+     */
+    bool is_condition_word() const
+    {
+        return
+            is_word(PC_WORD("IN")) ||
+            is_word(PC_WORD("AND")) ||
+            is_word(PC_WORD("OR")) ||
+            is_word(PC_WORD("NOT")) ||
+            is_word(PC_WORD("WHERE")) ||
+            is_word(PC_WORD("ON"));
+    }
+
+    /**
+     * @return True, if the current variable is "@@global", "@@session" or "@@local".
+     */
+    bool is_scope_variable() const
+    {
+        return
+            is_word(PC_WORD("@@GLOBAL")) ||
+            is_word(PC_WORD("@@SESSION")) ||
+            is_word(PC_WORD("@@LOCAL"));
+    }
+
+    // Significantly faster than library version.
+    static char toupper(char c)
+    {
+        return (c >= 'a' && c <='z') ? c - ('a' - 'A') : c;
+    }
+
+    static bool is_name_char(char c)
+    {
+        return isalnum((unsigned char)c) || (c == '_') || (c == '$');
+    }
+
+    /**
+     * @return True, if the current token is the word, case insensitively.
+     */
+    bool is_word(const char* zWord, int len) const
+    {
+        return (m_token_len == len) && is_prefix(zWord, len);
+    }
+
+    /**
+     * @return True, if the current token starts with the word, case insensitively.
+     */
+    bool is_prefix(const char* zWord, int len) const
+    {
+        bool rv = (m_token_len >= len);
+
+        for (int i = 0; rv && (i < len); ++i)
+        {
+            rv = (toupper(m_pToken[i]) == zWord[i]);
+        }
+
+        return rv;
+    }
+
+    /**
+     * Skip a quoted string or identifier, the current position being at
+     * the opening quote.
+     *
+     * @return True, if the closing quote was found.
+     */
+    bool skip_quoted()
+    {
+        char quote = *m_pI++;
+        bool rv = false;
+
+        while (!rv && (m_pI < m_pEnd))
+        {
+            char c = *m_pI++;
+
+            if (c == '\\' && quote != '`')
+            {
+                ++m_pI;
+            }
+            else if (c == quote)
+            {
+                if ((m_pI < m_pEnd) && (*m_pI == quote))
+                {
+                    ++m_pI;
+                }
+                else
+                {
+                    rv = true;
+                }
+            }
+        }
+
+        return rv && (m_pI <= m_pEnd);
+    }
+
+    void skip_name()
+    {
+        while ((m_pI < m_pEnd) && is_name_char(*m_pI))
+        {
+            ++m_pI;
+        }
+    }
+
+    token_t next_token()
+    {
+        token_t token = PARSER_UNKNOWN_TOKEN;
+
+        // Comments are not bypassed, as they may contain executable
+        // MySQL comments, and statements with comments are left to
+        // the query classifier.
+        while ((m_pI < m_pEnd) && isspace((unsigned char)*m_pI))
+        {
+            ++m_pI;
+        }
+
+        m_pToken = m_pI;
+
+        if (m_pI == m_pEnd)
+        {
+            token = PARSER_EXHAUSTED;
+        }
+        else
+        {
+            char c = *m_pI;
+
+            switch (c)
+            {
+            case ';':
+                ++m_pI;
+
+                while ((m_pI != m_pEnd) && isspace((unsigned char)*m_pI))
+                {
+                    ++m_pI;
+                }
+
+                // Multi-statements are left to the query classifier.
+                if (m_pI == m_pEnd)
+                {
+                    token = PARSER_EXHAUSTED;
+                }
+                break;
+
+            case '\'':
+            case '"':
+                if (skip_quoted())
+                {
+                    token = TK_STRING;
+                }
+                break;
+
+            case '`':
+                if (skip_quoted())
+                {
+                    token = TK_QUOTED_ID;
+                }
+                break;
+
+            case '@':
+                ++m_pI;
+
+                if ((m_pI < m_pEnd) && (*m_pI == '@'))
+                {
+                    ++m_pI;
+                }
+
+                if ((m_pI < m_pEnd) && is_name_char(*m_pI))
+                {
+                    skip_name();
+                    token = TK_VARIABLE;
+                }
+                break;
+
+            case '(':
+                ++m_pI;
+                token = TK_LP;
+                break;
+
+            case ')':
+                ++m_pI;
+                token = TK_RP;
+                break;
+
+            case ',':
+                ++m_pI;
+                token = TK_COMMA;
+                break;
+
+            case '.':
+                ++m_pI;
+                token = TK_DOT;
+                break;
+
+            case '=':
+                ++m_pI;
+                token = TK_EQ;
+                break;
+
+            case '-':
+                // "--" starts a comment.
+                if ((m_pI + 1 == m_pEnd) || (*(m_pI + 1) != '-'))
+                {
+                    ++m_pI;
+                    token = TK_OPERATOR;
+                }
+                break;
+
+            case '/':
+                // "/*" starts a comment.
+                if ((m_pI + 1 == m_pEnd) || (*(m_pI + 1) != '*'))
+                {
+                    ++m_pI;
+                    token = TK_OPERATOR;
+                }
+                break;
+
+            case '<':
+            case '>':
+            case '!':
+            case '+':
+            case '*':
+            case '%':
+            case '&':
+            case '|':
+            case '^':
+            case '~':
+                ++m_pI;
+                token = TK_OPERATOR;
+                break;
+
+            default:
+                if (isdigit((unsigned char)c))
+                {
+                    while ((m_pI < m_pEnd) && (is_name_char(*m_pI) || (*m_pI == '.')))
+                    {
+                        char p = toupper(*m_pI++);
+
+                        if ((p == 'E') && (m_pI < m_pEnd) && ((*m_pI == '+') || (*m_pI == '-')))
+                        {
+                            ++m_pI;
+                        }
+                    }
+
+                    token = TK_NUMBER;
+                }
+                else if (is_name_char(c))
+                {
+                    skip_name();
+                    token = TK_WORD;
+                }
+                // Anything else, including comments, placeholders and non-ASCII
+                // names, is left to the query classifier.
+            }
+        }
+
+        m_token_len = m_pI - m_pToken;
+
+        return token;
+    }
+
+private:
+    PreClassifier(const PreClassifier&);
+    PreClassifier& operator = (const PreClassifier&);
+
+private:
+    const char* m_pSql;
+    int         m_len;
+    const char* m_pI;
+    const char* m_pEnd;
+    const char* m_pToken;
+    int         m_token_len;
+};
+
+}
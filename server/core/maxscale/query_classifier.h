@@ -36,4 +36,34 @@ typedef enum qc_trx_parse_using
  */
 uint32_t qc_get_trx_type_mask_using(GWBUF* stmt, qc_trx_parse_using_t use);
 
+typedef enum qc_type_parse_using
+{
+    QC_TYPE_PARSE_USING_QC,     /**< Use the query classifier. */
+    QC_TYPE_PARSE_USING_PARSER, /**< Use custom parser, if possible, otherwise the query classifier. */
+} qc_type_parse_using_t;
+
+/**
+ * Returns the type bitmask of a statement.
+ *
+ * @param stmt  A COM_QUERY or COM_STMT_PREPARE packet.
+ * @param use   What method should be used.
+ *
+ * @return The type bitmask of the statement.
+ *
+ * @see qc_get_type_mask
+ */
+uint32_t qc_get_type_mask_using(GWBUF* stmt, qc_type_parse_using_t use);
+
+/**
+ * Returns the operation of a statement.
+ *
+ * @param stmt  A COM_QUERY or COM_STMT_PREPARE packet.
+ * @param use   What method should be used.
+ *
+ * @return The operation of the statement.
+ *
+ * @see qc_get_operation
+ */
+qc_query_op_t qc_get_operation_using(GWBUF* stmt, qc_type_parse_using_t use);
+
 MXS_END_DECLS
@@ -0,0 +1,33 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file
+ *
+ * Internal code for the statement statistics.
+ */
+
+#include <maxscale/topqueries.h>
+#include <maxscale/resultset.h>
+
+MXS_BEGIN_DECLS
+
+/**
+ * @brief Get the heaviest statements of all registered statistics
+ *
+ * @return A result set with one row for each statement
+ */
+RESULTSET* topQueriesGetList();
+
+MXS_END_DECLS
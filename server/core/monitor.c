@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <maxscale/alloc.h>
 #include <mysqld_error.h>
@@ -42,6 +43,7 @@
 #include <maxscale/pcre2.h>
 #include <maxscale/secrets.h>
 #include <maxscale/spinlock.h>
+#include <maxscale/thread.h>
 
 #include "maxscale/config.h"
 #include "maxscale/externcmd.h"
@@ -272,6 +274,10 @@ bool monitorAddServer(MXS_MONITOR *mon, SERVER *server)
         db->mon_prev_status = -1;
         /* pending status is updated by get_replication_tree */
         db->pending_status = 0;
+        db->probe_last = 0;
+        db->probe_max = 0;
+        db->probe_total = 0;
+        db->probe_count = 0;
 
         monitor_state_t old_state = mon->state;
 
@@ -471,6 +477,19 @@ monitorShow(DCB *dcb, MXS_MONITOR *monitor)
         sep = ", ";
     }
 
+    dcb_printf(dcb, "\n");
+    dcb_printf(dcb, "Probe durations:   ");
+
+    sep = "";
+
+    for (MXS_MONITOR_SERVERS *db = monitor->databases; db; db = db->next)
+    {
+        uint64_t avg = db->probe_count ? db->probe_total / db->probe_count : 0;
+        dcb_printf(dcb, "%s[%s]:%d last %lu us, avg %lu us, max %lu us", sep,
+                   db->server->name, db->server->port, db->probe_last, avg, db->probe_max);
+        sep = ", ";
+    }
+
     dcb_printf(dcb, "\n");
 
     if (monitor->handle)
@@ -1505,3 +1524,101 @@ void mon_process_state_changes(MXS_MONITOR *monitor, const char *script, uint64_
         }
     }
 }
+
+/** A probe of a single server, run by mon_probe_servers */
+typedef struct mon_probe_task
+{
+    mxs_monitor_probe_t probe;
+    MXS_MONITOR *monitor;
+    MXS_MONITOR_SERVERS *database;
+    THREAD thread;
+    bool threaded;
+} MON_PROBE_TASK;
+
+static void mon_run_probe(MON_PROBE_TASK *task)
+{
+    struct timespec start;
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    task->probe(task->monitor, task->database);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    MXS_MONITOR_SERVERS *db = task->database;
+    uint64_t usecs = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+
+    db->probe_last = usecs;
+    db->probe_total += usecs;
+    db->probe_count++;
+
+    if (usecs > db->probe_max)
+    {
+        db->probe_max = usecs;
+    }
+}
+
+static void mon_probe_thread(void *data)
+{
+    MON_PROBE_TASK *task = (MON_PROBE_TASK*)data;
+
+    if (mysql_thread_init() == 0)
+    {
+        mon_run_probe(task);
+        mysql_thread_end();
+    }
+    else
+    {
+        MXS_ERROR("[%s] mysql_thread_init failed, could not probe server [%s]:%d.",
+                  task->monitor->name, task->database->server->name,
+                  task->database->server->port);
+    }
+}
+
+void mon_probe_servers(MXS_MONITOR *monitor, mxs_monitor_probe_t probe)
+{
+    int n_servers = 0;
+
+    for (MXS_MONITOR_SERVERS *db = monitor->databases; db; db = db->next)
+    {
+        n_servers++;
+    }
+
+    if (n_servers == 0)
+    {
+        return;
+    }
+
+    MON_PROBE_TASK tasks[n_servers];
+    int i = 0;
+
+    for (MXS_MONITOR_SERVERS *db = monitor->databases; db; db = db->next, i++)
+    {
+        tasks[i].probe = probe;
+        tasks[i].monitor = monitor;
+        tasks[i].database = db;
+        tasks[i].threaded = false;
+
+        /** The first server is probed by the calling thread */
+        if (i > 0)
+        {
+            tasks[i].threaded = thread_start(&tasks[i].thread, mon_probe_thread, &tasks[i]) != NULL;
+        }
+    }
+
+    for (i = 0; i < n_servers; i++)
+    {
+        if (!tasks[i].threaded)
+        {
+            /** Also used if a thread could not be started */
+            mon_run_probe(&tasks[i]);
+        }
+    }
+
+    for (i = 0; i < n_servers; i++)
+    {
+        if (tasks[i].threaded)
+        {
+            thread_wait(tasks[i].thread);
+        }
+    }
+}
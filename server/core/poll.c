@@ -29,6 +29,7 @@
 #include <maxscale/config.h>
 #include <maxscale/dcb.h>
 #include <maxscale/housekeeper.h>
+#include <maxscale/listener.h>
 #include <maxscale/log_manager.h>
 #include <maxscale/platform.h>
 #include <maxscale/query_classifier.h>
@@ -158,6 +159,9 @@ typedef struct
     DCB *cur_dcb;       /*< Current DCB being processed */
     uint32_t event;     /*< Current event being processed */
     uint64_t cycle_start; /*< The time when the poll loop was started */
+    uint64_t n_accepted;  /*< No. of connections accepted by the thread */
+    uint64_t n_accepted_last; /*< n_accepted at the previous load sample */
+    double accept_rate;   /*< Accepted connections per second */
 } THREAD_DATA;
 
 static THREAD_DATA *thread_data = NULL;    /*< Status of each thread */
@@ -273,6 +277,9 @@ poll_init()
         for (int i = 0; i < n_threads; i++)
         {
             thread_data[i].state = THREAD_STOPPED;
+            thread_data[i].n_accepted = 0;
+            thread_data[i].n_accepted_last = 0;
+            thread_data[i].accept_rate = 0;
         }
     }
 
@@ -381,6 +388,12 @@ int poll_add_dcb(DCB *dcb)
     {
         owner = dcb->session->client_dcb->thread.id;
     }
+    else if (dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER && dcb->listener &&
+             dcb->listener->listener && dcb->listener->listener->listener_fds)
+    {
+        /** The connection was accepted from the socket of this thread */
+        owner = current_thread_id;
+    }
     else
     {
         owner = (unsigned int)atomic_add(&next_epoll_fd, 1) % n_threads;
@@ -394,18 +407,22 @@ int poll_add_dcb(DCB *dcb)
 
     if (dcb->dcb_role == DCB_ROLE_SERVICE_LISTENER)
     {
-        /** Listeners are added to all epoll instances */
+        /** Listeners are added to all epoll instances, each thread gets its
+         * own socket if the listener has one for each thread */
         int nthr = config_threadcount();
 
         for (int i = 0; i < nthr; i++)
         {
-            if ((rc = epoll_ctl(epoll_fd[i], EPOLL_CTL_ADD, dcb->fd, &ev)))
+            int fd = dcb->listener_fds ? dcb->listener_fds[i] : dcb->fd;
+
+            if ((rc = epoll_ctl(epoll_fd[i], EPOLL_CTL_ADD, fd, &ev)))
             {
                 error_num = errno;
                 /** Remove the listener from the previous epoll instances */
                 for (int j = 0; j < i; j++)
                 {
-                    epoll_ctl(epoll_fd[j], EPOLL_CTL_DEL, dcb->fd, &ev);
+                    fd = dcb->listener_fds ? dcb->listener_fds[j] : dcb->fd;
+                    epoll_ctl(epoll_fd[j], EPOLL_CTL_DEL, fd, &ev);
                 }
                 break;
             }
@@ -484,7 +501,8 @@ int poll_remove_dcb(DCB *dcb)
 
             for (int i = 0; i < nthr; i++)
             {
-                int tmp_rc = epoll_ctl(epoll_fd[i], EPOLL_CTL_DEL, dcb->fd, &ev);
+                int fd = dcb->listener_fds ? dcb->listener_fds[i] : dcb->fd;
+                int tmp_rc = epoll_ctl(epoll_fd[i], EPOLL_CTL_DEL, fd, &ev);
                 if (tmp_rc && rc == 0)
                 {
                     /** Even if one of the instances failed to remove it, try
@@ -1373,6 +1391,29 @@ dShowThreads(DCB *dcb)
             }
         }
     }
+
+    dcb_printf(dcb, "\nAccepted connections:\n\n");
+    dcb_printf(dcb, " ID | Total      | Per second\n");
+    dcb_printf(dcb, "----+------------+-----------\n");
+
+    for (i = 0; i < n_threads; i++)
+    {
+        dcb_printf(dcb, " %2d | %10lu | %10.2f\n",
+                   i, thread_data[i].n_accepted, thread_data[i].accept_rate);
+    }
+}
+
+int poll_current_thread_id()
+{
+    return current_thread_id;
+}
+
+void poll_count_accept()
+{
+    if (thread_data)
+    {
+        thread_data[current_thread_id].n_accepted++;
+    }
 }
 
 /**
@@ -1392,6 +1433,17 @@ poll_loadav(void *data)
     last_samples = load_samples;
     last_nfds = load_nfds;
 
+    if (thread_data)
+    {
+        for (int i = 0; i < n_threads; i++)
+        {
+            uint64_t n_accepted = thread_data[i].n_accepted;
+            thread_data[i].accept_rate = (double)(n_accepted - thread_data[i].n_accepted_last) /
+                                         POLL_LOAD_FREQ;
+            thread_data[i].n_accepted_last = n_accepted;
+        }
+    }
+
     /* POLL_LOAD_FREQ average is... */
     if (new_samples)
     {
@@ -19,6 +19,7 @@
 #include <maxscale/pcre2.h>
 #include <maxscale/utils.h>
 #include "maxscale/trxboundaryparser.hh"
+#include "maxscale/preclassifier.hh"
 
 #include "../core/maxscale/modules.h"
 
@@ -39,10 +40,12 @@ struct type_name_info
 
 static const char DEFAULT_QC_NAME[] = "qc_sqlite";
 static const char QC_TRX_PARSE_USING[] = "QC_TRX_PARSE_USING";
+static const char QC_TYPE_PARSE_USING[] = "QC_TYPE_PARSE_USING";
 
 static QUERY_CLASSIFIER* classifier;
 
 static qc_trx_parse_using_t qc_trx_parse_using = QC_TRX_PARSE_USING_PARSER;
+static qc_type_parse_using_t qc_type_parse_using = QC_TYPE_PARSE_USING_PARSER;
 
 
 bool qc_setup(const char* plugin_name, const char* plugin_args)
@@ -98,6 +101,27 @@ bool qc_process_init(uint32_t kind)
         }
     }
 
+    parse_using = getenv(QC_TYPE_PARSE_USING);
+
+    if (parse_using)
+    {
+        if (strcmp(parse_using, "QC_TYPE_PARSE_USING_QC") == 0)
+        {
+            qc_type_parse_using = QC_TYPE_PARSE_USING_QC;
+            MXS_NOTICE("Statement classification using QC.");
+        }
+        else if (strcmp(parse_using, "QC_TYPE_PARSE_USING_PARSER") == 0)
+        {
+            qc_type_parse_using = QC_TYPE_PARSE_USING_PARSER;
+            MXS_NOTICE("Statement classification using custom PARSER, if possible.");
+        }
+        else
+        {
+            MXS_NOTICE("QC_TYPE_PARSE_USING set, but the value %s is not known. "
+                       "Classifying using custom PARSER, if possible.", parse_using);
+        }
+    }
+
     bool rc = qc_thread_init(QC_INIT_SELF);
 
     if (rc)
@@ -190,28 +214,76 @@ qc_parse_result_t qc_parse(GWBUF* query, uint32_t collect)
     return (qc_parse_result_t)result;
 }
 
-uint32_t qc_get_type_mask(GWBUF* query)
+/**
+ * Classify a statement using the custom parser.
+ *
+ * A statement that already has been parsed by the query classifier is not
+ * classified, as then the result of the query classifier is readily available.
+ *
+ * @param query       A COM_QUERY or COM_STMT_PREPARE packet.
+ * @param type_mask   On successful return, the type mask.
+ * @param op          On successful return, the operation.
+ *
+ * @return True, if the custom parser could classify the statement.
+ */
+static bool qc_preclassify(GWBUF* query, uint32_t* type_mask, qc_query_op_t* op)
+{
+    bool rv = false;
+
+    if (!GWBUF_IS_PARSED(query))
+    {
+        maxscale::PreClassifier preclassifier;
+
+        rv = preclassifier.classify(query, type_mask, op);
+    }
+
+    return rv;
+}
+
+uint32_t qc_get_type_mask_using(GWBUF* query, qc_type_parse_using_t use)
 {
     QC_TRACE();
     ss_dassert(classifier);
 
     uint32_t type_mask = QUERY_TYPE_UNKNOWN;
+    qc_query_op_t op;
 
-    classifier->qc_get_type_mask(query, &type_mask);
+    if ((use != QC_TYPE_PARSE_USING_PARSER) || !qc_preclassify(query, &type_mask, &op))
+    {
+        classifier->qc_get_type_mask(query, &type_mask);
+    }
 
     return type_mask;
 }
 
-qc_query_op_t qc_get_operation(GWBUF* query)
+uint32_t qc_get_type_mask(GWBUF* query)
+{
+    return qc_get_type_mask_using(query, qc_type_parse_using);
+}
+
+qc_query_op_t qc_get_operation_using(GWBUF* query, qc_type_parse_using_t use)
 {
     QC_TRACE();
     ss_dassert(classifier);
 
-    int32_t op = QUERY_OP_UNDEFINED;
+    uint32_t type_mask;
+    qc_query_op_t op = QUERY_OP_UNDEFINED;
+
+    if ((use != QC_TYPE_PARSE_USING_PARSER) || !qc_preclassify(query, &type_mask, &op))
+    {
+        int32_t rv = QUERY_OP_UNDEFINED;
+
+        classifier->qc_get_operation(query, &rv);
 
-    classifier->qc_get_operation(query, &op);
+        op = (qc_query_op_t)rv;
+    }
+
+    return op;
+}
 
-    return (qc_query_op_t)op;
+qc_query_op_t qc_get_operation(GWBUF* query)
+{
+    return qc_get_operation_using(query, qc_type_parse_using);
 }
 
 char* qc_get_created_table_name(GWBUF* query)
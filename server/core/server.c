@@ -580,6 +580,7 @@ dprintServer(DCB *dcb, const SERVER *server)
                    l->ssl_key ? l->ssl_key : "null");
         dcb_printf(dcb, "\tSSL CA certificate:                  %s\n",
                    l->ssl_ca_cert ? l->ssl_ca_cert : "null");
+        ssl_print_handshake_stats(dcb, l);
     }
 }
 
@@ -1448,6 +1448,15 @@ void dprintService(DCB *dcb, SERVICE *service)
                service->stats.n_sessions);
     dcb_printf(dcb, "\tCurrently connected:                 %d\n",
                service->stats.n_current);
+
+    for (SERV_LISTENER *port = service->ports; port; port = port->next)
+    {
+        if (port->ssl)
+        {
+            dcb_printf(dcb, "\tListener:                            %s\n", port->name);
+            ssl_print_handshake_stats(dcb, port->ssl);
+        }
+    }
 }
 
 /**
@@ -1663,6 +1672,42 @@ int service_refresh_users(SERVICE *service)
     return ret;
 }
 
+static void service_refresh_users_task(void *data)
+{
+    SERVICE *service = (SERVICE*)data;
+    service_refresh_users(service);
+    atomic_add(&service->rate_limit.pending, -1);
+}
+
+/**
+ * Refresh the database users for the service in the housekeeper thread
+ *
+ * This is meant for callers that do not need the result of the refresh, so
+ * that the thread calling this does not have to wait for the users to be
+ * loaded from the backend servers. At most one refresh is pending at a time
+ * and the refresh is subject to the same rate limit as service_refresh_users().
+ *
+ * @param service Service to reload
+ */
+void service_refresh_users_async(SERVICE *service)
+{
+    if (atomic_add(&service->rate_limit.pending, 1) == 0)
+    {
+        char taskname[strlen(service->name) + sizeof("_refresh_users")];
+        snprintf(taskname, sizeof(taskname), "%s_refresh_users", service->name);
+
+        if (hktask_oneshot(taskname, service_refresh_users_task, service, 0) == 0)
+        {
+            MXS_ERROR("[%s] Failed to schedule the refresh of the users.", service->name);
+            atomic_add(&service->rate_limit.pending, -1);
+        }
+    }
+    else
+    {
+        atomic_add(&service->rate_limit.pending, -1);
+    }
+}
+
 void service_add_parameters(SERVICE *service, const MXS_CONFIG_PARAMETER *param)
 {
     while (param)
@@ -25,10 +25,13 @@
  *
  * @endverbatim
  */
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
+#include <maxscale/atomic.h>
 #include <maxscale/dcb.h>
 #include <maxscale/service.h>
 #include <maxscale/log_manager.h>
@@ -214,3 +217,70 @@ const char* ssl_method_type_to_string(ssl_method_type_t method_type)
         return "Unknown";
     }
 }
+
+/**
+ * @brief Return a monotonic timestamp in microseconds
+ */
+static uint64_t ssl_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void ssl_handshake_started(DCB *dcb, SSL_LISTENER *ssl)
+{
+    dcb->ssl_handshake_start = ssl_now();
+
+    if (dcb->dcb_role == DCB_ROLE_BACKEND_HANDLER)
+    {
+        spinlock_acquire(&ssl->lock);
+
+        if (ssl->session)
+        {
+            /** SSL_set_session takes its own reference to the session */
+            SSL_set_session(dcb->ssl, ssl->session);
+        }
+
+        spinlock_release(&ssl->lock);
+    }
+}
+
+void ssl_handshake_completed(DCB *dcb, SSL_LISTENER *ssl)
+{
+    if (SSL_session_reused(dcb->ssl))
+    {
+        atomic_add_int64(&ssl->n_resumed_handshakes, 1);
+    }
+    else
+    {
+        atomic_add_int64(&ssl->n_full_handshakes, 1);
+    }
+
+    atomic_add_int64(&ssl->handshake_time, ssl_now() - dcb->ssl_handshake_start);
+
+    if (dcb->dcb_role == DCB_ROLE_BACKEND_HANDLER)
+    {
+        SSL_SESSION *session = SSL_get1_session(dcb->ssl);
+
+        spinlock_acquire(&ssl->lock);
+        SSL_SESSION *old_session = ssl->session;
+        ssl->session = session;
+        spinlock_release(&ssl->lock);
+
+        if (old_session)
+        {
+            SSL_SESSION_free(old_session);
+        }
+    }
+}
+
+void ssl_print_handshake_stats(DCB *dcb, const SSL_LISTENER *ssl)
+{
+    int64_t n_handshakes = ssl->n_full_handshakes + ssl->n_resumed_handshakes;
+
+    dcb_printf(dcb, "\tSSL full handshakes:                 %" PRId64 "\n", ssl->n_full_handshakes);
+    dcb_printf(dcb, "\tSSL resumed handshakes:              %" PRId64 "\n", ssl->n_resumed_handshakes);
+    dcb_printf(dcb, "\tSSL average handshake time (us):     %" PRId64 "\n",
+               n_handshakes ? ssl->handshake_time / n_handshakes : 0);
+}
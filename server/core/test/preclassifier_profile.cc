@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/cppdefs.hh>
+#include <iomanip>
+#include <iostream>
+#include <maxscale/alloc.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+#include "../maxscale/preclassifier.hh"
+#include "../maxscale/query_classifier.h"
+
+using namespace std;
+
+namespace
+{
+
+char USAGE[] = "usage: preclassifier_profile [-q] -n count -s statement\n"
+    "\n"
+    "-q    profile also the query classifier\n";
+
+timespec timespec_subtract(const timespec& later, const timespec& earlier)
+{
+    timespec result = { 0, 0 };
+
+    ss_dassert((later.tv_sec > earlier.tv_sec) ||
+               ((later.tv_sec == earlier.tv_sec) && (later.tv_nsec > earlier.tv_nsec)));
+
+    if (later.tv_nsec >= earlier.tv_nsec)
+    {
+        result.tv_sec = later.tv_sec - earlier.tv_sec;
+        result.tv_nsec = later.tv_nsec - earlier.tv_nsec;
+    }
+    else
+    {
+        result.tv_sec = later.tv_sec - earlier.tv_sec - 1;
+        result.tv_nsec = 1000000000 + later.tv_nsec - earlier.tv_nsec;
+    }
+
+    return result;
+}
+
+GWBUF* create_gwbuf(const char* zStmt)
+{
+    size_t len = strlen(zStmt);
+    size_t payload_len = len + 1;
+    size_t gwbuf_len = MYSQL_HEADER_LEN + payload_len;
+
+    GWBUF* pBuf = gwbuf_alloc(gwbuf_len);
+
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf))) = payload_len;
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 1)) = (payload_len >> 8);
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 2)) = (payload_len >> 16);
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 3)) = 0x00;
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 4)) = 0x03;
+    memcpy((char*)GWBUF_DATA(pBuf) + 5, zStmt, len);
+
+    return pBuf;
+}
+
+void print_time(const char* zWhat, const timespec& start, const timespec& finish)
+{
+    struct timespec diff = timespec_subtract(finish, start);
+
+    cout << zWhat << ":" << diff.tv_sec << "." << setfill('0') << setw(9) << diff.tv_nsec << endl;
+}
+
+void profile_preclassifier(const char* zStatement, int nCount)
+{
+    size_t len = strlen(zStatement);
+    maxscale::PreClassifier preclassifier;
+    uint32_t type_mask = 0;
+    qc_query_op_t op = QUERY_OP_UNDEFINED;
+    bool classified = false;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+    for (int i = 0; i < nCount; ++i)
+    {
+        classified = preclassifier.classify(zStatement, len, &type_mask, &op);
+    }
+
+    struct timespec finish;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &finish);
+
+    print_time("Time", start, finish);
+
+    if (classified)
+    {
+        char* zType_mask = qc_typemask_to_string(type_mask);
+
+        cout << "Type:" << zType_mask << ", " << qc_op_to_string(op) << endl;
+
+        MXS_FREE(zType_mask);
+    }
+    else
+    {
+        cout << "Type:not classified, the query classifier would be used." << endl;
+    }
+}
+
+void profile_qc(const char* zStatement, int nCount)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+    for (int i = 0; i < nCount; ++i)
+    {
+        // A new buffer each time, as the parsing result is stored in the buffer.
+        GWBUF* pStmt = create_gwbuf(zStatement);
+
+        qc_get_type_mask_using(pStmt, QC_TYPE_PARSE_USING_QC);
+        qc_get_operation_using(pStmt, QC_TYPE_PARSE_USING_QC);
+
+        gwbuf_free(pStmt);
+    }
+
+    struct timespec finish;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &finish);
+
+    print_time("QC time", start, finish);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+
+    int nCount = 0;
+    const char* zStatement = NULL;
+    bool qc = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:s:q")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            nCount = atoi(optarg);
+            break;
+
+        case 's':
+            zStatement = optarg;
+            break;
+
+        case 'q':
+            qc = true;
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if ((rc == EXIT_SUCCESS) && zStatement && (nCount > 0))
+    {
+        rc = EXIT_FAILURE;
+
+        set_datadir(strdup("/tmp"));
+        set_langdir(strdup("."));
+        set_process_datadir(strdup("/tmp"));
+
+        if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+        {
+            profile_preclassifier(zStatement, nCount);
+
+            if (qc)
+            {
+                if (qc_setup("qc_sqlite", NULL) && qc_process_init(QC_INIT_BOTH))
+                {
+                    profile_qc(zStatement, nCount);
+                    qc_process_end(QC_INIT_BOTH);
+                    rc = EXIT_SUCCESS;
+                }
+                else
+                {
+                    cerr << "error: Could not initialize qc_sqlite." << endl;
+                }
+            }
+            else
+            {
+                rc = EXIT_SUCCESS;
+            }
+
+            mxs_log_finish();
+        }
+        else
+        {
+            cerr << "error: Could not initialize log." << endl;
+        }
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rc;
+}
@@ -207,6 +207,20 @@ int test_required_parameters()
     return 0;
 }
 
+int test_parse_size()
+{
+    TEST(config_parse_size("0") == 0);
+    TEST(config_parse_size("256") == 256);
+    TEST(config_parse_size("256k") == 256000);
+    TEST(config_parse_size("256Ki") == 256 * 1024);
+    TEST(config_parse_size("64M") == 64000000);
+    TEST(config_parse_size("64mi") == 64 * 1024 * 1024);
+    TEST(config_parse_size("2G") == 2000000000ULL);
+    TEST(config_parse_size("2Gi") == 2ULL * 1024 * 1024 * 1024);
+    TEST(config_parse_size("1Ti") == 1024ULL * 1024 * 1024 * 1024);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     int result = 0;
@@ -214,6 +228,7 @@ int main(int argc, char **argv)
     result += test_validity();
     result += test_add_parameter();
     result += test_required_parameters();
+    result += test_parse_size();
 
     return result;
 }
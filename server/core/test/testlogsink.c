@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test logsink.h functionality
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <maxscale/alloc.h>
+#include <maxscale/config.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/thread.h>
+
+#include "../maxscale/logsink.h"
+
+#define TEST(a, b) do{if (!(a)){printf("%s:%d "b"\n", __FILE__, __LINE__);return 1;}}while(false)
+
+#define N_THREADS 8
+#define N_RECORDS 10000
+
+static char filename[] = "/tmp/testlogsink.XXXXXX";
+
+static LOGSINK_CONFIG default_config =
+{
+    1024 * 1024,
+    64 * 1024,
+    10,
+    LOGSINK_BLOCK
+};
+
+static off_t file_size()
+{
+    struct stat st;
+    return stat(filename, &st) == 0 ? st.st_size : -1;
+}
+
+static LOGSINK *thread_sink;
+
+static void write_records(void *data)
+{
+    int id = (intptr_t)data;
+
+    for (int i = 0; i < N_RECORDS; i++)
+    {
+        logsink_printf(thread_sink, "%d %d\n", id, i);
+    }
+}
+
+/**
+ * Write from several threads and check that the records of each thread are
+ * written completely and in order.
+ */
+int test_threads()
+{
+    thread_sink = logsink_open(filename, false, &default_config);
+    TEST(thread_sink, "Opening the log sink should succeed");
+
+    THREAD threads[N_THREADS];
+
+    for (intptr_t i = 0; i < N_THREADS; i++)
+    {
+        TEST(thread_start(&threads[i], write_records, (void*)i), "Starting a thread should succeed");
+    }
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        thread_wait(threads[i]);
+    }
+
+    TEST(logsink_flush(thread_sink), "Flushing should succeed");
+
+    FILE *fp = fopen(filename, "r");
+    TEST(fp, "The file should be readable");
+
+    int next[N_THREADS] = {};
+    int id, n;
+
+    while (fscanf(fp, "%d %d\n", &id, &n) == 2)
+    {
+        TEST(id >= 0 && id < N_THREADS, "Thread ID should be valid");
+        TEST(next[id] == n, "The records of a thread should be in order");
+        next[id]++;
+    }
+
+    fclose(fp);
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        TEST(next[i] == N_RECORDS, "All records should be written");
+    }
+
+    LOGSINK_STATS stats;
+    logsink_get_stats(thread_sink, &stats);
+    TEST(stats.records == N_THREADS * N_RECORDS, "All records should be counted");
+    TEST(stats.dropped == 0, "No records should be dropped");
+    TEST(stats.errors == 0, "There should be no write errors");
+
+    logsink_close(thread_sink);
+    return 0;
+}
+
+/**
+ * Fill a small buffer with the drop policy.
+ */
+int test_drop()
+{
+    LOGSINK_CONFIG config = {4096, 1024 * 1024, 1000000, LOGSINK_DROP};
+    LOGSINK *sink = logsink_open(filename, false, &config);
+    TEST(sink, "Opening the log sink should succeed");
+
+    char record[100];
+    memset(record, 'a', sizeof(record) - 1);
+    record[sizeof(record) - 1] = '\n';
+
+    int added = 0;
+
+    for (int i = 0; i < 100; i++)
+    {
+        added += logsink_write(sink, record, sizeof(record));
+    }
+
+    TEST(added < 100, "Some records should be dropped");
+
+    LOGSINK_STATS stats;
+    logsink_get_stats(sink, &stats);
+    TEST(stats.records == (uint64_t)added, "Added records should be counted");
+    TEST(stats.records + stats.dropped == 100, "Dropped records should be counted");
+
+    TEST(logsink_flush(sink), "Flushing should succeed");
+    TEST(file_size() == added * (off_t)sizeof(record), "The added records should be written");
+
+    logsink_close(sink);
+    return 0;
+}
+
+/**
+ * Fill a small buffer with the block policy and write a record that is
+ * larger than the buffer.
+ */
+int test_block()
+{
+    LOGSINK_CONFIG config = {4096, 1024 * 1024, 1000000, LOGSINK_BLOCK};
+    LOGSINK *sink = logsink_open(filename, false, &config);
+    TEST(sink, "Opening the log sink should succeed");
+
+    char record[100];
+    memset(record, 'b', sizeof(record));
+
+    for (int i = 0; i < 100; i++)
+    {
+        TEST(logsink_write(sink, record, sizeof(record)), "Writing should succeed");
+    }
+
+    size_t large_size = 10000;
+    char *large = MXS_MALLOC(large_size);
+    TEST(large, "Memory allocation should succeed");
+    memset(large, 'c', large_size);
+    TEST(logsink_write(sink, large, large_size), "Writing a large record should succeed");
+    MXS_FREE(large);
+
+    LOGSINK_STATS stats;
+    logsink_get_stats(sink, &stats);
+    TEST(stats.records == 101, "All records should be added");
+    TEST(stats.dropped == 0, "No records should be dropped");
+    TEST(stats.blocked > 0, "The buffer should have been full");
+
+    TEST(logsink_flush(sink), "Flushing should succeed");
+    TEST(file_size() == (off_t)(100 * sizeof(record) + large_size), "All records should be written");
+
+    TEST(logsink_truncate(sink), "Truncating should succeed");
+    TEST(file_size() == 0, "The file should be empty");
+
+    logsink_close(sink);
+    return 0;
+}
+
+/**
+ * Check that the writer thread writes the records and that closing the
+ * log sink writes the buffered records.
+ */
+int test_writer()
+{
+    LOGSINK *sink = logsink_open(filename, false, &default_config);
+    TEST(sink, "Opening the log sink should succeed");
+
+    TEST(logsink_printf(sink, "Hello\n"), "Writing should succeed");
+
+    for (int i = 0; i < 100 && file_size() == 0; i++)
+    {
+        thread_millisleep(10);
+    }
+
+    TEST(file_size() == 6, "The writer thread should write the record");
+    logsink_close(sink);
+
+    LOGSINK_CONFIG config = default_config;
+    config.flush_interval = 1000000;
+    sink = logsink_open(filename, true, &config);
+    TEST(sink, "Opening the log sink should succeed");
+
+    TEST(logsink_printf(sink, "World\n"), "Writing should succeed");
+    logsink_close(sink);
+
+    for (int i = 0; i < 100 && file_size() == 6; i++)
+    {
+        thread_millisleep(10);
+    }
+
+    TEST(file_size() == 12, "Closing should write the record");
+
+    logsink_finish();
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int rc = 0;
+
+    config_get_global_options()->n_threads = 4;
+    mxs_log_init(NULL, NULL, MXS_LOG_TARGET_STDOUT);
+
+    int fd = mkstemp(filename);
+
+    if (fd == -1)
+    {
+        printf("Failed to create a temporary file.\n");
+        return 1;
+    }
+
+    close(fd);
+
+    rc += test_threads();
+    rc += test_drop();
+    rc += test_block();
+    rc += test_writer();
+
+    unlink(filename);
+    mxs_log_finish();
+
+    return rc;
+}
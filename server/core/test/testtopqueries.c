@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test topqueries.h functionality
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <maxscale/alloc.h>
+#include <maxscale/config.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/thread.h>
+
+#include "../maxscale/topqueries.h"
+
+#define TEST(a, b) do{if (!(a)){printf("%s:%d "b"\n", __FILE__, __LINE__);return 1;}}while(false)
+
+#define N_THREADS 4
+#define N_HEAVY 5
+#define N_REPEATS 1000
+
+/**
+ * Add a few frequent, slow statements among many statements that are
+ * executed only once and check that the frequent ones are found.
+ */
+int test_heavy_hitters()
+{
+    TOP_QUERIES *top = top_queries_create("heavy", N_HEAVY, 20);
+    TEST(top, "Creating the statistics should succeed");
+
+    char query[100];
+
+    for (int i = 0; i < N_REPEATS; i++)
+    {
+        for (int j = 0; j < N_HEAVY; j++)
+        {
+            sprintf(query, "SELECT * FROM t%d WHERE id = ?", j);
+            top_queries_add(top, 0, query, 100);
+        }
+
+        sprintf(query, "SELECT %d", i);
+        top_queries_add(top, 0, query, 1);
+    }
+
+    TOP_QUERY *result;
+    int n = top_queries_get(top, &result);
+    TEST(n == N_HEAVY, "The configured number of statements should be returned");
+
+    for (int i = 0; i < n; i++)
+    {
+        TEST(strncmp(result[i].canonical, "SELECT * FROM t", 15) == 0,
+             "Only the frequent statements should be returned");
+        TEST(result[i].count >= N_REPEATS, "The count should not be underestimated");
+        TEST(result[i].count - result[i].error <= N_REPEATS, "The error should bound the count");
+        TEST(result[i].max == 100, "The maximum duration should be correct");
+    }
+
+    top_queries_free_result(result, n);
+    top_queries_destroy(top);
+    return 0;
+}
+
+/**
+ * Check that statistics that can't hold any statements are rejected.
+ */
+int test_invalid_capacity()
+{
+    TEST(top_queries_create("invalid", 10, 0) == NULL, "A capacity of 0 should be rejected");
+    TEST(top_queries_create("invalid", 0, 10) == NULL, "A size of 0 should be rejected");
+    TEST(top_queries_create("invalid", 10, -1) == NULL, "A negative capacity should be rejected");
+    return 0;
+}
+
+/**
+ * Add the same statements in different threads and check that the
+ * statistics are merged.
+ */
+int test_merge()
+{
+    TOP_QUERIES *top = top_queries_create("merge", 10, 10);
+    TEST(top, "Creating the statistics should succeed");
+
+    for (int thread = 0; thread < N_THREADS + 2; thread++)
+    {
+        for (int i = 1; i <= 1000; i++)
+        {
+            top_queries_add(top, thread, "SELECT ?", i);
+        }
+
+        top_queries_add(top, thread, "SELECT ? FROM dual", 5);
+    }
+
+    TOP_QUERY *result;
+    int n = top_queries_get(top, &result);
+    TEST(n == 2, "Both statements should be returned");
+    TEST(strcmp(result[0].canonical, "SELECT ?") == 0, "The slower statement should be first");
+    TEST(result[0].count == (N_THREADS + 2) * 1000, "The counts should be merged");
+    TEST(result[0].error == 0, "No statement should have been replaced");
+    TEST(result[0].total == (N_THREADS + 2) * 500500, "The durations should be merged");
+    TEST(result[0].max == 1000, "The maximum duration should be correct");
+    TEST(result[0].p50 >= 500 && result[0].p50 <= 750, "The median should be close");
+    TEST(result[0].p99 >= 990 && result[0].p99 <= 1000, "The 99th percentile should be close");
+    TEST(result[1].count == N_THREADS + 2, "The counts should be merged");
+    TEST(result[1].p95 == 5, "The percentile should not exceed the maximum");
+
+    top_queries_free_result(result, n);
+    top_queries_destroy(top);
+    return 0;
+}
+
+static TOP_QUERIES *thread_top;
+
+static void add_statements(void *data)
+{
+    int id = (intptr_t)data;
+    char query[100];
+
+    for (int i = 0; i < 100000; i++)
+    {
+        sprintf(query, "SELECT %d", i % 50);
+        top_queries_add(thread_top, id, query, i % 100);
+    }
+}
+
+/**
+ * Add statements from several threads while the statistics are read.
+ */
+int test_threads()
+{
+    thread_top = top_queries_create("threads", 100, 20);
+    TEST(thread_top, "Creating the statistics should succeed");
+
+    THREAD threads[N_THREADS];
+
+    for (intptr_t i = 0; i < N_THREADS; i++)
+    {
+        TEST(thread_start(&threads[i], add_statements, (void*)i), "Starting a thread should succeed");
+    }
+
+    for (int i = 0; i < 100; i++)
+    {
+        RESULTSET *set = topQueriesGetList();
+        TEST(set, "Creating the result set should succeed");
+
+        RESULT_ROW *row;
+
+        while ((row = set->fetchrow(set, set->userdata)))
+        {
+            TEST(row->n_cols == 9, "The row should have all columns");
+            resultset_free_row(row);
+        }
+
+        resultset_free(set);
+    }
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        thread_wait(threads[i]);
+    }
+
+    TOP_QUERY *result;
+    int n = top_queries_get(thread_top, &result);
+    TEST(n > 0 && n <= 100, "Statements should be returned");
+
+    uint64_t count = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        count += result[i].count;
+    }
+
+    TEST(count >= N_THREADS * 100000, "All executions should be counted");
+
+    top_queries_free_result(result, n);
+    top_queries_destroy(thread_top);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int rc = 0;
+
+    config_get_global_options()->n_threads = N_THREADS;
+    mxs_log_init(NULL, NULL, MXS_LOG_TARGET_STDOUT);
+
+    rc += test_heavy_hitters();
+    rc += test_invalid_capacity();
+    rc += test_merge();
+    rc += test_threads();
+
+    mxs_log_finish();
+
+    return rc;
+}
@@ -0,0 +1,779 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file topqueries.c - Service-wide statistics of the heaviest statements
+ *
+ * Each thread has a shard that holds at most `capacity` statements. The
+ * statements of a shard are in a min-heap ordered by the execution count so
+ * that the statement replaced by the space-saving algorithm is always at the
+ * top of the heap. A hash index maps the canonical statements to the entries.
+ *
+ * The durations of each statement are counted in a histogram with two
+ * buckets for each power of two, which gives the percentiles with an error
+ * of at most 50%.
+ *
+ * The lock of a shard is only taken by the thread that owns it, except when
+ * the statistics are read, so it is practically never contended.
+ */
+
+#include "maxscale/topqueries.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <maxscale/alloc.h>
+#include <maxscale/config.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/spinlock.h>
+
+/** Number of duration histogram buckets */
+#define TQ_BUCKETS 64
+
+/** Longest stored canonical statement, longer ones are truncated */
+#define TQ_MAX_LEN 1024
+
+typedef struct tq_entry
+{
+    uint64_t hash;           /**< Hash of the canonical statement */
+    char    *canonical;      /**< The canonical statement */
+    size_t   canonical_size; /**< Size of the canonical statement buffer */
+    uint64_t count;          /**< Execution count, an upper bound */
+    uint64_t error;          /**< The count inherited from the replaced statement */
+    uint64_t samples;        /**< Executions counted in the durations */
+    uint64_t total;          /**< Total duration */
+    uint64_t max;            /**< Longest duration */
+    int      heap_pos;       /**< Position of the entry in the heap */
+    uint32_t buckets[TQ_BUCKETS]; /**< Duration histogram */
+} TQ_ENTRY;
+
+typedef struct tq_shard
+{
+    SPINLOCK  lock;
+    TQ_ENTRY *entries;    /**< The statements */
+    int      *heap;       /**< Entry indexes, the smallest count first */
+    int      *index;      /**< Hash index of the entries, -1 for empty slots */
+    int       index_size; /**< Size of the index, a power of two */
+    int       n_entries;  /**< Number of used entries */
+} TQ_SHARD;
+
+struct top_queries
+{
+    char        *name;
+    int          size;     /**< Number of reported statements */
+    int          capacity; /**< Statements per shard */
+    TQ_SHARD    *shards;   /**< One shard per worker and one for the others */
+    int          n_shards;
+    TOP_QUERIES *next;
+};
+
+/** All statement statistics */
+static struct
+{
+    SPINLOCK     lock;
+    TOP_QUERIES *list;
+} this_unit =
+{
+    SPINLOCK_INIT,
+    NULL
+};
+
+/** FNV-1a */
+static uint64_t statement_hash(const char *canonical)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const char *ptr = canonical; *ptr; ptr++)
+    {
+        hash ^= (uint8_t)*ptr;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static int duration_bucket(uint64_t duration)
+{
+    uint64_t value = duration + 1;
+    int bits = 63 - __builtin_clzll(value);
+    int bucket = bits == 0 ? 0 : 2 * bits + ((value >> (bits - 1)) & 1);
+
+    return MXS_MIN(bucket, TQ_BUCKETS - 1);
+}
+
+/** The longest duration that belongs to a bucket */
+static uint64_t bucket_limit(int bucket)
+{
+    int bits = bucket / 2;
+
+    if (bits == 0)
+    {
+        return 0;
+    }
+
+    uint64_t half = 1ULL << (bits - 1);
+    return (1ULL << bits) + ((bucket & 1) + 1) * half - 2;
+}
+
+static uint64_t percentile(const TQ_ENTRY *entry, int pct)
+{
+    uint64_t limit = (entry->samples * pct + 99) / 100;
+    uint64_t sum = 0;
+
+    for (int i = 0; i < TQ_BUCKETS; i++)
+    {
+        sum += entry->buckets[i];
+
+        if (sum >= limit && sum > 0)
+        {
+            return MXS_MIN(bucket_limit(i), entry->max);
+        }
+    }
+
+    return entry->max;
+}
+
+static void heap_swap(TQ_SHARD *shard, int a, int b)
+{
+    int tmp = shard->heap[a];
+    shard->heap[a] = shard->heap[b];
+    shard->heap[b] = tmp;
+    shard->entries[shard->heap[a]].heap_pos = a;
+    shard->entries[shard->heap[b]].heap_pos = b;
+}
+
+static inline uint64_t heap_count(TQ_SHARD *shard, int pos)
+{
+    return shard->entries[shard->heap[pos]].count;
+}
+
+static void heap_sift_up(TQ_SHARD *shard, int pos)
+{
+    while (pos > 0 && heap_count(shard, (pos - 1) / 2) > heap_count(shard, pos))
+    {
+        heap_swap(shard, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+static void heap_sift_down(TQ_SHARD *shard, int pos)
+{
+    while (true)
+    {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+
+        if (left < shard->n_entries && heap_count(shard, left) < heap_count(shard, smallest))
+        {
+            smallest = left;
+        }
+
+        if (right < shard->n_entries && heap_count(shard, right) < heap_count(shard, smallest))
+        {
+            smallest = right;
+        }
+
+        if (smallest == pos)
+        {
+            break;
+        }
+
+        heap_swap(shard, pos, smallest);
+        pos = smallest;
+    }
+}
+
+/**
+ * Find a statement in the index
+ *
+ * @param slot Set to the slot of the statement or to the free slot where it
+ *             should be added
+ *
+ * @return The entry index or -1 if the statement is not in the shard
+ */
+static int index_find(TQ_SHARD *shard, uint64_t hash, const char *canonical, int *slot)
+{
+    int mask = shard->index_size - 1;
+    int i = hash & mask;
+
+    while (shard->index[i] != -1)
+    {
+        TQ_ENTRY *entry = &shard->entries[shard->index[i]];
+
+        if (entry->hash == hash && strncmp(entry->canonical, canonical, TQ_MAX_LEN) == 0)
+        {
+            break;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    *slot = i;
+    return shard->index[i];
+}
+
+/** Remove an entry from the index, moving the following entries back */
+static void index_remove(TQ_SHARD *shard, int entry)
+{
+    int mask = shard->index_size - 1;
+    int i = shard->entries[entry].hash & mask;
+
+    while (shard->index[i] != entry)
+    {
+        i = (i + 1) & mask;
+    }
+
+    for (int j = (i + 1) & mask; shard->index[j] != -1; j = (j + 1) & mask)
+    {
+        int home = shard->entries[shard->index[j]].hash & mask;
+
+        // Move the entry back unless its home slot is between i and j
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+        {
+            shard->index[i] = shard->index[j];
+            i = j;
+        }
+    }
+
+    shard->index[i] = -1;
+}
+
+static bool entry_set_canonical(TQ_ENTRY *entry, const char *canonical)
+{
+    size_t len = strlen(canonical);
+
+    if (len > TQ_MAX_LEN)
+    {
+        len = TQ_MAX_LEN;
+    }
+
+    if (len + 1 > entry->canonical_size)
+    {
+        char *str = MXS_REALLOC(entry->canonical, len + 1);
+
+        if (str == NULL)
+        {
+            return false;
+        }
+
+        entry->canonical = str;
+        entry->canonical_size = len + 1;
+    }
+
+    memcpy(entry->canonical, canonical, len);
+    entry->canonical[len] = '\0';
+    return true;
+}
+
+static void entry_reset(TQ_ENTRY *entry, uint64_t hash, uint64_t count)
+{
+    entry->hash = hash;
+    entry->count = count + 1;
+    entry->error = count;
+    entry->samples = 0;
+    entry->total = 0;
+    entry->max = 0;
+    memset(entry->buckets, 0, sizeof(entry->buckets));
+}
+
+/**
+ * Find or add the entry of a statement
+ *
+ * @return The entry or NULL if memory allocation failed
+ */
+static TQ_ENTRY* shard_get_entry(TQ_SHARD *shard, int capacity, const char *canonical)
+{
+    uint64_t hash = statement_hash(canonical);
+    int slot;
+    int i = index_find(shard, hash, canonical, &slot);
+
+    if (i != -1)
+    {
+        shard->entries[i].count++;
+        heap_sift_down(shard, shard->entries[i].heap_pos);
+    }
+    else if (shard->n_entries < capacity)
+    {
+        i = shard->n_entries;
+
+        if (!entry_set_canonical(&shard->entries[i], canonical))
+        {
+            return NULL;
+        }
+
+        entry_reset(&shard->entries[i], hash, 0);
+        shard->index[slot] = i;
+        shard->heap[i] = i;
+        shard->entries[i].heap_pos = i;
+        shard->n_entries++;
+        heap_sift_up(shard, i);
+    }
+    else
+    {
+        // Replace the statement with the smallest count
+        i = shard->heap[0];
+        TQ_ENTRY *entry = &shard->entries[i];
+        index_remove(shard, i);
+
+        if (!entry_set_canonical(entry, canonical))
+        {
+            index_find(shard, entry->hash, entry->canonical, &slot);
+            shard->index[slot] = i;
+            return NULL;
+        }
+
+        entry_reset(entry, hash, entry->count);
+        index_find(shard, hash, canonical, &slot);
+        shard->index[slot] = i;
+        heap_sift_down(shard, 0);
+    }
+
+    return &shard->entries[i];
+}
+
+TOP_QUERIES* top_queries_create(const char *name, int size, int capacity)
+{
+    if (size < 1 || capacity < 1)
+    {
+        MXS_ERROR("Invalid size %d or capacity %d for statement statistics '%s', "
+                  "both must be at least 1.", size, capacity, name);
+        return NULL;
+    }
+
+    TOP_QUERIES *top = MXS_CALLOC(1, sizeof(TOP_QUERIES));
+    int n_shards = config_threadcount() + 1;
+    TQ_SHARD *shards = MXS_CALLOC(n_shards, sizeof(TQ_SHARD));
+    char *my_name = MXS_STRDUP(name);
+    int index_size = 1;
+
+    while (index_size < 2 * capacity)
+    {
+        index_size *= 2;
+    }
+
+    bool error = top == NULL || shards == NULL || my_name == NULL;
+
+    for (int i = 0; !error && i < n_shards; i++)
+    {
+        TQ_SHARD *shard = &shards[i];
+        spinlock_init(&shard->lock);
+        shard->entries = MXS_CALLOC(capacity, sizeof(TQ_ENTRY));
+        shard->heap = MXS_CALLOC(capacity, sizeof(int));
+        shard->index = MXS_MALLOC(index_size * sizeof(int));
+        shard->index_size = index_size;
+
+        if (shard->entries && shard->heap && shard->index)
+        {
+            memset(shard->index, -1, index_size * sizeof(int));
+        }
+        else
+        {
+            error = true;
+        }
+    }
+
+    if (error)
+    {
+        for (int i = 0; shards && i < n_shards; i++)
+        {
+            MXS_FREE(shards[i].entries);
+            MXS_FREE(shards[i].heap);
+            MXS_FREE(shards[i].index);
+        }
+
+        MXS_FREE(shards);
+        MXS_FREE(my_name);
+        MXS_FREE(top);
+        return NULL;
+    }
+
+    top->name = my_name;
+    top->size = size;
+    top->capacity = capacity;
+    top->shards = shards;
+    top->n_shards = n_shards;
+
+    spinlock_acquire(&this_unit.lock);
+    top->next = this_unit.list;
+    this_unit.list = top;
+    spinlock_release(&this_unit.lock);
+
+    return top;
+}
+
+void top_queries_destroy(TOP_QUERIES *top)
+{
+    if (top)
+    {
+        spinlock_acquire(&this_unit.lock);
+
+        for (TOP_QUERIES **ptr = &this_unit.list; *ptr; ptr = &(*ptr)->next)
+        {
+            if (*ptr == top)
+            {
+                *ptr = top->next;
+                break;
+            }
+        }
+
+        spinlock_release(&this_unit.lock);
+
+        for (int i = 0; i < top->n_shards; i++)
+        {
+            for (int j = 0; j < top->capacity; j++)
+            {
+                MXS_FREE(top->shards[i].entries[j].canonical);
+            }
+
+            MXS_FREE(top->shards[i].entries);
+            MXS_FREE(top->shards[i].heap);
+            MXS_FREE(top->shards[i].index);
+        }
+
+        MXS_FREE(top->shards);
+        MXS_FREE(top->name);
+        MXS_FREE(top);
+    }
+}
+
+void top_queries_add(TOP_QUERIES *top, int thread_id, const char *canonical, uint64_t duration)
+{
+    int i = thread_id >= 0 && thread_id < top->n_shards - 1 ? thread_id : top->n_shards - 1;
+    TQ_SHARD *shard = &top->shards[i];
+
+    spinlock_acquire(&shard->lock);
+
+    TQ_ENTRY *entry = shard_get_entry(shard, top->capacity, canonical);
+
+    if (entry)
+    {
+        entry->samples++;
+        entry->total += duration;
+        entry->buckets[duration_bucket(duration)]++;
+
+        if (duration > entry->max)
+        {
+            entry->max = duration;
+        }
+    }
+
+    spinlock_release(&shard->lock);
+}
+
+static int cmp_statement(const void *va, const void *vb)
+{
+    const TQ_ENTRY *a = (const TQ_ENTRY*)va;
+    const TQ_ENTRY *b = (const TQ_ENTRY*)vb;
+
+    if (a->hash != b->hash)
+    {
+        return a->hash < b->hash ? -1 : 1;
+    }
+
+    return strcmp(a->canonical, b->canonical);
+}
+
+static int cmp_total(const void *va, const void *vb)
+{
+    const TQ_ENTRY *a = (const TQ_ENTRY*)va;
+    const TQ_ENTRY *b = (const TQ_ENTRY*)vb;
+
+    if (a->total != b->total)
+    {
+        return a->total < b->total ? 1 : -1;
+    }
+
+    if (a->count != b->count)
+    {
+        return a->count < b->count ? 1 : -1;
+    }
+
+    return strcmp(a->canonical, b->canonical);
+}
+
+int top_queries_get(TOP_QUERIES *top, TOP_QUERY **result)
+{
+    TQ_ENTRY *all = MXS_MALLOC(top->n_shards * top->capacity * sizeof(TQ_ENTRY));
+
+    if (all == NULL)
+    {
+        return -1;
+    }
+
+    int n = 0;
+    bool error = false;
+
+    for (int i = 0; i < top->n_shards; i++)
+    {
+        TQ_SHARD *shard = &top->shards[i];
+
+        spinlock_acquire(&shard->lock);
+
+        for (int j = 0; j < shard->n_entries; j++)
+        {
+            all[n] = shard->entries[j];
+
+            if ((all[n].canonical = MXS_STRDUP(shard->entries[j].canonical)))
+            {
+                n++;
+            }
+            else
+            {
+                error = true;
+            }
+        }
+
+        spinlock_release(&shard->lock);
+    }
+
+    // Combine the entries of the same statement
+    int n_unique = 0;
+
+    if (n > 0)
+    {
+        qsort(all, n, sizeof(TQ_ENTRY), cmp_statement);
+        n_unique = 1;
+
+        for (int i = 1; i < n; i++)
+        {
+            TQ_ENTRY *prev = &all[n_unique - 1];
+
+            if (cmp_statement(prev, &all[i]) == 0)
+            {
+                prev->count += all[i].count;
+                prev->error += all[i].error;
+                prev->samples += all[i].samples;
+                prev->total += all[i].total;
+                prev->max = MXS_MAX(prev->max, all[i].max);
+
+                for (int j = 0; j < TQ_BUCKETS; j++)
+                {
+                    prev->buckets[j] += all[i].buckets[j];
+                }
+
+                MXS_FREE(all[i].canonical);
+            }
+            else
+            {
+                all[n_unique++] = all[i];
+            }
+        }
+
+        qsort(all, n_unique, sizeof(TQ_ENTRY), cmp_total);
+    }
+
+    int n_result = MXS_MIN(n_unique, top->size);
+    TOP_QUERY *rval = error ? NULL : MXS_CALLOC(MXS_MAX(n_result, 1), sizeof(TOP_QUERY));
+
+    for (int i = 0; rval && i < n_result; i++)
+    {
+        rval[i].canonical = all[i].canonical;
+        rval[i].count = all[i].count;
+        rval[i].error = all[i].error;
+        rval[i].samples = all[i].samples;
+        rval[i].total = all[i].total;
+        rval[i].max = all[i].max;
+        rval[i].p50 = percentile(&all[i], 50);
+        rval[i].p95 = percentile(&all[i], 95);
+        rval[i].p99 = percentile(&all[i], 99);
+        all[i].canonical = NULL;
+    }
+
+    for (int i = 0; i < n_unique; i++)
+    {
+        MXS_FREE(all[i].canonical);
+    }
+
+    MXS_FREE(all);
+
+    if (rval == NULL)
+    {
+        return -1;
+    }
+
+    *result = rval;
+    return n_result;
+}
+
+void top_queries_free_result(TOP_QUERY *result, int n)
+{
+    if (result)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            MXS_FREE(result[i].canonical);
+        }
+
+        MXS_FREE(result);
+    }
+}
+
+const char* top_queries_get_name(const TOP_QUERIES *top)
+{
+    return top->name;
+}
+
+/** The rows of the result set */
+typedef struct
+{
+    char     **names;
+    TOP_QUERY *queries;
+    int        n;
+    int        current;
+} TQ_ROWS;
+
+static void free_rows(TQ_ROWS *rows)
+{
+    for (int i = 0; i < rows->n; i++)
+    {
+        MXS_FREE(rows->names[i]);
+        MXS_FREE(rows->queries[i].canonical);
+    }
+
+    MXS_FREE(rows->names);
+    MXS_FREE(rows->queries);
+    MXS_FREE(rows);
+}
+
+/**
+ * Provide a row to the result set of the heaviest statements
+ *
+ * @param set   The result set
+ * @param data  The rows
+ * @return The next row or NULL
+ */
+static RESULT_ROW* topQueriesRowCallback(RESULTSET *set, void *data)
+{
+    TQ_ROWS *rows = (TQ_ROWS*)data;
+
+    if (rows->current >= rows->n)
+    {
+        free_rows(rows);
+        return NULL;
+    }
+
+    TOP_QUERY *query = &rows->queries[rows->current];
+    RESULT_ROW *row = resultset_make_row(set);
+    char buf[40];
+
+    resultset_row_set(row, 0, rows->names[rows->current]);
+    resultset_row_set(row, 1, query->canonical);
+    snprintf(buf, sizeof(buf), "%lu", query->count);
+    resultset_row_set(row, 2, buf);
+    snprintf(buf, sizeof(buf), "%.3f", query->total / 1000.0);
+    resultset_row_set(row, 3, buf);
+    snprintf(buf, sizeof(buf), "%.3f", query->samples ? query->total / 1000.0 / query->samples : 0);
+    resultset_row_set(row, 4, buf);
+    snprintf(buf, sizeof(buf), "%.3f", query->max / 1000.0);
+    resultset_row_set(row, 5, buf);
+    snprintf(buf, sizeof(buf), "%.3f", query->p50 / 1000.0);
+    resultset_row_set(row, 6, buf);
+    snprintf(buf, sizeof(buf), "%.3f", query->p95 / 1000.0);
+    resultset_row_set(row, 7, buf);
+    snprintf(buf, sizeof(buf), "%.3f", query->p99 / 1000.0);
+    resultset_row_set(row, 8, buf);
+
+    rows->current++;
+    return row;
+}
+
+/** Append the heaviest statements of one set of statistics to the rows */
+static bool add_rows(TQ_ROWS *rows, TOP_QUERIES *top)
+{
+    TOP_QUERY *queries;
+    int n = top_queries_get(top, &queries);
+
+    if (n < 0)
+    {
+        return false;
+    }
+
+    char **names = MXS_REALLOC(rows->names, (rows->n + n + 1) * sizeof(char*));
+
+    if (names)
+    {
+        rows->names = names;
+    }
+
+    TOP_QUERY *all = MXS_REALLOC(rows->queries, (rows->n + n + 1) * sizeof(TOP_QUERY));
+
+    if (all)
+    {
+        rows->queries = all;
+    }
+
+    if (names == NULL || all == NULL)
+    {
+        top_queries_free_result(queries, n);
+        return false;
+    }
+
+    int added = 0;
+
+    while (added < n && (rows->names[rows->n] = MXS_STRDUP(top->name)))
+    {
+        // The canonical statement is now owned by the rows
+        rows->queries[rows->n++] = queries[added++];
+    }
+
+    for (int i = added; i < n; i++)
+    {
+        MXS_FREE(queries[i].canonical);
+    }
+
+    MXS_FREE(queries);
+    return added == n;
+}
+
+RESULTSET* topQueriesGetList()
+{
+    TQ_ROWS *rows = MXS_CALLOC(1, sizeof(TQ_ROWS));
+
+    if (rows == NULL)
+    {
+        return NULL;
+    }
+
+    bool ok = true;
+
+    spinlock_acquire(&this_unit.lock);
+
+    for (TOP_QUERIES *top = this_unit.list; top && ok; top = top->next)
+    {
+        ok = add_rows(rows, top);
+    }
+
+    spinlock_release(&this_unit.lock);
+
+    RESULTSET *set;
+
+    if (!ok || (set = resultset_create(topQueriesRowCallback, rows)) == NULL)
+    {
+        free_rows(rows);
+        return NULL;
+    }
+
+    resultset_add_column(set, "Filter", 20, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Query", 80, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Count", 20, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Total Time (ms)", 20, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Average Time (ms)", 20, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Max Time (ms)", 20, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "50th Percentile (ms)", 20, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "95th Percentile (ms)", 20, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "99th Percentile (ms)", 20, COL_TYPE_VARCHAR);
+
+    return set;
+}
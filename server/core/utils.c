@@ -922,9 +922,14 @@ static bool configure_network_socket(int so)
 static bool configure_listener_socket(int so)
 {
     int one = 1;
+    int sndbuf = MXS_CLIENT_SO_SNDBUF;
+    int rcvbuf = MXS_CLIENT_SO_RCVBUF;
 
+    /** The buffer sizes are inherited by the accepted client sockets */
     if (setsockopt(so, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
-        setsockopt(so, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) != 0)
+        setsockopt(so, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) != 0 ||
+        setsockopt(so, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) != 0 ||
+        setsockopt(so, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) != 0)
     {
         MXS_ERROR("Failed to set socket option: %d, %s.", errno, mxs_strerror(errno));
         return false;
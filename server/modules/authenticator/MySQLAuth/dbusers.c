@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
 #include <mysql.h>
 #include <netdb.h>
 
@@ -74,8 +75,16 @@ static char* get_new_users_query(const char *server_version, bool include_root)
 
 int replace_mysql_users(SERV_LISTENER *listener, bool skip_local)
 {
+    MYSQL_AUTH *instance = (MYSQL_AUTH*)listener->auth_instance;
+    struct timespec start;
+    struct timespec end;
+
     spinlock_acquire(&listener->lock);
+    clock_gettime(CLOCK_MONOTONIC, &start);
     int i = get_users(listener, skip_local);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    instance->load_duration = (end.tv_sec - start.tv_sec) * 1000 +
+                              (end.tv_nsec - start.tv_nsec) / 1000000;
     spinlock_release(&listener->lock);
     return i;
 }
@@ -258,27 +267,6 @@ int validate_mysql_user(sqlite3 *handle, DCB *dcb, MYSQL_session *session,
     return rval;
 }
 
-/**
- * @brief Delete all users
- *
- * @param handle SQLite handle
- */
-static bool delete_mysql_users(sqlite3 *handle)
-{
-    bool rval = true;
-    char *err;
-
-    if (sqlite3_exec(handle, delete_users_query, NULL, NULL, &err) != SQLITE_OK ||
-        sqlite3_exec(handle, delete_databases_query, NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to delete old users: %s", err);
-        sqlite3_free(err);
-        rval = false;
-    }
-
-    return rval;
-}
-
 /**
  * If the hostname is of form a.b.c.d/e.f.g.h where e-h is 255 or 0, replace
  * the zeros in the first part with '%' and remove the second part. This does
@@ -342,6 +330,42 @@ static void merge_netmask(char *host)
     }
 }
 
+/**
+ * Convert a password into the form in which it is stored
+ *
+ * @param user User the password belongs to
+ * @param host Host of the user
+ * @param pw   The password, set to the stored form or to NULL if the user
+ *             has no password
+ *
+ * @return True if the user can be added, false if the password is not supported
+ */
+static bool convert_password(const char *user, const char *host, const char **pw)
+{
+    if (*pw && **pw)
+    {
+        if (strlen(*pw) == 16)
+        {
+            MXS_ERROR("The user %s@%s has on old password in the "
+                      "backend database. MaxScale does not support these "
+                      "old passwords. This user will not be able to connect "
+                      "via MaxScale. Update the users password to correct "
+                      "this.", user, host);
+            return false;
+        }
+        else if (**pw == '*')
+        {
+            (*pw)++;
+        }
+    }
+    else
+    {
+        *pw = NULL;
+    }
+
+    return true;
+}
+
 void add_mysql_user(sqlite3 *handle, const char *user, const char *host,
                     const char *db, bool anydb, const char *pw)
 {
@@ -357,24 +381,16 @@ void add_mysql_user(sqlite3 *handle, const char *user, const char *host,
         strcpy(dbstr, null_token);
     }
 
-    size_t pwlen = pw && *pw ? strlen(pw) + 2 : sizeof(null_token); /** +2 for single quotes */
+    if (!convert_password(user, host, &pw))
+    {
+        return;
+    }
+
+    size_t pwlen = pw ? strlen(pw) + 2 : sizeof(null_token); /** +2 for single quotes */
     char pwstr[pwlen + 1];
 
-    if (pw && *pw)
+    if (pw)
     {
-        if (strlen(pw) == 16)
-        {
-            MXS_ERROR("The user %s@%s has on old password in the "
-                      "backend database. MaxScale does not support these "
-                      "old passwords. This user will not be able to connect "
-                      "via MaxScale. Update the users password to correct "
-                      "this.", user, host);
-            return;
-        }
-        else if (*pw == '*')
-        {
-            pw++;
-        }
         sprintf(pwstr, "'%s'", pw);
     }
     else
@@ -397,21 +413,6 @@ void add_mysql_user(sqlite3 *handle, const char *user, const char *host,
     MXS_INFO("Added user: %s", insert_sql);
 }
 
-static void add_database(sqlite3 *handle, const char *db)
-{
-    size_t len = sizeof(insert_database_query) + strlen(db) + 1;
-    char insert_sql[len + 1];
-
-    sprintf(insert_sql, insert_database_query, db);
-
-    char *err;
-    if (sqlite3_exec(handle, insert_sql, NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to insert database: %s", err);
-        sqlite3_free(err);
-    }
-}
-
 /**
  * Returns a MYSQL object suitably configured.
  *
@@ -726,7 +727,247 @@ void commit_sqlite_transaction(sqlite3 *handle)
     }
 }
 
-int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV_LISTENER *listener)
+/**
+ * @brief Add a user to the staging table
+ *
+ * @param stmt  Prepared @c insert_staged_user_query
+ * @param user  Username
+ * @param host  Host
+ * @param db    Database
+ * @param anydb Global access to databases
+ * @param pw    Password
+ */
+static void add_staged_user(sqlite3_stmt *stmt, const char *user, const char *host,
+                            const char *db, bool anydb, const char *pw)
+{
+    if (convert_password(user, host, &pw))
+    {
+        sqlite3_bind_text(stmt, 1, user, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, host, -1, SQLITE_STATIC);
+
+        if (db && *db)
+        {
+            sqlite3_bind_text(stmt, 3, db, -1, SQLITE_STATIC);
+        }
+        else
+        {
+            sqlite3_bind_null(stmt, 3);
+        }
+
+        sqlite3_bind_int(stmt, 4, anydb ? 1 : 0);
+
+        if (pw)
+        {
+            sqlite3_bind_text(stmt, 5, pw, -1, SQLITE_STATIC);
+        }
+        else
+        {
+            sqlite3_bind_null(stmt, 5);
+        }
+
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            MXS_ERROR("Failed to insert user: %s", sqlite3_errmsg(sqlite3_db_handle(stmt)));
+        }
+
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+}
+
+/**
+ * @brief Add a database to the staging table
+ *
+ * @param stmt Prepared @c insert_staged_database_query
+ * @param db   Database
+ */
+static void add_staged_database(sqlite3_stmt *stmt, const char *db)
+{
+    sqlite3_bind_text(stmt, 1, db, -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        MXS_ERROR("Failed to insert database: %s", sqlite3_errmsg(sqlite3_db_handle(stmt)));
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+/**
+ * @brief Execute a statement that modifies the loaded users
+ *
+ * @param handle  SQLite handle
+ * @param sql     Statement to execute
+ * @param changes The number of modified rows is added to this
+ *
+ * @return True on success
+ */
+static bool apply_changes(sqlite3 *handle, const char *sql, int *changes)
+{
+    char *err;
+
+    if (sqlite3_exec(handle, sql, NULL, NULL, &err) != SQLITE_OK)
+    {
+        MXS_ERROR("Failed to apply the loaded users: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+
+    *changes += sqlite3_changes(handle);
+    return true;
+}
+
+/**
+ * @brief Replace the loaded users with the staged ones
+ *
+ * Only the rows that differ are modified and all of it is done in one
+ * transaction, so a user whose grants did not change is never missing.
+ *
+ * @param instance Authenticator instance
+ *
+ * @return True if the staged users were applied
+ */
+static bool apply_staged_users(MYSQL_AUTH *instance)
+{
+    sqlite3 *handle = instance->handle;
+    int added = 0;
+    int removed = 0;
+    char *err;
+
+    if (sqlite3_exec(handle, "BEGIN", NULL, NULL, &err) != SQLITE_OK)
+    {
+        MXS_ERROR("Failed to start transaction: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+
+    bool rval = apply_changes(handle, apply_added_users_query, &added) &&
+                apply_changes(handle, apply_removed_users_query, &removed) &&
+                apply_changes(handle, apply_added_databases_query, &added) &&
+                apply_changes(handle, apply_removed_databases_query, &removed);
+
+    if (rval)
+    {
+        commit_sqlite_transaction(handle);
+        instance->rows_added = added;
+        instance->rows_removed = removed;
+    }
+    else if (sqlite3_exec(handle, "ROLLBACK", NULL, NULL, &err) != SQLITE_OK)
+    {
+        MXS_ERROR("Failed to roll back transaction: %s", err);
+        sqlite3_free(err);
+    }
+
+    return rval;
+}
+
+/**
+ * Update a checksum with a string, FNV-1a.
+ *
+ * @param checksum The checksum so far
+ * @param str      The string, the terminating null included
+ *
+ * @return The updated checksum
+ */
+static uint64_t update_checksum(uint64_t checksum, const char *str)
+{
+    do
+    {
+        checksum ^= (uint8_t)*str;
+        checksum *= 0x100000001b3ULL;
+    }
+    while (*str++);
+
+    return checksum;
+}
+
+/**
+ * @brief Add the checksum of the grants and databases of a server to a checksum
+ *
+ * @param con      Connection to the server
+ * @param server   The server
+ * @param checksum Checksum to update
+ *
+ * @return True if the checksum could be calculated
+ */
+static bool get_grants_checksum(MYSQL *con, SERVER *server, uint64_t *checksum)
+{
+    bool rval = false;
+
+    if (mysql_query(con, grants_checksum_query) == 0)
+    {
+        MYSQL_RES *result = mysql_store_result(con);
+
+        if (result)
+        {
+            MYSQL_ROW row;
+            rval = true;
+
+            while ((row = mysql_fetch_row(result)))
+            {
+                if (row[0] && row[1])
+                {
+                    *checksum = update_checksum(*checksum, row[0]);
+                    *checksum = update_checksum(*checksum, row[1]);
+                }
+                else
+                {
+                    /** The table does not exist or has no checksum */
+                    rval = false;
+                }
+            }
+
+            mysql_free_result(result);
+        }
+    }
+
+    if (rval && mysql_query(con, "SHOW DATABASES") == 0)
+    {
+        MYSQL_RES *result = mysql_store_result(con);
+
+        if (result)
+        {
+            MYSQL_ROW row;
+
+            while ((row = mysql_fetch_row(result)))
+            {
+                *checksum = update_checksum(*checksum, row[0]);
+            }
+
+            mysql_free_result(result);
+        }
+        else
+        {
+            rval = false;
+        }
+    }
+    else
+    {
+        rval = false;
+    }
+
+    if (!rval)
+    {
+        MXS_INFO("Could not calculate the checksum of the grants on [%s]:%d, "
+                 "users will always be reloaded: %s",
+                 server->name, server->port, mysql_error(con));
+    }
+
+    return rval;
+}
+
+/**
+ * @brief Load the users and databases of a server into the staging tables
+ *
+ * @param con      Connection to the server
+ * @param server   The server
+ * @param service  The service
+ * @param listener The listener
+ *
+ * @return Number of users loaded or -1 if the users could not be loaded
+ */
+static int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV_LISTENER *listener)
 {
     if (server->server->server_string == NULL)
     {
@@ -740,7 +981,18 @@ int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV
     char *query = get_new_users_query(server->server->server_string, service->enable_root);
     MYSQL_AUTH *instance = (MYSQL_AUTH*)listener->auth_instance;
     bool anon_user = false;
-    int users = 0;
+    int users = -1;
+    sqlite3_stmt *user_stmt = NULL;
+    sqlite3_stmt *db_stmt = NULL;
+
+    if (sqlite3_prepare_v2(instance->handle, insert_staged_user_query, -1, &user_stmt, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(instance->handle, insert_staged_database_query, -1, &db_stmt, NULL) != SQLITE_OK)
+    {
+        MXS_ERROR("Failed to prepare statement: %s", sqlite3_errmsg(instance->handle));
+        sqlite3_finalize(user_stmt);
+        MXS_FREE(query);
+        return -1;
+    }
 
     if (query)
     {
@@ -750,9 +1002,8 @@ int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV
 
             if (result)
             {
-                start_sqlite_transaction(instance->handle);
-
                 MYSQL_ROW row;
+                users = 0;
 
                 while ((row = mysql_fetch_row(result)))
                 {
@@ -766,8 +1017,8 @@ int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV
                         merge_netmask(row[1]);
                     }
 
-                    add_mysql_user(instance->handle, row[0], row[1], row[2],
-                                   row[3] && strcmp(row[3], "Y") == 0, row[4]);
+                    add_staged_user(user_stmt, row[0], row[1], row[2],
+                                    row[3] && strcmp(row[3], "Y") == 0, row[4]);
                     users++;
 
                     if (row[0] && *row[0] == '\0')
@@ -778,8 +1029,6 @@ int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV
                     }
                 }
 
-                commit_sqlite_transaction(instance->handle);
-
                 mysql_free_result(result);
             }
         }
@@ -806,7 +1055,7 @@ int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV
             MYSQL_ROW row;
             while ((row = mysql_fetch_row(result)))
             {
-                add_database(instance->handle, row[0]);
+                add_staged_database(db_stmt, row[0]);
             }
 
             mysql_free_result(result);
@@ -817,13 +1066,43 @@ int get_users_from_server(MYSQL *con, SERVER_REF *server, SERVICE *service, SERV
         MXS_ERROR("Failed to load list of databases: %s", mysql_error(con));
     }
 
+    sqlite3_finalize(user_stmt);
+    sqlite3_finalize(db_stmt);
+
     return users;
 }
 
+/**
+ * @brief Empty the staging tables
+ *
+ * @param handle SQLite handle
+ *
+ * @return True on success
+ */
+static bool clear_staged_users(sqlite3 *handle)
+{
+    bool rval = true;
+    char *err;
+
+    if (sqlite3_exec(handle, delete_staged_users_query, NULL, NULL, &err) != SQLITE_OK ||
+        sqlite3_exec(handle, delete_staged_databases_query, NULL, NULL, &err) != SQLITE_OK)
+    {
+        MXS_ERROR("Failed to delete staged users: %s", err);
+        sqlite3_free(err);
+        rval = false;
+    }
+
+    return rval;
+}
+
 /**
  * Load the user/passwd form mysql.user table into the service users' hashtable
  * environment.
  *
+ * The users are first loaded into staging tables after which only the rows that
+ * changed are applied to the users table. If the checksum of the grants on the
+ * servers has not changed since the previous load, nothing is loaded.
+ *
  * @param service   The current service
  * @param users     The users table into which to load the users
  * @return          -1 on any error or the number of users inserted
@@ -846,9 +1125,21 @@ static int get_users(SERV_LISTENER *listener, bool skip_local)
         return -1;
     }
 
-    /** Delete the old users */
     MYSQL_AUTH *instance = (MYSQL_AUTH*)listener->auth_instance;
-    delete_mysql_users(instance->handle);
+    int n_servers = 0;
+
+    for (SERVER_REF *server = service->dbref; server; server = server->next)
+    {
+        n_servers++;
+    }
+
+    /** Connect to the servers and checksum their grants before loading anything */
+    MYSQL *cons[n_servers + 1];
+    SERVER_REF *servers[n_servers + 1];
+    int n_cons = 0;
+    bool checksum_ok = true;
+    uint64_t checksum = update_checksum(0xcbf29ce484222325ULL, service->enable_root ? "Y" : "N");
+    checksum = update_checksum(checksum, service->strip_db_esc ? "Y" : "N");
 
     SERVER_REF *server = service->dbref;
     int total_users = -1;
@@ -875,14 +1166,13 @@ static int get_users(SERV_LISTENER *listener, bool skip_local)
             else
             {
                 /** Successfully connected to a server */
-                int users = get_users_from_server(con, server, service, listener);
-
-                if (users > total_users)
+                if (!get_grants_checksum(con, server->server, &checksum))
                 {
-                    total_users = users;
+                    checksum_ok = false;
                 }
 
-                mysql_close(con);
+                servers[n_cons] = server;
+                cons[n_cons++] = con;
 
                 if (!service->users_from_all)
                 {
@@ -894,7 +1184,51 @@ static int get_users(SERV_LISTENER *listener, bool skip_local)
 
     MXS_FREE(dpwd);
 
-    if (server == NULL && total_users == -1)
+    instance->load_skipped = false;
+    instance->rows_added = 0;
+    instance->rows_removed = 0;
+
+    if (n_cons > 0 && checksum_ok && checksum == instance->checksum)
+    {
+        /** The grants have not changed since the users were last loaded */
+        instance->load_skipped = true;
+        total_users = instance->users;
+    }
+    else if ((n_cons > 0 || total_users == 0) && clear_staged_users(instance->handle))
+    {
+        start_sqlite_transaction(instance->handle);
+
+        for (int i = 0; i < n_cons; i++)
+        {
+            int users = get_users_from_server(cons[i], servers[i], service, listener);
+
+            if (users > total_users)
+            {
+                total_users = users;
+            }
+        }
+
+        commit_sqlite_transaction(instance->handle);
+
+        /** The old users are kept if no users could be loaded */
+        if (total_users >= 0 && apply_staged_users(instance))
+        {
+            instance->checksum = checksum_ok ? checksum : 0;
+            instance->users = total_users;
+        }
+        else
+        {
+            instance->checksum = 0;
+            total_users = -1;
+        }
+    }
+
+    for (int i = 0; i < n_cons; i++)
+    {
+        mysql_close(cons[i]);
+    }
+
+    if (n_cons == 0 && total_users == -1)
     {
         MXS_ERROR("Unable to get user data from backend database for service [%s]."
                   " Failed to connect to any of the backend databases.", service->name);
@@ -139,6 +139,9 @@ static bool open_instance_database(const char *path, sqlite3 **handle)
 
     if (sqlite3_exec(*handle, users_create_sql, NULL, NULL, &err) != SQLITE_OK ||
         sqlite3_exec(*handle, databases_create_sql, NULL, NULL, &err) != SQLITE_OK ||
+        sqlite3_exec(*handle, users_staging_create_sql, NULL, NULL, &err) != SQLITE_OK ||
+        sqlite3_exec(*handle, users_staging_index_sql, NULL, NULL, &err) != SQLITE_OK ||
+        sqlite3_exec(*handle, databases_staging_create_sql, NULL, NULL, &err) != SQLITE_OK ||
         sqlite3_exec(*handle, pragma_sql, NULL, NULL, &err) != SQLITE_OK)
     {
         MXS_ERROR("Failed to create database: %s", err);
@@ -184,6 +187,12 @@ static void* mysql_auth_init(char **options)
         instance->inject_service_user = true;
         instance->skip_auth = false;
         instance->handle = NULL;
+        instance->checksum = 0;
+        instance->users = 0;
+        instance->rows_added = 0;
+        instance->rows_removed = 0;
+        instance->load_duration = 0;
+        instance->load_skipped = false;
 
         for (int i = 0; options[i]; i++)
         {
@@ -644,9 +653,16 @@ static int mysql_auth_load_users(SERV_LISTENER *port)
         MXS_WARNING("[%s]: failed to load any user information. Authentication"
                     " will probably fail as a result.", service->name);
     }
+    else if (loaded > 0 && instance->load_skipped)
+    {
+        MXS_NOTICE("[%s] The %d MySQL users of listener %s are up to date, checked in %ld ms.",
+                   service->name, loaded, port->name, instance->load_duration);
+    }
     else if (loaded > 0)
     {
-        MXS_NOTICE("[%s] Loaded %d MySQL users for listener %s.", service->name, loaded, port->name);
+        MXS_NOTICE("[%s] Loaded %d MySQL users for listener %s in %ld ms, %d rows added and "
+                   "%d rows removed.", service->name, loaded, port->name,
+                   instance->load_duration, instance->rows_added, instance->rows_removed);
     }
 
     return rc;
@@ -688,11 +704,14 @@ int diag_cb(void *data, int columns, char **row, char **field_names)
 
 void mysql_auth_diagnostic(DCB *dcb, SERV_LISTENER *port)
 {
-    dcb_printf(dcb, "User names: ");
-
     MYSQL_AUTH *instance = (MYSQL_AUTH*)port->auth_instance;
     char *err;
 
+    dcb_printf(dcb, "Last user load: %ld ms, %d rows added, %d rows removed%s\n",
+               instance->load_duration, instance->rows_added, instance->rows_removed,
+               instance->load_skipped ? " (grants unchanged)" : "");
+    dcb_printf(dcb, "User names: ");
+
     if (sqlite3_exec(instance->handle, "SELECT user, host FROM " MYSQLAUTH_USERS_TABLE_NAME,
                      diag_cb, dcb, &err) != SQLITE_OK)
     {
@@ -48,6 +48,10 @@ static const char DBUSERS_FILE[] = "dbusers.db";
 /** The table name where we store the users */
 #define MYSQLAUTH_DATABASES_TABLE_NAME    "mysqlauth_databases"
 
+/** The staging tables into which the users are loaded before they are applied */
+#define MYSQLAUTH_USERS_STAGING_TABLE_NAME     "mysqlauth_users_staging"
+#define MYSQLAUTH_DATABASES_STAGING_TABLE_NAME "mysqlauth_databases_staging"
+
 /** CREATE TABLE statement for the in-memory users table */
 static const char users_create_sql[] =
     "CREATE TABLE IF NOT EXISTS " MYSQLAUTH_USERS_TABLE_NAME
@@ -57,6 +61,18 @@ static const char users_create_sql[] =
 static const char databases_create_sql[] =
     "CREATE TABLE IF NOT EXISTS " MYSQLAUTH_DATABASES_TABLE_NAME "(db varchar(255))";
 
+/** CREATE TABLE statements for the staging tables, private to the instance handle */
+static const char users_staging_create_sql[] =
+    "CREATE TEMP TABLE IF NOT EXISTS " MYSQLAUTH_USERS_STAGING_TABLE_NAME
+    "(user varchar(255), host varchar(255), db varchar(255), anydb boolean, password text)";
+
+static const char users_staging_index_sql[] =
+    "CREATE INDEX IF NOT EXISTS temp." MYSQLAUTH_USERS_STAGING_TABLE_NAME "_index ON "
+    MYSQLAUTH_USERS_STAGING_TABLE_NAME "(user, host)";
+
+static const char databases_staging_create_sql[] =
+    "CREATE TEMP TABLE IF NOT EXISTS " MYSQLAUTH_DATABASES_STAGING_TABLE_NAME "(db varchar(255))";
+
 /** PRAGMA configuration options for SQLite */
 static const char pragma_sql[] = "PRAGMA JOURNAL_MODE=MEMORY";
 
@@ -84,6 +100,48 @@ static const char insert_user_query[] =
 static const char insert_database_query[] =
     "INSERT OR REPLACE INTO " MYSQLAUTH_DATABASES_TABLE_NAME " VALUES ('%s')";
 
+/** Queries that empty the staging tables before a reload */
+static const char delete_staged_users_query[] = "DELETE FROM " MYSQLAUTH_USERS_STAGING_TABLE_NAME;
+
+static const char delete_staged_databases_query[] = "DELETE FROM " MYSQLAUTH_DATABASES_STAGING_TABLE_NAME;
+
+/** Prepared statements which load the staging tables */
+static const char insert_staged_user_query[] =
+    "INSERT INTO " MYSQLAUTH_USERS_STAGING_TABLE_NAME " VALUES (?, ?, ?, ?, ?)";
+
+static const char insert_staged_database_query[] =
+    "INSERT INTO " MYSQLAUTH_DATABASES_STAGING_TABLE_NAME " VALUES (?)";
+
+/**
+ * Queries that apply the difference between the staging tables and the loaded
+ * users. The new rows are added before the stale ones are removed so that a user
+ * whose grants changed is never missing.
+ */
+static const char apply_added_users_query[] =
+    "INSERT INTO " MYSQLAUTH_USERS_TABLE_NAME
+    " SELECT user, host, db, anydb, password FROM " MYSQLAUTH_USERS_STAGING_TABLE_NAME
+    " EXCEPT SELECT user, host, db, anydb, password FROM " MYSQLAUTH_USERS_TABLE_NAME;
+
+static const char apply_removed_users_query[] =
+    "DELETE FROM " MYSQLAUTH_USERS_TABLE_NAME " WHERE NOT EXISTS (SELECT 1 FROM "
+    MYSQLAUTH_USERS_STAGING_TABLE_NAME " AS s WHERE s.user IS " MYSQLAUTH_USERS_TABLE_NAME ".user"
+    " AND s.host IS " MYSQLAUTH_USERS_TABLE_NAME ".host AND s.db IS " MYSQLAUTH_USERS_TABLE_NAME ".db"
+    " AND s.anydb IS " MYSQLAUTH_USERS_TABLE_NAME ".anydb"
+    " AND s.password IS " MYSQLAUTH_USERS_TABLE_NAME ".password)";
+
+static const char apply_added_databases_query[] =
+    "INSERT INTO " MYSQLAUTH_DATABASES_TABLE_NAME
+    " SELECT db FROM " MYSQLAUTH_DATABASES_STAGING_TABLE_NAME
+    " EXCEPT SELECT db FROM " MYSQLAUTH_DATABASES_TABLE_NAME;
+
+static const char apply_removed_databases_query[] =
+    "DELETE FROM " MYSQLAUTH_DATABASES_TABLE_NAME " WHERE db NOT IN (SELECT db FROM "
+    MYSQLAUTH_DATABASES_STAGING_TABLE_NAME ")";
+
+/** Query whose result changes whenever the grants of any user change */
+static const char grants_checksum_query[] =
+    "CHECKSUM TABLE mysql.user, mysql.db, mysql.tables_priv";
+
 static const char dump_users_query[] =
     "SELECT user, host, db, anydb, password FROM " MYSQLAUTH_USERS_TABLE_NAME;
 
@@ -104,6 +162,13 @@ typedef struct mysql_auth
     char *cache_dir;          /**< Custom cache directory location */
     bool inject_service_user; /**< Inject the service user into the list of users */
     bool skip_auth;           /**< Authentication will always be successful */
+    uint64_t checksum;        /**< Checksum of the grants the users were loaded from,
+                               * zero if not known */
+    int users;                /**< Number of users found by the latest load */
+    int rows_added;           /**< Rows added by the latest load */
+    int rows_removed;         /**< Rows removed by the latest load */
+    long load_duration;       /**< Duration of the latest load in milliseconds */
+    bool load_skipped;        /**< The latest load found the grants unchanged */
 } MYSQL_AUTH;
 
 /** Common structure for both backend and client authenticators */
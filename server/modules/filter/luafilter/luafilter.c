@@ -34,6 +34,11 @@
  * is defined and valid, the matching entry point function in Lua will be called.
  * The same holds true for session script apart from no calls to createInstance
  * or diagnostic being made for the session script.
+ *
+ * The global script is by default executed in one Lua state shared by all worker
+ * threads. It can also be executed in one Lua state per worker thread, in which
+ * case data shared between the threads must be stored with the shared_get,
+ * shared_set and shared_add functions.
  */
 
 #define MXS_MODULE_NAME "luafilter"
@@ -44,6 +49,8 @@
 #include <lualib.h>
 #include <string.h>
 #include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
+#include <maxscale/config.h>
 #include <maxscale/debug.h>
 #include <maxscale/filter.h>
 #include <maxscale/log_manager.h>
@@ -66,6 +73,23 @@ static int32_t clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, G
 static void diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *dcb);
 static uint64_t getCapabilities(MXS_FILTER *instance);
 
+/** How the global script is executed */
+enum lua_global_mode
+{
+    LUA_GLOBAL_SHARED,     /**< One Lua state shared by all threads */
+    LUA_GLOBAL_PER_THREAD  /**< One Lua state per worker thread */
+};
+
+static const MXS_ENUM_VALUE global_script_mode_values[] =
+{
+    {"shared",     LUA_GLOBAL_SHARED},
+    {"per_thread", LUA_GLOBAL_PER_THREAD},
+    {NULL}
+};
+
+/** The global variable with which a global script declares itself stateless */
+#define LUA_STATELESS_VARIABLE "luafilter_stateless"
+
 /**
  * The module entry point routine. It is this routine that
  * must populate the structure that is referred to as the
@@ -106,6 +130,14 @@ MXS_MODULE* MXS_CREATE_MODULE()
         {
             {"global_script", MXS_MODULE_PARAM_PATH, NULL, MXS_MODULE_OPT_PATH_R_OK},
             {"session_script", MXS_MODULE_PARAM_PATH, NULL, MXS_MODULE_OPT_PATH_R_OK},
+            {
+                "global_script_mode",
+                MXS_MODULE_PARAM_ENUM,
+                "shared",
+                MXS_MODULE_OPT_NONE,
+                global_script_mode_values
+            },
+            {"shared_keys", MXS_MODULE_PARAM_COUNT, "1024"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -114,7 +146,6 @@ MXS_MODULE* MXS_CREATE_MODULE()
 }
 
 static int id_pool = 0;
-static GWBUF *current_global_query = NULL;
 
 /**
  * Push an unique integer to the Lua state's stack
@@ -166,15 +197,206 @@ static int lua_qc_get_operation(lua_State* state)
     return 1;
 }
 
+/**
+ * One entry in the shared key-value store. The key is set only once, with
+ * a compare-and-swap, and after that only the value changes.
+ */
+typedef struct
+{
+    char    *key;
+    int64_t  value;
+} LUA_SHARED_SLOT;
+
+/**
+ * The lock-free key-value store shared by all Lua states of a filter instance.
+ * Keys are never removed, so the capacity limits the number of distinct keys.
+ */
+typedef struct
+{
+    LUA_SHARED_SLOT *slots;
+    size_t           capacity; /**< A power of two */
+} LUA_SHARED;
+
+static uint32_t shared_hash(const char *key)
+{
+    uint32_t hash = 2166136261u;
+
+    for (const unsigned char *p = (const unsigned char*)key; *p; p++)
+    {
+        hash = (hash ^ *p) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Find the slot of a key in the shared store
+ *
+ * @param shared The shared store
+ * @param key    The key
+ * @param create Whether the key should be added if it does not exist
+ * @return The slot or NULL if the key does not exist or the store is full
+ */
+static LUA_SHARED_SLOT* shared_find(LUA_SHARED *shared, const char *key, bool create)
+{
+    size_t mask = shared->capacity - 1;
+    size_t start = shared_hash(key) & mask;
+    char *copy = NULL;
+
+    for (size_t i = 0; i < shared->capacity; i++)
+    {
+        LUA_SHARED_SLOT *slot = &shared->slots[(start + i) & mask];
+        char *slot_key = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
+
+        if (slot_key == NULL)
+        {
+            if (!create || (copy == NULL && (copy = MXS_STRDUP(key)) == NULL))
+            {
+                break;
+            }
+
+            if (__atomic_compare_exchange_n(&slot->key, &slot_key, copy, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                return slot;
+            }
+
+            // Another thread took the slot, slot_key now holds its key
+        }
+
+        if (strcmp(slot_key, key) == 0)
+        {
+            MXS_FREE(copy);
+            return slot;
+        }
+    }
+
+    MXS_FREE(copy);
+    return NULL;
+}
+
+/**
+ * Get a value from the shared store, the store is the first upvalue
+ *
+ * Lua signature: number shared_get(string)
+ *
+ * @param state Lua state
+ * @return Always 1, the value or 0 if the key does not exist
+ */
+static int lua_shared_get(lua_State* state)
+{
+    LUA_SHARED *shared = (LUA_SHARED*)lua_touserdata(state, lua_upvalueindex(1));
+    LUA_SHARED_SLOT *slot = shared_find(shared, luaL_checkstring(state, 1), false);
+
+    lua_pushinteger(state, slot ? __atomic_load_n(&slot->value, __ATOMIC_ACQUIRE) : 0);
+    return 1;
+}
+
+/**
+ * Set a value in the shared store, the store is the first upvalue
+ *
+ * Lua signature: nil shared_set(string, number)
+ *
+ * @param state Lua state
+ * @return Always 0
+ */
+static int lua_shared_set(lua_State* state)
+{
+    LUA_SHARED *shared = (LUA_SHARED*)lua_touserdata(state, lua_upvalueindex(1));
+    const char *key = luaL_checkstring(state, 1);
+    int64_t value = luaL_checkinteger(state, 2);
+    LUA_SHARED_SLOT *slot = shared_find(shared, key, true);
+
+    if (slot == NULL)
+    {
+        return luaL_error(state, "Cannot store '%s', the shared key-value store is full.", key);
+    }
+
+    __atomic_store_n(&slot->value, value, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Atomically add to a value in the shared store, the store is the first upvalue
+ *
+ * Lua signature: number shared_add(string, number)
+ *
+ * @param state Lua state
+ * @return Always 1, the value after the addition
+ */
+static int lua_shared_add(lua_State* state)
+{
+    LUA_SHARED *shared = (LUA_SHARED*)lua_touserdata(state, lua_upvalueindex(1));
+    const char *key = luaL_checkstring(state, 1);
+    int64_t value = luaL_checkinteger(state, 2);
+    LUA_SHARED_SLOT *slot = shared_find(shared, key, true);
+
+    if (slot == NULL)
+    {
+        return luaL_error(state, "Cannot store '%s', the shared key-value store is full.", key);
+    }
+
+    lua_pushinteger(state, atomic_add_int64(&slot->value, value) + value);
+    return 1;
+}
+
+/**
+ * Expose the query classifier API and the shared key-value store to a Lua state
+ *
+ * @param state         Lua state
+ * @param current_query Where the query being routed is stored
+ * @param shared        The shared key-value store
+ */
+static void expose_functions(lua_State* state, GWBUF **current_query, LUA_SHARED *shared)
+{
+    /** Expose a part of the query classifier API */
+    lua_pushlightuserdata(state, current_query);
+    lua_pushcclosure(state, lua_qc_get_type_mask, 1);
+    lua_setglobal(state, "lua_qc_get_type_mask");
+
+    lua_pushlightuserdata(state, current_query);
+    lua_pushcclosure(state, lua_qc_get_operation, 1);
+    lua_setglobal(state, "lua_qc_get_operation");
+
+    /** Expose the shared key-value store */
+    lua_pushlightuserdata(state, shared);
+    lua_pushcclosure(state, lua_shared_get, 1);
+    lua_setglobal(state, "shared_get");
+
+    lua_pushlightuserdata(state, shared);
+    lua_pushcclosure(state, lua_shared_set, 1);
+    lua_setglobal(state, "shared_set");
+
+    lua_pushlightuserdata(state, shared);
+    lua_pushcclosure(state, lua_shared_add, 1);
+    lua_setglobal(state, "shared_add");
+}
+
+/**
+ * A Lua state of the global script.
+ */
+typedef struct
+{
+    lua_State* lua_state;
+    GWBUF* current_query;
+    SPINLOCK lock;
+} LUA_GLOBAL_STATE;
+
 /**
  * The Lua filter instance.
+ *
+ * The first global Lua state is used by all threads that do not have a state
+ * of their own. With the per-thread mode, it is followed by one state for each
+ * worker thread.
  */
 typedef struct
 {
-    lua_State* global_lua_state;
+    LUA_GLOBAL_STATE* global_states;
+    int n_thread_states;  /**< Number of per-thread states */
+    bool stateless;       /**< Per-thread states need no locking */
     char* global_script;
     char* session_script;
-    SPINLOCK lock;
+    LUA_SHARED shared;
 } LUA_INSTANCE;
 
 /**
@@ -190,11 +412,117 @@ typedef struct
     MXS_UPSTREAM up;
 } LUA_SESSION;
 
+/**
+ * Get the global Lua state of the worker thread that owns a session. The state
+ * must be released with global_state_release().
+ *
+ * @param my_instance The filter instance with a global script
+ * @param my_session  The session or NULL if the call is not done for a session
+ * @return The Lua state to use
+ */
+static LUA_GLOBAL_STATE* global_state_acquire(LUA_INSTANCE *my_instance, LUA_SESSION *my_session)
+{
+    int thread_id = my_session ? my_session->session->client_dcb->thread.id : -1;
+    bool own = thread_id >= 0 && thread_id < my_instance->n_thread_states;
+    LUA_GLOBAL_STATE *state = &my_instance->global_states[own ? thread_id + 1 : 0];
+
+    if (!own || !my_instance->stateless)
+    {
+        spinlock_acquire(&state->lock);
+    }
+
+    return state;
+}
+
+static void global_state_release(LUA_INSTANCE *my_instance, LUA_GLOBAL_STATE *state)
+{
+    if (state == my_instance->global_states || !my_instance->stateless)
+    {
+        spinlock_release(&state->lock);
+    }
+}
+
+/**
+ * Load the global script into a new Lua state and call its createInstance
+ *
+ * @param my_instance The filter instance
+ * @param state       The state to initialize
+ * @return True if the script was loaded
+ */
+static bool global_state_init(LUA_INSTANCE *my_instance, LUA_GLOBAL_STATE *state)
+{
+    spinlock_init(&state->lock);
+
+    if ((state->lua_state = luaL_newstate()) == NULL)
+    {
+        MXS_ERROR("Unable to initialize new Lua state.");
+        return false;
+    }
+
+    luaL_openlibs(state->lua_state);
+    expose_functions(state->lua_state, &state->current_query, &my_instance->shared);
+
+    if (luaL_dofile(state->lua_state, my_instance->global_script))
+    {
+        MXS_ERROR("Failed to execute global script at '%s':%s.",
+                  my_instance->global_script, lua_tostring(state->lua_state, -1));
+        lua_close(state->lua_state);
+        state->lua_state = NULL;
+        return false;
+    }
+
+    lua_getglobal(state->lua_state, "createInstance");
+
+    if (lua_pcall(state->lua_state, 0, 0, 0))
+    {
+        MXS_WARNING("Failed to get global variable 'createInstance':  %s."
+                    " The createInstance entry point will not be called for the global script.",
+                    lua_tostring(state->lua_state, -1));
+        lua_pop(state->lua_state, -1); // Pop the error off the stack
+    }
+
+    return true;
+}
+
+static void free_lua_instance(LUA_INSTANCE *my_instance)
+{
+    if (my_instance->global_states)
+    {
+        for (int i = 0; i <= my_instance->n_thread_states; i++)
+        {
+            if (my_instance->global_states[i].lua_state)
+            {
+                lua_close(my_instance->global_states[i].lua_state);
+            }
+        }
+    }
+
+    if (my_instance->shared.slots)
+    {
+        for (size_t i = 0; i < my_instance->shared.capacity; i++)
+        {
+            MXS_FREE(my_instance->shared.slots[i].key);
+        }
+    }
+
+    MXS_FREE(my_instance->shared.slots);
+    MXS_FREE(my_instance->global_states);
+    MXS_FREE(my_instance->global_script);
+    MXS_FREE(my_instance->session_script);
+    MXS_FREE(my_instance);
+}
+
 /**
  * Create a new instance of the Lua filter.
  *
  * The global script will be loaded in this function and executed once on a global
- * level before calling the createInstance function in the Lua script.
+ * level before calling the createInstance function in the Lua script. With per-thread
+ * global states, this is done once for each state.
+ *
+ * A global script that does not keep any state of its own between the calls can
+ * declare itself stateless by setting the global variable luafilter_stateless to
+ * true. The script is then executed in per-thread states that are not locked.
+ *
  * @param options The options for this filter
  * @param params  Filter parameters
  * @return The instance data for this new instance
@@ -209,54 +537,58 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
         return NULL;
     }
 
-    spinlock_init(&my_instance->lock);
-
     my_instance->global_script = config_copy_string(params, "global_script");
     my_instance->session_script = config_copy_string(params, "session_script");
 
+    size_t capacity = 1;
+
+    while (capacity < (size_t)config_get_integer(params, "shared_keys"))
+    {
+        capacity *= 2;
+    }
+
+    my_instance->shared.capacity = capacity;
+    my_instance->shared.slots = MXS_CALLOC(capacity, sizeof(LUA_SHARED_SLOT));
+
+    if (my_instance->shared.slots == NULL)
+    {
+        free_lua_instance(my_instance);
+        return NULL;
+    }
+
     if (my_instance->global_script)
     {
-        if ((my_instance->global_lua_state = luaL_newstate()))
+        my_instance->global_states = MXS_CALLOC(config_threadcount() + 1, sizeof(LUA_GLOBAL_STATE));
+
+        if (my_instance->global_states == NULL ||
+            !global_state_init(my_instance, &my_instance->global_states[0]))
         {
-            luaL_openlibs(my_instance->global_lua_state);
+            free_lua_instance(my_instance);
+            return NULL;
+        }
 
-            if (luaL_dofile(my_instance->global_lua_state, my_instance->global_script))
-            {
-                MXS_ERROR("Failed to execute global script at '%s':%s.",
-                          my_instance->global_script, lua_tostring(my_instance->global_lua_state, -1));
-                MXS_FREE(my_instance->global_script);
-                MXS_FREE(my_instance->session_script);
-                MXS_FREE(my_instance);
-                my_instance = NULL;
-            }
-            else if (my_instance->global_lua_state)
-            {
-                lua_getglobal(my_instance->global_lua_state, "createInstance");
+        lua_State *first = my_instance->global_states[0].lua_state;
+        lua_getglobal(first, LUA_STATELESS_VARIABLE);
+        my_instance->stateless = lua_toboolean(first, -1);
+        lua_pop(first, 1);
 
-                if (lua_pcall(my_instance->global_lua_state, 0, 0, 0))
+        if (my_instance->stateless ||
+            config_get_enum(params, "global_script_mode", global_script_mode_values) == LUA_GLOBAL_PER_THREAD)
+        {
+            for (int i = 1; i <= config_threadcount(); i++)
+            {
+                if (!global_state_init(my_instance, &my_instance->global_states[i]))
                 {
-                    MXS_WARNING("Failed to get global variable 'createInstance':  %s."
-                                " The createInstance entry point will not be called for the global script.",
-                                lua_tostring(my_instance->global_lua_state, -1));
-                    lua_pop(my_instance->global_lua_state, -1); // Pop the error off the stack
+                    free_lua_instance(my_instance);
+                    return NULL;
                 }
 
-                /** Expose a part of the query classifier API */
-                lua_pushlightuserdata(my_instance->global_lua_state, &current_global_query);
-                lua_pushcclosure(my_instance->global_lua_state, lua_qc_get_type_mask, 1);
-                lua_setglobal(my_instance->global_lua_state, "lua_qc_get_type_mask");
-
-                lua_pushlightuserdata(my_instance->global_lua_state, &current_global_query);
-                lua_pushcclosure(my_instance->global_lua_state, lua_qc_get_operation, 1);
-                lua_setglobal(my_instance->global_lua_state, "lua_qc_get_operation");
-
+                my_instance->n_thread_states++;
             }
-        }
-        else
-        {
-            MXS_ERROR("Unable to initialize new Lua state.");
-            MXS_FREE(my_instance);
-            my_instance = NULL;
+
+            MXS_NOTICE("Global script '%s' is executed in %d per-thread Lua states%s.",
+                       my_instance->global_script, my_instance->n_thread_states,
+                       my_instance->stateless ? " without locking" : "");
         }
     }
 
@@ -312,14 +644,7 @@ static MXS_FILTER_SESSION *newSession(MXS_FILTER *instance, MXS_SESSION *session
             lua_pushcfunction(my_session->lua_state, id_gen);
             lua_setglobal(my_session->lua_state, "id_gen");
 
-            /** Expose a part of the query classifier API */
-            lua_pushlightuserdata(my_session->lua_state, &my_session->current_query);
-            lua_pushcclosure(my_session->lua_state, lua_qc_get_type_mask, 1);
-            lua_setglobal(my_session->lua_state, "lua_qc_get_type_mask");
-
-            lua_pushlightuserdata(my_session->lua_state, &my_session->current_query);
-            lua_pushcclosure(my_session->lua_state, lua_qc_get_operation, 1);
-            lua_setglobal(my_session->lua_state, "lua_qc_get_operation");
+            expose_functions(my_session->lua_state, &my_session->current_query, &my_instance->shared);
 
             /** Call the newSession entry point */
             lua_getglobal(my_session->lua_state, "newSession");
@@ -336,23 +661,23 @@ static MXS_FILTER_SESSION *newSession(MXS_FILTER *instance, MXS_SESSION *session
         }
     }
 
-    if (my_session && my_instance->global_lua_state)
+    if (my_session && my_instance->global_states)
     {
-        spinlock_acquire(&my_instance->lock);
+        LUA_GLOBAL_STATE *global = global_state_acquire(my_instance, my_session);
 
-        lua_getglobal(my_instance->global_lua_state, "newSession");
-        lua_pushstring(my_instance->global_lua_state, session->client_dcb->user);
-        lua_pushstring(my_instance->global_lua_state, session->client_dcb->remote);
+        lua_getglobal(global->lua_state, "newSession");
+        lua_pushstring(global->lua_state, session->client_dcb->user);
+        lua_pushstring(global->lua_state, session->client_dcb->remote);
 
-        if (lua_pcall(my_instance->global_lua_state, 2, 0, 0))
+        if (lua_pcall(global->lua_state, 2, 0, 0))
         {
             MXS_WARNING("Failed to get global variable 'newSession': '%s'."
                         " The newSession entry point will not be called for the global script.",
-                        lua_tostring(my_instance->global_lua_state, -1));
-            lua_pop(my_instance->global_lua_state, -1); // Pop the error off the stack
+                        lua_tostring(global->lua_state, -1));
+            lua_pop(global->lua_state, -1); // Pop the error off the stack
         }
 
-        spinlock_release(&my_instance->lock);
+        global_state_release(my_instance, global);
     }
 
     return (MXS_FILTER_SESSION*)my_session;
@@ -388,20 +713,20 @@ static void closeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session)
         spinlock_release(&my_session->lock);
     }
 
-    if (my_instance->global_lua_state)
+    if (my_instance->global_states)
     {
-        spinlock_acquire(&my_instance->lock);
+        LUA_GLOBAL_STATE *global = global_state_acquire(my_instance, my_session);
 
-        lua_getglobal(my_instance->global_lua_state, "closeSession");
+        lua_getglobal(global->lua_state, "closeSession");
 
-        if (lua_pcall(my_instance->global_lua_state, 0, 0, 0))
+        if (lua_pcall(global->lua_state, 0, 0, 0))
         {
             MXS_WARNING("Failed to get global variable 'closeSession': '%s'."
                         " The closeSession entry point will not be called for the global script.",
-                        lua_tostring(my_instance->global_lua_state, -1));
-            lua_pop(my_instance->global_lua_state, -1);
+                        lua_tostring(global->lua_state, -1));
+            lua_pop(global->lua_state, -1);
         }
-        spinlock_release(&my_instance->lock);
+        global_state_release(my_instance, global);
     }
 }
 
@@ -478,20 +803,20 @@ static int32_t clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GW
 
         spinlock_release(&my_session->lock);
     }
-    if (my_instance->global_lua_state)
+    if (my_instance->global_states)
     {
-        spinlock_acquire(&my_instance->lock);
+        LUA_GLOBAL_STATE *global = global_state_acquire(my_instance, my_session);
 
-        lua_getglobal(my_instance->global_lua_state, "clientReply");
+        lua_getglobal(global->lua_state, "clientReply");
 
-        if (lua_pcall(my_instance->global_lua_state, 0, 0, 0))
+        if (lua_pcall(global->lua_state, 0, 0, 0))
         {
             MXS_ERROR("Global scope call to 'clientReply' failed: '%s'.",
-                      lua_tostring(my_session->lua_state, -1));
-            lua_pop(my_instance->global_lua_state, -1);
+                      lua_tostring(global->lua_state, -1));
+            lua_pop(global->lua_state, -1);
         }
 
-        spinlock_release(&my_instance->lock);
+        global_state_release(my_instance, global);
     }
 
     return my_session->up.clientReply(my_session->up.instance,
@@ -564,36 +889,36 @@ static int32_t routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWB
             spinlock_release(&my_session->lock);
         }
 
-        if (my_instance->global_lua_state)
+        if (my_instance->global_states)
         {
-            spinlock_acquire(&my_instance->lock);
-            current_global_query = queue;
+            LUA_GLOBAL_STATE *global = global_state_acquire(my_instance, my_session);
+            global->current_query = queue;
 
-            lua_getglobal(my_instance->global_lua_state, "routeQuery");
+            lua_getglobal(global->lua_state, "routeQuery");
 
-            lua_pushlstring(my_instance->global_lua_state, fullquery, strlen(fullquery));
+            lua_pushlstring(global->lua_state, fullquery, strlen(fullquery));
 
-            if (lua_pcall(my_instance->global_lua_state, 1, 0, 0))
+            if (lua_pcall(global->lua_state, 1, 0, 0))
             {
                 MXS_ERROR("Global scope call to 'routeQuery' failed: '%s'.",
-                          lua_tostring(my_instance->global_lua_state, -1));
-                lua_pop(my_instance->global_lua_state, -1);
+                          lua_tostring(global->lua_state, -1));
+                lua_pop(global->lua_state, -1);
             }
-            else if (lua_gettop(my_instance->global_lua_state))
+            else if (lua_gettop(global->lua_state))
             {
-                if (lua_isstring(my_instance->global_lua_state, -1))
+                if (lua_isstring(global->lua_state, -1))
                 {
                     gwbuf_free(forward);
-                    forward = modutil_create_query(lua_tostring(my_instance->global_lua_state, -1));
+                    forward = modutil_create_query(lua_tostring(global->lua_state, -1));
                 }
-                else if (lua_isboolean(my_instance->global_lua_state, -1))
+                else if (lua_isboolean(global->lua_state, -1))
                 {
-                    route = lua_toboolean(my_instance->global_lua_state, -1);
+                    route = lua_toboolean(global->lua_state, -1);
                 }
             }
 
-            current_global_query = NULL;
-            spinlock_release(&my_instance->lock);
+            global->current_query = NULL;
+            global_state_release(my_instance, global);
         }
 
         MXS_FREE(fullquery);
@@ -629,32 +954,34 @@ static void diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *
 
     if (my_instance)
     {
-        if (my_instance->global_lua_state)
+        if (my_instance->global_states)
         {
-            spinlock_acquire(&my_instance->lock);
+            LUA_GLOBAL_STATE *global = global_state_acquire(my_instance, NULL);
 
-            lua_getglobal(my_instance->global_lua_state, "diagnostic");
+            lua_getglobal(global->lua_state, "diagnostic");
 
-            if (lua_pcall(my_instance->global_lua_state, 0, 1, 0) == 0)
+            if (lua_pcall(global->lua_state, 0, 1, 0) == 0)
             {
-                lua_gettop(my_instance->global_lua_state);
-                if (lua_isstring(my_instance->global_lua_state, -1))
+                lua_gettop(global->lua_state);
+                if (lua_isstring(global->lua_state, -1))
                 {
-                    dcb_printf(dcb, "%s", lua_tostring(my_instance->global_lua_state, -1));
+                    dcb_printf(dcb, "%s", lua_tostring(global->lua_state, -1));
                     dcb_printf(dcb, "\n");
                 }
             }
             else
             {
                 dcb_printf(dcb, "Global scope call to 'diagnostic' failed: '%s'.\n",
-                           lua_tostring(my_instance->global_lua_state, -1));
-                lua_pop(my_instance->global_lua_state, -1);
+                           lua_tostring(global->lua_state, -1));
+                lua_pop(global->lua_state, -1);
             }
-            spinlock_release(&my_instance->lock);
+            global_state_release(my_instance, global);
         }
         if (my_instance->global_script)
         {
             dcb_printf(dcb, "Global script: %s\n", my_instance->global_script);
+            dcb_printf(dcb, "Global script states: %d%s\n", my_instance->n_thread_states + 1,
+                       my_instance->stateless ? " (stateless)" : "");
         }
         if (my_instance->session_script)
         {
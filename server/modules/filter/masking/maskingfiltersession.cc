@@ -25,11 +25,13 @@ using maxscale::Buffer;
 using std::ostream;
 using std::string;
 using std::stringstream;
+using std::vector;
 
 MaskingFilterSession::MaskingFilterSession(MXS_SESSION* pSession, const MaskingFilter* pFilter)
     : maxscale::FilterSession(pSession)
     , m_filter(*pFilter)
     , m_state(IGNORING_RESPONSE)
+    , m_row_continues(false)
 {
 }
 
@@ -65,43 +67,65 @@ int MaskingFilterSession::routeQuery(GWBUF* pPacket)
 
 int MaskingFilterSession::clientReply(GWBUF* pPacket)
 {
-    ss_dassert(GWBUF_IS_CONTIGUOUS(pPacket));
+    switch (m_state)
+    {
+    case EXPECTING_ROW:
+        // Rows are masked in place, as they are, so that they need not be
+        // made contiguous.
+        handle_row(pPacket);
+        break;
 
-    ComResponse response(pPacket);
+    case IGNORING_RESPONSE:
+    case SUPPRESSING_RESPONSE:
+        break;
 
-    if (response.is_err())
-    {
-        // If we get an error response, we just abort what we were doing.
-        m_state = EXPECTING_NOTHING;
-    }
-    else
-    {
-        switch (m_state)
+    default:
         {
-        case EXPECTING_NOTHING:
-            MXS_WARNING("Received data, although expected nothing.");
-        case IGNORING_RESPONSE:
-            break;
+            GWBUF* pContiguous = gwbuf_make_contiguous(pPacket);
 
-        case EXPECTING_RESPONSE:
-            handle_response(pPacket);
-            break;
+            if (!pContiguous)
+            {
+                // The original buffer is intact if the allocation fails, and
+                // it is freed below.
+                poll_fake_hangup_event(m_pSession->client_dcb);
+                m_state = SUPPRESSING_RESPONSE;
+                break;
+            }
 
-        case EXPECTING_FIELD:
-            handle_field(pPacket);
-            break;
+            pPacket = pContiguous;
 
-        case EXPECTING_ROW:
-            handle_row(pPacket);
-            break;
+            ComResponse response(pPacket);
 
-        case EXPECTING_FIELD_EOF:
-        case EXPECTING_ROW_EOF:
-            handle_eof(pPacket);
-            break;
+            if (response.is_err())
+            {
+                // If we get an error response, we just abort what we were doing.
+                m_state = EXPECTING_NOTHING;
+            }
+            else
+            {
+                switch (m_state)
+                {
+                case EXPECTING_NOTHING:
+                    MXS_WARNING("Received data, although expected nothing.");
+                    break;
 
-        case SUPPRESSING_RESPONSE:
-            break;
+                case EXPECTING_RESPONSE:
+                    handle_response(pPacket);
+                    break;
+
+                case EXPECTING_FIELD:
+                    handle_field(pPacket);
+                    break;
+
+                case EXPECTING_FIELD_EOF:
+                case EXPECTING_ROW_EOF:
+                    handle_eof(pPacket);
+                    break;
+
+                default:
+                    ss_dassert(!true);
+                }
+            }
         }
     }
 
@@ -113,6 +137,7 @@ int MaskingFilterSession::clientReply(GWBUF* pPacket)
     }
     else
     {
+        gwbuf_free(pPacket);
         // TODO: The return value should mean something.
         rv = 0;
     }
@@ -142,6 +167,24 @@ void MaskingFilterSession::handle_response(GWBUF* pPacket)
     }
 }
 
+namespace
+{
+
+/**
+ * How many resultsets' worth of resolved rules a session caches. Should a
+ * session issue queries with more distinct columns than this, the cache is
+ * cleared and filled again.
+ */
+const size_t MAX_CACHED_RESULTSETS = 256;
+
+void warn_of_type_mismatch(const MaskingRules::Rule& rule)
+{
+    MXS_WARNING("The rule targeting \"%s\" matches a column "
+                "that is not of string type.", rule.match().c_str());
+}
+
+}
+
 void MaskingFilterSession::handle_field(GWBUF* pPacket)
 {
     ComQueryResponse::ColumnDef column_def(pPacket);
@@ -150,7 +193,32 @@ void MaskingFilterSession::handle_field(GWBUF* pPacket)
     {
         handle_large_payload();
     }
-    else
+    else if (m_res.append_column(column_def))
+    {
+        // All fields have been read.
+        resolve_rules();
+        m_state = EXPECTING_FIELD_EOF;
+    }
+}
+
+void MaskingFilterSession::resolve_rules()
+{
+    const SMaskingRules& sRules = m_res.rules();
+
+    if (sRules != m_sCached_rules)
+    {
+        // The rules have been reloaded.
+        m_rules_cache.clear();
+        m_sCached_rules = sRules;
+    }
+
+    // The user and host do not change during the session, so the rules of a
+    // resultset only depend upon its columns. The types of the columns are not
+    // part of the signature as they may change, so they are checked below.
+    string signature = m_res.signature();
+    RulesBySignature::iterator i = m_rules_cache.find(signature);
+
+    if (i == m_rules_cache.end())
     {
         const char *zUser = session_get_user(m_pSession);
         const char *zHost = session_get_remote(m_pSession);
@@ -165,14 +233,43 @@ void MaskingFilterSession::handle_field(GWBUF* pPacket)
             zHost = "";
         }
 
-        const MaskingRules::Rule* pRule = m_res.rules()->get_rule_for(column_def, zUser, zHost);
+        const vector<ResponseState::Column>& columns = m_res.columns();
+        vector<const MaskingRules::Rule*> rules;
+
+        for (size_t j = 0; j < columns.size(); ++j)
+        {
+            const ResponseState::Column& column = columns[j];
+            rules.push_back(sRules->get_rule_for(column.database, column.table,
+                                                 column.name, zUser, zHost));
+        }
+
+        if (m_rules_cache.size() >= MAX_CACHED_RESULTSETS)
+        {
+            m_rules_cache.clear();
+        }
+
+        i = m_rules_cache.insert(std::make_pair(signature, rules)).first;
+    }
+
+    // The rule is checked against the type once per resultset, so the values
+    // of the column need not be checked one by one.
+    const vector<enum_field_types>& types = m_res.types();
+    vector<const MaskingRules::Rule*> rules(i->second);
 
-        if (m_res.append_type_and_rule(column_def.type(), pRule))
+    for (size_t j = 0; j < rules.size(); ++j)
+    {
+        if (rules[j] && !ComQueryResponse::TextResultsetRow::Value::is_string(types[j]))
         {
-            // All fields have been read.
-            m_state = EXPECTING_FIELD_EOF;
+            if (m_filter.config().warn_type_mismatch() == Config::WARN_ALWAYS)
+            {
+                warn_of_type_mismatch(*rules[j]);
+            }
+
+            rules[j] = NULL;
         }
     }
+
+    m_res.set_column_rules(rules);
 }
 
 void MaskingFilterSession::handle_eof(GWBUF* pPacket)
@@ -184,6 +281,13 @@ void MaskingFilterSession::handle_eof(GWBUF* pPacket)
         switch (m_state)
         {
         case EXPECTING_FIELD_EOF:
+            if (m_res.some_rule_matches())
+            {
+                m_masker.reset(m_res.command() == MYSQL_COM_STMT_EXECUTE,
+                               m_res.types(), m_res.column_rules());
+            }
+
+            m_row_continues = false;
             m_state = EXPECTING_ROW;
             break;
 
@@ -203,28 +307,41 @@ void MaskingFilterSession::handle_eof(GWBUF* pPacket)
     }
 }
 
-namespace
+void MaskingFilterSession::handle_row(GWBUF* pPacket)
 {
+    // The packet may consist of several buffers, so only the header, and the
+    // payload of a possible EOF packet, is copied.
+    uint8_t header[MYSQL_EOF_PACKET_LEN];
+    size_t n = gwbuf_copy_data(pPacket, 0, sizeof(header), header);
+    ss_dassert(n >= MYSQL_HEADER_LEN);
 
-void warn_of_type_mismatch(const MaskingRules::Rule& rule)
-{
-    MXS_WARNING("The rule targeting \"%s\" matches a column "
-                "that is not of string type.", rule.match().c_str());
-}
+    uint32_t payload_len = MYSQL_GET_PAYLOAD_LEN(header);
+    bool continuation = m_row_continues;
 
-}
+    // A payload of exactly 16MB means that the row continues in the next
+    // packet, whose payload is just more of the row.
+    m_row_continues = (payload_len == ComPacket::MAX_PAYLOAD_LEN);
 
-void MaskingFilterSession::handle_row(GWBUF* pPacket)
-{
-    ComPacket response(pPacket);
-
-    if ((response.payload_len() == ComEOF::PAYLOAD_LEN) &&
-        (ComResponse(response).type() == ComResponse::EOF_PACKET))
+    if (continuation)
+    {
+        if (m_res.some_rule_matches())
+        {
+            m_masker.mask(pPacket);
+        }
+    }
+    else if ((n > MYSQL_HEADER_LEN) && (header[MYSQL_HEADER_LEN] == ComResponse::ERR_PACKET))
+    {
+        // If we get an error response, we just abort what we were doing.
+        m_state = EXPECTING_NOTHING;
+    }
+    else if ((payload_len == ComEOF::PAYLOAD_LEN) &&
+             (header[MYSQL_HEADER_LEN] == ComResponse::EOF_PACKET))
     {
-        // EOF after last row.
-        ComEOF eof(response);
+        // EOF after last row. The payload is the header byte, two bytes of
+        // warnings and two bytes of status.
+        uint16_t status = gw_mysql_get_byte2(header + MYSQL_HEADER_LEN + 3);
 
-        if (eof.status() & SERVER_MORE_RESULTS_EXIST)
+        if (status & SERVER_MORE_RESULTS_EXIST)
         {
             m_res.reset_multi();
             m_state = EXPECTING_RESPONSE;
@@ -234,19 +351,10 @@ void MaskingFilterSession::handle_row(GWBUF* pPacket)
             m_state = EXPECTING_NOTHING;
         }
     }
-    else
+    else if (m_res.some_rule_matches())
     {
-        if (m_res.some_rule_matches())
-        {
-            if (response.payload_len() >= ComPacket::MAX_PAYLOAD_LEN)
-            {
-                handle_large_payload();
-            }
-            else
-            {
-                mask_values(response);
-            }
-        }
+        m_masker.start_row();
+        m_masker.mask(pPacket);
     }
 }
 
@@ -264,69 +372,3 @@ void MaskingFilterSession::handle_large_payload()
         m_state = IGNORING_RESPONSE;
     }
 }
-
-void MaskingFilterSession::mask_values(ComPacket& response)
-{
-    switch (m_res.command())
-    {
-    case MYSQL_COM_QUERY:
-        {
-            ComQueryResponse::TextResultsetRow row(response, m_res.types());
-
-            ComQueryResponse::TextResultsetRow::iterator i = row.begin();
-            while (i != row.end())
-            {
-                const MaskingRules::Rule* pRule = m_res.get_rule();
-
-                if (pRule)
-                {
-                    ComQueryResponse::TextResultsetRow::Value value = *i;
-
-                    if (value.is_string())
-                    {
-                        LEncString s = value.as_string();
-                        pRule->rewrite(s);
-                    }
-                    else if (m_filter.config().warn_type_mismatch() == Config::WARN_ALWAYS)
-                    {
-                        warn_of_type_mismatch(*pRule);
-                    }
-                }
-                ++i;
-            }
-        }
-        break;
-
-    case MYSQL_COM_STMT_EXECUTE:
-        {
-            ComQueryResponse::BinaryResultsetRow row(response, m_res.types());
-
-            ComQueryResponse::BinaryResultsetRow::iterator i = row.begin();
-            while (i != row.end())
-            {
-                const MaskingRules::Rule* pRule = m_res.get_rule();
-
-                if (pRule)
-                {
-                    ComQueryResponse::BinaryResultsetRow::Value value = *i;
-
-                    if (value.is_string())
-                    {
-                        LEncString s = value.as_string();
-                        pRule->rewrite(s);
-                    }
-                    else if (m_filter.config().warn_type_mismatch() == Config::WARN_ALWAYS)
-                    {
-                        warn_of_type_mismatch(*pRule);
-                    }
-                }
-                ++i;
-            }
-        }
-        break;
-
-    default:
-        MXS_ERROR("Unexpected request: %d", m_res.command());
-        ss_dassert(!true);
-    }
-}
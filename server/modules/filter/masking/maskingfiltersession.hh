@@ -15,9 +15,11 @@
 #include <maxscale/cppdefs.hh>
 #include <memory>
 #include <tr1/memory>
+#include <tr1/unordered_map>
 #include <maxscale/buffer.hh>
 #include <maxscale/filter.hh>
 #include "maskingrules.hh"
+#include "rowmasker.hh"
 
 class MaskingFilter;
 class MaskingFilterConfig;
@@ -58,8 +60,7 @@ private:
     void handle_row(GWBUF* pPacket);
     void handle_eof(GWBUF* pPacket);
     void handle_large_payload();
-
-    void mask_values(ComPacket& response);
+    void resolve_rules();
 
 private:
     typedef std::tr1::shared_ptr<MaskingRules> SMaskingRules;
@@ -70,7 +71,6 @@ private:
         ResponseState()
             : m_command(0)
             , m_nTotal_fields(0)
-            , m_index(0)
             , m_multi_result(false)
             , m_some_rule_matches(false)
         {}
@@ -89,8 +89,8 @@ private:
         {
             m_nTotal_fields = 0;
             m_types.clear();
+            m_columns.clear();
             m_rules.clear();
-            m_index = 0;
             m_multi_result = true;
         }
 
@@ -124,17 +124,63 @@ private:
             m_nTotal_fields = n;
         }
 
-        bool append_type_and_rule(enum_field_types type, const MaskingRules::Rule* pRule)
+        struct Column
+        {
+            std::string database;
+            std::string table;
+            std::string name;
+        };
+
+        bool append_column(const ComQueryResponse::ColumnDef& column_def)
+        {
+            Column column;
+            column.database = column_def.schema().to_string();
+            column.table = column_def.org_table().to_string();
+            column.name = column_def.org_name().to_string();
+
+            m_types.push_back(column_def.type());
+            m_columns.push_back(column);
+
+            return m_columns.size() == m_nTotal_fields;
+        }
+
+        const std::vector<Column>& columns() const
+        {
+            return m_columns;
+        }
+
+        /**
+         * @return A string identifying the columns of the resultset.
+         */
+        std::string signature() const
         {
-            m_types.push_back(type);
-            m_rules.push_back(pRule);
+            std::string s;
 
-            if (pRule)
+            for (std::vector<Column>::const_iterator i = m_columns.begin(); i != m_columns.end(); ++i)
             {
-                m_some_rule_matches = true;
+                s += i->database;
+                s += '\0';
+                s += i->table;
+                s += '\0';
+                s += i->name;
+                s += '\0';
             }
 
-            return m_rules.size() == m_nTotal_fields;
+            return s;
+        }
+
+        void set_column_rules(const std::vector<const MaskingRules::Rule*>& rules)
+        {
+            ss_dassert(rules.size() == m_nTotal_fields);
+            m_rules = rules;
+            m_some_rule_matches = false;
+
+            for (std::vector<const MaskingRules::Rule*>::const_iterator i = m_rules.begin();
+                 !m_some_rule_matches && (i != m_rules.end());
+                 ++i)
+            {
+                m_some_rule_matches = (*i != NULL);
+            }
         }
 
         const std::vector<enum_field_types>& types() const
@@ -142,15 +188,9 @@ private:
             return m_types;
         }
 
-        const MaskingRules::Rule* get_rule()
+        const std::vector<const MaskingRules::Rule*>& column_rules() const
         {
-            ss_dassert(m_nTotal_fields == m_rules.size());
-            ss_dassert(m_index < m_rules.size());
-            const MaskingRules::Rule* pRule = m_rules[m_index++];
-            // The rules will be used repeatedly for each row. Hence, once we hit
-            // the end, we need to continue from the start.
-            m_index = m_index % m_rules.size();
-            return pRule;
+            return m_rules;
         }
 
     private:
@@ -158,8 +198,8 @@ private:
         SMaskingRules                          m_sRules;            /*<! The rules that are used. */
         uint32_t                               m_nTotal_fields;     /*<! The total number of fields. */
         std::vector<enum_field_types>          m_types;             /*<! The column types. */
+        std::vector<Column>                    m_columns;           /*<! The columns. */
         std::vector<const MaskingRules::Rule*> m_rules;             /*<! The rules applied for columns. */
-        size_t                                 m_index;             /*<! Index to the current rule.*/
         bool                                   m_multi_result;      /*<! Are we processing multi-results. */
         bool                                   m_some_rule_matches; /*<! At least one rule matches. */
     };
@@ -167,4 +207,12 @@ private:
     const MaskingFilter& m_filter;
     state_t              m_state;
     ResponseState        m_res;
+    RowMasker            m_masker;        /*<! Masks the rows of the current resultset. */
+    bool                 m_row_continues; /*<! The current row continues in the next packet. */
+
+    typedef std::tr1::unordered_map<std::string, std::vector<const MaskingRules::Rule*> > RulesBySignature;
+
+    SMaskingRules        m_sCached_rules; /*<! The rules the cached rules are from. */
+    RulesBySignature     m_rules_cache;   /*<! The matching rules of resultsets, by column
+                                                   signature, before the column types are checked. */
 };
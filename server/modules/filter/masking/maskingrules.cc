@@ -14,6 +14,7 @@
 #define MXS_MODULE_NAME "masking"
 #include "maskingrules.hh"
 #include <algorithm>
+#include <ctype.h>
 #include <errno.h>
 #include <functional>
 #include <string.h>
@@ -43,6 +44,44 @@ static const char KEY_TABLE[]      = "table";
 static const char KEY_VALUE[]      = "value";
 static const char KEY_WITH[]       = "with";
 
+/**
+ * Quote a string so that it is matched literally in a PCRE2 pattern.
+ *
+ * @param s  The string to quote.
+ *
+ * @return The quoted string.
+ */
+string pcre_quote(const string& s)
+{
+    string quoted;
+
+    for (string::const_iterator i = s.begin(); i != s.end(); ++i)
+    {
+        unsigned char c = *i;
+
+        if ((c < 0x80) && !isalnum(c))
+        {
+            quoted += '\\';
+        }
+
+        quoted += c;
+    }
+
+    return quoted;
+}
+
+/**
+ * Return the pattern matching the user part of an account.
+ *
+ * @param user  The user name of an account, or empty for any user.
+ *
+ * @return A pattern matching the user and the separating newline.
+ */
+string user_pattern(const string& user)
+{
+    return (user.empty() ? "[^\\n]*" : pcre_quote(user)) + "\\n";
+}
+
 /**
  * @class AccountVerbatim
  *
@@ -81,6 +120,11 @@ public:
             (m_host.empty() || (m_host == zHost));
     }
 
+    string pattern() const
+    {
+        return user_pattern(m_user) + (m_host.empty() ? "" : pcre_quote(m_host) + "\\z");
+    }
+
 private:
     AccountVerbatim(const string& user, const string& host)
         : m_user(user)
@@ -118,7 +162,9 @@ public:
 
         int errcode;
         PCRE2_SIZE erroffset;
-        pcre2_code* pCode = pcre2_compile((PCRE2_SPTR)host.c_str(), PCRE2_ZERO_TERMINATED, 0,
+        // The whole host must match, as in the combined pattern.
+        string anchored = "^(?:" + host + ")\\z";
+        pcre2_code* pCode = pcre2_compile((PCRE2_SPTR)anchored.c_str(), PCRE2_ZERO_TERMINATED, 0,
                                           &errcode, &erroffset, NULL);
 
         if (pCode)
@@ -174,6 +220,13 @@ public:
         return rv;
     }
 
+    string pattern() const
+    {
+        // The user pattern ends at the newline, so the host is anchored at
+        // both ends.
+        return user_pattern(m_user) + "(?:" + m_host + ")\\z";
+    }
+
 private:
     AccountRegexp(const string& user,
                   const string& host,
@@ -547,6 +600,121 @@ MaskingRules::Rule::Account::~Account()
 // MaskingRules::Rule
 //
 
+namespace
+{
+
+/**
+ * Combine accounts into a single regular expression.
+ *
+ * @param accounts  The accounts to combine.
+ *
+ * @return A compiled pattern that matches "user\nhost" if any of the accounts
+ *         matches the user and host, or NULL if there are no accounts or the
+ *         pattern could not be compiled.
+ */
+pcre2_code* compile_accounts(const vector<MaskingRules::Rule::SAccount>& accounts)
+{
+    pcre2_code* pCode = NULL;
+
+    if (!accounts.empty())
+    {
+        string pattern("^(?:");
+
+        for (vector<MaskingRules::Rule::SAccount>::const_iterator i = accounts.begin();
+             i != accounts.end();
+             ++i)
+        {
+            if (i != accounts.begin())
+            {
+                pattern += "|";
+            }
+
+            pattern += "(?:" + (*i)->pattern() + ")";
+        }
+
+        pattern += ")";
+
+        int errcode;
+        PCRE2_SIZE erroffset;
+        pCode = pcre2_compile((PCRE2_SPTR)pattern.c_str(), PCRE2_ZERO_TERMINATED, 0,
+                              &errcode, &erroffset, NULL);
+
+        if (!pCode)
+        {
+            // Not fatal, the accounts are then matched one by one.
+            PCRE2_UCHAR errbuf[512];
+            pcre2_get_error_message(errcode, errbuf, sizeof(errbuf));
+            MXS_WARNING("Combining accounts failed at %d for regex '%s': %s",
+                        (int)erroffset, pattern.c_str(), errbuf);
+        }
+    }
+
+    return pCode;
+}
+
+class AccountMatcher : std::unary_function<MaskingRules::Rule::SAccount, bool>
+{
+public:
+    AccountMatcher(const char* zUser, const char* zHost)
+        : m_zUser(zUser)
+        , m_zHost(zHost)
+    {}
+
+    bool operator()(const MaskingRules::Rule::SAccount& sAccount)
+    {
+        return sAccount->matches(m_zUser, m_zHost);
+    }
+
+private:
+    const char* m_zUser;
+    const char* m_zHost;
+};
+
+/**
+ * Check whether any account matches a user and host.
+ *
+ * @param pCode     The accounts combined with @c compile_accounts, or NULL.
+ * @param accounts  The accounts.
+ * @param zUser     The user.
+ * @param zHost     The host.
+ *
+ * @return True, if some account matches.
+ */
+bool matches_any(pcre2_code* pCode,
+                 const vector<MaskingRules::Rule::SAccount>& accounts,
+                 const char* zUser,
+                 const char* zHost)
+{
+    bool rv = false;
+
+    if (pCode)
+    {
+        string subject(zUser);
+        subject += '\n';
+        subject += zHost;
+
+        pcre2_match_data* pData = pcre2_match_data_create_from_pattern(pCode, NULL);
+
+        if (pData)
+        {
+            Closer<pcre2_match_data*> data(pData);
+
+            rv = (pcre2_match(pCode, (PCRE2_SPTR)subject.c_str(), subject.length(),
+                              0, 0, pData, NULL) >= 0);
+        }
+    }
+    else
+    {
+        AccountMatcher matcher(zUser, zHost);
+
+        rv = (std::find_if(accounts.begin(), accounts.end(), matcher) != accounts.end());
+    }
+
+    return rv;
+}
+
+}
+
 MaskingRules::Rule::Rule(const std::string& column,
                          const std::string& table,
                          const std::string& database,
@@ -561,11 +729,15 @@ MaskingRules::Rule::Rule(const std::string& column,
     , m_fill(fill)
     , m_applies_to(applies_to)
     , m_exempted(exempted)
+    , m_pApplies_to(compile_accounts(applies_to))
+    , m_pExempted(compile_accounts(exempted))
 {
 }
 
 MaskingRules::Rule::~Rule()
 {
+    pcre2_code_free(m_pApplies_to);
+    pcre2_code_free(m_pExempted);
 }
 
 //static
@@ -638,29 +810,6 @@ string MaskingRules::Rule::match() const
     return s;
 }
 
-namespace
-{
-
-class AccountMatcher : std::unary_function<MaskingRules::Rule::SAccount, bool>
-{
-public:
-    AccountMatcher(const char* zUser, const char* zHost)
-        : m_zUser(zUser)
-        , m_zHost(zHost)
-    {}
-
-    bool operator()(const MaskingRules::Rule::SAccount& sAccount)
-    {
-        return sAccount->matches(m_zUser, m_zHost);
-    }
-
-private:
-    const char* m_zUser;
-    const char* m_zHost;
-};
-
-}
-
 bool MaskingRules::Rule::matches(const ComQueryResponse::ColumnDef& column_def,
                                  const char* zUser,
                                  const char* zHost) const
@@ -670,35 +819,39 @@ bool MaskingRules::Rule::matches(const ComQueryResponse::ColumnDef& column_def,
         (m_table.empty() || (m_table == column_def.org_table())) &&
         (m_database.empty() || (m_database == column_def.schema()));
 
-    if (match)
-    {
-        // If the column matched, then we need to check whether the rule applies
-        // to the user and host.
-
-        AccountMatcher matcher(zUser, zHost);
-
-        if (m_applies_to.size() != 0)
-        {
-            match = false;
+    // If the column matched, then we need to check whether the rule applies
+    // to the user and host.
+    return match && matches_account(zUser, zHost);
+}
 
-            vector<SAccount>::const_iterator i = std::find_if(m_applies_to.begin(),
-                                                              m_applies_to.end(),
-                                                              matcher);
+bool MaskingRules::Rule::matches(const string& database,
+                                 const string& table,
+                                 const string& column,
+                                 const char* zUser,
+                                 const char* zHost) const
+{
+    bool match =
+        (m_column == column) &&
+        (m_table.empty() || (m_table == table)) &&
+        (m_database.empty() || (m_database == database));
 
-            match = (i != m_applies_to.end());
-        }
+    return match && matches_account(zUser, zHost);
+}
 
-        if (match && (m_exempted.size() != 0))
-        {
-            // If it is still a match, we need to check whether the user/host is
-            // exempted.
+bool MaskingRules::Rule::matches_account(const char* zUser, const char* zHost) const
+{
+    bool match = true;
 
-            vector<SAccount>::const_iterator i = std::find_if(m_exempted.begin(),
-                                                              m_exempted.end(),
-                                                              matcher);
+    if (m_applies_to.size() != 0)
+    {
+        match = matches_any(m_pApplies_to, m_applies_to, zUser, zHost);
+    }
 
-            match = (i == m_exempted.end());
-        }
+    if (match && (m_exempted.size() != 0))
+    {
+        // If it is still a match, we need to check whether the user/host is
+        // exempted.
+        match = !matches_any(m_pExempted, m_exempted, zUser, zHost);
     }
 
     return match;
@@ -706,47 +859,53 @@ bool MaskingRules::Rule::matches(const ComQueryResponse::ColumnDef& column_def,
 
 void MaskingRules::Rule::rewrite(LEncString& s) const
 {
-    bool rewritten = false;
-
-    size_t total_len = s.length();
+    uint8_t* pData = s.length() ? reinterpret_cast<uint8_t*>(&*s.begin()) : NULL;
 
-    if (!m_value.empty())
+    if (!rewrite(pData, 0, s.length(), s.length()))
     {
-        if (m_value.length() == total_len)
-        {
-            std::copy(m_value.begin(), m_value.end(), s.begin());
-            rewritten = true;
-        }
+        MXS_ERROR("Length of returned value \"%s\" is %u, while length of "
+                  "replacement value \"%s\" is %u, and no 'fill' value specified.",
+                  s.to_string().c_str(), (unsigned)s.length(),
+                  m_value.c_str(), (unsigned)m_value.length());
     }
+}
 
-    if (!rewritten)
+bool MaskingRules::Rule::rewrite(uint8_t* pData, size_t offset, size_t len, size_t total_len) const
+{
+    bool rewritten = true;
+
+    if (!m_value.empty() && (m_value.length() == total_len))
     {
-        if (!m_fill.empty())
-        {
-            LEncString::iterator i = s.begin();
-            size_t len = m_fill.length();
+        std::copy(m_value.data() + offset, m_value.data() + offset + len, pData);
+    }
+    else if (m_fill.length() == 1)
+    {
+        std::fill(pData, pData + len, m_fill[0]);
+    }
+    else if (!m_fill.empty())
+    {
+        // The fill is repeated from the start of the value, so the position
+        // within the fill is given by the offset within the value.
+        size_t fill_len = m_fill.length();
+        size_t i = offset % fill_len;
 
-            while (total_len)
-            {
-                if (total_len < len)
-                {
-                    len = total_len;
-                }
+        while (len)
+        {
+            size_t n = std::min(fill_len - i, len);
 
-                std::copy(m_fill.data(), m_fill.data() + len, i);
+            std::copy(m_fill.data() + i, m_fill.data() + i + n, pData);
 
-                i += len;
-                total_len -= len;
-            }
-        }
-        else
-        {
-            MXS_ERROR("Length of returned value \"%s\" is %u, while length of "
-                      "replacement value \"%s\" is %u, and no 'fill' value specified.",
-                      s.to_string().c_str(), (unsigned)s.length(),
-                      m_value.c_str(), (unsigned)m_value.length());
+            pData += n;
+            len -= n;
+            i = 0;
         }
     }
+    else
+    {
+        rewritten = false;
+    }
+
+    return rewritten;
 }
 
 //
@@ -758,6 +917,16 @@ MaskingRules::MaskingRules(json_t* pRoot, const std::vector<SRule>& rules)
     , m_rules(rules)
 {
     json_incref(m_pRoot);
+
+    // A rule can only match a column with the same name, so only the rules
+    // of that column need to be checked. The order of the rules is retained,
+    // so the first matching rule is still the one that is used.
+    for (vector<SRule>::const_iterator i = m_rules.begin(); i != m_rules.end(); ++i)
+    {
+        const SRule& sRule = *i;
+
+        m_rules_by_column[sRule->column()].push_back(sRule.get());
+    }
 }
 
 MaskingRules::~MaskingRules()
@@ -840,48 +1009,51 @@ std::auto_ptr<MaskingRules> MaskingRules::create_from(json_t* pRoot)
     return sRules;
 }
 
-namespace
+const MaskingRules::Rule* MaskingRules::get_rule_for(const ComQueryResponse::ColumnDef& column_def,
+                                                     const char* zUser,
+                                                     const char* zHost) const
 {
+    const Rule* pRule = NULL;
 
-class RuleMatcher : std::unary_function<MaskingRules::SRule, bool>
-{
-public:
-    RuleMatcher(const ComQueryResponse::ColumnDef& column_def,
-                const char* zUser,
-                const char* zHost)
-        : m_column_def(column_def)
-        , m_zUser(zUser)
-        , m_zHost(zHost)
-    {
-    }
+    RulesByColumn::const_iterator i = m_rules_by_column.find(column_def.org_name().to_string());
 
-    bool operator()(const MaskingRules::SRule& sRule)
+    if (i != m_rules_by_column.end())
     {
-        return sRule->matches(m_column_def, m_zUser, m_zHost);
-    }
+        const vector<const Rule*>& rules = i->second;
 
-private:
-    const ComQueryResponse::ColumnDef& m_column_def;
-    const char* m_zUser;
-    const char* m_zHost;
-};
+        for (vector<const Rule*>::const_iterator j = rules.begin(); !pRule && (j != rules.end()); ++j)
+        {
+            if ((*j)->matches(column_def, zUser, zHost))
+            {
+                pRule = *j;
+            }
+        }
+    }
 
+    return pRule;
 }
 
-const MaskingRules::Rule* MaskingRules::get_rule_for(const ComQueryResponse::ColumnDef& column_def,
+const MaskingRules::Rule* MaskingRules::get_rule_for(const string& database,
+                                                     const string& table,
+                                                     const string& column,
                                                      const char* zUser,
                                                      const char* zHost) const
 {
     const Rule* pRule = NULL;
 
-    RuleMatcher matcher(column_def, zUser, zHost);
-    vector<SRule>::const_iterator i = std::find_if(m_rules.begin(), m_rules.end(), matcher);
+    RulesByColumn::const_iterator i = m_rules_by_column.find(column);
 
-    if (i != m_rules.end())
+    if (i != m_rules_by_column.end())
     {
-        const SRule& sRule = *i;
+        const vector<const Rule*>& rules = i->second;
 
-        pRule = sRule.get();
+        for (vector<const Rule*>::const_iterator j = rules.begin(); !pRule && (j != rules.end()); ++j)
+        {
+            if ((*j)->matches(database, table, column, zUser, zHost))
+            {
+                pRule = *j;
+            }
+        }
     }
 
     return pRule;
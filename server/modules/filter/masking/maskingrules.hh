@@ -15,9 +15,11 @@
 #include <maxscale/cppdefs.hh>
 #include <memory>
 #include <tr1/memory>
+#include <tr1/unordered_map>
 #include <string>
 #include <vector>
 #include <jansson.h>
+#include <maxscale/pcre2.h>
 #include "mysql.hh"
 
 /**
@@ -62,6 +64,18 @@ public:
              * @return True, if the data should be masked.
              */
             virtual bool matches(const char* zUser, const char* zHost) const = 0;
+
+            /**
+             * Return a PCRE2 pattern equivalent to @c matches.
+             *
+             * The pattern is matched against a string consisting of the user
+             * and the host separated by a newline, and it is used for combining
+             * several accounts into a single regular expression.
+             *
+             * @return A pattern that matches "user\nhost" if @c matches would
+             *         return true for the user and host.
+             */
+            virtual std::string pattern() const = 0;
         };
 
         typedef std::tr1::shared_ptr<Account> SAccount;
@@ -142,12 +156,45 @@ public:
                      const char* zUser,
                      const char* zHost) const;
 
+        /**
+         * Establish whether a rule matches a column and user/host.
+         *
+         * @param database  The database of the column.
+         * @param table     The original table of the column.
+         * @param column    The original name of the column.
+         * @param zUser     The current user.
+         * @param zHost     The current host.
+         *
+         * @return True, if the rule matches.
+         */
+        bool matches(const std::string& database,
+                     const std::string& table,
+                     const std::string& column,
+                     const char* zUser,
+                     const char* zHost) const;
+
         void rewrite(LEncString& s) const;
 
+        /**
+         * Rewrite a part of a value in place.
+         *
+         * @param pData      The bytes to rewrite.
+         * @param offset     The offset of @c pData within the value.
+         * @param len        The number of bytes to rewrite.
+         * @param total_len  The length of the entire value.
+         *
+         * @return True, if the bytes could be rewritten, false if the length
+         *         of the value does not match the replacement value and
+         *         no fill has been specified.
+         */
+        bool rewrite(uint8_t* pData, size_t offset, size_t len, size_t total_len) const;
+
     private:
         Rule(const Rule&);
         Rule& operator = (const Rule&);
 
+        bool matches_account(const char* zUser, const char* zHost) const;
+
     private:
         std::string           m_column;
         std::string           m_table;
@@ -156,6 +203,8 @@ public:
         std::string           m_fill;
         std::vector<SAccount> m_applies_to;
         std::vector<SAccount> m_exempted;
+        pcre2_code*           m_pApplies_to; /*<! All of m_applies_to combined, or NULL. */
+        pcre2_code*           m_pExempted;   /*<! All of m_exempted combined, or NULL. */
     };
 
     ~MaskingRules();
@@ -205,11 +254,34 @@ public:
                              const char* zUser,
                              const char* zHost) const;
 
+    /**
+     * Return the rule object that matches a column and user/host.
+     *
+     * @param database  The database of the column.
+     * @param table     The original table of the column.
+     * @param column    The original name of the column.
+     * @param zUser     The current user.
+     * @param zHost     The current host.
+     *
+     * @return A rule object that matches the column and user/host
+     *         or NULL if no such rule object exists.
+     *
+     * @attention The returned object remains value only as long as the
+     *            @c MaskingRules object remains valid.
+     */
+    const Rule* get_rule_for(const std::string& database,
+                             const std::string& table,
+                             const std::string& column,
+                             const char* zUser,
+                             const char* zHost) const;
+
     typedef std::tr1::shared_ptr<Rule> SRule;
 
 private:
     MaskingRules(json_t* pRoot, const std::vector<SRule>& rules);
 
+    typedef std::tr1::unordered_map<std::string, std::vector<const Rule*> > RulesByColumn;
+
 private:
     MaskingRules(const MaskingRules&);
     MaskingRules& operator = (const MaskingRules&);
@@ -217,4 +289,5 @@ private:
 private:
     json_t*            m_pRoot;
     std::vector<SRule> m_rules;
+    RulesByColumn      m_rules_by_column; /*<! The rules, in order, keyed by column name. */
 };
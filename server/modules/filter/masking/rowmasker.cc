@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#define MXS_MODULE_NAME "masking"
+#include "rowmasker.hh"
+#include <algorithm>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/protocol/mysql.h>
+
+using std::vector;
+
+RowMasker::RowMasker()
+    : m_binary(false)
+    , m_state(ROW_END)
+    , m_index(0)
+    , m_nRead(0)
+    , m_nLength_bytes(0)
+    , m_value_len(0)
+    , m_nLeft(0)
+{
+}
+
+void RowMasker::reset(bool binary,
+                      const vector<enum_field_types>& types,
+                      const vector<const MaskingRules::Rule*>& rules)
+{
+    ss_dassert(types.size() == rules.size());
+
+    m_binary = binary;
+    m_columns.resize(types.size());
+
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        Column& column = m_columns[i];
+
+        column.encoding = LENENC;
+        column.size = 0;
+        column.pRule = rules[i];
+
+        if (binary)
+        {
+            // See https://dev.mysql.com/doc/internals/en/binary-protocol-value.html
+            switch (types[i])
+            {
+            case MYSQL_TYPE_LONGLONG:
+            case MYSQL_TYPE_DOUBLE:
+                column.encoding = FIXED;
+                column.size = 8;
+                break;
+
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_FLOAT:
+                column.encoding = FIXED;
+                column.size = 4;
+                break;
+
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_YEAR:
+                column.encoding = FIXED;
+                column.size = 2;
+                break;
+
+            case MYSQL_TYPE_TINY:
+                column.encoding = FIXED;
+                column.size = 1;
+                break;
+
+            case MYSQL_TYPE_NULL:
+                column.encoding = FIXED;
+                column.size = 0;
+                break;
+
+            case MYSQL_TYPE_DATE:
+            case MYSQL_TYPE_DATETIME:
+            case MYSQL_TYPE_TIMESTAMP:
+            case MYSQL_TYPE_TIME:
+                column.encoding = LENGTH_BYTE;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        ss_dassert(!column.pRule || column.encoding == LENENC);
+    }
+
+    // See https://dev.mysql.com/doc/internals/en/binary-protocol-resultset-row.html
+    m_nulls.resize(binary ? (types.size() + 7 + 2) / 8 : 0);
+    m_state = ROW_END;
+}
+
+void RowMasker::start_row()
+{
+    m_index = 0;
+    m_nRead = 0;
+
+    if (m_binary)
+    {
+        m_state = ROW_HEADER;
+    }
+    else
+    {
+        begin_column();
+    }
+}
+
+void RowMasker::mask(uint8_t* pData, size_t len)
+{
+    uint8_t* pEnd = pData + len;
+
+    while ((pData < pEnd) && (m_state != ROW_END))
+    {
+        switch (m_state)
+        {
+        case ROW_HEADER:
+            ss_dassert(*pData == 0);
+            ++pData;
+            m_state = NULL_BITMAP;
+            break;
+
+        case NULL_BITMAP:
+            {
+                size_t n = std::min((size_t)(pEnd - pData), m_nulls.size() - m_nRead);
+                std::copy(pData, pData + n, m_nulls.begin() + m_nRead);
+                pData += n;
+                m_nRead += n;
+
+                if (m_nRead == m_nulls.size())
+                {
+                    begin_column();
+                }
+            }
+            break;
+
+        case LENGTH:
+            {
+                uint8_t c = *pData++;
+
+                if ((c < 0xfb) || (m_columns[m_index].encoding == LENGTH_BYTE))
+                {
+                    begin_value(c);
+                }
+                else if (c == 0xfb)
+                {
+                    // NULL
+                    end_column();
+                }
+                else
+                {
+                    m_nLength_bytes = (c == 0xfc) ? 2 : ((c == 0xfd) ? 3 : 8);
+                    m_nRead = 0;
+                    m_value_len = 0;
+                    m_state = LENGTH_BYTES;
+                }
+            }
+            break;
+
+        case LENGTH_BYTES:
+            m_value_len |= (uint64_t)*pData++ << (8 * m_nRead++);
+
+            if (m_nRead == m_nLength_bytes)
+            {
+                begin_value(m_value_len);
+            }
+            break;
+
+        case VALUE:
+            {
+                size_t n = std::min((uint64_t)(pEnd - pData), m_nLeft);
+                const MaskingRules::Rule* pRule = m_columns[m_index].pRule;
+
+                if (pRule)
+                {
+                    size_t offset = m_value_len - m_nLeft;
+
+                    if (!pRule->rewrite(pData, offset, n, m_value_len) && (offset == 0))
+                    {
+                        MXS_ERROR("Length of returned value is %lu, while length of "
+                                  "replacement value \"%s\" is %u, and no 'fill' value specified.",
+                                  (unsigned long)m_value_len,
+                                  pRule->value().c_str(), (unsigned)pRule->value().length());
+                    }
+                }
+
+                pData += n;
+                m_nLeft -= n;
+
+                if (m_nLeft == 0)
+                {
+                    end_column();
+                }
+            }
+            break;
+
+        case ROW_END:
+            ss_dassert(!true);
+            break;
+        }
+    }
+}
+
+void RowMasker::mask(GWBUF* pPacket)
+{
+    size_t skip = MYSQL_HEADER_LEN;
+
+    for (GWBUF* pBuf = pPacket; pBuf && (m_state != ROW_END); pBuf = pBuf->next)
+    {
+        size_t len = GWBUF_LENGTH(pBuf);
+
+        if (skip < len)
+        {
+            mask(GWBUF_DATA(pBuf) + skip, len - skip);
+            skip = 0;
+        }
+        else
+        {
+            skip -= len;
+        }
+    }
+}
+
+void RowMasker::begin_column()
+{
+    m_state = ROW_END;
+
+    while ((m_index < m_columns.size()) && (m_state == ROW_END))
+    {
+        const Column& column = m_columns[m_index];
+
+        if (m_binary && is_null(m_index))
+        {
+            // NULL values of a binary row have no bytes at all.
+            ++m_index;
+        }
+        else if (column.encoding == FIXED)
+        {
+            if (column.size != 0)
+            {
+                m_value_len = column.size;
+                m_nLeft = column.size;
+                m_state = VALUE;
+            }
+            else
+            {
+                ++m_index;
+            }
+        }
+        else
+        {
+            m_state = LENGTH;
+        }
+    }
+}
+
+void RowMasker::begin_value(uint64_t len)
+{
+    if (len != 0)
+    {
+        m_value_len = len;
+        m_nLeft = len;
+        m_state = VALUE;
+    }
+    else
+    {
+        end_column();
+    }
+}
+
+void RowMasker::end_column()
+{
+    ++m_index;
+    begin_column();
+}
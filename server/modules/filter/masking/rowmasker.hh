@@ -0,0 +1,127 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/cppdefs.hh>
+#include <vector>
+#include <maxscale/buffer.h>
+#include "maskingrules.hh"
+
+/**
+ * @class RowMasker
+ *
+ * A RowMasker masks the values of resultset rows in place, without requiring
+ * the row to be contiguous. The payload of a row can be provided in arbitrary
+ * chunks, so a row that is split across several buffers or, if the payload is
+ * larger than 16MB, across several packets can be masked as it arrives.
+ *
+ * The rules are resolved once per resultset, when the masker is reset, and
+ * the rows are then scanned without any per-value lookups or copying.
+ */
+class RowMasker
+{
+public:
+    RowMasker();
+
+    /**
+     * Prepare the masker for the rows of a resultset.
+     *
+     * @param binary  True, if the rows are binary resultset rows (the response
+     *                to a COM_STMT_EXECUTE), false if they are textual.
+     * @param types   The types of the columns.
+     * @param rules   The rule of each column, or NULL if the values of the column
+     *                should not be masked. Must be as long as @c types and only
+     *                columns of string type may have a rule.
+     */
+    void reset(bool binary,
+               const std::vector<enum_field_types>& types,
+               const std::vector<const MaskingRules::Rule*>& rules);
+
+    /**
+     * Start a new row. The following calls to @c mask provide the payload
+     * of the row.
+     */
+    void start_row();
+
+    /**
+     * Mask a chunk of the payload of the current row.
+     *
+     * @param pData  The next bytes of the payload of the row.
+     * @param len    The number of bytes.
+     */
+    void mask(uint8_t* pData, size_t len);
+
+    /**
+     * Mask the payload of a packet containing the current row or, if the
+     * row is larger than 16MB, a part of it.
+     *
+     * @param pPacket  A single MySQL packet, possibly consisting of a chain
+     *                 of buffers.
+     */
+    void mask(GWBUF* pPacket);
+
+    /**
+     * @return True, if all values of the current row have been processed.
+     */
+    bool row_complete() const
+    {
+        return m_state == ROW_END;
+    }
+
+private:
+    enum state_t
+    {
+        ROW_HEADER,   /*<! The 0x00 header of a binary row. */
+        NULL_BITMAP,  /*<! The NULL bitmap of a binary row. */
+        LENGTH,       /*<! The first byte of the length of a value. */
+        LENGTH_BYTES, /*<! The remaining bytes of a length-encoded integer. */
+        VALUE,        /*<! The bytes of a value. */
+        ROW_END       /*<! All values have been processed. */
+    };
+
+    enum encoding_t
+    {
+        LENENC,       /*<! A length-encoded string. */
+        LENGTH_BYTE,  /*<! A byte specifying the length, followed by that many bytes. */
+        FIXED         /*<! A fixed number of bytes. */
+    };
+
+    struct Column
+    {
+        encoding_t                encoding;
+        uint8_t                   size;  /*<! The size of a FIXED value. */
+        const MaskingRules::Rule* pRule; /*<! The rule of the column, or NULL. */
+    };
+
+    bool is_null(size_t index) const
+    {
+        // The two first bits of the NULL bitmap of a binary row are not used.
+        index += 2;
+        return m_nulls[index / 8] & (1 << (index % 8));
+    }
+
+    void begin_column();
+    void begin_value(uint64_t len);
+    void end_column();
+
+private:
+    std::vector<Column>  m_columns;        /*<! The columns of the resultset. */
+    bool                 m_binary;         /*<! Whether the rows are binary. */
+    std::vector<uint8_t> m_nulls;          /*<! The NULL bitmap of the current binary row. */
+    state_t              m_state;          /*<! What is expected next. */
+    size_t               m_index;          /*<! The index of the current column. */
+    size_t               m_nRead;          /*<! Bytes read of the NULL bitmap or the length. */
+    size_t               m_nLength_bytes;  /*<! Bytes in the length of the current value. */
+    uint64_t             m_value_len;      /*<! The length of the current value. */
+    uint64_t             m_nLeft;          /*<! Bytes left of the current value. */
+};
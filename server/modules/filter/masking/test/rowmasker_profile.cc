@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "rowmasker.hh"
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <time.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+
+using namespace std;
+
+namespace
+{
+
+char USAGE[] =
+    "usage: rowmasker_profile [-n rows] [-c columns] [-m masked] [-l length] [-b]\n"
+    "\n"
+    "-n  Number of rows to mask, default 100000.\n"
+    "-c  Number of columns in a row, default 100.\n"
+    "-m  Every m:th column is masked, default 2.\n"
+    "-l  Length of each value, default 20.\n"
+    "-b  Use binary instead of textual rows.\n";
+
+timespec timespec_subtract(const timespec& later, const timespec& earlier)
+{
+    timespec result = { 0, 0 };
+
+    ss_dassert((later.tv_sec > earlier.tv_sec) ||
+               ((later.tv_sec == earlier.tv_sec) && (later.tv_nsec > earlier.tv_nsec)));
+
+    if (later.tv_nsec >= earlier.tv_nsec)
+    {
+        result.tv_sec = later.tv_sec - earlier.tv_sec;
+        result.tv_nsec = later.tv_nsec - earlier.tv_nsec;
+    }
+    else
+    {
+        result.tv_sec = later.tv_sec - earlier.tv_sec - 1;
+        result.tv_nsec = 1000000000 + later.tv_nsec - earlier.tv_nsec;
+    }
+
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+
+    int nRows = 100000;
+    int nColumns = 100;
+    int nMasked = 2;
+    int len = 20;
+    bool binary = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:c:m:l:b")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            nRows = atoi(optarg);
+            break;
+
+        case 'c':
+            nColumns = atoi(optarg);
+            break;
+
+        case 'm':
+            nMasked = atoi(optarg);
+            break;
+
+        case 'l':
+            len = atoi(optarg);
+            break;
+
+        case 'b':
+            binary = true;
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if ((rc == EXIT_SUCCESS) && (nRows > 0) && (nColumns > 0) && (nMasked > 0) &&
+        (len > 0) && (len < 0xfb))
+    {
+        if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+        {
+            const vector<MaskingRules::Rule::SAccount> no_accounts;
+            MaskingRules::Rule rule("a", "", "", "", "X", no_accounts, no_accounts);
+
+            vector<enum_field_types> types(nColumns, MYSQL_TYPE_VAR_STRING);
+            vector<const MaskingRules::Rule*> rules(nColumns, NULL);
+            vector<uint8_t> row;
+
+            if (binary)
+            {
+                // The row header and an empty NULL bitmap.
+                row.push_back(0);
+                row.resize(1 + (nColumns + 7 + 2) / 8, 0);
+            }
+
+            for (int i = 0; i < nColumns; ++i)
+            {
+                if (i % nMasked == 0)
+                {
+                    rules[i] = &rule;
+                }
+
+                row.push_back(len);
+                row.resize(row.size() + len, 'a');
+            }
+
+            RowMasker masker;
+            masker.reset(binary, types, rules);
+
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+            for (int i = 0; i < nRows; ++i)
+            {
+                masker.start_row();
+                masker.mask(&row[0], row.size());
+            }
+
+            struct timespec finish;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &finish);
+
+            struct timespec diff = timespec_subtract(finish, start);
+            double seconds = diff.tv_sec + diff.tv_nsec / 1000000000.0;
+            double mb = (double)row.size() * nRows / (1024 * 1024);
+
+            cout << "Time:" << diff.tv_sec << "." << setfill('0') << setw(9) << diff.tv_nsec << endl;
+            cout << "Throughput: " << fixed << setprecision(1)
+                 << (seconds > 0 ? mb / seconds : 0) << " MB/s, "
+                 << (seconds > 0 ? nRows / seconds : 0) << " rows/s" << endl;
+
+            mxs_log_finish();
+        }
+        else
+        {
+            cerr << "error: Could not initialize log." << endl;
+            rc = EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rc;
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "rowmasker.hh"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <maxscale/alloc.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/protocol/mysql.h>
+
+using namespace std;
+
+namespace
+{
+
+typedef MaskingRules::Rule Rule;
+
+const vector<Rule::SAccount> no_accounts;
+
+// Same length as the value, so the value is used.
+Rule value_rule("a", "", "", "1234", "", no_accounts, no_accounts);
+// Different length than the value, so the fill is used.
+Rule fill_rule("b", "", "", "blah", "xy", no_accounts, no_accounts);
+
+void append_lenenc(vector<uint8_t>& row, uint64_t n)
+{
+    size_t nBytes = 0;
+
+    if (n < 0xfb)
+    {
+        row.push_back(n);
+    }
+    else if (n < 0x10000)
+    {
+        row.push_back(0xfc);
+        nBytes = 2;
+    }
+    else if (n < 0x1000000)
+    {
+        row.push_back(0xfd);
+        nBytes = 3;
+    }
+    else
+    {
+        row.push_back(0xfe);
+        nBytes = 8;
+    }
+
+    for (size_t i = 0; i < nBytes; ++i)
+    {
+        row.push_back((n >> (8 * i)) & 0xff);
+    }
+}
+
+void append_string(vector<uint8_t>& row, const string& s)
+{
+    append_lenenc(row, s.length());
+    row.insert(row.end(), s.begin(), s.end());
+}
+
+string filled(size_t len)
+{
+    string s;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        s += (i % 2 == 0) ? 'x' : 'y';
+    }
+
+    return s;
+}
+
+/**
+ * Mask a row in chunks of all sizes and compare the result to the expected row.
+ */
+int test_chunks(RowMasker& masker, const vector<uint8_t>& row, const vector<uint8_t>& expected)
+{
+    int rv = 0;
+
+    for (size_t chunk = 1; chunk <= row.size(); ++chunk)
+    {
+        vector<uint8_t> data(row);
+
+        masker.start_row();
+
+        for (size_t i = 0; i < data.size(); i += chunk)
+        {
+            masker.mask(&data[i], min(chunk, data.size() - i));
+        }
+
+        if (!masker.row_complete())
+        {
+            cerr << "error: The row was not completely processed with chunk size "
+                 << chunk << "." << endl;
+            ++rv;
+        }
+
+        if (data != expected)
+        {
+            cerr << "error: The row was not masked correctly with chunk size "
+                 << chunk << "." << endl;
+            ++rv;
+        }
+    }
+
+    return rv;
+}
+
+int test_text()
+{
+    cout << "Text rows" << endl;
+
+    vector<enum_field_types> types;
+    vector<const Rule*> rules;
+
+    types.push_back(MYSQL_TYPE_VAR_STRING);
+    rules.push_back(&value_rule);
+    types.push_back(MYSQL_TYPE_VAR_STRING);
+    rules.push_back(&fill_rule);
+    types.push_back(MYSQL_TYPE_LONG);
+    rules.push_back(NULL);
+    types.push_back(MYSQL_TYPE_VAR_STRING);
+    rules.push_back(&value_rule);
+    types.push_back(MYSQL_TYPE_BLOB);
+    rules.push_back(&fill_rule);
+    types.push_back(MYSQL_TYPE_VAR_STRING);
+    rules.push_back(NULL);
+
+    vector<uint8_t> row;
+    vector<uint8_t> expected;
+
+    append_string(row, "abcd");
+    append_string(expected, "1234");
+    append_string(row, "hello");
+    append_string(expected, filled(5));
+    append_string(row, "42");
+    append_string(expected, "42");
+    row.push_back(0xfb); // NULL
+    expected.push_back(0xfb);
+    append_string(row, string(300, 'q'));
+    append_string(expected, filled(300));
+    append_string(row, "plain");
+    append_string(expected, "plain");
+
+    RowMasker masker;
+    masker.reset(false, types, rules);
+
+    return test_chunks(masker, row, expected);
+}
+
+int test_binary()
+{
+    cout << "Binary rows" << endl;
+
+    vector<enum_field_types> types;
+    vector<const Rule*> rules;
+
+    types.push_back(MYSQL_TYPE_LONGLONG);
+    rules.push_back(NULL);
+    types.push_back(MYSQL_TYPE_VAR_STRING);
+    rules.push_back(&value_rule);
+    types.push_back(MYSQL_TYPE_DATETIME);
+    rules.push_back(NULL);
+    types.push_back(MYSQL_TYPE_VAR_STRING);
+    rules.push_back(&fill_rule);
+    types.push_back(MYSQL_TYPE_BLOB);
+    rules.push_back(&fill_rule);
+    types.push_back(MYSQL_TYPE_TINY);
+    rules.push_back(NULL);
+
+    vector<uint8_t> row;
+    vector<uint8_t> expected;
+
+    row.push_back(0x00);
+    // The value of the fourth column is NULL; the two first bits are not used.
+    row.push_back(1 << (3 + 2));
+
+    for (int i = 0; i < 8; ++i)
+    {
+        // Bytes that would look like lengths, if interpreted as such.
+        row.push_back(0xf8 + i);
+    }
+
+    expected = row;
+
+    append_string(row, "abcd");
+    append_string(expected, "1234");
+
+    const uint8_t datetime[] = { 7, 0xe1, 0x07, 1, 2, 3, 4, 5 };
+    row.insert(row.end(), datetime, datetime + sizeof(datetime));
+    expected.insert(expected.end(), datetime, datetime + sizeof(datetime));
+
+    append_string(row, string(70000, 'q'));
+    append_string(expected, filled(70000));
+
+    row.push_back(0xff);
+    expected.push_back(0xff);
+
+    RowMasker masker;
+    masker.reset(true, types, rules);
+
+    // Masking a 70kB row byte by byte takes a while, so only a few chunk
+    // sizes are tested.
+    int rv = 0;
+    const size_t chunks[] = { 1, 2, 3, 7, 251, 4096, row.size() };
+
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i)
+    {
+        vector<uint8_t> data(row);
+
+        masker.start_row();
+
+        for (size_t j = 0; j < data.size(); j += chunks[i])
+        {
+            masker.mask(&data[j], min(chunks[i], data.size() - j));
+        }
+
+        if (!masker.row_complete() || (data != expected))
+        {
+            cerr << "error: The row was not masked correctly with chunk size "
+                 << chunks[i] << "." << endl;
+            ++rv;
+        }
+    }
+
+    return rv;
+}
+
+GWBUF* create_packet(const uint8_t* pPayload, size_t len, uint8_t packet_no)
+{
+    uint8_t header[MYSQL_HEADER_LEN];
+    gw_mysql_set_byte3(header, len);
+    header[3] = packet_no;
+
+    GWBUF* pPacket = gwbuf_alloc_and_load(MYSQL_HEADER_LEN, header);
+    MXS_ABORT_IF_NULL(pPacket);
+
+    // Split the payload into two buffers, so that the packet is a chain.
+    size_t half = len / 2;
+    pPacket = gwbuf_append(pPacket, gwbuf_alloc_and_load(half, pPayload));
+    pPacket = gwbuf_append(pPacket, gwbuf_alloc_and_load(len - half, pPayload + half));
+
+    return pPacket;
+}
+
+int test_large_payload()
+{
+    cout << "Rows larger than 16MB" << endl;
+
+    vector<enum_field_types> types;
+    vector<const Rule*> rules;
+
+    types.push_back(MYSQL_TYPE_LONG_BLOB);
+    rules.push_back(&fill_rule);
+    types.push_back(MYSQL_TYPE_VAR_STRING);
+    rules.push_back(&value_rule);
+
+    vector<uint8_t> row;
+    size_t len = 0xffffff + 100;
+
+    append_lenenc(row, len);
+    row.resize(row.size() + len, 'q');
+    append_string(row, "abcd");
+
+    // The payload of the first packet is exactly 16MB, which means that the
+    // row continues in the next packet.
+    size_t first = 0xffffff;
+    GWBUF* pFirst = create_packet(&row[0], first, 1);
+    GWBUF* pSecond = create_packet(&row[first], row.size() - first, 2);
+
+    RowMasker masker;
+    masker.reset(false, types, rules);
+
+    masker.start_row();
+    masker.mask(pFirst);
+
+    int rv = 0;
+
+    if (masker.row_complete())
+    {
+        cerr << "error: The row was completed by the first packet." << endl;
+        ++rv;
+    }
+
+    masker.mask(pSecond);
+
+    if (!masker.row_complete())
+    {
+        cerr << "error: The row was not completed by the second packet." << endl;
+        ++rv;
+    }
+
+    vector<uint8_t> data(row.size());
+    size_t n = gwbuf_copy_data(pFirst, MYSQL_HEADER_LEN, first, &data[0]);
+    n += gwbuf_copy_data(pSecond, MYSQL_HEADER_LEN, row.size() - first, &data[first]);
+    ss_dassert(n == row.size());
+
+    vector<uint8_t> expected;
+    append_lenenc(expected, len);
+    string fill = filled(len);
+    expected.insert(expected.end(), fill.begin(), fill.end());
+    append_string(expected, "1234");
+
+    if (data != expected)
+    {
+        cerr << "error: The row was not masked correctly." << endl;
+        ++rv;
+    }
+
+    gwbuf_free(pFirst);
+    gwbuf_free(pSecond);
+
+    return rv;
+}
+
+}
+
+int main()
+{
+    int rv = 0;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_STDOUT))
+    {
+        rv += test_text();
+        rv += test_binary();
+        rv += test_large_payload();
+
+        mxs_log_finish();
+    }
+    else
+    {
+        cerr << "error: Could not initialize log." << endl;
+        rv = EXIT_FAILURE;
+    }
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
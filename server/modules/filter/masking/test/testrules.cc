@@ -132,6 +132,7 @@ const char valid_users[] =
     "        \"'alice'@'host'\","
     "        \"'bob'@'%'\","
     "        \"'cecil'@'%.123.45.2'\","
+    "        \"'frank'@'192.168.%'\","
     "        \"'david'\","
     "        \"@'host'\""
     "      ],"
@@ -160,6 +161,10 @@ struct expected_account
         "cecil",
         ".*\\.123\\.45\\.2"
     },
+    {
+        "frank",
+        "192\\.168\\..*"
+    },
     {
         "david",
         ""
@@ -172,6 +177,88 @@ struct expected_account
 
 const size_t nExpected_accounts = (sizeof(expected_accounts) / sizeof(expected_accounts[0]));
 
+// Several rules for the same column, and rules for different columns.
+const char valid_columns[] =
+    "{"
+    "  \"rules\": ["
+    "    {"
+    "      \"replace\": { "
+    "        \"column\": \"a\", "
+    "        \"table\": \"t1\" "
+    "      },"
+    "      \"with\": {"
+    "        \"value\": \"first\" "
+    "      }"
+    "    },"
+    "    {"
+    "      \"replace\": { "
+    "        \"column\": \"b\" "
+    "      },"
+    "      \"with\": {"
+    "        \"value\": \"other\" "
+    "      }"
+    "    },"
+    "    {"
+    "      \"replace\": { "
+    "        \"column\": \"a\", "
+    "        \"database\": \"d\" "
+    "      },"
+    "      \"with\": {"
+    "        \"value\": \"second\" "
+    "      }"
+    "    },"
+    "    {"
+    "      \"replace\": { "
+    "        \"column\": \"a\" "
+    "      },"
+    "      \"with\": {"
+    "        \"value\": \"third\" "
+    "      }"
+    "    }"
+    "  ]"
+    "}";
+
+struct expected_column_rule
+{
+    const char* zDatabase;
+    const char* zTable;
+    const char* zColumn;
+    const char* zValue; // NULL, if no rule should match
+} expected_column_rules[] =
+{
+    { "d", "t1", "a", "first" },
+    { "d", "t2", "a", "second" },
+    { "e", "t2", "a", "third" },
+    { "e", "t1", "b", "other" },
+    { "d", "t1", "c", NULL },
+};
+
+const size_t nExpected_column_rules =
+    (sizeof(expected_column_rules) / sizeof(expected_column_rules[0]));
+
+struct expected_match
+{
+    const char* zUser;
+    const char* zHost;
+    bool        match;
+} expected_matches[] =
+{
+    { "alice", "host",       true },
+    { "alice", "other",      false },
+    { "bob",   "anywhere",   true },
+    { "cecil", "1.123.45.2", true },
+    { "cecil", "1.123.46.2", false },
+    { "cecil", "1.123.45.23", false },
+    { "frank", "192.168.0.1",  true },
+    { "frank", "10.192.168.5", false },
+    { "david", "anywhere",   true },
+    { "eve",   "host",       true },
+    { "eve",   "other",      false },
+    { "admin", "host",       false },
+};
+
+const size_t nExpected_matches = (sizeof(expected_matches) / sizeof(expected_matches[0]));
+
 class MaskingRulesTester
 {
 public:
@@ -238,6 +325,50 @@ public:
 
         return rc;
     }
+
+    static int test_matching()
+    {
+        int rc = EXIT_SUCCESS;
+
+        auto_ptr<MaskingRules> sRules = MaskingRules::parse(valid_columns);
+        ss_dassert(sRules.get());
+
+        for (size_t i = 0; i < nExpected_column_rules; ++i)
+        {
+            const expected_column_rule& e = expected_column_rules[i];
+
+            const MaskingRules::Rule* pRule = sRules->get_rule_for(e.zDatabase, e.zTable, e.zColumn,
+                                                                   "user", "host");
+
+            if ((pRule && !e.zValue) || (!pRule && e.zValue) || (pRule && (pRule->value() != e.zValue)))
+            {
+                cout << i << ": Expected \"" << (e.zValue ? e.zValue : "NULL") << "\", got \""
+                     << (pRule ? pRule->value() : "NULL") << "\"." << endl;
+                rc = EXIT_FAILURE;
+            }
+        }
+
+        sRules = MaskingRules::parse(valid_users);
+        ss_dassert(sRules.get());
+
+        for (size_t i = 0; i < nExpected_matches; ++i)
+        {
+            const expected_match& e = expected_matches[i];
+
+            // The accounts of a rule are combined into a single regular expression,
+            // which must give the same result as matching the accounts one by one.
+            bool match = sRules->get_rule_for("d", "t", "a", e.zUser, e.zHost) != NULL;
+
+            if (match != e.match)
+            {
+                cout << i << ": Expected " << e.zUser << "@" << e.zHost << " to "
+                     << (e.match ? "" : "not ") << "match." << endl;
+                rc = EXIT_FAILURE;
+            }
+        }
+
+        return rc;
+    }
 };
 
 int main()
@@ -248,6 +379,11 @@ int main()
     {
         rc = (MaskingRulesTester::test_parsing() == EXIT_FAILURE) ? EXIT_FAILURE : EXIT_SUCCESS;
         rc = (MaskingRulesTester::test_account_handling() == EXIT_FAILURE) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+        if (MaskingRulesTester::test_matching() == EXIT_FAILURE)
+        {
+            rc = EXIT_FAILURE;
+        }
     }
 
     return rc;
@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file maxqlacheck.c - Binary query log reader
+ *
+ * Checks, prints and aggregates the binary log files written by the qlafilter
+ * with log_format=binary.
+ */
+
+#include <getopt.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <maxscale/alloc.h>
+#include <maxscale/hashtable.h>
+#include <maxscale/log_manager.h>
+#include "qlaformat.h"
+
+/** Statistics of one canonical statement */
+typedef struct
+{
+    const char *canonical; /**< The statement, owned by the hashtable */
+    uint64_t    count;     /**< Number of executions */
+    uint64_t    timed;     /**< Executions with a known duration */
+    uint64_t    total;     /**< Total duration in microseconds */
+    uint64_t    max;       /**< Longest duration in microseconds */
+} STATEMENT_STATS;
+
+static int verbose = 0;
+static bool dump = false;
+static bool aggregate = false;
+static int top = 0;
+static const char *user = NULL;
+static const char *host = NULL;
+static const char *service = NULL;
+static bool use_match = false;
+static regex_t match;
+
+static HASHTABLE *statements = NULL;
+
+/** Buffer for null-terminated copies of strings */
+static char *strbuf = NULL;
+static size_t strbuf_size = 0;
+
+static const char *maxqlacheck_version = "1.0.0";
+
+static struct option long_options[] =
+{
+    {"verbose",   no_argument,       0, 'v'},
+    {"dump",      no_argument,       0, 'd'},
+    {"aggregate", no_argument,       0, 'a'},
+    {"top",       required_argument, 0, 't'},
+    {"user",      required_argument, 0, 'u'},
+    {"host",      required_argument, 0, 'H'},
+    {"service",   required_argument, 0, 's'},
+    {"match",     required_argument, 0, 'm'},
+    {"version",   no_argument,       0, 'V'},
+    {"help",      no_argument,       0, '?'},
+    {0, 0, 0, 0}
+};
+
+static bool string_equals(const QLA_STRING *string, const char *str)
+{
+    return string->len == strlen(str) && memcmp(string->str, str, string->len) == 0;
+}
+
+/**
+ * Get a null-terminated copy of a string. The copy is valid until the
+ * next call.
+ */
+static const char* string_get(const QLA_STRING *string)
+{
+    if (string->len + 1 > strbuf_size)
+    {
+        strbuf_size = string->len + 1;
+        strbuf = MXS_REALLOC(strbuf, strbuf_size);
+        MXS_ABORT_IF_NULL(strbuf);
+    }
+
+    memcpy(strbuf, string->str, string->len);
+    strbuf[string->len] = '\0';
+    return strbuf;
+}
+
+static bool event_matches(const QLA_EVENT *event)
+{
+    return (user == NULL || string_equals(&event->user, user)) &&
+           (host == NULL || string_equals(&event->host, host)) &&
+           (service == NULL || string_equals(&event->service, service)) &&
+           (!use_match || regexec(&match, string_get(&event->canonical), 0, NULL, 0) == 0);
+}
+
+static void dump_event(const QLA_EVENT *event)
+{
+    time_t sec = event->timestamp / 1000000;
+    struct tm t;
+    char date[20];
+    localtime_r(&sec, &t);
+    strftime(date, sizeof(date), "%F %T", &t);
+
+    printf("%.*s,%lu,%s.%06lu,%.*s@%.*s,",
+           (int)event->service.len, event->service.str, event->session,
+           date, event->timestamp % 1000000,
+           (int)event->user.len, event->user.str,
+           (int)event->host.len, event->host.str);
+
+    if (event->duration != QLA_DURATION_UNKNOWN)
+    {
+        printf("%lu", event->duration);
+    }
+
+    printf(",%.*s\n", (int)event->canonical.len, event->canonical.str);
+}
+
+static void aggregate_event(const QLA_EVENT *event)
+{
+    const char *canonical = string_get(&event->canonical);
+    STATEMENT_STATS *stats = hashtable_fetch(statements, (void*)canonical);
+
+    if (stats == NULL)
+    {
+        stats = MXS_CALLOC(1, sizeof(STATEMENT_STATS));
+        MXS_ABORT_IF_NULL(stats);
+        hashtable_add(statements, (void*)canonical, stats);
+    }
+
+    stats->count++;
+
+    if (event->duration != QLA_DURATION_UNKNOWN)
+    {
+        stats->timed++;
+        stats->total += event->duration;
+
+        if (event->duration > stats->max)
+        {
+            stats->max = event->duration;
+        }
+    }
+}
+
+static int cmp_stats(const void *va, const void *vb)
+{
+    const STATEMENT_STATS *a = *(const STATEMENT_STATS**)va;
+    const STATEMENT_STATS *b = *(const STATEMENT_STATS**)vb;
+
+    if (a->total != b->total)
+    {
+        return a->total < b->total ? 1 : -1;
+    }
+
+    if (a->count != b->count)
+    {
+        return a->count < b->count ? 1 : -1;
+    }
+
+    return strcmp(a->canonical, b->canonical);
+}
+
+static void print_aggregate()
+{
+    int n = hashtable_size(statements);
+    STATEMENT_STATS **all = MXS_MALLOC(MXS_MAX(n, 1) * sizeof(STATEMENT_STATS*));
+    MXS_ABORT_IF_NULL(all);
+
+    HASHITERATOR *iter = hashtable_iterator(statements);
+    MXS_ABORT_IF_NULL(iter);
+    char *key;
+    int i = 0;
+
+    while ((key = hashtable_next(iter)) && i < n)
+    {
+        all[i] = hashtable_fetch(statements, key);
+        all[i]->canonical = key;
+        i++;
+    }
+
+    hashtable_iterator_free(iter);
+    qsort(all, i, sizeof(STATEMENT_STATS*), cmp_stats);
+
+    if (top > 0 && top < i)
+    {
+        i = top;
+    }
+
+    printf("Count,Total ms,Average ms,Max ms,Query\n");
+
+    for (int j = 0; j < i; j++)
+    {
+        STATEMENT_STATS *stats = all[j];
+        double avg = stats->timed ? (double)stats->total / stats->timed : 0;
+
+        printf("%lu,%.3f,%.3f,%.3f,%s\n", stats->count, stats->total / 1000.0,
+               avg / 1000.0, stats->max / 1000.0, stats->canonical);
+    }
+
+    MXS_FREE(all);
+}
+
+static int check_file(const char *filename)
+{
+    QLA_READER *reader = qla_reader_open(filename);
+
+    if (reader == NULL)
+    {
+        return 1;
+    }
+
+    uint64_t matched = 0;
+    uint64_t prev_blocks = 0;
+    QLA_EVENT event;
+
+    while (qla_reader_next(reader, &event))
+    {
+        if (verbose > 1 && reader->blocks != prev_blocks)
+        {
+            printf("Block %lu: %lu bytes\n", reader->blocks, reader->len);
+            prev_blocks = reader->blocks;
+        }
+
+        if (event_matches(&event))
+        {
+            matched++;
+
+            if (dump)
+            {
+                dump_event(&event);
+            }
+
+            if (aggregate)
+            {
+                aggregate_event(&event);
+            }
+        }
+    }
+
+    int rval = 0;
+
+    if (reader->error != QLA_READ_OK)
+    {
+        printf("Failed to read block %lu of %s: %s. Read %lu events before failure.\n",
+               reader->blocks + 1, filename, qla_read_error_str(reader->error), reader->events);
+        rval = 1;
+    }
+    else if (!dump && !aggregate)
+    {
+        printf("%s: %lu blocks, %lu events, %lu bytes (%lu uncompressed)\n",
+               filename, reader->blocks, reader->events, reader->stored_bytes,
+               reader->raw_bytes);
+
+        if (verbose && matched != reader->events)
+        {
+            printf("%s: %lu matching events\n", filename, matched);
+        }
+    }
+
+    qla_reader_close(reader);
+    return rval;
+}
+
+/**
+ * Print version information
+ */
+static void
+printVersion(const char *progname)
+{
+    printf("%s Version %s\n", progname, maxqlacheck_version);
+}
+
+/**
+ * Display the --help text.
+ */
+static void
+printUsage(const char *progname)
+{
+    printVersion(progname);
+
+    printf("The MaxScale binary query log utility.\n\n");
+    printf("Usage: %s [OPTIONS] <query log file>...\n\n", progname);
+    printf("  -v|--verbose      Print more information, use twice to print each block\n");
+    printf("  -d|--dump         Print the events as text\n");
+    printf("  -a|--aggregate    Print statistics of each canonical statement\n");
+    printf("  -t|--top N        With --aggregate, print the N statements with the largest total duration\n");
+    printf("  -u|--user USER    Only use the events of this user\n");
+    printf("  -H|--host HOST    Only use the events from this host\n");
+    printf("  -s|--service SVC  Only use the events of this service\n");
+    printf("  -m|--match REGEX  Only use the events whose canonical statement matches the regex\n");
+    printf("  -V|--version      Print version information and exit\n");
+    printf("  -?|--help         Print this help text\n");
+}
+
+int main(int argc, char **argv)
+{
+    int option_index = 0;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "vdat:u:H:s:m:V?", long_options, &option_index)) >= 0)
+    {
+        switch (c)
+        {
+        case 'v':
+            verbose++;
+            break;
+        case 'd':
+            dump = true;
+            break;
+        case 'a':
+            aggregate = true;
+            break;
+        case 't':
+            top = atoi(optarg);
+            break;
+        case 'u':
+            user = optarg;
+            break;
+        case 'H':
+            host = optarg;
+            break;
+        case 's':
+            service = optarg;
+            break;
+        case 'm':
+            if (regcomp(&match, optarg, REG_EXTENDED | REG_NOSUB | REG_ICASE) != 0)
+            {
+                printf("ERROR: Invalid regular expression '%s'.\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            use_match = true;
+            break;
+        case 'V':
+            printVersion(*argv);
+            exit(EXIT_SUCCESS);
+            break;
+        case '?':
+            printUsage(*argv);
+            exit(optopt ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+    }
+
+    if (optind >= argc)
+    {
+        printf("ERROR: No query log file was specified.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    mxs_log_init(NULL, NULL, MXS_LOG_TARGET_STDOUT);
+    mxs_log_set_augmentation(0);
+
+    if (aggregate)
+    {
+        statements = hashtable_alloc(1000, hashtable_item_strhash, hashtable_item_strcmp);
+        MXS_ABORT_IF_NULL(statements);
+        hashtable_memory_fns(statements, hashtable_item_strdup, NULL,
+                             hashtable_item_free, hashtable_item_free);
+    }
+
+    if (dump)
+    {
+        printf("Service,Session,Date,User@Host,Duration us,Query\n");
+    }
+
+    int rval = EXIT_SUCCESS;
+
+    for (int i = optind; i < argc; i++)
+    {
+        if (check_file(argv[i]))
+        {
+            rval = EXIT_FAILURE;
+        }
+    }
+
+    if (aggregate)
+    {
+        print_aggregate();
+        hashtable_free(statements);
+    }
+
+    if (use_match)
+    {
+        regfree(&match);
+    }
+
+    MXS_FREE(strbuf);
+    mxs_log_flush_sync();
+    mxs_log_finish();
+
+    return rval;
+}
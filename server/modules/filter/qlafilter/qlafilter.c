@@ -22,6 +22,14 @@
  * The filter makes no attempt to deal with query packets that do not fit
  * in a single GWBUF.
  *
+ * The log files are written with log sinks so that the worker threads do
+ * not wait for the file writes.
+ *
+ * With the binary log format the canonical form of each statement is logged
+ * with its duration into compressed blocks, see qlaformat.h. The blocks of
+ * the unified log file are kept per worker thread and written when they are
+ * full or older than the flush interval. The files are read with maxqlacheck.
+ *
  * A single option may be passed to the filter, this is the name of the
  * file to which the queries are logged. A serial number is appended to this
  * name in order that each session logs to a different file.
@@ -39,6 +47,7 @@
 #include <stdio.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/stat.h>
 #include <maxscale/filter.h>
 #include <maxscale/modinfo.h>
 #include <maxscale/modutil.h>
@@ -50,7 +59,11 @@
 #include <string.h>
 #include <maxscale/atomic.h>
 #include <maxscale/alloc.h>
+#include <maxscale/logsink.h>
 #include <maxscale/service.h>
+#include <maxscale/housekeeper.h>
+#include <maxscale/spinlock.h>
+#include "qlaformat.h"
 
 /** Date string buffer size */
 #define QLA_DATE_BUFFER_SIZE 20
@@ -72,6 +85,13 @@ enum log_options
 /** Default values for logged data */
 #define LOG_DATA_DEFAULT "date,user,query"
 
+/** Log file formats */
+enum log_format
+{
+    LOG_FORMAT_TEXT,
+    LOG_FORMAT_BINARY
+};
+
 /*
  * The filter entry points
  */
@@ -80,9 +100,22 @@ static MXS_FILTER_SESSION *newSession(MXS_FILTER *instance, MXS_SESSION *session
 static void closeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session);
 static void freeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session);
 static void setDownstream(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, MXS_DOWNSTREAM *downstream);
+static void setUpstream(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, MXS_UPSTREAM *upstream);
 static int routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, GWBUF *queue);
+static int clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, GWBUF *queue);
 static void diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *dcb);
 static uint64_t getCapabilities(MXS_FILTER* instance);
+static void destroyInstance(MXS_FILTER *instance);
+
+/**
+ * A block of the binary unified log file. Each worker thread has its own
+ * block and the last block is shared by sessions of other threads.
+ */
+typedef struct
+{
+    SPINLOCK   lock;
+    QLA_BLOCK *block;
+} QLA_UNIFIED_BLOCK;
 
 /**
  * A instance structure, the assumption is that the option passed
@@ -105,9 +138,13 @@ typedef struct
     regex_t nore; /* Compiled regex nomatch text */
     uint32_t log_mode_flags; /* Log file mode settings */
     uint32_t log_file_data_flags; /* What data is saved to the files */
-    FILE *unified_fp; /* Unified log file. The pointer needs to be shared here
-                       * to avoid garbled printing. */
-    bool flush_writes; /* Flush log file after every write? */
+    LOGSINK *unified_sink; /* Unified log file. The log sink needs to be shared
+                            * here to avoid garbled printing. */
+    LOGSINK_CONFIG sink_config; /* Log sink configuration */
+    uint32_t log_format; /* Text or binary log files */
+    QLA_UNIFIED_BLOCK *blocks; /* Blocks of the binary unified log file */
+    int n_blocks; /* Number of blocks */
+    char *flush_task; /* Housekeeper task that writes old blocks */
     bool append;    /* Open files in append-mode? */
     bool write_warning_given; /* To make sure some warning are only given once */
 } QLA_INSTANCE;
@@ -124,17 +161,28 @@ typedef struct
 {
     int active;
     MXS_DOWNSTREAM down;
+    MXS_UPSTREAM up;
     char *filename;   /* The session-specific log file name */
-    FILE *fp;         /* The session-specific log file */
+    LOGSINK *sink;    /* The session-specific log file */
+    QLA_BLOCK *block; /* Block of the binary session log file */
     const char *remote;
     char *service;    /* The service name this filter is attached to. Not owned. */
     size_t ses_id;    /* The session this filter serves */
     const char *user; /* The client */
+    int thread_id;    /* The worker thread of the session */
+    char *canonical;  /* Binary format: the statement waiting for a reply */
+    uint64_t query_start; /* Binary format: when the statement was routed */
 } QLA_SESSION;
 
-static FILE* open_log_file(uint32_t, QLA_INSTANCE *, const char *);
-static int write_log_entry(uint32_t, FILE*, QLA_INSTANCE*, QLA_SESSION*, const char*,
+static LOGSINK* open_log_file(uint32_t, QLA_INSTANCE *, const char *);
+static int write_log_entry(uint32_t, LOGSINK*, QLA_INSTANCE*, QLA_SESSION*, const char*,
                            const char*, size_t);
+static bool start_binary_entry(QLA_INSTANCE*, QLA_SESSION*, GWBUF*);
+static bool write_binary_entry(QLA_INSTANCE*, QLA_SESSION*, uint64_t);
+static bool write_block(QLA_INSTANCE*, LOGSINK*, QLA_BLOCK*, uint64_t, bool);
+static void flush_blocks(void*);
+static void free_blocks(QLA_INSTANCE*);
+static void log_write_error(QLA_INSTANCE*);
 
 static const MXS_ENUM_VALUE option_values[] =
 {
@@ -161,6 +209,13 @@ static const MXS_ENUM_VALUE log_data_values[] =
     {NULL}
 };
 
+static const MXS_ENUM_VALUE log_format_values[] =
+{
+    {"text",   LOG_FORMAT_TEXT},
+    {"binary", LOG_FORMAT_BINARY},
+    {NULL}
+};
+
 /**
  * The module entry point routine. It is this routine that
  * must populate the structure that is referred to as the
@@ -178,12 +233,12 @@ MXS_MODULE* MXS_CREATE_MODULE()
         closeSession,
         freeSession,
         setDownstream,
-        NULL, // No Upstream requirement
+        setUpstream,
         routeQuery,
-        NULL, // No client reply
+        clientReply,
         diagnostic,
         getCapabilities,
-        NULL, // No destroyInstance
+        destroyInstance,
     };
 
     static MXS_MODULE info =
@@ -242,6 +297,13 @@ MXS_MODULE* MXS_CREATE_MODULE()
                 MXS_MODULE_OPT_NONE,
                 log_data_values
             },
+            {
+                "log_format",
+                MXS_MODULE_PARAM_ENUM,
+                "text",
+                MXS_MODULE_OPT_NONE,
+                log_format_values
+            },
             {
                 "flush",
                 MXS_MODULE_PARAM_BOOL,
@@ -252,6 +314,28 @@ MXS_MODULE* MXS_CREATE_MODULE()
                 MXS_MODULE_PARAM_BOOL,
                 "false"
             },
+            {
+                LOGSINK_PARAM_BUFFER_SIZE,
+                MXS_MODULE_PARAM_SIZE,
+                LOGSINK_DEFAULT_BUFFER_SIZE
+            },
+            {
+                LOGSINK_PARAM_BATCH_SIZE,
+                MXS_MODULE_PARAM_SIZE,
+                LOGSINK_DEFAULT_BATCH_SIZE
+            },
+            {
+                LOGSINK_PARAM_FLUSH_INTERVAL,
+                MXS_MODULE_PARAM_COUNT,
+                LOGSINK_DEFAULT_FLUSH_INTERVAL
+            },
+            {
+                LOGSINK_PARAM_POLICY,
+                MXS_MODULE_PARAM_ENUM,
+                LOGSINK_DEFAULT_POLICY,
+                MXS_MODULE_OPT_NONE,
+                logsink_policy_values
+            },
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -277,11 +361,13 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
     if (my_instance)
     {
         my_instance->sessions = 0;
-        my_instance->unified_fp = NULL;
+        my_instance->unified_sink = NULL;
+        my_instance->blocks = NULL;
+        my_instance->n_blocks = 0;
+        my_instance->flush_task = NULL;
         my_instance->write_warning_given = false;
         my_instance->name = MXS_STRDUP_A(name);
         my_instance->filebase = MXS_STRDUP_A(config_get_string(params, "filebase"));
-        my_instance->flush_writes = config_get_bool(params, "flush");
         my_instance->append = config_get_bool(params, "append");
         my_instance->match = config_copy_string(params, "match");
         my_instance->nomatch = config_copy_string(params, "exclude");
@@ -289,8 +375,16 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
         my_instance->user_name = config_copy_string(params, "user");
         my_instance->log_file_data_flags = config_get_enum(params, "log_data", log_data_values);
         my_instance->log_mode_flags = config_get_enum(params, "log_type", log_type_values);
+        my_instance->log_format = config_get_enum(params, "log_format", log_format_values);
+        logsink_config_get(params, &my_instance->sink_config);
         bool error = false;
 
+        if (config_get_bool(params, "flush"))
+        {
+            // Write every entry as soon as possible
+            my_instance->sink_config.flush_interval = 0;
+        }
+
         int cflags = config_get_enum(params, "options", option_values);
 
         if (my_instance->match && regcomp(&my_instance->re, my_instance->match, cflags))
@@ -322,16 +416,12 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
             {
                 snprintf(filename, namelen, "%s.unified", my_instance->filebase);
                 // Open the file. It is only closed at program exit
-                my_instance->unified_fp = open_log_file(my_instance->log_file_data_flags,
-                                                        my_instance, filename);
+                my_instance->unified_sink = open_log_file(my_instance->log_file_data_flags,
+                                                          my_instance, filename);
 
-                if (my_instance->unified_fp == NULL)
+                if (my_instance->unified_sink == NULL)
                 {
-                    char errbuf[MXS_STRERROR_BUFLEN];
-                    MXS_ERROR("Opening output file for qla "
-                              "filter failed due to %d, %s",
-                              errno,
-                              strerror_r(errno, errbuf, sizeof(errbuf)));
+                    MXS_ERROR("Opening output file for qla filter failed.");
                     error = true;
                 }
                 MXS_FREE(filename);
@@ -342,6 +432,39 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
             }
         }
 
+        if (!error && my_instance->unified_sink &&
+            my_instance->log_format == LOG_FORMAT_BINARY)
+        {
+            // One block for each worker and one for the others
+            my_instance->n_blocks = config_threadcount() + 1;
+            my_instance->blocks = MXS_CALLOC(my_instance->n_blocks, sizeof(QLA_UNIFIED_BLOCK));
+            error = my_instance->blocks == NULL;
+
+            for (int i = 0; !error && i < my_instance->n_blocks; i++)
+            {
+                spinlock_init(&my_instance->blocks[i].lock);
+                my_instance->blocks[i].block = qla_block_alloc();
+                error = my_instance->blocks[i].block == NULL;
+            }
+
+            if (!error)
+            {
+                // Write the blocks of idle workers once a second
+                const char PREFIX[] = "qlafilter ";
+                my_instance->flush_task = MXS_MALLOC(sizeof(PREFIX) + strlen(name));
+
+                if (my_instance->flush_task)
+                {
+                    sprintf(my_instance->flush_task, "%s%s", PREFIX, name);
+                    hktask_add(my_instance->flush_task, flush_blocks, my_instance, 1);
+                }
+                else
+                {
+                    error = true;
+                }
+            }
+        }
+
         if (error)
         {
             if (my_instance->match)
@@ -355,9 +478,10 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
                 MXS_FREE(my_instance->nomatch);
                 regfree(&my_instance->nore);
             }
-            if (my_instance->unified_fp != NULL)
+            free_blocks(my_instance);
+            if (my_instance->unified_sink != NULL)
             {
-                fclose(my_instance->unified_fp);
+                logsink_close(my_instance->unified_sink);
             }
             MXS_FREE(my_instance->filebase);
             MXS_FREE(my_instance->source);
@@ -369,6 +493,43 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
     return (MXS_FILTER *) my_instance;
 }
 
+/**
+ * Destroy the filter instance. The buffered blocks of the binary unified
+ * log file are written and the file is closed.
+ *
+ * @param instance  The filter instance
+ */
+static void
+destroyInstance(MXS_FILTER *instance)
+{
+    QLA_INSTANCE *my_instance = (QLA_INSTANCE *) instance;
+
+    if (my_instance->flush_task)
+    {
+        hktask_remove(my_instance->flush_task);
+    }
+
+    for (int i = 0; i < my_instance->n_blocks; i++)
+    {
+        QLA_UNIFIED_BLOCK *ublock = &my_instance->blocks[i];
+
+        spinlock_acquire(&ublock->lock);
+        if (!write_block(my_instance, my_instance->unified_sink, ublock->block, 0, true))
+        {
+            log_write_error(my_instance);
+        }
+        spinlock_release(&ublock->lock);
+    }
+
+    free_blocks(my_instance);
+
+    if (my_instance->unified_sink)
+    {
+        logsink_close(my_instance->unified_sink);
+        my_instance->unified_sink = NULL;
+    }
+}
+
 /**
  * Associate a new session with this instance of the filter.
  *
@@ -410,6 +571,7 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
         my_session->remote = remote;
         my_session->ses_id = session->ses_id;
         my_session->service = session->service->name;
+        my_session->thread_id = session->client_dcb->thread.id;
 
         sprintf(my_session->filename, "%s.%lu",
                 my_instance->filebase,
@@ -423,15 +585,18 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
         {
             uint32_t data_flags = (my_instance->log_file_data_flags &
                                    ~LOG_DATA_SESSION); // No point printing "Session"
-            my_session->fp = open_log_file(data_flags, my_instance, my_session->filename);
+            my_session->sink = open_log_file(data_flags, my_instance, my_session->filename);
+
+            if (my_session->sink && my_instance->log_format == LOG_FORMAT_BINARY &&
+                (my_session->block = qla_block_alloc()) == NULL)
+            {
+                logsink_close(my_session->sink);
+                my_session->sink = NULL;
+            }
 
-            if (my_session->fp == NULL)
+            if (my_session->sink == NULL)
             {
-                char errbuf[MXS_STRERROR_BUFLEN];
-                MXS_ERROR("Opening output file for qla "
-                          "filter failed due to %d, %s",
-                          errno,
-                          strerror_r(errno, errbuf, sizeof(errbuf)));
+                MXS_ERROR("Opening output file for qla filter failed.");
                 MXS_FREE(my_session->filename);
                 MXS_FREE(my_session);
                 my_session = NULL;
@@ -444,7 +609,8 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
 /**
  * Close a session with the filter, this is the mechanism
  * by which a filter may cleanup data structure etc.
- * In the case of the QLA filter we simple close the file descriptor.
+ * In the case of the QLA filter we simple close the log file. The
+ * buffered entries are written by the log sink writer.
  *
  * @param instance  The filter instance data
  * @param session   The session being closed
@@ -452,11 +618,24 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
 static void
 closeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session)
 {
+    QLA_INSTANCE *my_instance = (QLA_INSTANCE *) instance;
     QLA_SESSION *my_session = (QLA_SESSION *) session;
 
-    if (my_session->active && my_session->fp)
+    if (my_session->canonical &&
+        !write_binary_entry(my_instance, my_session, QLA_DURATION_UNKNOWN))
     {
-        fclose(my_session->fp);
+        log_write_error(my_instance);
+    }
+
+    if (my_session->active && my_session->sink)
+    {
+        if (my_session->block &&
+            !write_block(my_instance, my_session->sink, my_session->block, 0, true))
+        {
+            log_write_error(my_instance);
+        }
+
+        logsink_close(my_session->sink);
     }
 }
 
@@ -471,6 +650,8 @@ freeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session)
 {
     QLA_SESSION *my_session = (QLA_SESSION *) session;
 
+    qla_block_free(my_session->block);
+    MXS_FREE(my_session->canonical);
     MXS_FREE(my_session->filename);
     MXS_FREE(session);
     return;
@@ -492,6 +673,22 @@ setDownstream(MXS_FILTER *instance, MXS_FILTER_SESSION *session, MXS_DOWNSTREAM
     my_session->down = *downstream;
 }
 
+/**
+ * Set the upstream filter or session to which results will be
+ * passed from this filter.
+ *
+ * @param instance  The filter instance data
+ * @param session   The filter session
+ * @param upstream  The upstream filter or session.
+ */
+static void
+setUpstream(MXS_FILTER *instance, MXS_FILTER_SESSION *session, MXS_UPSTREAM *upstream)
+{
+    QLA_SESSION *my_session = (QLA_SESSION *) session;
+
+    my_session->up = *upstream;
+}
+
 /**
  * The routeQuery entry point. This is passed the query buffer
  * to which the filter should be applied. Once applied the
@@ -521,45 +718,51 @@ routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *queue)
                 (my_instance->nomatch == NULL ||
                  regexec(&my_instance->nore, sql, 0, limits, REG_STARTEND) != 0))
             {
-                char buffer[QLA_DATE_BUFFER_SIZE];
-                gettimeofday(&tv, NULL);
-                localtime_r(&tv.tv_sec, &t);
-                strftime(buffer, sizeof(buffer), "%F %T", &t);
-
-                /**
-                 * Loop over all the possible log file modes and write to
-                 * the enabled files.
-                 */
-                int length = limits[0].rm_eo;
                 bool write_error = false;
-                if (my_instance->log_mode_flags & CONFIG_FILE_SESSION)
+
+                if (my_instance->log_format == LOG_FORMAT_BINARY)
+                {
+                    // The entry is written when the reply arrives
+                    write_error = !start_binary_entry(my_instance, my_session, queue);
+                }
+                else
                 {
-                    // In this case there is no need to write the session
-                    // number into the files.
-                    uint32_t data_flags = (my_instance->log_file_data_flags &
-                                           ~LOG_DATA_SESSION);
+                    char buffer[QLA_DATE_BUFFER_SIZE];
+                    gettimeofday(&tv, NULL);
+                    localtime_r(&tv.tv_sec, &t);
+                    strftime(buffer, sizeof(buffer), "%F %T", &t);
 
-                    if (write_log_entry(data_flags, my_session->fp,
-                                        my_instance, my_session, buffer, sql, length) < 0)
+                    /**
+                     * Loop over all the possible log file modes and write to
+                     * the enabled files.
+                     */
+                    int length = limits[0].rm_eo;
+                    if (my_instance->log_mode_flags & CONFIG_FILE_SESSION)
                     {
-                        write_error = true;
+                        // In this case there is no need to write the session
+                        // number into the files.
+                        uint32_t data_flags = (my_instance->log_file_data_flags &
+                                               ~LOG_DATA_SESSION);
+
+                        if (write_log_entry(data_flags, my_session->sink,
+                                            my_instance, my_session, buffer, sql, length) < 0)
+                        {
+                            write_error = true;
+                        }
                     }
-                }
-                if (my_instance->log_mode_flags & CONFIG_FILE_UNIFIED)
-                {
-                    uint32_t data_flags = my_instance->log_file_data_flags;
-                    if (write_log_entry(data_flags, my_instance->unified_fp,
-                                        my_instance, my_session, buffer, sql, length) < 0)
+                    if (my_instance->log_mode_flags & CONFIG_FILE_UNIFIED)
                     {
-                        write_error = true;
+                        uint32_t data_flags = my_instance->log_file_data_flags;
+                        if (write_log_entry(data_flags, my_instance->unified_sink,
+                                            my_instance, my_session, buffer, sql, length) < 0)
+                        {
+                            write_error = true;
+                        }
                     }
                 }
-                if (write_error && !my_instance->write_warning_given)
+                if (write_error)
                 {
-                    MXS_ERROR("qla-filter '%s': Log file write failed. "
-                              "Suppressing further similar warnings.",
-                              my_instance->name);
-                    my_instance->write_warning_given = true;
+                    log_write_error(my_instance);
                 }
             }
         }
@@ -569,6 +772,38 @@ routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *queue)
                                        my_session->down.session, queue);
 }
 
+/**
+ * The clientReply entry point. With the binary log format the statement
+ * that is waiting for a reply is logged with its duration.
+ *
+ * @param instance  The filter instance data
+ * @param session   The filter session
+ * @param reply     The reply
+ */
+static int
+clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *reply)
+{
+    QLA_INSTANCE *my_instance = (QLA_INSTANCE *) instance;
+    QLA_SESSION *my_session = (QLA_SESSION *) session;
+
+    if (my_session->canonical)
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        uint64_t now = tv.tv_sec * 1000000 + tv.tv_usec;
+        uint64_t duration = now > my_session->query_start ? now - my_session->query_start : 0;
+
+        if (!write_binary_entry(my_instance, my_session, duration))
+        {
+            log_write_error(my_instance);
+        }
+    }
+
+    /* Pass the result upstream */
+    return my_session->up.clientReply(my_session->up.instance,
+                                      my_session->up.session, reply);
+}
+
 /**
  * Diagnostics routine
  *
@@ -590,7 +825,20 @@ diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *dcb)
     {
         dcb_printf(dcb, "\t\tLogging to file            %s.\n",
                    my_session->filename);
+
+        if (my_session->sink)
+        {
+            logsink_diagnostics(my_session->sink, dcb);
+        }
     }
+    if (my_instance->unified_sink)
+    {
+        dcb_printf(dcb, "\t\tLogging to file            %s.unified\n",
+                   my_instance->filebase);
+        logsink_diagnostics(my_instance->unified_sink, dcb);
+    }
+    dcb_printf(dcb, "\t\tLog file format            %s\n",
+               my_instance->log_format == LOG_FORMAT_BINARY ? "binary" : "text");
     if (my_instance->source)
     {
         dcb_printf(dcb, "\t\tLimit logging to connections from  %s\n",
@@ -622,39 +870,72 @@ static uint64_t getCapabilities(MXS_FILTER* instance)
 {
     return RCAP_TYPE_CONTIGUOUS_INPUT;
 }
+/**
+ * Check if a file starts with the header of a binary query log.
+ * @param   filename    File to check
+ * @return  True if the file is a binary query log
+ */
+static bool is_binary_log(const char *filename)
+{
+    bool rval = false;
+    FILE *file = fopen(filename, "rb");
+
+    if (file)
+    {
+        char magic[QLA_FILE_MAGIC_LEN];
+        rval = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+               memcmp(magic, QLA_FILE_MAGIC, sizeof(magic)) == 0;
+        fclose(file);
+    }
+
+    return rval;
+}
+
 /**
  * Open the log file and print a header if appropriate.
  * @param   data_flags  Data save settings flags
  * @param   instance    The filter instance
  * @param   filename    Target file path
- * @return  A valid file on success, null otherwise.
+ * @return  A valid log sink on success, null otherwise.
  */
-static FILE* open_log_file(uint32_t data_flags, QLA_INSTANCE *instance, const char *filename)
+static LOGSINK* open_log_file(uint32_t data_flags, QLA_INSTANCE *instance, const char *filename)
 {
     bool file_existed = false;
-    FILE *fp = NULL;
-    if (instance->append == false)
+    struct stat st;
+
+    if (instance->append && stat(filename, &st) == 0 && st.st_size > 0)
     {
-        // Just open the file (possibly overwriting) and then print header.
-        fp = fopen(filename, "w");
+        // The file already has contents, no header is needed
+        file_existed = true;
+
+        // Appending one format to a file of the other format would mix them
+        bool binary = (instance->log_format == LOG_FORMAT_BINARY);
+
+        if (is_binary_log(filename) != binary)
+        {
+            MXS_ERROR("File %s is not a %s query log, refusing to append to it. Remove "
+                      "or rename the file when changing 'log_format'.", filename,
+                      binary ? "binary" : "text");
+            return NULL;
+        }
     }
-    else
+
+    // Without the "append"-setting the file is truncated
+    LOGSINK *sink = logsink_open(filename, instance->append, &instance->sink_config);
+
+    if (sink && !file_existed && instance->log_format == LOG_FORMAT_BINARY)
     {
-        // Using fopen() with 'a+' means we will always write to the end but can read
-        // anywhere. Depending on the "append"-setting the file has been
-        // opened in different modes, which should be considered if file handling
-        // changes later (e.g. rewinding).
-        if ((fp = fopen(filename, "a+")) != NULL)
+        uint8_t header[QLA_FILE_HEADER_LEN];
+        qla_file_header(header);
+
+        if (!logsink_write(sink, (const char*)header, sizeof(header)))
         {
-            // Check to see if file already has contents
-            fseek(fp, 0, SEEK_END);
-            if (ftell(fp) > 0) // Any errors in ftell cause overwriting
-            {
-                file_existed = true;
-            }
+            logsink_close(sink);
+            MXS_ERROR("Failed to print header to file %s.", filename);
+            return NULL;
         }
     }
-    if (fp && !file_existed)
+    else if (sink && !file_existed)
     {
         // Print a header. Luckily, we know the header has limited length
         const char SERVICE[] = "Service,";
@@ -703,28 +984,25 @@ static FILE* open_log_file(uint32_t data_flags, QLA_INSTANCE *instance, const ch
         else
         {
             // Nothing to print
-            return fp;
+            return sink;
         }
 
         // Finally, write the log header.
-        int written = fprintf(fp, "%s", print_str);
-
-        if ((written <= 0) ||
-            ((instance->flush_writes) && (fflush(fp) < 0)))
+        if (!logsink_write(sink, print_str, current_pos - print_str))
         {
             // Weird error, file opened but a write failed. Best to stop.
-            fclose(fp);
+            logsink_close(sink);
             MXS_ERROR("Failed to print header to file %s.", filename);
             return NULL;
         }
     }
-    return fp;
+    return sink;
 }
 
 /**
  * Write an entry to the log file.
  * @param   data_flags    Controls what to write
- * @param   logfile    Target file
+ * @param   logfile    Target log sink
  * @param   instance    Filter instance
  * @param   session    Filter session
  * @param   time_string Date entry
@@ -732,7 +1010,7 @@ static FILE* open_log_file(uint32_t data_flags, QLA_INSTANCE *instance, const ch
  * @param   sql_str_len Length of SQL-string
  * @return  The number of characters written, or a negative value on failure
  */
-static int write_log_entry(uint32_t data_flags, FILE *logfile, QLA_INSTANCE *instance,
+static int write_log_entry(uint32_t data_flags, LOGSINK *logfile, QLA_INSTANCE *instance,
                            QLA_SESSION *session, const char *time_string, const char *sql_string,
                            size_t sql_str_len)
 {
@@ -771,9 +1049,8 @@ static int write_log_entry(uint32_t data_flags, FILE *logfile, QLA_INSTANCE *ins
         return 0; // Nothing to print
     }
 
-    // Allocate space for a buffer. Printing to the file in parts would likely
-    // cause garbled printing if several threads write simultaneously, so we
-    // have to first print to a string.
+    // Allocate space for a buffer. The entry is added to the log sink as
+    // one record so that the entries of different threads are not mixed.
     char *print_str = NULL;
     if ((print_str = MXS_CALLOC(print_len, sizeof(char))) == NULL)
     {
@@ -845,21 +1122,183 @@ static int write_log_entry(uint32_t data_flags, FILE *logfile, QLA_INSTANCE *ins
     }
 
     // Finally, write the log event.
-    int written = fprintf(logfile, "%s", print_str);
+    int written = current_pos - print_str;
+
+    if (!logsink_write(logfile, print_str, written))
+    {
+        written = -1;
+    }
+
     MXS_FREE(print_str);
+    return written;
+}
 
-    if ((!instance->flush_writes) || (written <= 0))
+/**
+ * Log a statement write failure, only once per filter instance.
+ * @param   instance    Filter instance
+ */
+static void log_write_error(QLA_INSTANCE *instance)
+{
+    if (!instance->write_warning_given)
     {
-        return written;
+        MXS_ERROR("qla-filter '%s': Log file write failed. "
+                  "Suppressing further similar warnings.",
+                  instance->name);
+        instance->write_warning_given = true;
     }
-    else
+}
+
+/**
+ * Start a binary log entry. The canonical form of the statement is stored
+ * until the reply arrives. A previous statement that got no reply is logged
+ * without a duration.
+ * @param   instance    Filter instance
+ * @param   session    Filter session
+ * @param   queue    The statement
+ * @return  False if writing the previous entry failed
+ */
+static bool start_binary_entry(QLA_INSTANCE *instance, QLA_SESSION *session, GWBUF *queue)
+{
+    bool rval = true;
+
+    if (session->canonical)
+    {
+        rval = write_binary_entry(instance, session, QLA_DURATION_UNKNOWN);
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    session->query_start = tv.tv_sec * 1000000 + tv.tv_usec;
+    if ((session->canonical = modutil_get_canonical(queue)) == NULL)
     {
-        // Try flushing. If successful, still return the characters written.
-        int rval = fflush(logfile);
-        if (rval >= 0)
+        MXS_ERROR("Failed to get the canonical form of a statement of session %lu, "
+                  "the statement is not logged.", session->ses_id);
+    }
+
+    return rval;
+}
+
+/**
+ * Add the statement waiting for a reply to the binary log blocks.
+ * @param   instance    Filter instance
+ * @param   session    Filter session
+ * @param   duration    Duration in microseconds or QLA_DURATION_UNKNOWN
+ * @return  True on success
+ */
+static bool write_binary_entry(QLA_INSTANCE *instance, QLA_SESSION *session, uint64_t duration)
+{
+    ss_dassert(session->canonical);
+    QLA_EVENT event =
+    {
+        session->query_start,
+        duration,
+        session->ses_id,
+        {session->service, strlen(session->service)},
+        {session->user, strlen(session->user)},
+        {session->remote, strlen(session->remote)},
+        {session->canonical, strlen(session->canonical)}
+    };
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t now = tv.tv_sec * 1000000 + tv.tv_usec;
+    bool rval = true;
+
+    if (session->block)
+    {
+        rval = qla_block_add(session->block, &event) &&
+               write_block(instance, session->sink, session->block, now, false);
+    }
+
+    if (instance->blocks)
+    {
+        int i = MXS_MIN(session->thread_id, instance->n_blocks - 1);
+        QLA_UNIFIED_BLOCK *ublock = &instance->blocks[i];
+
+        spinlock_acquire(&ublock->lock);
+        if (!qla_block_add(ublock->block, &event) ||
+            !write_block(instance, instance->unified_sink, ublock->block, now, false))
+        {
+            rval = false;
+        }
+        spinlock_release(&ublock->lock);
+    }
+
+    MXS_FREE(session->canonical);
+    session->canonical = NULL;
+    return rval;
+}
+
+/**
+ * Write a binary log block if it is full or older than the flush interval.
+ * @param   instance    Filter instance
+ * @param   sink    Target log sink
+ * @param   block    The block
+ * @param   now    Current time in microseconds
+ * @param   force    Write the block even if it is neither full nor old
+ * @return  True if the block was not written or was written successfully
+ */
+static bool write_block(QLA_INSTANCE *instance, LOGSINK *sink, QLA_BLOCK *block,
+                        uint64_t now, bool force)
+{
+    bool rval = true;
+    uint64_t interval = (uint64_t)instance->sink_config.flush_interval * 1000;
+
+    if (block->n_events > 0 &&
+        (force || qla_block_full(block) || now < block->first_ts ||
+         now - block->first_ts >= interval))
+    {
+        const uint8_t *data;
+        size_t len = qla_block_encode(block, &data);
+        rval = len > 0 && logsink_write(sink, (const char*)data, len);
+    }
+
+    return rval;
+}
+
+/**
+ * Housekeeper task that writes the blocks of the binary unified log file
+ * that are older than the flush interval.
+ * @param   data    Filter instance
+ */
+static void flush_blocks(void *data)
+{
+    QLA_INSTANCE *instance = (QLA_INSTANCE*)data;
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t now = tv.tv_sec * 1000000 + tv.tv_usec;
+
+    for (int i = 0; i < instance->n_blocks; i++)
+    {
+        QLA_UNIFIED_BLOCK *ublock = &instance->blocks[i];
+
+        spinlock_acquire(&ublock->lock);
+        if (!write_block(instance, instance->unified_sink, ublock->block, now, false))
         {
-            return written;
+            log_write_error(instance);
         }
-        return rval;
+        spinlock_release(&ublock->lock);
     }
 }
+
+/**
+ * Free the blocks of the binary unified log file.
+ * @param   instance    Filter instance
+ */
+static void free_blocks(QLA_INSTANCE *instance)
+{
+    if (instance->blocks)
+    {
+        for (int i = 0; i < instance->n_blocks; i++)
+        {
+            qla_block_free(instance->blocks[i].block);
+        }
+
+        MXS_FREE(instance->blocks);
+        instance->blocks = NULL;
+        instance->n_blocks = 0;
+    }
+
+    MXS_FREE(instance->flush_task);
+    instance->flush_task = NULL;
+}
@@ -0,0 +1,608 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file qlaformat.c - The binary query log format
+ *
+ * @see qlaformat.h
+ */
+
+#define MXS_MODULE_NAME "qlafilter"
+
+#include "qlaformat.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zlib.h>
+#include <maxscale/alloc.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+
+/** Number of slots in the string dictionary of a block, a power of two */
+#define QLA_DICT_SLOTS 2048
+
+/** Strings in a block after which the block is written. An event adds at
+ * most four strings so the dictionary is never more than half full. */
+#define QLA_DICT_MAX_STRINGS (QLA_DICT_SLOTS / 2 - 4)
+
+/** Initial size of the payload buffer of a block */
+#define QLA_BLOCK_INITIAL_SIZE 4096
+
+/** Longest varint, a 64-bit value takes at most ten bytes */
+#define QLA_VARINT_MAX_LEN 10
+
+struct qla_dict_slot
+{
+    uint32_t hash;   /**< Hash of the string */
+    uint32_t offset; /**< Offset of the string in the payload */
+    uint32_t len;    /**< Length of the string */
+    uint32_t id;     /**< String ID plus one, 0 for an empty slot */
+};
+
+static inline void write_le32(uint8_t *ptr, uint32_t value)
+{
+    ptr[0] = value;
+    ptr[1] = value >> 8;
+    ptr[2] = value >> 16;
+    ptr[3] = value >> 24;
+}
+
+static inline uint32_t read_le32(const uint8_t *ptr)
+{
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+           ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+static inline uint8_t* write_varint(uint8_t *ptr, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *ptr++ = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+
+    *ptr++ = value;
+    return ptr;
+}
+
+static bool read_varint(const uint8_t *data, size_t len, size_t *pos, uint64_t *value)
+{
+    uint64_t rval = 0;
+
+    for (int shift = 0; shift < 64 && *pos < len; shift += 7)
+    {
+        uint8_t byte = data[(*pos)++];
+        rval |= (uint64_t)(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            *value = rval;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline uint64_t zigzag_encode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/** FNV-1a */
+static uint32_t string_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+void qla_file_header(uint8_t *buf)
+{
+    memcpy(buf, QLA_FILE_MAGIC, QLA_FILE_MAGIC_LEN);
+    buf[QLA_FILE_MAGIC_LEN] = QLA_FILE_VERSION;
+    buf[QLA_FILE_MAGIC_LEN + 1] = 0;
+}
+
+QLA_BLOCK* qla_block_alloc()
+{
+    QLA_BLOCK *block = MXS_CALLOC(1, sizeof(QLA_BLOCK));
+    uint8_t *data = MXS_MALLOC(QLA_BLOCK_INITIAL_SIZE);
+    QLA_DICT_SLOT *dict = MXS_CALLOC(QLA_DICT_SLOTS, sizeof(QLA_DICT_SLOT));
+
+    if (block && data && dict)
+    {
+        block->data = data;
+        block->capacity = QLA_BLOCK_INITIAL_SIZE;
+        block->dict = dict;
+    }
+    else
+    {
+        MXS_FREE(block);
+        MXS_FREE(data);
+        MXS_FREE(dict);
+        block = NULL;
+    }
+
+    return block;
+}
+
+void qla_block_free(QLA_BLOCK *block)
+{
+    if (block)
+    {
+        MXS_FREE(block->data);
+        MXS_FREE(block->out);
+        MXS_FREE(block->dict);
+        MXS_FREE(block);
+    }
+}
+
+static bool block_reserve(QLA_BLOCK *block, size_t len)
+{
+    if (block->len + len > block->capacity)
+    {
+        size_t capacity = block->capacity * 2;
+
+        while (block->len + len > capacity)
+        {
+            capacity *= 2;
+        }
+
+        uint8_t *data = MXS_REALLOC(block->data, capacity);
+
+        if (data == NULL)
+        {
+            return false;
+        }
+
+        block->data = data;
+        block->capacity = capacity;
+    }
+
+    return true;
+}
+
+/**
+ * Find the ID of a string, adding it to the block if it is not yet there
+ *
+ * @return The ID of the string or -1 if memory allocation failed
+ */
+static int64_t block_string_id(QLA_BLOCK *block, const QLA_STRING *string)
+{
+    uint32_t hash = string_hash(string->str, string->len);
+    uint32_t i = hash & (QLA_DICT_SLOTS - 1);
+
+    while (block->dict[i].id)
+    {
+        QLA_DICT_SLOT *slot = &block->dict[i];
+
+        if (slot->hash == hash && slot->len == string->len &&
+            memcmp(block->data + slot->offset, string->str, string->len) == 0)
+        {
+            return slot->id - 1;
+        }
+
+        i = (i + 1) & (QLA_DICT_SLOTS - 1);
+    }
+
+    if (!block_reserve(block, 1 + 2 * QLA_VARINT_MAX_LEN + string->len))
+    {
+        return -1;
+    }
+
+    uint32_t id = block->n_strings++;
+    uint8_t *ptr = block->data + block->len;
+    *ptr++ = QLA_ENTRY_STRING;
+    ptr = write_varint(ptr, id);
+    ptr = write_varint(ptr, string->len);
+    memcpy(ptr, string->str, string->len);
+
+    block->dict[i].hash = hash;
+    block->dict[i].offset = ptr - block->data;
+    block->dict[i].len = string->len;
+    block->dict[i].id = id + 1;
+    block->len = ptr + string->len - block->data;
+
+    return id;
+}
+
+bool qla_block_add(QLA_BLOCK *block, const QLA_EVENT *event)
+{
+    ss_dassert(block->n_strings <= QLA_DICT_MAX_STRINGS);
+
+    int64_t service = block_string_id(block, &event->service);
+    int64_t user = block_string_id(block, &event->user);
+    int64_t host = block_string_id(block, &event->host);
+    int64_t canonical = block_string_id(block, &event->canonical);
+
+    if (service < 0 || user < 0 || host < 0 || canonical < 0 ||
+        !block_reserve(block, 1 + 7 * QLA_VARINT_MAX_LEN))
+    {
+        return false;
+    }
+
+    if (block->n_events == 0)
+    {
+        block->first_ts = event->timestamp;
+    }
+
+    uint64_t duration = event->duration == QLA_DURATION_UNKNOWN ? 0 : event->duration + 1;
+    uint8_t *ptr = block->data + block->len;
+    *ptr++ = QLA_ENTRY_EVENT;
+    ptr = write_varint(ptr, zigzag_encode(event->timestamp - block->prev_ts));
+    ptr = write_varint(ptr, duration);
+    ptr = write_varint(ptr, event->session);
+    ptr = write_varint(ptr, service);
+    ptr = write_varint(ptr, user);
+    ptr = write_varint(ptr, host);
+    ptr = write_varint(ptr, canonical);
+
+    block->len = ptr - block->data;
+    block->prev_ts = event->timestamp;
+    block->n_events++;
+
+    return true;
+}
+
+bool qla_block_full(const QLA_BLOCK *block)
+{
+    return block->len >= QLA_BLOCK_SIZE || block->n_strings >= QLA_DICT_MAX_STRINGS;
+}
+
+size_t qla_block_encode(QLA_BLOCK *block, const uint8_t **out)
+{
+    if (block->n_events == 0)
+    {
+        return 0;
+    }
+
+    uLongf bound = compressBound(block->len);
+    size_t needed = QLA_BLOCK_HEADER_LEN + MXS_MAX(bound, block->len);
+
+    if (needed > block->out_capacity)
+    {
+        uint8_t *buf = MXS_REALLOC(block->out, needed);
+
+        if (buf == NULL)
+        {
+            return 0;
+        }
+
+        block->out = buf;
+        block->out_capacity = needed;
+    }
+
+    uint8_t *stored = block->out + QLA_BLOCK_HEADER_LEN;
+    uLongf stored_len = bound;
+    uint8_t compression = QLA_COMPRESSION_ZLIB;
+
+    if (compress2(stored, &stored_len, block->data, block->len, Z_BEST_SPEED) != Z_OK ||
+        stored_len >= block->len)
+    {
+        // Not worth compressing
+        memcpy(stored, block->data, block->len);
+        stored_len = block->len;
+        compression = QLA_COMPRESSION_NONE;
+    }
+
+    write_le32(block->out, block->len);
+    write_le32(block->out + 4, stored_len);
+    write_le32(block->out + 8, crc32(crc32(0L, Z_NULL, 0), stored, stored_len));
+    block->out[12] = compression;
+
+    block->len = 0;
+    block->n_strings = 0;
+    block->n_events = 0;
+    block->prev_ts = 0;
+    memset(block->dict, 0, QLA_DICT_SLOTS * sizeof(QLA_DICT_SLOT));
+
+    *out = block->out;
+    return QLA_BLOCK_HEADER_LEN + stored_len;
+}
+
+QLA_READER* qla_reader_open(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+
+    if (file == NULL)
+    {
+        char errbuf[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to open '%s': %d, %s", filename, errno,
+                  strerror_r(errno, errbuf, sizeof(errbuf)));
+        return NULL;
+    }
+
+    uint8_t header[QLA_FILE_HEADER_LEN];
+
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, QLA_FILE_MAGIC, QLA_FILE_MAGIC_LEN) != 0)
+    {
+        MXS_ERROR("'%s' is not a binary query log.", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    if (header[QLA_FILE_MAGIC_LEN] != QLA_FILE_VERSION)
+    {
+        MXS_ERROR("Unsupported binary query log version %d in '%s'.",
+                  header[QLA_FILE_MAGIC_LEN], filename);
+        fclose(file);
+        return NULL;
+    }
+
+    QLA_READER *reader = MXS_CALLOC(1, sizeof(QLA_READER));
+
+    if (reader == NULL)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    reader->file = file;
+    reader->stored_bytes = QLA_FILE_HEADER_LEN;
+    return reader;
+}
+
+void qla_reader_close(QLA_READER *reader)
+{
+    if (reader)
+    {
+        fclose(reader->file);
+        MXS_FREE(reader->raw);
+        MXS_FREE(reader->stored);
+        MXS_FREE(reader->strings);
+        MXS_FREE(reader);
+    }
+}
+
+static bool reader_reserve(uint8_t **buf, size_t *capacity, size_t len)
+{
+    if (len > *capacity)
+    {
+        uint8_t *newbuf = MXS_REALLOC(*buf, len);
+
+        if (newbuf == NULL)
+        {
+            return false;
+        }
+
+        *buf = newbuf;
+        *capacity = len;
+    }
+
+    return true;
+}
+
+/**
+ * Read the next block into the raw payload buffer
+ *
+ * @return True if a block was read, false at the end of the file or on error
+ */
+static bool reader_next_block(QLA_READER *reader)
+{
+    uint8_t header[QLA_BLOCK_HEADER_LEN];
+    size_t n = fread(header, 1, sizeof(header), reader->file);
+
+    if (n != sizeof(header))
+    {
+        if (ferror(reader->file))
+        {
+            reader->error = QLA_READ_IO;
+        }
+        else if (n > 0)
+        {
+            reader->error = QLA_READ_TRUNCATED;
+        }
+
+        return false;
+    }
+
+    uint32_t raw_len = read_le32(header);
+    uint32_t stored_len = read_le32(header + 4);
+    uint32_t crc = read_le32(header + 8);
+    uint8_t compression = header[12];
+
+    /** Empty blocks are never written */
+    if (raw_len == 0 || raw_len > QLA_BLOCK_MAX_SIZE || stored_len > QLA_BLOCK_MAX_SIZE ||
+        (compression != QLA_COMPRESSION_ZLIB &&
+         (compression != QLA_COMPRESSION_NONE || stored_len != raw_len)))
+    {
+        reader->error = QLA_READ_CORRUPT;
+        return false;
+    }
+
+    if (!reader_reserve(&reader->stored, &reader->stored_capacity, stored_len) ||
+        !reader_reserve(&reader->raw, &reader->raw_capacity, raw_len))
+    {
+        reader->error = QLA_READ_MEMORY;
+        return false;
+    }
+
+    if (fread(reader->stored, 1, stored_len, reader->file) != stored_len)
+    {
+        reader->error = ferror(reader->file) ? QLA_READ_IO : QLA_READ_TRUNCATED;
+        return false;
+    }
+
+    if (crc32(crc32(0L, Z_NULL, 0), reader->stored, stored_len) != crc)
+    {
+        reader->error = QLA_READ_CHECKSUM;
+        return false;
+    }
+
+    if (compression == QLA_COMPRESSION_ZLIB)
+    {
+        uLongf len = raw_len;
+
+        if (uncompress(reader->raw, &len, reader->stored, stored_len) != Z_OK || len != raw_len)
+        {
+            reader->error = QLA_READ_CORRUPT;
+            return false;
+        }
+    }
+    else
+    {
+        memcpy(reader->raw, reader->stored, raw_len);
+    }
+
+    reader->pos = 0;
+    reader->len = raw_len;
+    reader->n_strings = 0;
+    reader->prev_ts = 0;
+    reader->blocks++;
+    reader->raw_bytes += raw_len;
+    reader->stored_bytes += QLA_BLOCK_HEADER_LEN + stored_len;
+
+    return true;
+}
+
+static bool reader_add_string(QLA_READER *reader)
+{
+    uint64_t id, len;
+
+    if (!read_varint(reader->raw, reader->len, &reader->pos, &id) ||
+        !read_varint(reader->raw, reader->len, &reader->pos, &len) ||
+        id != reader->n_strings || len > reader->len - reader->pos)
+    {
+        reader->error = QLA_READ_CORRUPT;
+        return false;
+    }
+
+    if (reader->n_strings == reader->strings_capacity)
+    {
+        uint32_t capacity = reader->strings_capacity ? reader->strings_capacity * 2 : 64;
+        QLA_STRING *strings = MXS_REALLOC(reader->strings, capacity * sizeof(QLA_STRING));
+
+        if (strings == NULL)
+        {
+            reader->error = QLA_READ_MEMORY;
+            return false;
+        }
+
+        reader->strings = strings;
+        reader->strings_capacity = capacity;
+    }
+
+    reader->strings[reader->n_strings].str = (const char*)reader->raw + reader->pos;
+    reader->strings[reader->n_strings].len = len;
+    reader->n_strings++;
+    reader->pos += len;
+
+    return true;
+}
+
+static bool reader_read_event(QLA_READER *reader, QLA_EVENT *event)
+{
+    uint64_t values[7];
+
+    for (int i = 0; i < 7; i++)
+    {
+        if (!read_varint(reader->raw, reader->len, &reader->pos, &values[i]))
+        {
+            reader->error = QLA_READ_CORRUPT;
+            return false;
+        }
+    }
+
+    for (int i = 3; i < 7; i++)
+    {
+        if (values[i] >= reader->n_strings)
+        {
+            reader->error = QLA_READ_CORRUPT;
+            return false;
+        }
+    }
+
+    reader->prev_ts += zigzag_decode(values[0]);
+    event->timestamp = reader->prev_ts;
+    event->duration = values[1] ? values[1] - 1 : QLA_DURATION_UNKNOWN;
+    event->session = values[2];
+    event->service = reader->strings[values[3]];
+    event->user = reader->strings[values[4]];
+    event->host = reader->strings[values[5]];
+    event->canonical = reader->strings[values[6]];
+    reader->events++;
+
+    return true;
+}
+
+bool qla_reader_next(QLA_READER *reader, QLA_EVENT *event)
+{
+    while (reader->error == QLA_READ_OK)
+    {
+        if (reader->pos >= reader->len && !reader_next_block(reader))
+        {
+            break;
+        }
+
+        switch (reader->raw[reader->pos++])
+        {
+        case QLA_ENTRY_STRING:
+            reader_add_string(reader);
+            break;
+
+        case QLA_ENTRY_EVENT:
+            if (reader_read_event(reader, event))
+            {
+                return true;
+            }
+            break;
+
+        default:
+            reader->error = QLA_READ_CORRUPT;
+            break;
+        }
+    }
+
+    return false;
+}
+
+const char* qla_read_error_str(qla_read_error_t error)
+{
+    switch (error)
+    {
+    case QLA_READ_OK:
+        return "No error";
+
+    case QLA_READ_IO:
+        return "Failed to read the file";
+
+    case QLA_READ_TRUNCATED:
+        return "The file ends in the middle of a block";
+
+    case QLA_READ_CHECKSUM:
+        return "Block checksum mismatch";
+
+    case QLA_READ_CORRUPT:
+        return "Corrupted block";
+
+    case QLA_READ_MEMORY:
+        return "Memory allocation failed";
+
+    default:
+        ss_dassert(!true);
+        return "Unknown error";
+    }
+}
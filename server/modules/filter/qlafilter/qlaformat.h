@@ -0,0 +1,239 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file qlaformat.h - The binary query log format
+ *
+ * A binary query log starts with an 8 byte file header: the magic string
+ * "MXSQLA", the format version and a reserved byte. The header is followed
+ * by blocks that each have a 13 byte block header and the block payload:
+ *
+ *   uint32 raw length, uint32 stored length, uint32 CRC32 of the stored data,
+ *   uint8 compression
+ *
+ * All integers in the headers are little-endian. The payload of a block is a
+ * sequence of entries that start with a one byte entry type:
+ *
+ *   QLA_ENTRY_STRING: varint ID, varint length, string bytes
+ *   QLA_ENTRY_EVENT:  zigzag varint timestamp delta, varint duration,
+ *                     varint session ID, varint service string ID,
+ *                     varint user string ID, varint host string ID,
+ *                     varint canonical statement string ID
+ *
+ * The strings form a dictionary that is local to the block: each distinct
+ * service, user, host and canonical statement is stored once per block and
+ * the events refer to it by ID. The timestamps are microseconds since the
+ * epoch and the first event of a block is relative to zero. The duration is
+ * the number of microseconds plus one, zero means that it is not known.
+ *
+ * Since blocks are self-contained, the blocks written by different threads
+ * can be appended to the same file in any order.
+ */
+
+#include <maxscale/cdefs.h>
+#include <stdint.h>
+#include <stdio.h>
+
+MXS_BEGIN_DECLS
+
+#define QLA_FILE_MAGIC       "MXSQLA"
+#define QLA_FILE_MAGIC_LEN   6
+#define QLA_FILE_VERSION     1
+#define QLA_FILE_HEADER_LEN  8
+#define QLA_BLOCK_HEADER_LEN 13
+
+/** Size of the raw payload after which a block is written */
+#define QLA_BLOCK_SIZE (64 * 1024)
+
+/** The largest block payload a reader accepts */
+#define QLA_BLOCK_MAX_SIZE (64 * 1024 * 1024)
+
+/** Duration value of events whose duration is not known */
+#define QLA_DURATION_UNKNOWN UINT64_MAX
+
+typedef enum qla_entry_type
+{
+    QLA_ENTRY_STRING = 1,
+    QLA_ENTRY_EVENT  = 2
+} qla_entry_type_t;
+
+typedef enum qla_compression
+{
+    QLA_COMPRESSION_NONE = 0,
+    QLA_COMPRESSION_ZLIB = 1
+} qla_compression_t;
+
+/** A string that is not null-terminated */
+typedef struct qla_string
+{
+    const char *str;
+    size_t      len;
+} QLA_STRING;
+
+/** One logged statement */
+typedef struct qla_event
+{
+    uint64_t   timestamp; /**< Microseconds since the epoch */
+    uint64_t   duration;  /**< Microseconds, QLA_DURATION_UNKNOWN if not known */
+    uint64_t   session;   /**< Session ID */
+    QLA_STRING service;
+    QLA_STRING user;
+    QLA_STRING host;
+    QLA_STRING canonical; /**< The canonical form of the statement */
+} QLA_EVENT;
+
+typedef struct qla_dict_slot QLA_DICT_SLOT;
+
+/** A block that is being built */
+typedef struct qla_block
+{
+    uint8_t       *data;         /**< The raw payload */
+    size_t         len;          /**< Length of the raw payload */
+    size_t         capacity;     /**< Size of the payload buffer */
+    uint8_t       *out;          /**< The encoded block */
+    size_t         out_capacity; /**< Size of the encoded block buffer */
+    QLA_DICT_SLOT *dict;         /**< The strings of this block */
+    uint32_t       n_strings;    /**< Number of strings in the block */
+    uint32_t       n_events;     /**< Number of events in the block */
+    uint64_t       first_ts;     /**< Timestamp of the first event */
+    uint64_t       prev_ts;      /**< Timestamp of the previous event */
+} QLA_BLOCK;
+
+/**
+ * @brief Write the file header
+ *
+ * @param buf Buffer of at least QLA_FILE_HEADER_LEN bytes
+ */
+void qla_file_header(uint8_t *buf);
+
+/**
+ * @brief Allocate a block
+ *
+ * @return A new block or NULL if memory allocation failed
+ */
+QLA_BLOCK* qla_block_alloc();
+
+/**
+ * @brief Free a block
+ *
+ * @param block Block to free
+ */
+void qla_block_free(QLA_BLOCK *block);
+
+/**
+ * @brief Add an event to a block
+ *
+ * @param block The block
+ * @param event The event to add
+ *
+ * @return True if the event was added, false if memory allocation failed
+ */
+bool qla_block_add(QLA_BLOCK *block, const QLA_EVENT *event);
+
+/**
+ * @brief Check whether a block should be written
+ *
+ * @param block The block
+ *
+ * @return True if the block is full
+ */
+bool qla_block_full(const QLA_BLOCK *block);
+
+/**
+ * @brief Encode a block
+ *
+ * The block is compressed, prefixed with the block header and emptied for
+ * the next events. The returned buffer is owned by the block and is valid
+ * until the next call.
+ *
+ * @param block The block
+ * @param out   Pointer where the encoded block is stored
+ *
+ * @return Length of the encoded block, 0 if the block was empty or
+ *         memory allocation failed
+ */
+size_t qla_block_encode(QLA_BLOCK *block, const uint8_t **out);
+
+/** Errors found when reading a binary query log */
+typedef enum qla_read_error
+{
+    QLA_READ_OK,
+    QLA_READ_IO,        /**< Reading the file failed */
+    QLA_READ_TRUNCATED, /**< The file ends in the middle of a block */
+    QLA_READ_CHECKSUM,  /**< The checksum of a block does not match */
+    QLA_READ_CORRUPT,   /**< A block could not be decoded */
+    QLA_READ_MEMORY     /**< Memory allocation failed */
+} qla_read_error_t;
+
+/** Reader of a binary query log */
+typedef struct qla_reader
+{
+    FILE            *file;
+    uint8_t         *raw;          /**< Decompressed payload of the current block */
+    size_t           raw_capacity;
+    uint8_t         *stored;       /**< Stored payload of the current block */
+    size_t           stored_capacity;
+    size_t           pos;          /**< Read position in the payload */
+    size_t           len;          /**< Length of the payload */
+    QLA_STRING      *strings;      /**< Strings of the current block */
+    uint32_t         n_strings;
+    uint32_t         strings_capacity;
+    uint64_t         prev_ts;      /**< Timestamp of the previous event */
+    uint64_t         blocks;       /**< Blocks read */
+    uint64_t         events;       /**< Events read */
+    uint64_t         raw_bytes;    /**< Decompressed bytes read */
+    uint64_t         stored_bytes; /**< File bytes read */
+    qla_read_error_t error;
+} QLA_READER;
+
+/**
+ * @brief Open a binary query log
+ *
+ * @param filename File to open
+ *
+ * @return The reader or NULL if the file could not be opened or memory
+ *         allocation failed. The error is logged.
+ */
+QLA_READER* qla_reader_open(const char *filename);
+
+/**
+ * @brief Read the next event
+ *
+ * The strings of the event are valid until the next call.
+ *
+ * @param reader The reader
+ * @param event  The event to fill
+ *
+ * @return True if an event was read, false at the end of the file or on
+ *         error. The error is stored in the reader.
+ */
+bool qla_reader_next(QLA_READER *reader, QLA_EVENT *event);
+
+/**
+ * @brief Close a binary query log
+ *
+ * @param reader Reader to close
+ */
+void qla_reader_close(QLA_READER *reader);
+
+/**
+ * @brief Get a description of a read error
+ *
+ * @param error The error
+ *
+ * @return Description of the error
+ */
+const char* qla_read_error_str(qla_read_error_t error);
+
+MXS_END_DECLS
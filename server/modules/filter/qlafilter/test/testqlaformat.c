@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file testqlaformat.c - Tests of the binary query log format
+ *
+ * Events are encoded into blocks, written to a file and read back. The
+ * decoded events must be identical to the written ones and truncated or
+ * corrupted files must be detected.
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+
+#include "../qlaformat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+
+/** Enough events to fill several blocks */
+#define N_EVENTS 20000
+
+static char service[] = "test_service";
+static char host[] = "127.0.0.1";
+
+/**
+ * Generate the test event number @c i. The timestamps are not monotonic, some
+ * durations are unknown and the statements repeat so that the dictionary of a
+ * block is used.
+ */
+static void make_event(int i, QLA_EVENT *event, char *user, char *canonical)
+{
+    sprintf(user, "user%d", i % 3);
+    sprintf(canonical, "SELECT a, b, c FROM table_%d WHERE id = ? AND name LIKE ? "
+            "ORDER BY a, b, c LIMIT ?", i % 2000);
+
+    event->timestamp = 1490000000000000 + i * 100 - (i % 10 == 0 ? 250 : 0);
+    event->duration = i % 7 == 0 ? QLA_DURATION_UNKNOWN : (uint64_t)i * 3;
+    event->session = i % 13;
+    event->service.str = service;
+    event->service.len = strlen(service);
+    event->user.str = user;
+    event->user.len = strlen(user);
+    event->host.str = host;
+    event->host.len = strlen(host);
+    event->canonical.str = canonical;
+    event->canonical.len = strlen(canonical);
+}
+
+static bool string_equal(QLA_STRING a, QLA_STRING b)
+{
+    return a.len == b.len && memcmp(a.str, b.str, a.len) == 0;
+}
+
+/**
+ * Write the test events into a file
+ *
+ * @return Number of blocks written
+ */
+static int write_events(const char *filename)
+{
+    FILE *file = fopen(filename, "wb");
+    ss_info_dassert(file, "Test file should be created");
+
+    uint8_t header[QLA_FILE_HEADER_LEN];
+    qla_file_header(header);
+    ss_info_dassert(fwrite(header, 1, sizeof(header), file) == sizeof(header),
+                    "File header should be written");
+
+    QLA_BLOCK *block = qla_block_alloc();
+    ss_info_dassert(block, "Block should be allocated");
+
+    int blocks = 0;
+    const uint8_t *out;
+    size_t len;
+
+    for (int i = 0; i < N_EVENTS; i++)
+    {
+        QLA_EVENT event;
+        char user[32];
+        char canonical[256];
+        make_event(i, &event, user, canonical);
+        ss_info_dassert(qla_block_add(block, &event), "Event should be added");
+
+        if (qla_block_full(block))
+        {
+            len = qla_block_encode(block, &out);
+            ss_info_dassert(len > QLA_BLOCK_HEADER_LEN, "Full block should be encoded");
+            ss_info_dassert(fwrite(out, 1, len, file) == len, "Block should be written");
+            blocks++;
+        }
+    }
+
+    if ((len = qla_block_encode(block, &out)))
+    {
+        ss_info_dassert(fwrite(out, 1, len, file) == len, "Last block should be written");
+        blocks++;
+    }
+
+    ss_info_dassert(qla_block_encode(block, &out) == 0, "Empty block should not be encoded");
+
+    qla_block_free(block);
+    fclose(file);
+
+    return blocks;
+}
+
+static int test_roundtrip(const char *filename)
+{
+    ss_dfprintf(stderr, "testqlaformat : Encode and decode events.");
+    int blocks = write_events(filename);
+    ss_info_dassert(blocks > 1, "The events should fill more than one block");
+
+    QLA_READER *reader = qla_reader_open(filename);
+    ss_info_dassert(reader, "Reader should be opened");
+
+    QLA_EVENT event;
+    int n = 0;
+
+    while (qla_reader_next(reader, &event))
+    {
+        QLA_EVENT expected;
+        char user[32];
+        char canonical[256];
+        make_event(n, &expected, user, canonical);
+
+        ss_info_dassert(event.timestamp == expected.timestamp, "Timestamps should match");
+        ss_info_dassert(event.duration == expected.duration, "Durations should match");
+        ss_info_dassert(event.session == expected.session, "Sessions should match");
+        ss_info_dassert(string_equal(event.service, expected.service), "Services should match");
+        ss_info_dassert(string_equal(event.user, expected.user), "Users should match");
+        ss_info_dassert(string_equal(event.host, expected.host), "Hosts should match");
+        ss_info_dassert(string_equal(event.canonical, expected.canonical),
+                        "Statements should match");
+        n++;
+    }
+
+    ss_info_dassert(reader->error == QLA_READ_OK, "The whole file should be read without errors");
+    ss_info_dassert(n == N_EVENTS, "All events should be read");
+    ss_info_dassert(reader->events == N_EVENTS, "The reader should count all events");
+    ss_info_dassert(reader->blocks == (uint64_t)blocks, "The reader should count all blocks");
+
+    qla_reader_close(reader);
+    ss_dfprintf(stderr, "\t..done\n");
+
+    return 0;
+}
+
+/** Read all events and return the error of the reader */
+static qla_read_error_t read_all(const char *filename)
+{
+    QLA_READER *reader = qla_reader_open(filename);
+    ss_info_dassert(reader, "Reader should be opened");
+
+    QLA_EVENT event;
+
+    while (qla_reader_next(reader, &event))
+    {
+    }
+
+    qla_read_error_t rval = reader->error;
+    qla_reader_close(reader);
+
+    return rval;
+}
+
+static int test_damaged(const char *filename)
+{
+    ss_dfprintf(stderr, "testqlaformat : Detect damaged files.");
+    write_events(filename);
+
+    FILE *file = fopen(filename, "rb+");
+    ss_info_dassert(file, "Test file should be opened");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+
+    /** Flip a byte in the payload of the first block */
+    int offset = QLA_FILE_HEADER_LEN + QLA_BLOCK_HEADER_LEN + 10;
+    fseek(file, offset, SEEK_SET);
+    int c = fgetc(file);
+    fseek(file, offset, SEEK_SET);
+    fputc(c ^ 0xff, file);
+    fclose(file);
+
+    ss_info_dassert(read_all(filename) == QLA_READ_CHECKSUM, "Corrupted block should be detected");
+
+    write_events(filename);
+    ss_info_dassert(truncate(filename, size - 5) == 0, "Test file should be truncated");
+    ss_info_dassert(read_all(filename) == QLA_READ_TRUNCATED, "Truncated block should be detected");
+
+    ss_info_dassert(truncate(filename, QLA_FILE_HEADER_LEN + 3) == 0, "Test file should be truncated");
+    ss_info_dassert(read_all(filename) == QLA_READ_TRUNCATED,
+                    "Truncated block header should be detected");
+
+    ss_info_dassert(truncate(filename, QLA_FILE_HEADER_LEN) == 0, "Test file should be truncated");
+    ss_info_dassert(read_all(filename) == QLA_READ_OK, "A file without blocks should be empty");
+
+    /** An empty uncompressed block with a matching checksum */
+    uint8_t empty[QLA_BLOCK_HEADER_LEN] = {0};
+    file = fopen(filename, "ab");
+    ss_info_dassert(file, "Test file should be opened");
+    ss_info_dassert(fwrite(empty, 1, sizeof(empty), file) == sizeof(empty),
+                    "Empty block should be written");
+    fclose(file);
+    ss_info_dassert(read_all(filename) == QLA_READ_CORRUPT, "Empty block should be rejected");
+
+    ss_info_dassert(truncate(filename, 3) == 0, "Test file should be truncated");
+    ss_info_dassert(qla_reader_open(filename) == NULL, "A file without a header should be rejected");
+    ss_dfprintf(stderr, "\t..done\n");
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+    char filename[] = "/tmp/testqlaformat.XXXXXX";
+    int fd = mkstemp(filename);
+
+    if (fd == -1)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+
+    close(fd);
+    mxs_log_init(NULL, NULL, MXS_LOG_TARGET_DEFAULT);
+
+    result += test_roundtrip(filename);
+    result += test_damaged(filename);
+
+    mxs_log_finish();
+    unlink(filename);
+    exit(result);
+}
@@ -29,6 +29,12 @@
  *          of the request (optional)
  * user     A user name to match against. If present only requests that
  *          originate from this user will be duplciated (optional)
+ * async    Queue the duplicates and send them to the branch service only
+ *          when it has replied to the previous one (optional)
+ * queue_size       The maximum number of queued duplicates of all sessions,
+ *                  further duplicates are dropped (optional)
+ * sample_threshold The number of queued duplicates after which duplicates
+ *                  are increasingly dropped (optional)
  *
  * Revision History
  * ================
@@ -59,7 +65,10 @@
 #include <maxscale/poll.h>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/housekeeper.h>
+#include <maxscale/hk_heartbeat.h>
 #include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
+#include <maxscale/random_jkiss.h>
 
 #define MYSQL_COM_QUIT                  0x01
 #define MYSQL_COM_INITDB                0x02
@@ -122,8 +131,26 @@ typedef struct
     regex_t re; /* Compiled regex text */
     char *nomatch; /* Optional text to match against for exclusion */
     regex_t nore; /* Compiled regex nomatch text */
+    bool async; /* Queue the duplicates instead of routing them immediately */
+    int queue_size; /* Maximum number of queued duplicates */
+    int sample_threshold; /* Queued duplicates after which some are dropped */
+    int queued; /* Number of queued duplicates of all sessions */
+    uint64_t n_mirrored; /* Number of duplicates routed to the branch */
+    uint64_t n_dropped; /* Number of duplicates dropped */
+    long lag; /* Queueing time of the latest routed duplicate, in heartbeats */
+    long max_lag; /* Longest queueing time of a duplicate, in heartbeats */
 } TEE_INSTANCE;
 
+/**
+ * A duplicate waiting to be routed to the branch session
+ */
+typedef struct tee_mirror_item
+{
+    GWBUF *buffer; /* The duplicate */
+    long queued; /* The heartbeat when the duplicate was queued */
+    struct tee_mirror_item *next;
+} TEE_MIRROR_ITEM;
+
 /**
  * The session structure for this TEE filter.
  * This stores the downstream filter information, such that the
@@ -156,6 +183,10 @@ typedef struct
     GWBUF* queue;
     SPINLOCK tee_lock;
     DCB* client_dcb;
+    TEE_MIRROR_ITEM *mirror_head; /* Queued duplicates, oldest first */
+    TEE_MIRROR_ITEM *mirror_tail;
+    bool mirror_waiting; /* The branch has not replied to the latest duplicate */
+    bool mirror_sending; /* The queue is being routed to the branch */
 
 #ifdef SS_DEBUG
     long d_id;
@@ -185,6 +216,14 @@ int route_single_query(TEE_INSTANCE* my_instance,
                        TEE_SESSION* my_session,
                        GWBUF* buffer,
                        GWBUF* clone);
+int route_async_query(TEE_INSTANCE* my_instance,
+                      TEE_SESSION* my_session,
+                      GWBUF* buffer,
+                      GWBUF* clone);
+static void mirror_send(TEE_INSTANCE* my_instance, TEE_SESSION* my_session, bool flush);
+static int mirror_branch_write(DCB *dcb, GWBUF *buf);
+static int mirror_branch_write_ready(DCB *dcb);
+static int mirror_branch_drained(DCB *dcb, DCB_REASON reason, void *data);
 int reset_session_state(TEE_SESSION* my_session, GWBUF* buffer);
 void create_orphan(MXS_SESSION* ses);
 
@@ -344,6 +383,9 @@ MXS_MODULE* MXS_CREATE_MODULE()
                 MXS_MODULE_OPT_NONE,
                 option_values
             },
+            {"async", MXS_MODULE_PARAM_BOOL, "false"},
+            {"queue_size", MXS_MODULE_PARAM_COUNT, "1000"},
+            {"sample_threshold", MXS_MODULE_PARAM_COUNT, "0"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -373,6 +415,21 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
         my_instance->userName = config_copy_string(params, "user");
         my_instance->match = config_copy_string(params, "match");
         my_instance->nomatch = config_copy_string(params, "exclude");
+        my_instance->async = config_get_bool(params, "async");
+        my_instance->queue_size = config_get_integer(params, "queue_size");
+        my_instance->sample_threshold = config_get_integer(params, "sample_threshold");
+
+        if (my_instance->async && my_instance->sample_threshold >= my_instance->queue_size)
+        {
+            MXS_ERROR("The value of 'sample_threshold' must be smaller than "
+                      "the value of 'queue_size'.");
+            MXS_FREE(my_instance->match);
+            MXS_FREE(my_instance->nomatch);
+            MXS_FREE(my_instance->source);
+            MXS_FREE(my_instance->userName);
+            MXS_FREE(my_instance);
+            return NULL;
+        }
 
         int cflags = config_get_enum(params, "options", option_values);
 
@@ -505,6 +562,14 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
 
             my_session->branch_session = ses;
             my_session->branch_dcb = dcb;
+
+            if (my_instance->async)
+            {
+                /** The queue is drained when the branch replies */
+                dcb->func.write = mirror_branch_write;
+                dcb->func.write_ready = mirror_branch_write_ready;
+                dcb_add_callback(dcb, DCB_REASON_DRAINED, mirror_branch_drained, my_session);
+            }
         }
     }
 retblock:
@@ -532,6 +597,15 @@ closeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session)
 #endif
     if (my_session->active)
     {
+        if (my_session->instance->async)
+        {
+            dcb_remove_callback(my_session->branch_dcb, DCB_REASON_DRAINED,
+                                mirror_branch_drained, my_session);
+
+            /** Route the remaining duplicates so that the branch executes
+             * the same statements as the main session */
+            mirror_send(my_session->instance, my_session, true);
+        }
 
         if ((bsession = my_session->branch_session) != NULL)
         {
@@ -676,6 +750,11 @@ routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *queue)
     TEE_SESSION *my_session = (TEE_SESSION *) session;
     GWBUF *clone = clone_query(my_instance, my_session, queue);
 
+    if (my_instance->async)
+    {
+        return route_async_query(my_instance, my_session, queue, clone);
+    }
+
     return route_single_query(my_instance, my_session, queue, clone);
 }
 
@@ -695,6 +774,12 @@ clientReply(MXS_FILTER* instance, MXS_FILTER_SESSION *session, GWBUF *reply)
     int rc = 1, branch, eof;
     TEE_SESSION *my_session = (TEE_SESSION *) session;
 
+    if (my_session->mirror_head)
+    {
+        /** The branch may have replied since the previous query */
+        mirror_send((TEE_INSTANCE *) instance, my_session, false);
+    }
+
     return my_session->up.clientReply(my_session->up.instance,
                                       my_session->up.session,
                                       reply);
@@ -739,6 +824,26 @@ diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *dcb)
         dcb_printf(dcb, "\t\tExclude queries that match		%s\n",
                    my_instance->nomatch);
     }
+    if (my_instance->async)
+    {
+        dcb_printf(dcb, "\t\tMaximum queued statements		%d\n",
+                   my_instance->queue_size);
+        if (my_instance->sample_threshold)
+        {
+            dcb_printf(dcb, "\t\tSample statements after		%d\n",
+                       my_instance->sample_threshold);
+        }
+        dcb_printf(dcb, "\t\tNo. of queued statements:	%d\n",
+                   my_instance->queued);
+        dcb_printf(dcb, "\t\tNo. of statements mirrored:	%lu\n",
+                   my_instance->n_mirrored);
+        dcb_printf(dcb, "\t\tNo. of statements dropped:	%lu\n",
+                   my_instance->n_dropped);
+        dcb_printf(dcb, "\t\tCurrent lag:			%ldms\n",
+                   my_instance->lag * 100);
+        dcb_printf(dcb, "\t\tMaximum lag:			%ldms\n",
+                   my_instance->max_lag * 100);
+    }
     if (my_session)
     {
         dcb_printf(dcb, "\t\tNo. of statements duplicated:	%d.\n",
@@ -906,6 +1011,261 @@ int route_single_query(TEE_INSTANCE* my_instance, TEE_SESSION* my_session, GWBUF
     return rval;
 }
 
+/**
+ * Check whether a command is answered by the server
+ *
+ * @param buffer Buffer with the command
+ * @return True if the server sends a reply to the command
+ */
+static bool command_has_reply(GWBUF *buffer)
+{
+    uint8_t command = GWBUF_LENGTH(buffer) > 4 ? GWBUF_DATA(buffer)[4] : 0;
+
+    return command != MYSQL_COM_QUIT &&
+           command != MYSQL_COM_STMT_SEND_LONG_DATA &&
+           command != MYSQL_COM_STMT_CLOSE;
+}
+
+/**
+ * Check whether the branch session can take the next duplicate. Only one
+ * duplicate is sent at a time so that a slow branch does not accumulate
+ * queries in its connections.
+ *
+ * @param my_session Tee session
+ * @return True if the next duplicate can be routed to the branch
+ */
+static bool mirror_ready(TEE_SESSION* my_session)
+{
+    return !my_session->mirror_waiting || DCB_REPLIED(my_session->branch_dcb);
+}
+
+/**
+ * Route a duplicate to the branch session
+ *
+ * @param my_instance Tee instance
+ * @param my_session Tee session
+ * @param clone The duplicate
+ */
+static void mirror_route(TEE_INSTANCE* my_instance, TEE_SESSION* my_session, GWBUF* clone)
+{
+    if (my_session->branch_session->state == SESSION_STATE_ROUTER_READY)
+    {
+        /** The cloned client DCB of the branch is flagged when it is written to */
+        my_session->branch_dcb->flags &= ~DCBF_REPLIED;
+        my_session->mirror_waiting = command_has_reply(clone);
+        atomic_add_uint64(&my_instance->n_mirrored, 1);
+        MXS_SESSION_ROUTE_QUERY(my_session->branch_session, clone);
+    }
+    else
+    {
+        atomic_add_uint64(&my_instance->n_dropped, 1);
+        gwbuf_free(clone);
+    }
+}
+
+/**
+ * Route the queued duplicates to the branch session until it has to reply
+ * to one of them.
+ *
+ * @param my_instance Tee instance
+ * @param my_session Tee session
+ * @param flush Route all queued duplicates without waiting for the replies
+ */
+static void mirror_send(TEE_INSTANCE* my_instance, TEE_SESSION* my_session, bool flush)
+{
+    if (my_session->mirror_sending)
+    {
+        /** Called again while the branch routes a duplicate */
+        return;
+    }
+
+    my_session->mirror_sending = true;
+
+    while (my_session->mirror_head && (flush || mirror_ready(my_session)))
+    {
+        TEE_MIRROR_ITEM *item = my_session->mirror_head;
+        my_session->mirror_head = item->next;
+
+        if (my_session->mirror_head == NULL)
+        {
+            my_session->mirror_tail = NULL;
+        }
+
+        atomic_add(&my_instance->queued, -1);
+
+        long lag = hkheartbeat - item->queued;
+        my_instance->lag = lag;
+
+        if (lag > my_instance->max_lag)
+        {
+            my_instance->max_lag = lag;
+        }
+
+        mirror_route(my_instance, my_session, item->buffer);
+        MXS_FREE(item);
+    }
+
+    if (my_session->mirror_head == NULL)
+    {
+        /** Nothing is waiting, the branch keeps up */
+        my_instance->lag = 0;
+    }
+
+    my_session->mirror_sending = false;
+}
+
+/**
+ * Write routine of the cloned client DCB of the branch session in async mode.
+ * The reply is discarded and, for the first reply to a duplicate, a fake
+ * write event is added so that the next duplicate is routed from the poll
+ * loop instead of the reply path of the branch router.
+ *
+ * @param dcb The cloned client DCB
+ * @param buf The reply
+ * @return Always 1
+ */
+static int mirror_branch_write(DCB *dcb, GWBUF *buf)
+{
+    gwbuf_free(buf);
+
+    if (!DCB_REPLIED(dcb))
+    {
+        dcb->flags |= DCBF_REPLIED;
+        poll_fake_write_event(dcb);
+    }
+
+    return 1;
+}
+
+/**
+ * Fake write event handler of the cloned client DCB. The write queue of the
+ * clone is always empty so this only triggers the DCB_REASON_DRAINED callback.
+ *
+ * @param dcb The cloned client DCB
+ * @return 0
+ */
+static int mirror_branch_write_ready(DCB *dcb)
+{
+    return dcb_drain_writeq(dcb);
+}
+
+/**
+ * Route the queued duplicates after the branch has replied
+ *
+ * @param dcb The cloned client DCB
+ * @param reason Always DCB_REASON_DRAINED
+ * @param data The tee session
+ * @return 0
+ */
+static int mirror_branch_drained(DCB *dcb, DCB_REASON reason, void *data)
+{
+    TEE_SESSION *my_session = (TEE_SESSION *) data;
+
+    if (my_session->active && my_session->mirror_head)
+    {
+        mirror_send(my_session->instance, my_session, false);
+    }
+
+    return 0;
+}
+
+/**
+ * Check whether a duplicate should be dropped because too many duplicates
+ * are queued. Between sample_threshold and queue_size queued duplicates,
+ * the probability of dropping a duplicate grows linearly from zero to one.
+ * Duplicates required for the consistency of the branch session are never
+ * dropped.
+ *
+ * @param my_instance Tee instance
+ * @param clone The duplicate
+ * @param queued Number of queued duplicates, including this one
+ * @return True if the duplicate should be dropped
+ */
+static bool mirror_drop(TEE_INSTANCE* my_instance, GWBUF* clone, int queued)
+{
+    bool rval = false;
+
+    if (!packet_is_required(clone))
+    {
+        if (queued > my_instance->queue_size)
+        {
+            rval = true;
+        }
+        else if (my_instance->sample_threshold && queued > my_instance->sample_threshold)
+        {
+            int range = my_instance->queue_size - my_instance->sample_threshold;
+            rval = (int)(random_jkiss() % range) < queued - my_instance->sample_threshold;
+        }
+    }
+
+    return rval;
+}
+
+/**
+ * Route the main query downstream along the main filter chain and queue
+ * a clone of the buffer for the branch session. The clone is routed
+ * immediately if the branch has replied to all previous clones, otherwise
+ * it is routed when the branch has caught up. If too many clones are
+ * queued, the clone is dropped.
+ *
+ * @param my_instance Tee instance
+ * @param my_session Tee session
+ * @param buffer Main buffer
+ * @param clone Cloned buffer
+ * @return 1 on success, 0 on failure.
+ */
+int route_async_query(TEE_INSTANCE* my_instance, TEE_SESSION* my_session, GWBUF* buffer, GWBUF* clone)
+{
+    int rval = 0;
+
+    if (my_session->active && my_session->branch_session)
+    {
+        rval = my_session->down.routeQuery(my_session->down.instance,
+                                           my_session->down.session,
+                                           buffer);
+        if (clone)
+        {
+            my_session->n_duped++;
+            int queued = atomic_add(&my_instance->queued, 1) + 1;
+            TEE_MIRROR_ITEM *item;
+
+            if (mirror_drop(my_instance, clone, queued) ||
+                (item = MXS_MALLOC(sizeof(TEE_MIRROR_ITEM))) == NULL)
+            {
+                atomic_add(&my_instance->queued, -1);
+                atomic_add_uint64(&my_instance->n_dropped, 1);
+                gwbuf_free(clone);
+            }
+            else
+            {
+                item->buffer = clone;
+                item->queued = hkheartbeat;
+                item->next = NULL;
+
+                if (my_session->mirror_tail)
+                {
+                    my_session->mirror_tail->next = item;
+                }
+                else
+                {
+                    my_session->mirror_head = item;
+                }
+
+                my_session->mirror_tail = item;
+
+                /** Routed at once if the branch has replied to the previous duplicate */
+                mirror_send(my_instance, my_session, false);
+            }
+        }
+    }
+    else if (clone)
+    {
+        gwbuf_free(clone);
+    }
+
+    return rval;
+}
+
 /**
  * Reset the session's internal counters.
  * @param my_session Tee session
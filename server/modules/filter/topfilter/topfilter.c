@@ -26,6 +26,10 @@
  * file to which the queries are logged. A serial number is appended to this
  * name in order that each session logs to a different file.
  *
+ * With global_top=true, the statistics of the canonical forms of the
+ * statements are also collected from all sessions of the service. They
+ * can be inspected with the "top" module command and with maxinfo.
+ *
  * Date         Who             Description
  * 18/06/2014   Mark Riddoch    Addition of source and user filters
  *
@@ -38,14 +42,17 @@
 #include <fcntl.h>
 #include <maxscale/filter.h>
 #include <maxscale/modinfo.h>
+#include <maxscale/modulecmd.h>
 #include <maxscale/modutil.h>
 #include <maxscale/log_manager.h>
+#include <maxscale/logsink.h>
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
 #include <regex.h>
 #include <maxscale/atomic.h>
 #include <maxscale/alloc.h>
+#include <maxscale/topqueries.h>
 
 /*
  * The filter entry points
@@ -60,6 +67,7 @@ static int routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, GWBUF
 static int clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, GWBUF *queue);
 static void diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *dcb);
 static uint64_t getCapabilities(MXS_FILTER* instance);
+static void destroyInstance(MXS_FILTER *instance);
 
 /**
  * A instance structure, the assumption is that the option passed
@@ -80,6 +88,9 @@ typedef struct
     regex_t re; /* Compiled regex text */
     char *exclude; /* Optional text to match against for exclusion */
     regex_t exre; /* Compiled regex nomatch text */
+    LOGSINK_CONFIG sink_config; /* Configuration of the report log sinks */
+    TOP_QUERIES *global; /* Statistics of all sessions, NULL if not enabled */
+    int global_capacity; /* Statements kept by each thread */
 } TOPN_INSTANCE;
 
 /**
@@ -110,6 +121,8 @@ typedef struct
     int fd;
     struct timeval start;
     char *current;
+    char *canonical; /* Canonical form of current, for the global statistics */
+    int thread_id; /* The worker thread of the session */
     TOPNQ **top;
     int n_statements;
     struct timeval total;
@@ -125,6 +138,51 @@ static const MXS_ENUM_VALUE option_values[] =
     {NULL}
 };
 
+/**
+ * Print the heaviest statements of all sessions
+ *
+ * @param argv The output DCB and the filter
+ *
+ * @return True if the statements were printed
+ */
+static bool topn_show_top(const MODULECMD_ARG *argv)
+{
+    DCB *dcb = argv->argv[0].value.dcb;
+    MXS_FILTER_DEF *filter = argv->argv[1].value.filter;
+    TOPN_INSTANCE *inst = (TOPN_INSTANCE*)filter_def_get_instance(filter);
+
+    if (inst->global == NULL)
+    {
+        modulecmd_set_error("The filter '%s' does not have 'global_top' enabled.",
+                            filter_def_get_name(filter));
+        return false;
+    }
+
+    TOP_QUERY *top;
+    int n = top_queries_get(inst->global, &top);
+
+    if (n < 0)
+    {
+        modulecmd_set_error("Memory allocation failed");
+        return false;
+    }
+
+    dcb_printf(dcb, "     Count | Total (ms) |   Avg (ms) |   Max (ms) |   p50 (ms) |   p95 (ms) |   p99 (ms) | Query\n");
+    dcb_printf(dcb, "-----------+------------+------------+------------+------------+------------+------------+------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        dcb_printf(dcb, "%10lu | %10.3f | %10.3f | %10.3f | %10.3f | %10.3f | %10.3f | %s\n",
+                   top[i].count, top[i].total / 1000.0,
+                   top[i].samples ? top[i].total / 1000.0 / top[i].samples : 0,
+                   top[i].max / 1000.0, top[i].p50 / 1000.0, top[i].p95 / 1000.0,
+                   top[i].p99 / 1000.0, top[i].canonical);
+    }
+
+    top_queries_free_result(top, n);
+    return true;
+}
+
 /**
  * The module entry point routine. It is this routine that
  * must populate the structure that is referred to as the
@@ -135,6 +193,14 @@ static const MXS_ENUM_VALUE option_values[] =
  */
 MXS_MODULE* MXS_CREATE_MODULE()
 {
+    modulecmd_arg_type_t args_top[] =
+    {
+        {MODULECMD_ARG_OUTPUT, "DCB where result is written"},
+        {MODULECMD_ARG_FILTER | MODULECMD_ARG_NAME_MATCHES_DOMAIN, "Filter to inspect"}
+    };
+
+    modulecmd_register_command(MXS_MODULE_NAME, "top", topn_show_top, 2, args_top);
+
     static MXS_FILTER_OBJECT MyObject =
     {
         createInstance,
@@ -147,7 +213,7 @@ MXS_MODULE* MXS_CREATE_MODULE()
         clientReply,
         diagnostic,
         getCapabilities,
-        NULL, // No destroyInstance
+        destroyInstance,
     };
 
     static MXS_MODULE info =
@@ -176,6 +242,18 @@ MXS_MODULE* MXS_CREATE_MODULE()
                 MXS_MODULE_OPT_NONE,
                 option_values
             },
+            {"global_top", MXS_MODULE_PARAM_BOOL, "false"},
+            {"global_capacity", MXS_MODULE_PARAM_COUNT, "256"},
+            {LOGSINK_PARAM_BUFFER_SIZE, MXS_MODULE_PARAM_SIZE, LOGSINK_DEFAULT_BUFFER_SIZE},
+            {LOGSINK_PARAM_BATCH_SIZE, MXS_MODULE_PARAM_SIZE, LOGSINK_DEFAULT_BATCH_SIZE},
+            {LOGSINK_PARAM_FLUSH_INTERVAL, MXS_MODULE_PARAM_COUNT, LOGSINK_DEFAULT_FLUSH_INTERVAL},
+            {
+                LOGSINK_PARAM_POLICY,
+                MXS_MODULE_PARAM_ENUM,
+                LOGSINK_DEFAULT_POLICY,
+                MXS_MODULE_OPT_NONE,
+                logsink_policy_values
+            },
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -206,6 +284,9 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
         my_instance->source = config_copy_string(params, "source");
         my_instance->user = config_copy_string(params, "user");
         my_instance->filebase = MXS_STRDUP_A(config_get_string(params, "filebase"));
+        logsink_config_get(params, &my_instance->sink_config);
+        my_instance->global = NULL;
+        my_instance->global_capacity = config_get_integer(params, "global_capacity");
 
         int cflags = config_get_enum(params, "options", option_values);
         bool error = false;
@@ -233,6 +314,20 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
             error = true;
         }
 
+        if (my_instance->global_capacity < 1)
+        {
+            MXS_ERROR("Invalid value %d for 'global_capacity', the value must "
+                      "be at least 1.", my_instance->global_capacity);
+            error = true;
+        }
+
+        if (!error && config_get_bool(params, "global_top") &&
+            (my_instance->global = top_queries_create(name, my_instance->topN,
+                                                      my_instance->global_capacity)) == NULL)
+        {
+            error = true;
+        }
+
         if (error)
         {
             if (my_instance->exclude)
@@ -256,6 +351,19 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
     return (MXS_FILTER *) my_instance;
 }
 
+/**
+ * Destroy the filter instance
+ *
+ * @param instance The filter instance
+ */
+static void
+destroyInstance(MXS_FILTER *instance)
+{
+    TOPN_INSTANCE *my_instance = (TOPN_INSTANCE *) instance;
+
+    top_queries_destroy(my_instance->global);
+}
+
 /**
  * Associate a new session with this instance of the filter.
  *
@@ -297,6 +405,8 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
         my_session->total.tv_sec = 0;
         my_session->total.tv_usec = 0;
         my_session->current = NULL;
+        my_session->canonical = NULL;
+        my_session->thread_id = session->client_dcb->thread.id;
         if ((remote = session_get_remote(session)) != NULL)
         {
             my_session->clientHost = MXS_STRDUP_A(remote);
@@ -336,7 +446,8 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
 /**
  * Close a session with the filter, this is the mechanism
  * by which a filter may cleanup data structure etc.
- * In the case of the TOPN filter we simple close the file descriptor.
+ * In the case of the TOPN filter we write the report of the session. The
+ * report is written to the file by the log sink writer.
  *
  * @param instance  The filter instance data
  * @param session   The session being closed
@@ -348,58 +459,58 @@ closeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session)
     TOPN_SESSION *my_session = (TOPN_SESSION *) session;
     struct timeval diff;
     int i;
-    FILE *fp;
+    LOGSINK *sink;
     int statements;
 
     gettimeofday(&my_session->disconnect, NULL);
     timersub((&my_session->disconnect), &(my_session->connect), &diff);
-    if ((fp = fopen(my_session->filename, "w")) != NULL)
+    if ((sink = logsink_open(my_session->filename, false, &my_instance->sink_config)) != NULL)
     {
         statements = my_session->n_statements != 0 ? my_session->n_statements : 1;
 
-        fprintf(fp, "Top %d longest running queries in session.\n",
-                my_instance->topN);
-        fprintf(fp, "==========================================\n\n");
-        fprintf(fp, "Time (sec) | Query\n");
-        fprintf(fp, "-----------+-----------------------------------------------------------------\n");
+        logsink_printf(sink, "Top %d longest running queries in session.\n",
+                       my_instance->topN);
+        logsink_printf(sink, "==========================================\n\n");
+        logsink_printf(sink, "Time (sec) | Query\n");
+        logsink_printf(sink, "-----------+-----------------------------------------------------------------\n");
         for (i = 0; i < my_instance->topN; i++)
         {
             if (my_session->top[i]->sql)
             {
-                fprintf(fp, "%10.3f |  %s\n",
-                        (double) ((my_session->top[i]->duration.tv_sec * 1000)
-                                  + (my_session->top[i]->duration.tv_usec / 1000)) / 1000,
-                        my_session->top[i]->sql);
+                logsink_printf(sink, "%10.3f |  %s\n",
+                               (double) ((my_session->top[i]->duration.tv_sec * 1000)
+                                         + (my_session->top[i]->duration.tv_usec / 1000)) / 1000,
+                               my_session->top[i]->sql);
             }
         }
-        fprintf(fp, "-----------+-----------------------------------------------------------------\n");
+        logsink_printf(sink, "-----------+-----------------------------------------------------------------\n");
         struct tm tm;
         localtime_r(&my_session->connect.tv_sec, &tm);
         char buffer[32]; // asctime_r documentation requires 26
         asctime_r(&tm, buffer);
-        fprintf(fp, "\n\nSession started %s", buffer);
+        logsink_printf(sink, "\n\nSession started %s", buffer);
         if (my_session->clientHost)
         {
-            fprintf(fp, "Connection from %s\n",
-                    my_session->clientHost);
+            logsink_printf(sink, "Connection from %s\n",
+                           my_session->clientHost);
         }
         if (my_session->userName)
         {
-            fprintf(fp, "Username        %s\n",
-                    my_session->userName);
+            logsink_printf(sink, "Username        %s\n",
+                           my_session->userName);
         }
-        fprintf(fp, "\nTotal of %d statements executed.\n",
-                statements);
-        fprintf(fp, "Total statement execution time   %5d.%d seconds\n",
-                (int) my_session->total.tv_sec,
-                (int) my_session->total.tv_usec / 1000);
-        fprintf(fp, "Average statement execution time %9.3f seconds\n",
-                (double) ((my_session->total.tv_sec * 1000)
-                          + (my_session->total.tv_usec / 1000))
-                / (1000 * statements));
-        fprintf(fp, "Total connection time            %5d.%d seconds\n",
-                (int) diff.tv_sec, (int) diff.tv_usec / 1000);
-        fclose(fp);
+        logsink_printf(sink, "\nTotal of %d statements executed.\n",
+                       statements);
+        logsink_printf(sink, "Total statement execution time   %5d.%d seconds\n",
+                       (int) my_session->total.tv_sec,
+                       (int) my_session->total.tv_usec / 1000);
+        logsink_printf(sink, "Average statement execution time %9.3f seconds\n",
+                       (double) ((my_session->total.tv_sec * 1000)
+                                 + (my_session->total.tv_usec / 1000))
+                       / (1000 * statements));
+        logsink_printf(sink, "Total connection time            %5d.%d seconds\n",
+                       (int) diff.tv_sec, (int) diff.tv_usec / 1000);
+        logsink_close(sink);
     }
 }
 
@@ -415,6 +526,7 @@ freeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session)
     TOPN_SESSION *my_session = (TOPN_SESSION *) session;
 
     MXS_FREE(my_session->filename);
+    MXS_FREE(my_session->canonical);
     MXS_FREE(session);
     return;
 }
@@ -484,6 +596,12 @@ routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *queue)
                 }
                 gettimeofday(&my_session->start, NULL);
                 my_session->current = ptr;
+
+                if (my_instance->global)
+                {
+                    MXS_FREE(my_session->canonical);
+                    my_session->canonical = modutil_get_canonical(queue);
+                }
             }
             else
             {
@@ -496,19 +614,6 @@ routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *queue)
                                        my_session->down.session, queue);
 }
 
-static int
-cmp_topn(const void *va, const void *vb)
-{
-    TOPNQ **a = (TOPNQ **) va;
-    TOPNQ **b = (TOPNQ **) vb;
-
-    if ((*b)->duration.tv_sec == (*a)->duration.tv_sec)
-    {
-        return (*b)->duration.tv_usec - (*a)->duration.tv_usec;
-    }
-    return (*b)->duration.tv_sec - (*a)->duration.tv_sec;
-}
-
 static int
 clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *reply)
 {
@@ -543,19 +648,35 @@ clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *reply)
             MXS_FREE(my_session->top[my_instance->topN - 1]->sql);
             my_session->top[my_instance->topN - 1]->sql = my_session->current;
             my_session->top[my_instance->topN - 1]->duration = diff;
+            i = my_instance->topN - 1;
             inserted = 1;
         }
 
         if (inserted)
         {
-            qsort(my_session->top, my_instance->topN,
-                  sizeof(TOPNQ *), cmp_topn);
+            /** The other queries are already in order, move the new one up */
+            while (i > 0 && timercmp(&my_session->top[i - 1]->duration,
+                                     &my_session->top[i]->duration, <))
+            {
+                TOPNQ *tmp = my_session->top[i - 1];
+                my_session->top[i - 1] = my_session->top[i];
+                my_session->top[i] = tmp;
+                i--;
+            }
         }
         else
         {
             MXS_FREE(my_session->current);
         }
         my_session->current = NULL;
+
+        if (my_session->canonical)
+        {
+            top_queries_add(my_instance->global, my_session->thread_id, my_session->canonical,
+                            diff.tv_sec * 1000000 + diff.tv_usec);
+            MXS_FREE(my_session->canonical);
+            my_session->canonical = NULL;
+        }
     }
 
     /* Pass the result upstream */
@@ -583,6 +704,11 @@ diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *dcb)
 
     dcb_printf(dcb, "\t\tReport size            %d\n",
                my_instance->topN);
+    if (my_instance->global)
+    {
+        dcb_printf(dcb, "\t\tGlobal statistics of %d statements per thread\n",
+                   my_instance->global_capacity);
+    }
     if (my_instance->source)
     {
         dcb_printf(dcb, "\t\tLimit logging to connections from  %s\n",
@@ -59,6 +59,7 @@
 #include <maxscale/modinfo.h>
 #include <maxscale/modutil.h>
 #include <maxscale/log_manager.h>
+#include <maxscale/logsink.h>
 #include <maxscale/thread.h>
 #include <maxscale/server.h>
 #include <maxscale/atomic.h>
@@ -105,7 +106,7 @@ typedef struct
     bool log_enabled;
 
     int query_delimiter_size; /* the length of the query delimiter */
-    FILE* fp;
+    LOGSINK* sink;
 } TPM_INSTANCE;
 
 /**
@@ -179,6 +180,16 @@ MXS_MODULE* MXS_CREATE_MODULE()
             {"query_delimiter", MXS_MODULE_PARAM_STRING, DEFAULT_QUERY_DELIMITER},
             {"source", MXS_MODULE_PARAM_STRING},
             {"user", MXS_MODULE_PARAM_STRING},
+            {LOGSINK_PARAM_BUFFER_SIZE, MXS_MODULE_PARAM_SIZE, LOGSINK_DEFAULT_BUFFER_SIZE},
+            {LOGSINK_PARAM_BATCH_SIZE, MXS_MODULE_PARAM_SIZE, LOGSINK_DEFAULT_BATCH_SIZE},
+            {LOGSINK_PARAM_FLUSH_INTERVAL, MXS_MODULE_PARAM_COUNT, LOGSINK_DEFAULT_FLUSH_INTERVAL},
+            {
+                LOGSINK_PARAM_POLICY,
+                MXS_MODULE_PARAM_ENUM,
+                LOGSINK_DEFAULT_POLICY,
+                MXS_MODULE_OPT_NONE,
+                logsink_policy_values
+            },
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -248,12 +259,12 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
         }
 
 
-        my_instance->fp = fopen(my_instance->filename, "w");
+        LOGSINK_CONFIG sink_config;
+        logsink_config_get(params, &sink_config);
 
-        if (my_instance->fp == NULL)
+        if (!error && (my_instance->sink = logsink_open(my_instance->filename, false, &sink_config)) == NULL)
         {
-            MXS_ERROR("Opening output file '%s' for tpmfilter failed due to %d, %s",
-                      my_instance->filename, errno, strerror(errno));
+            MXS_ERROR("Opening output file '%s' for tpmfilter failed.", my_instance->filename);
             error = true;
         }
 
@@ -275,11 +286,12 @@ createInstance(const char *name, char **options, MXS_CONFIG_PARAMETER *params)
             MXS_FREE(my_instance->query_delimiter);
             MXS_FREE(my_instance->source);
             MXS_FREE(my_instance->user);
-            if (my_instance->fp)
+            if (my_instance->sink)
             {
-                fclose(my_instance->fp);
+                logsink_close(my_instance->sink);
             }
             MXS_FREE(my_instance);
+            my_instance = NULL;
         }
     }
 
@@ -357,14 +369,7 @@ newSession(MXS_FILTER *instance, MXS_SESSION *session)
 static  void
 closeSession(MXS_FILTER *instance, MXS_FILTER_SESSION *session)
 {
-    TPM_SESSION *my_session = (TPM_SESSION *)session;
-    TPM_INSTANCE    *my_instance = (TPM_INSTANCE *)instance;
-    if (my_instance->fp != NULL)
-    {
-        // flush FP when a session is closed.
-        fflush(my_instance->fp);
-    }
-
+    // The log file is written by the log sink writer
 }
 
 /**
@@ -542,16 +547,16 @@ clientReply(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *reply)
         if (my_instance->log_enabled)
         {
             /* this prints "timestamp | server_name | user_name | latency | sql_statements" */
-            fprintf(my_instance->fp, "%ld%s%s%s%s%s%ld%s%s\n",
-                    timestamp,
-                    my_instance->delimiter,
-                    reply->server->unique_name,
-                    my_instance->delimiter,
-                    my_session->userName,
-                    my_instance->delimiter,
-                    millis,
-                    my_instance->delimiter,
-                    my_session->sql);
+            logsink_printf(my_instance->sink, "%ld%s%s%s%s%s%ld%s%s\n",
+                           timestamp,
+                           my_instance->delimiter,
+                           reply->server->unique_name,
+                           my_instance->delimiter,
+                           my_session->userName,
+                           my_instance->delimiter,
+                           millis,
+                           my_instance->delimiter,
+                           my_session->sql);
         }
 
         my_session->sql_index = 0;
@@ -595,6 +600,7 @@ diagnostic(MXS_FILTER *instance, MXS_FILTER_SESSION *fsession, DCB *dcb)
     if (my_instance->query_delimiter)
         dcb_printf(dcb, "\t\tLogging with query delimiter %s.\n",
                    my_instance->query_delimiter);
+    logsink_diagnostics(my_instance->sink, dcb);
 }
 
 /**
@@ -623,13 +629,10 @@ static void checkNamedPipe(void *args)
         {
             if (buffer[0] == '1')
             {
-                // reopens the log file.
-                inst->fp = fopen(inst->filename, "w");
-                if (inst->fp == NULL)
+                // restarts the log file.
+                if (!logsink_truncate(inst->sink))
                 {
-                    MXS_ERROR("Failed to open a log file for tpmfilter.");
-                    MXS_FREE(inst);
-                    return;
+                    MXS_ERROR("Failed to truncate the log file of tpmfilter.");
                 }
                 inst->log_enabled = true;
             }
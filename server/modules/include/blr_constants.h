@@ -34,6 +34,7 @@ MXS_BEGIN_DECLS
 #define BINLOG_MAGIC_SIZE 4
 #define BINLOG_NAMEFMT    "%s.%06d"
 #define BINLOG_NAME_ROOT  "mysql-bin"
+#define BINLOG_COMPRESSED_SUFFIX ".compressed"
 
 #define BINLOG_EVENT_HDR_LEN     19
 
@@ -48,6 +48,19 @@ MXS_BEGIN_DECLS
 #define CDC_FIELD_MAXLEN       8192
 #define CDC_REQUESTLINE_MAXLEN 8192
 
+/**
+ * Batched binary frames
+ *
+ * Clients that register with TYPE=BATCH receive the data as frames. Each frame
+ * starts with a 4 byte little-endian payload length followed by a one byte
+ * frame type and the payload. A schema frame contains the JSON schema of the
+ * records that follow it. A rows frame starts with a 4 byte little-endian
+ * record count followed by the records in Avro binary encoding.
+ */
+#define CDC_FRAME_HEADER_LEN 5
+#define CDC_FRAME_SCHEMA     1
+#define CDC_FRAME_ROWS       2
+
 #define CDC_UNDEFINED                    0
 #define CDC_ALLOC                        1
 #define CDC_STATE_WAIT_FOR_AUTH          2
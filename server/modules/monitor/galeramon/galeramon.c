@@ -442,9 +442,15 @@ monitorMain(void *arg)
         while (ptr)
         {
             ptr->mon_prev_status = ptr->server->status;
+            ptr = ptr->next;
+        }
 
-            monitorDatabase(mon, ptr);
+        /* Probe all nodes concurrently */
+        mon_probe_servers(mon, monitorDatabase);
 
+        ptr = mon->databases;
+        while (ptr)
+        {
             /* Log server status change */
             if (mon_status_changed(ptr))
             {
@@ -1120,9 +1120,16 @@ monitorMain(void *arg)
             /* copy server status into monitor pending_status */
             ptr->pending_status = ptr->server->status;
 
-            /* monitor current node */
-            monitorDatabase(mon, ptr);
+            ptr = ptr->next;
+        }
 
+        /* monitor all nodes concurrently */
+        mon_probe_servers(mon, monitorDatabase);
+
+        ptr = mon->databases;
+
+        while (ptr)
+        {
             /* reset the slave list of current node */
             memset(&ptr->server->slaves, 0, sizeof(ptr->server->slaves));
 
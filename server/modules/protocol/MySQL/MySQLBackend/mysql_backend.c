@@ -545,7 +545,7 @@ gw_reply_on_error(DCB *dcb, mxs_auth_state_t state)
      * backends have done authentication. */
     if (state == MXS_AUTH_STATE_FAILED && session->state != SESSION_STATE_STOPPING)
     {
-        service_refresh_users(session->service);
+        service_refresh_users_async(session->service);
     }
 
     GWBUF* errbuf = mysql_create_custom_error(1, 0, "Authentication with backend "
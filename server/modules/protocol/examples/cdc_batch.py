@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2016 MariaDB Corporation Ab
+#
+# Use of this software is governed by the Business Source License included
+# in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+#
+# Change Date: 2019-07-01
+#
+# On the date above, in accordance with the Business Source License, use
+# of this software will be governed by version 2 or later of the General
+# Public License.
+
+#
+# This program reads the batched binary CDC format and prints the records
+# as JSON. It can also be used to compare the throughput of the JSON and
+# the BATCH formats.
+#
+
+import sys
+import time
+import json
+import socket
+import struct
+import hashlib
+import argparse
+import binascii
+
+FRAME_SCHEMA = 1
+FRAME_ROWS = 2
+
+
+class Reader:
+    """Decoder for Avro binary encoded data"""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def long(self):
+        shift = 0
+        value = 0
+        while True:
+            b = self.data[self.pos]
+            self.pos += 1
+            value |= (b & 0x7f) << shift
+            shift += 7
+            if b & 0x80 == 0:
+                break
+        return (value >> 1) ^ -(value & 1)
+
+    def fixed(self, size):
+        value = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return value
+
+    def read(self, field_type):
+        if isinstance(field_type, list):
+            # A union is encoded as the index of the branch followed by the
+            # value, nullable fields are unions with "null"
+            return self.read(field_type[self.long()])
+
+        if isinstance(field_type, dict):
+            if field_type["type"] == "enum":
+                return field_type["symbols"][self.long()]
+            return self.read(field_type["type"])
+
+        if field_type in ("int", "long"):
+            return self.long()
+        elif field_type == "float":
+            return struct.unpack("<f", self.fixed(4))[0]
+        elif field_type == "double":
+            return struct.unpack("<d", self.fixed(8))[0]
+        elif field_type == "string":
+            return self.fixed(self.long()).decode("utf_8", "replace")
+        elif field_type == "bytes":
+            return binascii.b2a_hex(self.fixed(self.long())).decode()
+        elif field_type == "boolean":
+            return self.fixed(1) != b'\x00'
+        elif field_type == "null":
+            return None
+        raise Exception("Unsupported Avro type: " + str(field_type))
+
+
+class Client:
+    """Connection to a CDC listener"""
+
+    def __init__(self, opts, data_format):
+        self.sock = socket.create_connection([opts.host, opts.port])
+        self.bytes = 0
+        self.buf = b''
+        self.last_read = time.time()
+
+        auth_string = binascii.b2a_hex((opts.user + ":").encode())
+        auth_string += bytes(hashlib.sha1(opts.password.encode("utf_8")).hexdigest().encode())
+        self.command(auth_string)
+        self.command(("REGISTER UUID=XXX-YYY_YYY, TYPE=" + data_format).encode())
+        self.sock.send(("REQUEST-DATA " + opts.FILE + (" " + opts.GTID if opts.GTID else "")).encode())
+
+    def command(self, cmd):
+        self.sock.send(cmd)
+        response = self.sock.recv(1024).decode()
+
+        if "err" in response.lower():
+            print(response.strip(), file=sys.stderr)
+            exit(1)
+
+    def fill(self, size):
+        while len(self.buf) < size:
+            try:
+                data = self.sock.recv(65536)
+            except socket.timeout:
+                # The stream has caught up with the Avro files
+                return False
+            if len(data) == 0:
+                return False
+            self.bytes += len(data)
+            self.buf += data
+            self.last_read = time.time()
+        return True
+
+    def frame(self):
+        """Read one frame, returns a tuple of frame type and payload"""
+        if not self.fill(5):
+            return None, None
+
+        length, frame_type = struct.unpack("<IB", self.buf[:5])
+
+        if not self.fill(5 + length):
+            return None, None
+
+        payload = self.buf[5:5 + length]
+        self.buf = self.buf[5 + length:]
+        return frame_type, payload
+
+    def line(self):
+        """Read one newline delimited JSON document"""
+        while b'\n' not in self.buf:
+            if not self.fill(len(self.buf) + 1):
+                return None
+        line, self.buf = self.buf.split(b'\n', 1)
+        return line
+
+
+def decode_rows(schema, payload):
+    count = struct.unpack("<I", payload[:4])[0]
+    reader = Reader(payload)
+    reader.pos = 4
+    rows = []
+
+    for i in range(count):
+        rows.append({f["name"]: reader.read(f["type"]) for f in schema["fields"]})
+
+    return rows
+
+
+def read_batch(opts, output):
+    client = Client(opts, "BATCH")
+    schema = None
+    rows = 0
+
+    while True:
+        frame_type, payload = client.frame()
+
+        if frame_type is None:
+            break
+        elif frame_type == FRAME_SCHEMA:
+            schema = json.loads(payload.decode())
+            if output:
+                print(json.dumps(schema))
+        elif frame_type == FRAME_ROWS:
+            if opts.decode or output:
+                for row in decode_rows(schema, payload):
+                    rows += 1
+                    if output:
+                        print(json.dumps(row))
+            else:
+                rows += struct.unpack("<I", payload[:4])[0]
+
+    return rows, client.bytes, client.last_read
+
+
+def read_json(opts):
+    client = Client(opts, "JSON")
+    rows = -1
+
+    while True:
+        line = client.line()
+
+        if line is None:
+            break
+
+        # The first document is the schema
+        json.loads(line.decode())
+        rows += 1
+
+    return rows, client.bytes, client.last_read
+
+
+def benchmark(name, func):
+    start = time.time()
+    rows, nbytes, end = func()
+    elapsed = max(end - start, 0.000001)
+    print("%-6s rows: %10d bytes: %12d rows/s: %12.0f bytes/s: %14.0f" %
+          (name, rows, nbytes, rows / elapsed, nbytes / elapsed))
+
+
+parser = argparse.ArgumentParser(description = "CDC batched binary format consumer", conflict_handler="resolve")
+parser.add_argument("-h", "--host", dest="host", help="Network address where the connection is made", default="localhost")
+parser.add_argument("-P", "--port", dest="port", help="Port where the connection is made", default="4001")
+parser.add_argument("-u", "--user", dest="user", help="Username used when connecting", default="")
+parser.add_argument("-p", "--password", dest="password", help="Password used when connecting", default="")
+parser.add_argument("-t", "--timeout", dest="read_timeout", help="Read timeout, the program exits when no data is read for this many seconds", default=0)
+parser.add_argument("-b", "--benchmark", dest="benchmark", action="store_true",
+                    help="Read the requested data in JSON and BATCH formats and print the throughput of both")
+parser.add_argument("-d", "--decode", dest="decode", action="store_true",
+                    help="Decode the records when benchmarking the BATCH format")
+parser.add_argument("FILE", help="Requested table name in the following format: DATABASE.TABLE[.VERSION]")
+parser.add_argument("GTID", help="Requested GTID position", default=None, nargs='?')
+
+opts = parser.parse_args(sys.argv[1:])
+
+if int(opts.read_timeout) > 0:
+    socket.setdefaulttimeout(int(opts.read_timeout))
+
+if opts.benchmark:
+    benchmark("JSON", lambda: read_json(opts))
+    benchmark("BATCH", lambda: read_batch(opts, False))
+else:
+    read_batch(opts, True)
@@ -82,6 +82,7 @@ static void clientReply(MXS_ROUTER *instance, MXS_ROUTER_SESSION *router_session
 static void errorReply(MXS_ROUTER *instance, MXS_ROUTER_SESSION *router_session, GWBUF *message,
                        DCB *backend_dcb, mxs_error_action_t action, bool *succp);
 static uint64_t getCapabilities(MXS_ROUTER* instance);
+static void destroyInstance(MXS_ROUTER* instance);
 extern int MaxScaleUptime();
 extern void avro_get_used_tables(AVRO_INSTANCE *router, DCB *dcb);
 void converter_func(void* data);
@@ -151,7 +152,7 @@ MXS_MODULE* MXS_CREATE_MODULE()
         clientReply,
         errorReply,
         getCapabilities,
-        NULL
+        destroyInstance
     };
 
     static MXS_MODULE info =
@@ -185,6 +186,7 @@ MXS_MODULE* MXS_CREATE_MODULE()
             {"group_trx", MXS_MODULE_PARAM_COUNT, "1"},
             {"start_index", MXS_MODULE_PARAM_COUNT, "1"},
             {"block_size", MXS_MODULE_PARAM_COUNT, "0"},
+            {"converter_threads", MXS_MODULE_PARAM_COUNT, "0"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -303,8 +305,18 @@ static bool conversion_task_ctl(AVRO_INSTANCE *inst, bool start)
  * @param inst Avro router instance
  * @param options The @c router_options of a binlogrouter instance
  */
-void read_source_service_options(AVRO_INSTANCE *inst, const char** options)
+/**
+ * @brief Read the binlog options of the source service
+ *
+ * @param inst    The router instance
+ * @param options Router options of the source service
+ * @return False if the source service compresses its binlog files as the
+ *         compressed files can not be converted
+ */
+bool read_source_service_options(AVRO_INSTANCE *inst, const char** options)
 {
+    bool rval = true;
+
     if (options)
     {
         for (int i = 0; options[i]; i++)
@@ -327,9 +339,15 @@ void read_source_service_options(AVRO_INSTANCE *inst, const char** options)
                 {
                     inst->fileroot = MXS_STRDUP_A(value);
                 }
+                else if (strcmp(option, "binlog_compression") == 0 && config_truth_value(value))
+                {
+                    rval = false;
+                }
             }
         }
     }
+
+    return rval;
 }
 
 /**
@@ -407,6 +425,11 @@ createInstance(SERVICE *service, char **options)
     inst->trx_target = config_get_integer(params, "group_trx");
     int first_file = config_get_integer(params, "start_index");
     inst->block_size = config_get_integer(params, "block_size");
+    inst->n_converters = MXS_MIN(config_get_integer(params, "converter_threads"),
+                                 AVRO_CONVERTER_MAX_THREADS);
+    inst->converters = NULL;
+    inst->current_trx = NULL;
+    inst->last_converter = -1;
 
     MXS_CONFIG_PARAMETER *param = config_get_param(params, "source");
     inst->gtid.domain = 0;
@@ -428,7 +451,16 @@ createInstance(SERVICE *service, char **options)
             {
                 MXS_NOTICE("[%s] Using configuration options from service '%s'.",
                            service->name, source->name);
-                read_source_service_options(inst, (const char**)source->routerOptions);
+                MXS_CONFIG_PARAMETER *compression = config_get_param(source->svc_config_param,
+                                                                      "binlog_compression");
+
+                if (!read_source_service_options(inst, (const char**)source->routerOptions) ||
+                    (compression && config_truth_value(compression->value)))
+                {
+                    MXS_ERROR("[%s] Service '%s' compresses its binlog files. The avrorouter "
+                              "can not read compressed binlog files.", service->name, source->name);
+                    err = true;
+                }
             }
             else
             {
@@ -603,6 +635,11 @@ createInstance(SERVICE *service, char **options)
     avro_load_conversion_state(inst);
     avro_load_metadata_from_schemas(inst);
 
+    if (inst->n_converters > 0)
+    {
+        avro_converters_start(inst);
+    }
+
     /*
      * Add tasks for statistic computation
      */
@@ -879,6 +916,8 @@ diagnostics(MXS_ROUTER *router, DCB *dcb)
     avro_get_used_tables(router_inst, dcb);
     dcb_printf(dcb, "\n");
 
+    avro_converters_diagnostics(router_inst, dcb);
+
     dcb_printf(dcb, "\tNumber of AVRO clients:              %u\n",
                router_inst->stats.n_clients);
 
@@ -1011,6 +1050,18 @@ static uint64_t getCapabilities(MXS_ROUTER* instance)
     return RCAP_TYPE_NO_RSESSION;
 }
 
+/**
+ * Stop the converter threads. The housekeeper, which runs the conversion
+ * task, has already been stopped so no new row events are dispatched.
+ *
+ * @param instance The router instance
+ */
+static void destroyInstance(MXS_ROUTER* instance)
+{
+    AVRO_INSTANCE *router = (AVRO_INSTANCE*)instance;
+    avro_converters_stop(router);
+}
+
 /**
  * The stats gathering function called from the housekeeper so that we
  * can get timed averages of binlog records shippped
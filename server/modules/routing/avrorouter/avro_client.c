@@ -49,7 +49,7 @@ extern uint32_t extract_field(uint8_t *src, int bits);
 static int avro_client_do_registration(AVRO_INSTANCE *, AVRO_CLIENT *, GWBUF *);
 int avro_client_callback(DCB *dcb, DCB_REASON reason, void *data);
 static void avro_client_process_command(AVRO_INSTANCE *router, AVRO_CLIENT *client, GWBUF *queue);
-static bool avro_client_stream_data(AVRO_CLIENT *client);
+static bool avro_client_stream_data(AVRO_CLIENT *client, bool *file_done);
 void avro_notify_client(AVRO_CLIENT *client);
 void poll_fake_write_event(DCB *dcb);
 GWBUF* read_avro_json_schema(const char *avrofile, const char* dir);
@@ -183,6 +183,14 @@ avro_client_do_registration(AVRO_INSTANCE *router, AVRO_CLIENT *client, GWBUF *d
                     client->state = AVRO_CLIENT_REGISTERED;
                     client->format = AVRO_FORMAT_JSON;
                 }
+                else if (memcmp(tmp_ptr + 5, "BATCH", 5) == 0)
+                {
+                    ret = 1;
+                    client->state = AVRO_CLIENT_REGISTERED;
+                    client->format = AVRO_FORMAT_BATCH;
+                    client->dcb->high_water = AVRO_BATCH_HIGH_WATER;
+                    client->dcb->low_water = AVRO_BATCH_LOW_WATER;
+                }
                 else
                 {
                     fprintf(stderr, "Registration TYPE not supported, only AVRO\n");
@@ -474,6 +482,13 @@ avro_client_process_command(AVRO_INSTANCE *router, AVRO_CLIENT *client, GWBUF *q
                 /* set callback routine for data sending */
                 dcb_add_callback(client->dcb, DCB_REASON_DRAINED, avro_client_callback, client);
 
+                if (client->format == AVRO_FORMAT_BATCH)
+                {
+                    /** Continue streaming as soon as the client has
+                     * consumed enough of the queued frames */
+                    dcb_add_callback(client->dcb, DCB_REASON_LOW_WATER, avro_client_callback, client);
+                }
+
                 /* Add fake event that will call the avro_client_callback() routine */
                 poll_fake_write_event(client->dcb);
             }
@@ -577,6 +592,44 @@ static int send_row(DCB *dcb, json_t* row)
     return rc;
 }
 
+/**
+ * @brief Send a batched frame to the client
+ *
+ * @param dcb Client DCB
+ * @param type Frame type
+ * @param header Frame type specific header or NULL for no header
+ * @param header_len Length of @c header
+ * @param payload Frame payload, freed by this function
+ * @return Return value of the DCB write function
+ */
+static int send_frame(DCB *dcb, uint8_t type, const uint8_t *header, size_t header_len,
+                      GWBUF *payload)
+{
+    int rc = 0;
+    uint32_t len = header_len + gwbuf_length(payload);
+    GWBUF *buf = gwbuf_alloc(CDC_FRAME_HEADER_LEN + header_len);
+
+    if (buf)
+    {
+        uint8_t *data = GWBUF_DATA(buf);
+        gw_mysql_set_byte4(data, len);
+        data[4] = type;
+
+        if (header_len)
+        {
+            memcpy(data + CDC_FRAME_HEADER_LEN, header, header_len);
+        }
+
+        rc = dcb->func.write(dcb, gwbuf_append(buf, payload));
+    }
+    else
+    {
+        gwbuf_free(payload);
+    }
+
+    return rc;
+}
+
 static void set_current_gtid(AVRO_CLIENT *client, json_t *row)
 {
     json_t *obj = json_object_get(row, avro_sequence);
@@ -653,6 +706,46 @@ static bool stream_binary(AVRO_CLIENT *client)
     return bytes >= AVRO_DATA_BURST_SIZE;
 }
 
+/**
+ * @brief Stream Avro data in batched binary frames
+ *
+ * All unread records of a data block are sent in one frame without decoding
+ * them. Streaming stops when the write queue of the client grows above the
+ * high water mark. The DCB_REASON_LOW_WATER callback continues it once the
+ * client has consumed enough of the queued data.
+ *
+ * @param client Client to stream to
+ * @param file_done Set to true if all blocks of the file were sent
+ * @return Always false, the client is notified by the DCB callbacks
+ */
+static bool stream_batch(AVRO_CLIENT *client, bool *file_done)
+{
+    MAXAVRO_FILE *file = client->file_handle;
+    DCB *dcb = client->dcb;
+    bool more_blocks = true;
+    int rc = 1;
+
+    do
+    {
+        uint64_t records;
+        GWBUF *rows = maxavro_record_read_batch(file, &records);
+
+        if (rows)
+        {
+            uint8_t count[4];
+            gw_mysql_set_byte4(count, records);
+            rc = send_frame(dcb, CDC_FRAME_ROWS, count, sizeof(count), rows);
+            client->stats.n_events += records;
+            client->stats.n_bytes += gwbuf_length(rows);
+        }
+    }
+    while (rc > 0 && !DCB_ABOVE_HIGH_WATER(dcb) && (more_blocks = maxavro_next_block(file)));
+
+    *file_done = rc > 0 && !more_blocks;
+
+    return false;
+}
+
 static int sqlite_cb(void* data, int rows, char** values, char** names)
 {
     for (int i = 0; i < rows; i++)
@@ -671,6 +764,15 @@ static const char select_template[] = "SELECT max(position) FROM gtid WHERE doma
 
 static bool seek_to_index_pos(AVRO_CLIENT *client, MAXAVRO_FILE* file)
 {
+    long pos;
+    uint64_t record;
+
+    /** The GTID index points directly to the first record of the GTID */
+    if (avro_gtid_index_find(file->filename, &client->gtid, &pos, &record))
+    {
+        return maxavro_record_set_pos(file, pos) && maxavro_record_seek(file, record);
+    }
+
     char *name = strrchr(client->file_handle->filename, '/');
     ss_dassert(name);
     name++;
@@ -712,6 +814,8 @@ static bool seek_to_gtid(AVRO_CLIENT *client, MAXAVRO_FILE* file)
     do
     {
         json_t *row;
+        long pos = maxavro_record_tell(file);
+
         while ((row = maxavro_record_read_json(file)))
         {
             json_t *obj = json_object_get(row, avro_sequence);
@@ -742,13 +846,22 @@ static bool seek_to_gtid(AVRO_CLIENT *client, MAXAVRO_FILE* file)
             }
 
             /** We'll send the first found row immediately since we have already
-             * read the row into memory */
+             * read the row into memory. Batched frames contain the records in
+             * their binary form so the record is read again. */
             if (!seeking)
             {
+                if (client->format == AVRO_FORMAT_BATCH)
+                {
+                    maxavro_record_unread(file, pos);
+                    json_decref(row);
+                    break;
+                }
+
                 send_row(client->dcb, row);
             }
 
             json_decref(row);
+            pos = maxavro_record_tell(file);
         }
     }
     while (seeking && maxavro_next_block(file));
@@ -762,11 +875,14 @@ static bool seek_to_gtid(AVRO_CLIENT *client, MAXAVRO_FILE* file)
  * @param router     The router instance
  * @param client     The specific client data
  * @param avro_file  The requested AVRO file
+ * @param file_done  Set to false if the client can't be rotated to the next
+ *                   file because the current one has not been fully sent
  * @return True if more data needs to be read
  */
-static bool avro_client_stream_data(AVRO_CLIENT *client)
+static bool avro_client_stream_data(AVRO_CLIENT *client, bool *file_done)
 {
     bool read_more = false;
+    *file_done = true;
     AVRO_INSTANCE *router = client->router;
 
     if (strnlen(client->avro_binfile, 1))
@@ -786,17 +902,17 @@ static bool avro_client_stream_data(AVRO_CLIENT *client)
 
         if (ok)
         {
+            /** The native Avro format does not support seeking to a GTID */
+            if (client->format != AVRO_FORMAT_AVRO && client->requested_gtid &&
+                seek_to_index_pos(client, client->file_handle) &&
+                seek_to_gtid(client, client->file_handle))
+            {
+                client->requested_gtid = false;
+            }
+
             switch (client->format)
             {
             case AVRO_FORMAT_JSON:
-                /** Currently only JSON format supports seeking to a GTID */
-                if (client->requested_gtid &&
-                    seek_to_index_pos(client, client->file_handle) &&
-                    seek_to_gtid(client, client->file_handle))
-                {
-                    client->requested_gtid = false;
-                }
-
                 read_more = stream_json(client);
                 break;
 
@@ -804,6 +920,10 @@ static bool avro_client_stream_data(AVRO_CLIENT *client)
                 read_more = stream_binary(client);
                 break;
 
+            case AVRO_FORMAT_BATCH:
+                read_more = stream_batch(client, file_done);
+                break;
+
             default:
                 MXS_ERROR("Unexpected format: %d", client->format);
                 break;
@@ -973,7 +1093,7 @@ static void print_next_filename(const char *file, const char *dir, char *dest, s
  */
 int avro_client_callback(DCB *dcb, DCB_REASON reason, void *userdata)
 {
-    if (reason == DCB_REASON_DRAINED)
+    if (reason == DCB_REASON_DRAINED || reason == DCB_REASON_LOW_WATER)
     {
         AVRO_CLIENT *client = (AVRO_CLIENT*)userdata;
 
@@ -998,6 +1118,14 @@ int avro_client_callback(DCB *dcb, DCB_REASON reason, void *userdata)
                 schema = read_avro_json_schema(client->avro_binfile, client->router->avrodir);
                 break;
 
+            case AVRO_FORMAT_BATCH:
+                if ((schema = read_avro_json_schema(client->avro_binfile, client->router->avrodir)))
+                {
+                    send_frame(client->dcb, CDC_FRAME_SCHEMA, NULL, 0, schema);
+                    schema = NULL;
+                }
+                break;
+
             case AVRO_FORMAT_AVRO:
                 schema = read_avro_binary_schema(client->avro_binfile, client->router->avrodir);
                 break;
@@ -1013,15 +1141,18 @@ int avro_client_callback(DCB *dcb, DCB_REASON reason, void *userdata)
         }
 
         /** Stream the data to the client */
-        bool read_more = avro_client_stream_data(client);
+        bool file_done;
+        bool read_more = avro_client_stream_data(client, &file_done);
 
         char filename[PATH_MAX + 1];
         print_next_filename(client->avro_binfile, client->router->avrodir,
                             filename, sizeof(filename));
 
         bool next_file;
-        /** If the next file is available, send it to the client */
-        if ((next_file = (access(filename, R_OK) == 0)))
+        /** If the next file is available, send it to the client. Batched
+         * streaming can stop before the end of the current file has been
+         * reached, either above the high water mark or after a failed write. */
+        if ((next_file = (file_done && access(filename, R_OK) == 0)))
         {
             rotate_avro_file(client, filename);
         }
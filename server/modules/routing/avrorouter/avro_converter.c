@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file avro_converter.c - Parallel conversion of row events
+ *
+ * The thread that reads the binlog parses all events and keeps track of the
+ * table metadata. The row events are handed over to a pool of converter
+ * threads which convert them into Avro records. Each table is always assigned
+ * to the same converter which means that the rows of a table are written in
+ * the order they appear in the binlog.
+ *
+ * The converters are drained before the table metadata is modified and before
+ * a checkpoint is made. This guarantees that the stored conversion state
+ * always matches the data in the Avro files.
+ */
+
+#include "avrorouter.h"
+
+#include <time.h>
+#include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
+#include <maxscale/log_manager.h>
+
+/**
+ * @brief Get monotonic time in nanoseconds
+ *
+ * @return Current monotonic time
+ */
+uint64_t avro_monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void trx_release(AVRO_TRX *trx)
+{
+    if (trx && atomic_add(&trx->refcount, -1) == 1)
+    {
+        MXS_FREE(trx);
+    }
+}
+
+static inline bool is_same_trx(const gtid_pos_t *a, const gtid_pos_t *b)
+{
+    return a->domain == b->domain && a->server_id == b->server_id && a->seq == b->seq;
+}
+
+/**
+ * @brief Wait until a converter has at most @c limit jobs queued
+ *
+ * @param conv Converter to wait for
+ * @param limit Maximum number of queued jobs, 0 waits until the converter is idle
+ */
+static void converter_wait(AVRO_CONVERTER *conv, int limit)
+{
+    pthread_mutex_lock(&conv->lock);
+
+    while (conv->queued > limit)
+    {
+        pthread_cond_wait(&conv->done, &conv->lock);
+    }
+
+    pthread_mutex_unlock(&conv->lock);
+}
+
+/**
+ * The converter thread main loop
+ *
+ * @param data The converter
+ */
+static void converter_main(void *data)
+{
+    AVRO_CONVERTER *conv = (AVRO_CONVERTER*)data;
+
+    pthread_mutex_lock(&conv->lock);
+
+    while (true)
+    {
+        uint64_t wait_start = avro_monotonic_ns();
+
+        while (conv->head == NULL && !conv->shutdown)
+        {
+            pthread_cond_wait(&conv->work, &conv->lock);
+        }
+
+        if (conv->head == NULL)
+        {
+            break;
+        }
+
+        AVRO_ROW_JOB *job = conv->head;
+        conv->head = job->next;
+
+        if (conv->head == NULL)
+        {
+            conv->tail = NULL;
+        }
+
+        conv->busy = true;
+        pthread_mutex_unlock(&conv->lock);
+
+        uint64_t start = avro_monotonic_ns();
+        int records = convert_row_event(&job->trx->gtid, &job->hdr, job->pos, job->map,
+                                        job->table, GWBUF_DATA(job->event), job->rows,
+                                        job->col_present);
+        uint64_t end = avro_monotonic_ns();
+        uint32_t bytes = job->hdr.event_size;
+
+        trx_release(job->trx);
+        gwbuf_free(job->event);
+        MXS_FREE(job);
+
+        pthread_mutex_lock(&conv->lock);
+        conv->stats.events++;
+        conv->stats.records += records;
+        conv->stats.bytes += bytes;
+        conv->stats.busy_ns += end - start;
+        conv->stats.wait_ns += start - wait_start;
+        conv->busy = false;
+        conv->queued--;
+        pthread_cond_broadcast(&conv->done);
+    }
+
+    pthread_mutex_unlock(&conv->lock);
+}
+
+/**
+ * @brief Start the converter threads
+ *
+ * If not all of the threads can be started, the router uses the ones that
+ * were started. If no threads could be started, the rows are converted by
+ * the thread that reads the binlog.
+ *
+ * @param router Router instance with @c n_converters set
+ * @return True if all converter threads were started
+ */
+bool avro_converters_start(AVRO_INSTANCE *router)
+{
+    int wanted = router->n_converters;
+    router->n_converters = 0;
+    router->current_trx = NULL;
+    router->last_converter = -1;
+
+    if ((router->converters = MXS_CALLOC(wanted, sizeof(AVRO_CONVERTER))) == NULL)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < wanted; i++)
+    {
+        AVRO_CONVERTER *conv = &router->converters[i];
+        conv->router = router;
+        conv->id = i;
+        pthread_mutex_init(&conv->lock, NULL);
+        pthread_cond_init(&conv->work, NULL);
+        pthread_cond_init(&conv->done, NULL);
+
+        if (thread_start(&conv->thread, converter_main, conv) == NULL)
+        {
+            MXS_ERROR("[%s] Failed to start converter thread %d, using %d converter threads.",
+                      router->service->name, i, router->n_converters);
+            pthread_mutex_destroy(&conv->lock);
+            pthread_cond_destroy(&conv->work);
+            pthread_cond_destroy(&conv->done);
+            break;
+        }
+
+        router->n_converters++;
+    }
+
+    MXS_NOTICE("[%s] Converting row events with %d converter threads.",
+               router->service->name, router->n_converters);
+
+    return router->n_converters == wanted;
+}
+
+/**
+ * @brief Queue a row event to the converter that owns the table
+ *
+ * The event numbers of a transaction are assigned in the order the rows
+ * appear in the binlog. When the rows of a transaction move from one
+ * converter to another, the previous converter is allowed to finish before
+ * the new event is queued.
+ *
+ * @param router Router instance
+ * @param job Row event to convert, the converter takes ownership of it
+ * @param table_ident Table identifier in `db.table` format
+ */
+void avro_converter_dispatch(AVRO_INSTANCE *router, AVRO_ROW_JOB *job, const char *table_ident)
+{
+    ss_dassert(router->n_converters > 0);
+    uint64_t start = avro_monotonic_ns();
+
+    if (router->current_trx == NULL || !is_same_trx(&router->current_trx->gtid, &router->gtid))
+    {
+        trx_release(router->current_trx);
+        AVRO_TRX *trx = MXS_MALLOC(sizeof(AVRO_TRX));
+        MXS_ABORT_IF_NULL(trx);
+        trx->gtid = router->gtid;
+        trx->refcount = 1;
+        router->current_trx = trx;
+        router->last_converter = -1;
+    }
+
+    int id = (unsigned int)hashtable_item_strhash(table_ident) % router->n_converters;
+
+    if (router->last_converter != -1 && router->last_converter != id)
+    {
+        converter_wait(&router->converters[router->last_converter], 0);
+    }
+
+    router->last_converter = id;
+    atomic_add(&router->current_trx->refcount, 1);
+    job->trx = router->current_trx;
+    job->next = NULL;
+
+    AVRO_CONVERTER *conv = &router->converters[id];
+    pthread_mutex_lock(&conv->lock);
+
+    while (conv->queued >= AVRO_CONVERTER_QUEUE_MAX)
+    {
+        pthread_cond_wait(&conv->done, &conv->lock);
+    }
+
+    if (conv->tail)
+    {
+        conv->tail->next = job;
+    }
+    else
+    {
+        conv->head = job;
+    }
+
+    conv->tail = job;
+    conv->queued++;
+    pthread_cond_signal(&conv->work);
+    pthread_mutex_unlock(&conv->lock);
+
+    router->reader_stats.wait_ns += avro_monotonic_ns() - start;
+}
+
+/**
+ * @brief Wait until all queued row events have been converted
+ *
+ * This must be called before the table maps, table definitions or open Avro
+ * files are modified and before the Avro files are flushed.
+ *
+ * @param router Router instance
+ */
+void avro_converters_drain(AVRO_INSTANCE *router)
+{
+    if (router->n_converters > 0)
+    {
+        uint64_t start = avro_monotonic_ns();
+
+        for (int i = 0; i < router->n_converters; i++)
+        {
+            converter_wait(&router->converters[i], 0);
+        }
+
+        if (router->current_trx && is_same_trx(&router->current_trx->gtid, &router->gtid))
+        {
+            router->gtid.event_num = router->current_trx->gtid.event_num;
+        }
+
+        router->reader_stats.wait_ns += avro_monotonic_ns() - start;
+    }
+}
+
+/**
+ * @brief Stop the converter threads
+ *
+ * The queued row events are converted before the threads exit. The reading
+ * thread must not dispatch events while the converters are stopped.
+ *
+ * @param router Router instance
+ */
+void avro_converters_stop(AVRO_INSTANCE *router)
+{
+    for (int i = 0; i < router->n_converters; i++)
+    {
+        AVRO_CONVERTER *conv = &router->converters[i];
+
+        pthread_mutex_lock(&conv->lock);
+        conv->shutdown = true;
+        pthread_cond_signal(&conv->work);
+        pthread_mutex_unlock(&conv->lock);
+
+        thread_wait(conv->thread);
+
+        pthread_mutex_destroy(&conv->lock);
+        pthread_cond_destroy(&conv->work);
+        pthread_cond_destroy(&conv->done);
+    }
+
+    trx_release(router->current_trx);
+    router->current_trx = NULL;
+    router->last_converter = -1;
+    router->n_converters = 0;
+    MXS_FREE(router->converters);
+    router->converters = NULL;
+}
+
+static double per_second(uint64_t count, uint64_t ns)
+{
+    return ns ? count / (ns / 1000000000.0) : 0.0;
+}
+
+/**
+ * @brief Print conversion pipeline statistics
+ *
+ * @param router Router instance
+ * @param dcb DCB where the statistics are printed
+ */
+void avro_converters_diagnostics(AVRO_INSTANCE *router, DCB *dcb)
+{
+    AVRO_STAGE_STATS *rs = &router->reader_stats;
+    uint64_t reader_ns = rs->busy_ns > rs->wait_ns ? rs->busy_ns - rs->wait_ns : 0;
+
+    dcb_printf(dcb, "\tConverter threads:                   %d\n", router->n_converters);
+    dcb_printf(dcb, "\tBinlog reader events:                %lu\n", rs->events);
+    dcb_printf(dcb, "\tBinlog reader bytes:                 %lu\n", rs->bytes);
+    dcb_printf(dcb, "\tBinlog reader events/second:         %.0f\n",
+               per_second(rs->events, reader_ns));
+    dcb_printf(dcb, "\tBinlog reader wait time (seconds):   %.3f\n", rs->wait_ns / 1000000000.0);
+
+    if (router->n_converters == 0)
+    {
+        dcb_printf(dcb, "\tRecords written:                     %lu\n", rs->records);
+    }
+
+    for (int i = 0; i < router->n_converters; i++)
+    {
+        AVRO_CONVERTER *conv = &router->converters[i];
+
+        pthread_mutex_lock(&conv->lock);
+        AVRO_STAGE_STATS stats = conv->stats;
+        int queued = conv->queued;
+        pthread_mutex_unlock(&conv->lock);
+
+        dcb_printf(dcb, "\tConverter %d:\n", i);
+        dcb_printf(dcb, "\t\tQueued row events:           %d\n", queued);
+        dcb_printf(dcb, "\t\tConverted row events:        %lu\n", stats.events);
+        dcb_printf(dcb, "\t\tRecords written:             %lu\n", stats.records);
+        dcb_printf(dcb, "\t\tRecords/second:              %.0f\n",
+                   per_second(stats.records, stats.busy_ns));
+        dcb_printf(dcb, "\t\tBytes/second:                %.0f\n",
+                   per_second(stats.bytes, stats.busy_ns));
+        dcb_printf(dcb, "\t\tIdle time (seconds):         %.3f\n", stats.wait_ns / 1000000000.0);
+    }
+}
@@ -68,12 +68,21 @@ bool avro_open_binlog(const char *binlogdir, const char *file, int *dest)
 
     if ((fd = open(path, O_RDONLY)) == -1)
     {
+        char zpath[PATH_MAX + 1];
+        snprintf(zpath, sizeof(zpath), "%s" BINLOG_COMPRESSED_SUFFIX, path);
+
         if (errno != ENOENT)
         {
             char err[MXS_STRERROR_BUFLEN];
             MXS_ERROR("Failed to open binlog file %s: %d, %s", path, errno,
                       strerror_r(errno, err, sizeof(err)));
         }
+        else if (access(zpath, F_OK) == 0)
+        {
+            MXS_ERROR("Binlog file %s has been compressed by the binlogrouter. Compressed "
+                      "binlog files can not be converted, disable 'binlog_compression' or "
+                      "increase 'binlog_compression_keep'.", path);
+        }
         return false;
     }
 
@@ -478,6 +487,7 @@ void notify_all_clients(AVRO_INSTANCE *router)
 
 void do_checkpoint(AVRO_INSTANCE *router, uint64_t *total_rows, uint64_t *total_commits)
 {
+    avro_converters_drain(router);
     update_used_tables(router);
     avro_flush_all_tables(router, AVROROUTER_FLUSH);
     avro_save_conversion_state(router);
@@ -493,12 +503,10 @@ void do_checkpoint(AVRO_INSTANCE *router, uint64_t *total_rows, uint64_t *total_
  * Routine detects errors and pending transactions
  *
  * @param router        The router instance
- * @param fix           Whether to fix or not errors
- * @param debug         Whether to enable or not the debug for events
  * @return              How the binlog was closed
  * @see enum avro_binlog_end
  */
-avro_binlog_end_t avro_read_all_events(AVRO_INSTANCE *router)
+static avro_binlog_end_t read_all_events(AVRO_INSTANCE *router)
 {
     uint8_t hdbuf[BINLOG_EVENT_HDR_LEN];
     unsigned long long pos = router->current_pos;
@@ -627,6 +635,9 @@ avro_binlog_end_t avro_read_all_events(AVRO_INSTANCE *router)
             return AVRO_BINLOG_ERROR;
         }
 
+        router->reader_stats.events++;
+        router->reader_stats.bytes += hdr.event_size;
+
         /* check for pending transaction */
         if (pending_transaction == 0)
         {
@@ -687,7 +698,7 @@ avro_binlog_end_t avro_read_all_events(AVRO_INSTANCE *router)
                  (hdr.event_type >= WRITE_ROWS_EVENTv2 && hdr.event_type <= DELETE_ROWS_EVENTv2))
         {
             router->row_count++;
-            handle_row_event(router, &hdr, ptr);
+            handle_row_event(router, &hdr, result);
         }
         /* Decode ROTATE EVENT */
         else if (hdr.event_type == ROTATE_EVENT)
@@ -794,6 +805,25 @@ avro_binlog_end_t avro_read_all_events(AVRO_INSTANCE *router)
     return AVRO_BINLOG_ERROR;
 }
 
+/**
+ * @brief Read all replication events from a binlog file.
+ *
+ * All row events read from the binlog are converted into Avro records before
+ * this function returns.
+ *
+ * @param router        The router instance
+ * @return              How the binlog was closed
+ * @see enum avro_binlog_end
+ */
+avro_binlog_end_t avro_read_all_events(AVRO_INSTANCE *router)
+{
+    uint64_t start = avro_monotonic_ns();
+    avro_binlog_end_t rval = read_all_events(router);
+    avro_converters_drain(router);
+    router->reader_stats.busy_ns += avro_monotonic_ns() - start;
+    return rval;
+}
+
 /**
  * Read the field names from the stored Avro schemas
  *
@@ -1033,6 +1063,7 @@ void handle_query_event(AVRO_INSTANCE *router, REP_HEADER *hdr, int *pending_tra
     if (is_create_table_statement(router, sql, len))
     {
         TABLE_CREATE *created = NULL;
+        avro_converters_drain(router);
 
         if (is_create_like_statement(sql, len))
         {
@@ -1077,7 +1108,16 @@ void handle_query_event(AVRO_INSTANCE *router, REP_HEADER *hdr, int *pending_tra
 
         if (created)
         {
+            avro_converters_drain(router);
             table_create_alter(created, sql, sql + len);
+
+            /** The field indexes of the old table version are no longer valid */
+            TABLE_MAP *map = hashtable_fetch(router->table_maps, full_ident);
+
+            if (map)
+            {
+                table_map_invalidate_fields(map);
+            }
         }
         else
         {
@@ -21,7 +21,10 @@
  * seeking to the offset of the file and reading the record instead of iterating
  * through all the records and looking for a matching record.
  *
- * The index is stored as an SQLite3 database.
+ * The index is stored as an SQLite3 database. In addition to this, each Avro
+ * file has a GTID index file next to it which stores the data block and record
+ * number of every GTID in the file. Clients memory map it and binary search it
+ * to find the exact starting position of a GTID.
  *
  * @verbatim
  * Revision History
@@ -36,6 +39,9 @@
 
 #include <maxscale/debug.h>
 #include <glob.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 void* safe_key_free(void *data);
 
@@ -70,6 +76,415 @@ int index_query_cb(void *data, int rows, char** values, char** names)
     return 0;
 }
 
+/** Number of GTID index entries that are buffered before they are written */
+#define GTID_INDEX_BATCH 256
+
+typedef struct gtid_index_writer
+{
+    int                   fd;
+    uint64_t              n_written; /*< Number of entries written to the file */
+    uint64_t              n_sorted;  /*< Length of the sorted prefix, including buffered entries */
+    bool                  sorted;    /*< Whether all entries belong to the sorted prefix */
+    uint64_t              indexed_pos; /*< Position up to which all entries are written */
+    bool                  lost;      /*< Whether entries were lost in a failed write */
+    AVRO_GTID_INDEX_ENTRY last;
+    int                   n_entries;
+    AVRO_GTID_INDEX_ENTRY entries[GTID_INDEX_BATCH];
+} GTID_INDEX_WRITER;
+
+static void gtid_index_filename(const char *avrofile, char *dest, size_t size)
+{
+    snprintf(dest, size, "%s%s", avrofile, AVRO_GTID_INDEX_SUFFIX);
+}
+
+static bool gtid_index_header_ok(const AVRO_GTID_INDEX_HEADER *hdr)
+{
+    return memcmp(hdr->magic, AVRO_GTID_INDEX_MAGIC, sizeof(AVRO_GTID_INDEX_MAGIC)) == 0 &&
+           hdr->version == AVRO_GTID_INDEX_VERSION;
+}
+
+/**
+ * @brief Publish the number of written and sorted entries in the index header
+ *
+ * This is called only after the entries have been written so that the
+ * readers never see entries that are not yet complete.
+ *
+ * @param writer Index writer
+ * @return True if the header was updated
+ */
+static bool gtid_index_publish(GTID_INDEX_WRITER *writer)
+{
+    uint64_t counts[3] = {writer->n_written, MXS_MIN(writer->n_sorted, writer->n_written),
+                          writer->indexed_pos};
+    ss_dassert(offsetof(AVRO_GTID_INDEX_HEADER, n_sorted) ==
+               offsetof(AVRO_GTID_INDEX_HEADER, n_entries) + sizeof(uint64_t));
+    ss_dassert(offsetof(AVRO_GTID_INDEX_HEADER, indexed_pos) ==
+               offsetof(AVRO_GTID_INDEX_HEADER, n_sorted) + sizeof(uint64_t));
+
+    if (pwrite(writer->fd, counts, sizeof(counts),
+               offsetof(AVRO_GTID_INDEX_HEADER, n_entries)) != sizeof(counts))
+    {
+        char err[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to write GTID index header: %d, %s", errno,
+                  strerror_r(errno, err, sizeof(err)));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Replace the GTID index with a copy of its first entries
+ *
+ * Clients map the whole index file so it must never be shrunk in place. The
+ * kept entries are copied into a new file which is renamed over the old one.
+ * The clients that still map the old file keep on using it.
+ *
+ * @param writer Index writer with the counts of the kept entries
+ * @param path Path to the GTID index file
+ * @param hdr Header of the index
+ * @return True if the index was replaced, the new file is stored in the writer
+ */
+static bool gtid_index_rewrite(GTID_INDEX_WRITER *writer, const char *path,
+                               AVRO_GTID_INDEX_HEADER *hdr)
+{
+    char tmp[PATH_MAX + 1];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    bool rval = fd != -1;
+
+    hdr->n_entries = writer->n_written;
+    hdr->n_sorted = writer->n_sorted;
+    hdr->indexed_pos = writer->indexed_pos;
+
+    if (rval && write(fd, hdr, sizeof(*hdr)) != sizeof(*hdr))
+    {
+        rval = false;
+    }
+
+    for (uint64_t i = 0; rval && i < writer->n_written; i += GTID_INDEX_BATCH)
+    {
+        size_t len = MXS_MIN(writer->n_written - i, GTID_INDEX_BATCH) * sizeof(AVRO_GTID_INDEX_ENTRY);
+
+        off_t offset = sizeof(*hdr) + i * sizeof(AVRO_GTID_INDEX_ENTRY);
+
+        if (pread(writer->fd, writer->entries, len, offset) != (ssize_t)len ||
+            write(fd, writer->entries, len) != (ssize_t)len)
+        {
+            rval = false;
+        }
+    }
+
+    if (rval && rename(tmp, path) != 0)
+    {
+        rval = false;
+    }
+
+    if (!rval)
+    {
+        char err[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to rewrite GTID index file '%s': %d, %s", path, errno,
+                  strerror_r(errno, err, sizeof(err)));
+
+        if (fd != -1)
+        {
+            close(fd);
+            unlink(tmp);
+        }
+
+        fd = -1;
+    }
+
+    close(writer->fd);
+    writer->fd = fd;
+
+    return rval;
+}
+
+/**
+ * @brief Open the GTID index of an Avro file for appending
+ *
+ * Indexing continues from @c resume_pos, the position stored in the SQLite
+ * index. If the GTID index is behind it, @c resume_pos is moved back to the
+ * end of the GTID index so that the missing entries are added. Entries that
+ * point to data blocks at or after @c resume_pos are removed as those blocks
+ * will be indexed again. A missing or invalid index is recreated in which
+ * case @c resume_pos is set to zero.
+ *
+ * @param writer Writer to initialize
+ * @param filename Path to the Avro file
+ * @param resume_pos Position where indexing continues
+ * @return True if the index was opened
+ */
+static bool gtid_index_open(GTID_INDEX_WRITER *writer, const char *filename, long *resume_pos)
+{
+    char path[PATH_MAX + 1];
+    gtid_index_filename(filename, path, sizeof(path));
+    memset(writer, 0, sizeof(*writer));
+
+    if ((writer->fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) == -1)
+    {
+        char err[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to open GTID index file '%s': %d, %s", path, errno,
+                  strerror_r(errno, err, sizeof(err)));
+        return false;
+    }
+
+    AVRO_GTID_INDEX_HEADER hdr;
+    struct stat st;
+    off_t size = fstat(writer->fd, &st) == 0 ? st.st_size : 0;
+    bool valid = size >= (off_t)sizeof(hdr) &&
+                 pread(writer->fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) &&
+                 gtid_index_header_ok(&hdr);
+    off_t n_entries = 0;
+
+    if (*resume_pos < 0)
+    {
+        *resume_pos = 0;
+    }
+
+    if (valid)
+    {
+        /** Only the published entries are complete */
+        n_entries = (size - sizeof(hdr)) / sizeof(AVRO_GTID_INDEX_ENTRY);
+
+        if ((uint64_t)n_entries > hdr.n_entries)
+        {
+            n_entries = hdr.n_entries;
+        }
+
+        if ((uint64_t)*resume_pos > hdr.indexed_pos)
+        {
+            /** The GTID index is behind */
+            *resume_pos = hdr.indexed_pos;
+        }
+    }
+    else
+    {
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, AVRO_GTID_INDEX_MAGIC, sizeof(AVRO_GTID_INDEX_MAGIC));
+        hdr.version = AVRO_GTID_INDEX_VERSION;
+        *resume_pos = 0;
+    }
+
+    /** Drop the entries of the blocks that will be indexed again */
+    while (n_entries > 0)
+    {
+        off_t offset = sizeof(hdr) + (n_entries - 1) * sizeof(AVRO_GTID_INDEX_ENTRY);
+
+        if (pread(writer->fd, &writer->last, sizeof(writer->last), offset) != sizeof(writer->last))
+        {
+            n_entries = 0;
+            *resume_pos = 0;
+        }
+        else if (*resume_pos > 0 && writer->last.pos < (uint64_t)*resume_pos)
+        {
+            break;
+        }
+        else
+        {
+            n_entries--;
+        }
+    }
+
+    if (n_entries == 0)
+    {
+        memset(&writer->last, 0, sizeof(writer->last));
+    }
+
+    writer->n_written = n_entries;
+    writer->n_sorted = MXS_MIN(hdr.n_sorted, (uint64_t)n_entries);
+    writer->sorted = writer->n_sorted == writer->n_written;
+    writer->indexed_pos = *resume_pos;
+    off_t new_size = sizeof(hdr) + n_entries * sizeof(AVRO_GTID_INDEX_ENTRY);
+
+    if (!valid || new_size != size)
+    {
+        return gtid_index_rewrite(writer, path, &hdr);
+    }
+
+    if (!gtid_index_publish(writer) || lseek(writer->fd, size, SEEK_SET) != size)
+    {
+        char err[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to open GTID index file '%s' for appending: %d, %s", path, errno,
+                  strerror_r(errno, err, sizeof(err)));
+        close(writer->fd);
+        return false;
+    }
+
+    return true;
+}
+
+static void gtid_index_flush(GTID_INDEX_WRITER *writer)
+{
+    size_t len = writer->n_entries * sizeof(AVRO_GTID_INDEX_ENTRY);
+
+    if (len && write(writer->fd, writer->entries, len) != (ssize_t)len)
+    {
+        char err[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("Failed to write GTID index: %d, %s", errno,
+                  strerror_r(errno, err, sizeof(err)));
+
+        /** The lost entries are never published, continue after the last
+         * published entry and stop extending the sorted prefix */
+        lseek(writer->fd, sizeof(AVRO_GTID_INDEX_HEADER) +
+              writer->n_written * sizeof(AVRO_GTID_INDEX_ENTRY), SEEK_SET);
+        writer->n_sorted = MXS_MIN(writer->n_sorted, writer->n_written);
+        writer->sorted = false;
+        writer->lost = true;
+    }
+    else
+    {
+        writer->n_written += writer->n_entries;
+        gtid_index_publish(writer);
+    }
+
+    writer->n_entries = 0;
+}
+
+static void gtid_index_add(GTID_INDEX_WRITER *writer, gtid_pos_t *gtid, long pos, uint64_t record)
+{
+    AVRO_GTID_INDEX_ENTRY *entry = &writer->entries[writer->n_entries++];
+    entry->domain = gtid->domain;
+    entry->server_id = gtid->server_id;
+    entry->seq = gtid->seq;
+    entry->pos = pos;
+    entry->record = record;
+
+    if (entry->seq < writer->last.seq)
+    {
+        writer->sorted = false;
+    }
+    else if (writer->sorted)
+    {
+        writer->n_sorted++;
+    }
+
+    writer->last = *entry;
+
+    if (writer->n_entries == GTID_INDEX_BATCH)
+    {
+        gtid_index_flush(writer);
+    }
+}
+
+/**
+ * @brief Write the buffered entries and close the GTID index
+ *
+ * @param writer Index writer
+ * @param indexed_pos Position up to which the Avro file was indexed
+ */
+static void gtid_index_close(GTID_INDEX_WRITER *writer, uint64_t indexed_pos)
+{
+    gtid_index_flush(writer);
+
+    /** If entries were lost, the blocks after the old position are indexed
+     * again the next time */
+    if (!writer->lost)
+    {
+        writer->indexed_pos = indexed_pos;
+        gtid_index_publish(writer);
+    }
+
+    close(writer->fd);
+}
+
+static inline bool is_same_source(const AVRO_GTID_INDEX_ENTRY *entry, const gtid_pos_t *gtid)
+{
+    return entry->domain == gtid->domain && entry->server_id == gtid->server_id;
+}
+
+/**
+ * @brief Find the position of a GTID from the GTID index of an Avro file
+ *
+ * The position of the first GTID from the same domain and server that is
+ * equal to or larger than the requested one is returned. If no such GTID is
+ * indexed, the position of the last indexed GTID is returned as the rest of
+ * the file has not yet been indexed.
+ *
+ * @param avrofile Path to the Avro file
+ * @param gtid GTID to find
+ * @param pos The data block position is stored here
+ * @param record Number of the record inside the data block is stored here
+ * @return True if a position was found, false if the file has no usable index
+ */
+bool avro_gtid_index_find(const char *avrofile, const gtid_pos_t *gtid, long *pos, uint64_t *record)
+{
+    char path[PATH_MAX + 1];
+    gtid_index_filename(avrofile, path, sizeof(path));
+    bool rval = false;
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 &&
+        st.st_size >= (off_t)(sizeof(AVRO_GTID_INDEX_HEADER) + sizeof(AVRO_GTID_INDEX_ENTRY)))
+    {
+        /** The index file is only appended to, the indexing task replaces
+         * it with a new file instead of shrinking it */
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            const AVRO_GTID_INDEX_HEADER *hdr = (const AVRO_GTID_INDEX_HEADER*)map;
+            const AVRO_GTID_INDEX_ENTRY *entries = (const AVRO_GTID_INDEX_ENTRY*)(hdr + 1);
+            size_t n = (st.st_size - sizeof(*hdr)) / sizeof(AVRO_GTID_INDEX_ENTRY);
+
+            /** Only the published entries are complete and only the sorted
+             * prefix can be binary searched, the rest is scanned */
+            n = MXS_MIN(n, hdr->n_entries);
+            size_t n_sorted = MXS_MIN(n, hdr->n_sorted);
+
+            if (gtid_index_header_ok(hdr) && n > 0)
+            {
+                size_t i = 0;
+
+                if (n_sorted > 0)
+                {
+                    /** Find the first entry in the sorted prefix with an equal
+                     * or larger sequence number */
+                    size_t high = n_sorted;
+
+                    while (i < high)
+                    {
+                        size_t mid = i + (high - i) / 2;
+
+                        if (entries[mid].seq < gtid->seq)
+                        {
+                            i = mid + 1;
+                        }
+                        else
+                        {
+                            high = mid;
+                        }
+                    }
+                }
+
+                while (i < n && !(is_same_source(&entries[i], gtid) && entries[i].seq >= gtid->seq))
+                {
+                    i++;
+                }
+
+                const AVRO_GTID_INDEX_ENTRY *entry = i < n ? &entries[i] : &entries[n - 1];
+                *pos = entry->pos;
+                *record = i < n ? entry->record : 0;
+                rval = true;
+            }
+
+            munmap(map, st.st_size);
+        }
+    }
+
+    close(fd);
+    return rval;
+}
+
 void avro_index_file(AVRO_INSTANCE *router, const char* filename)
 {
     MAXAVRO_FILE *file = maxavro_file_open(filename);
@@ -98,9 +513,20 @@ void avro_index_file(AVRO_INSTANCE *router, const char* filename)
                 return;
             }
 
+            /** The GTID index can be behind the SQLite index if it was
+             * created after the file was first indexed or if it could
+             * not be written */
+            long sqlite_pos = pos;
+            GTID_INDEX_WRITER writer;
+            bool have_index = gtid_index_open(&writer, filename, &pos);
+
             /** Continue from last position */
             if (pos > 0 && !maxavro_record_set_pos(file, pos))
             {
+                if (have_index)
+                {
+                    gtid_index_close(&writer, writer.indexed_pos);
+                }
                 maxavro_file_close(file);
                 return;
             }
@@ -115,9 +541,10 @@ void avro_index_file(AVRO_INSTANCE *router, const char* filename)
 
             do
             {
-                json_t *row = maxavro_record_read_json(file);
+                json_t *row;
+                uint64_t record = 0;
 
-                if (row)
+                while ((row = maxavro_record_read_json(file)))
                 {
                     gtid_pos_t gtid;
                     set_gtid(&gtid, row);
@@ -126,29 +553,45 @@ void avro_index_file(AVRO_INSTANCE *router, const char* filename)
                         prev_gtid.server_id != gtid.server_id ||
                         prev_gtid.seq != gtid.seq)
                     {
-                        snprintf(sql, sizeof(sql), insert_template, gtid.domain,
-                                 gtid.server_id, gtid.seq, name, file->block_start_pos);
-                        if (sqlite3_exec(router->sqlite_handle, sql, NULL, NULL,
-                                         &errmsg) != SQLITE_OK)
+                        if (have_index)
                         {
-                            MXS_ERROR("Failed to insert GTID %lu-%lu-%lu for %s "
-                                      "into index database: %s", gtid.domain,
-                                      gtid.server_id, gtid.seq, name, errmsg);
+                            gtid_index_add(&writer, &gtid, file->block_start_pos, record);
+                        }
 
+                        /** The SQLite index only stores the first GTID of each block */
+                        if (record == 0 && (long)file->block_start_pos >= sqlite_pos)
+                        {
+                            snprintf(sql, sizeof(sql), insert_template, gtid.domain,
+                                     gtid.server_id, gtid.seq, name, file->block_start_pos);
+                            if (sqlite3_exec(router->sqlite_handle, sql, NULL, NULL,
+                                             &errmsg) != SQLITE_OK)
+                            {
+                                MXS_ERROR("Failed to insert GTID %lu-%lu-%lu for %s "
+                                          "into index database: %s", gtid.domain,
+                                          gtid.server_id, gtid.seq, name, errmsg);
+
+                            }
+                            sqlite3_free(errmsg);
+                            errmsg = NULL;
                         }
-                        sqlite3_free(errmsg);
-                        errmsg = NULL;
                         prev_gtid = gtid;
                     }
                     json_decref(row);
+                    record++;
                 }
-                else
+
+                if (record == 0)
                 {
                     break;
                 }
             }
             while (maxavro_next_block(file));
 
+            if (have_index)
+            {
+                gtid_index_close(&writer, file->block_start_pos);
+            }
+
             if (sqlite3_exec(router->sqlite_handle, "COMMIT", NULL, NULL, &errmsg) != SQLITE_OK)
             {
                 MXS_ERROR("Failed to commit transaction: %s", errmsg);
@@ -16,6 +16,7 @@
 #include <maxscale/mysql_utils.h>
 #include <jansson.h>
 #include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
 #include <strings.h>
 
 #define WRITE_EVENT         0
@@ -91,6 +92,8 @@ bool handle_table_map_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr
 
         if (old == NULL || old->version != create->version)
         {
+            /** The old table map and Avro file are freed below */
+            avro_converters_drain(router);
             TABLE_MAP *map = table_map_alloc(ptr, ev_len, create);
 
             if (map)
@@ -110,6 +113,7 @@ bool handle_table_map_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr
                     if (avro_table)
                     {
                         bool notify = old != NULL;
+                        table_map_resolve_fields(map, avro_table->avro_schema);
 
                         if (old)
                         {
@@ -170,55 +174,151 @@ bool handle_table_map_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr
     return rval;
 }
 
+/**
+ * @brief Get a field of a record
+ *
+ * @param record Record where the field is
+ * @param index Resolved field index or -1 if the index is not known
+ * @param name Name of the field
+ * @param field Where the field is stored
+ */
+static inline void get_record_field(avro_value_t *record, int index, const char *name,
+                                    avro_value_t *field)
+{
+    if (index >= 0)
+    {
+        ss_debug(int rc = )avro_value_get_by_index(record, index, field, NULL);
+        ss_dassert(rc == 0);
+    }
+    else
+    {
+        ss_debug(int rc = )avro_value_get_by_name(record, name, field, NULL);
+        ss_dassert(rc == 0);
+    }
+}
+
 /**
  * @brief Set common field values and update the GTID subsequence counter
  *
  * This sets the domain, server ID, sequence and event position fields of
  * the GTID. It also sets the event timestamp and event type fields.
  *
- * @param router Avro router instance
+ * @param gtid GTID of the transaction, the event number is incremented
  * @param hdr Replication header
+ * @param map Table map with the resolved field indexes
  * @param event_type Event type
  * @param record Record to prepare
  */
-static void prepare_record(AVRO_INSTANCE *router, REP_HEADER *hdr,
+static void prepare_record(gtid_pos_t *gtid, REP_HEADER *hdr, TABLE_MAP *map,
                            int event_type, avro_value_t *record)
 {
+    int *fields = map->generated_fields;
     avro_value_t field;
-    avro_value_get_by_name(record, avro_domain, &field, NULL);
-    avro_value_set_int(&field, router->gtid.domain);
+    get_record_field(record, fields[AVRO_FIELD_DOMAIN], avro_domain, &field);
+    avro_value_set_int(&field, gtid->domain);
 
-    avro_value_get_by_name(record, avro_server_id, &field, NULL);
-    avro_value_set_int(&field, router->gtid.server_id);
+    get_record_field(record, fields[AVRO_FIELD_SERVER_ID], avro_server_id, &field);
+    avro_value_set_int(&field, gtid->server_id);
 
-    avro_value_get_by_name(record, avro_sequence, &field, NULL);
-    avro_value_set_int(&field, router->gtid.seq);
+    get_record_field(record, fields[AVRO_FIELD_SEQUENCE], avro_sequence, &field);
+    avro_value_set_int(&field, gtid->seq);
 
-    router->gtid.event_num++;
-    avro_value_get_by_name(record, avro_event_number, &field, NULL);
-    avro_value_set_int(&field, router->gtid.event_num);
+    gtid->event_num++;
+    get_record_field(record, fields[AVRO_FIELD_EVENT_NUMBER], avro_event_number, &field);
+    avro_value_set_int(&field, gtid->event_num);
 
-    avro_value_get_by_name(record, avro_timestamp, &field, NULL);
+    get_record_field(record, fields[AVRO_FIELD_TIMESTAMP], avro_timestamp, &field);
     avro_value_set_int(&field, hdr->timestamp);
 
-    avro_value_get_by_name(record, avro_event_type, &field, NULL);
+    get_record_field(record, fields[AVRO_FIELD_EVENT_TYPE], avro_event_type, &field);
     avro_value_set_enum(&field, event_type);
 }
 
+/**
+ * @brief Convert the rows of a row event into Avro records
+ *
+ * This is called either by the thread reading the binlog or by the converter
+ * thread that owns the Avro file of the table.
+ *
+ * @param gtid GTID of the transaction, the event number is updated
+ * @param hdr Replication header
+ * @param pos Binlog position of the event, used for logging
+ * @param map Table map of the table
+ * @param table Avro file where the records are written
+ * @param start Pointer to the start of the event
+ * @param ptr Pointer to the start of the row data
+ * @param col_present Bitmap of the columns present in the rows
+ * @return Number of records written
+ */
+int convert_row_event(gtid_pos_t *gtid, REP_HEADER *hdr, uint64_t pos, TABLE_MAP *map,
+                      AVRO_TABLE *table, uint8_t *start, uint8_t *ptr, uint8_t *col_present)
+{
+    TABLE_CREATE* create = map->table_create;
+    avro_value_t record;
+    avro_generic_value_new(table->avro_writer_iface, &record);
+
+    /** Each event has one or more rows in it. The number of rows is not known
+     * beforehand so we must continue processing them until we reach the end
+     * of the event. */
+    int records = 0;
+    MXS_INFO("Row Event for '%s.%s' at %lu", map->database, map->table, pos);
+
+    while (ptr - start < hdr->event_size - BINLOG_EVENT_HDR_LEN)
+    {
+        /** Shared by the converter threads */
+        static uint64_t total_row_count = 0;
+        MXS_INFO("Row %lu", atomic_add_uint64(&total_row_count, 1) + 1);
+
+        /** Add the current GTID and timestamp */
+        uint8_t *end = start + hdr->event_size - BINLOG_EVENT_HDR_LEN;
+        int event_type = get_event_type(hdr->event_type);
+        prepare_record(gtid, hdr, map, event_type, &record);
+        ptr = process_row_event_data(map, create, &record, ptr, col_present, end);
+        if (avro_file_writer_append_value(table->avro_file, &record))
+        {
+            MXS_ERROR("Failed to write value at position %ld: %s",
+                      pos, avro_strerror());
+        }
+        records++;
+
+        /** Update rows events have the before and after images of the
+         * affected rows so we'll process them as another record with
+         * a different type */
+        if (event_type == UPDATE_EVENT)
+        {
+            prepare_record(gtid, hdr, map, UPDATE_EVENT_AFTER, &record);
+            ptr = process_row_event_data(map, create, &record, ptr, col_present, end);
+            if (avro_file_writer_append_value(table->avro_file, &record))
+            {
+                MXS_ERROR("Failed to write value at position %ld: %s",
+                          pos, avro_strerror());
+            }
+            records++;
+        }
+    }
+
+    avro_value_decref(&record);
+    return records;
+}
+
 /**
  * @brief Handle a single RBR row event
  *
  * These events contain the changes in the data. This function assumes that full
  * row image is sent in every row event.
  *
+ * If converter threads are used, the rows are queued to the converter that
+ * owns the table and this function returns before they are converted.
+ *
  * @param router Avro router instance
  * @param hdr Replication header
- * @param ptr Pointer to the start of the event
+ * @param event The event payload
  * @return True on succcess, false on error
  */
-bool handle_row_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr)
+bool handle_row_event(AVRO_INSTANCE *router, REP_HEADER *hdr, GWBUF *event)
 {
     bool rval = false;
+    uint8_t *ptr = GWBUF_DATA(event);
     uint8_t *start = ptr;
     uint8_t table_id_size = router->event_type_hdr_lens[hdr->event_type] == 6 ? 4 : 6;
     uint64_t table_id = 0;
@@ -259,8 +359,7 @@ bool handle_row_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr)
      * the future partial row images could be used if the bitfield containing
      * the columns that are present in this event is used. */
     const int coldata_size = (ncolumns + 7) / 8;
-    uint8_t col_present[coldata_size];
-    memcpy(&col_present, ptr, coldata_size);
+    uint8_t *col_present = ptr;
     ptr += coldata_size;
 
     /** Update events have the before and after images of the row. This can be
@@ -287,50 +386,28 @@ bool handle_row_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr)
 
         if (table && create && ncolumns == map->columns)
         {
-            avro_value_t record;
-            avro_generic_value_new(table->avro_writer_iface, &record);
-
-            /** Each event has one or more rows in it. The number of rows is not known
-             * beforehand so we must continue processing them until we reach the end
-             * of the event. */
-            int rows = 0;
-            MXS_INFO("Row Event for '%s' at %lu", table_ident, router->current_pos);
-
-            while (ptr - start < hdr->event_size - BINLOG_EVENT_HDR_LEN)
+            if (router->n_converters > 0)
             {
-                static uint64_t total_row_count = 1;
-                MXS_INFO("Row %lu", total_row_count++);
-
-                /** Add the current GTID and timestamp */
-                uint8_t *end = ptr + hdr->event_size - BINLOG_EVENT_HDR_LEN;
-                int event_type = get_event_type(hdr->event_type);
-                prepare_record(router, hdr, event_type, &record);
-                ptr = process_row_event_data(map, create, &record, ptr, col_present, end);
-                if (avro_file_writer_append_value(table->avro_file, &record))
-                {
-                    MXS_ERROR("Failed to write value at position %ld: %s",
-                              router->current_pos, avro_strerror());
-                }
-
-                /** Update rows events have the before and after images of the
-                 * affected rows so we'll process them as another record with
-                 * a different type */
-                if (event_type == UPDATE_EVENT)
-                {
-                    prepare_record(router, hdr, UPDATE_EVENT_AFTER, &record);
-                    ptr = process_row_event_data(map, create, &record, ptr, col_present, end);
-                    if (avro_file_writer_append_value(table->avro_file, &record))
-                    {
-                        MXS_ERROR("Failed to write value at position %ld: %s",
-                                  router->current_pos, avro_strerror());
-                    }
-                }
-
-                rows++;
+                AVRO_ROW_JOB *job = MXS_MALLOC(sizeof(AVRO_ROW_JOB));
+                MXS_ABORT_IF_NULL(job);
+                job->event = gwbuf_clone(event);
+                job->hdr = *hdr;
+                job->pos = router->current_pos;
+                job->rows = ptr;
+                job->col_present = col_present;
+                job->map = map;
+                job->table = table;
+                avro_converter_dispatch(router, job, table_ident);
+            }
+            else
+            {
+                router->reader_stats.records += convert_row_event(&router->gtid, hdr,
+                                                                  router->current_pos, map,
+                                                                  table, start, ptr,
+                                                                  col_present);
             }
 
             add_used_table(router, table_ident);
-            avro_value_decref(&record);
             rval = true;
         }
         else if (table == NULL)
@@ -518,8 +595,8 @@ uint8_t* process_row_event_data(TABLE_MAP *map, TABLE_CREATE *create, avro_value
 
     for (long i = 0; i < map->columns && i < create->columns && npresent < ncolumns; i++)
     {
-        ss_debug(int rc = )avro_value_get_by_name(record, create->column_names[i], &field, NULL);
-        ss_dassert(rc == 0);
+        get_record_field(record, map->column_fields ? map->column_fields[i] : -1,
+                         create->column_names[i], &field);
 
         if (bit_is_set(columns_present, ncolumns, i))
         {
@@ -1357,6 +1357,8 @@ TABLE_MAP *table_map_alloc(uint8_t *ptr, uint8_t hdr_len, TABLE_CREATE* create)
         map->database = MXS_STRDUP(schema_name);
         map->table = MXS_STRDUP(table_name);
         map->table_create = create;
+        map->column_fields = NULL;
+        table_map_invalidate_fields(map);
         if (map->column_types && map->database && map->table &&
             map->column_metadata && map->null_bitmap)
         {
@@ -1387,6 +1389,7 @@ void table_map_free(TABLE_MAP *map)
 {
     if (map)
     {
+        MXS_FREE(map->column_fields);
         MXS_FREE(map->column_types);
         MXS_FREE(map->database);
         MXS_FREE(map->table);
@@ -1410,3 +1413,64 @@ void table_map_remap(uint8_t *ptr, uint8_t hdr_len, TABLE_MAP *map)
     memcpy(&table_id, ptr, id_size);
     map->id = table_id;
 }
+
+/**
+ * @brief Resolve the Avro field indexes of a table map
+ *
+ * The fields of a record are looked up by index instead of by name when
+ * the rows are converted. The indexes are resolved once for each table version
+ * when the table map event is processed.
+ *
+ * @param map Table map to resolve
+ * @param schema The Avro schema of this table version
+ */
+void table_map_resolve_fields(TABLE_MAP *map, avro_schema_t schema)
+{
+    TABLE_CREATE *create = map->table_create;
+    int *fields = MXS_MALLOC(sizeof(int) * map->columns);
+
+    if (fields)
+    {
+        map->generated_fields[AVRO_FIELD_DOMAIN] =
+            avro_schema_record_field_get_index(schema, avro_domain);
+        map->generated_fields[AVRO_FIELD_SERVER_ID] =
+            avro_schema_record_field_get_index(schema, avro_server_id);
+        map->generated_fields[AVRO_FIELD_SEQUENCE] =
+            avro_schema_record_field_get_index(schema, avro_sequence);
+        map->generated_fields[AVRO_FIELD_EVENT_NUMBER] =
+            avro_schema_record_field_get_index(schema, avro_event_number);
+        map->generated_fields[AVRO_FIELD_TIMESTAMP] =
+            avro_schema_record_field_get_index(schema, avro_timestamp);
+        map->generated_fields[AVRO_FIELD_EVENT_TYPE] =
+            avro_schema_record_field_get_index(schema, avro_event_type);
+
+        for (uint64_t i = 0; i < map->columns; i++)
+        {
+            fields[i] = i < create->columns ?
+                        avro_schema_record_field_get_index(schema, create->column_names[i]) : -1;
+            ss_dassert(i >= create->columns || fields[i] != -1);
+        }
+
+        MXS_FREE(map->column_fields);
+        map->column_fields = fields;
+    }
+}
+
+/**
+ * @brief Invalidate the resolved Avro field indexes of a table map
+ *
+ * This is done when the table definition changes. The fields are looked up by
+ * name until the next table map event for the new table version is processed.
+ *
+ * @param map Table map to invalidate
+ */
+void table_map_invalidate_fields(TABLE_MAP *map)
+{
+    for (int i = 0; i < AVRO_FIELD_GENERATED_COUNT; i++)
+    {
+        map->generated_fields[i] = -1;
+    }
+
+    MXS_FREE(map->column_fields);
+    map->column_fields = NULL;
+}
@@ -28,6 +28,7 @@
 #include <maxscale/dcb.h>
 #include <maxscale/service.h>
 #include <maxscale/spinlock.h>
+#include <maxscale/thread.h>
 #include <maxscale/mysql_binlog.h>
 #include <maxscale/users.h>
 #include <avro.h>
@@ -60,6 +61,11 @@ MXS_BEGIN_DECLS
 #define MEMORY_TABLE_NAME      MEMORY_DATABASE_NAME".mem_used_tables"
 #define INDEX_TABLE_NAME       "indexing_progress"
 
+/** Suffix of the GTID index file that is stored next to each Avro file */
+#define AVRO_GTID_INDEX_SUFFIX  ".gidx"
+#define AVRO_GTID_INDEX_MAGIC   "MXSGIDX"
+#define AVRO_GTID_INDEX_VERSION 3
+
 /** Name of the file where the binlog to Avro conversion progress is stored */
 #define AVRO_PROGRESS_FILE "avro-conversion.ini"
 
@@ -82,7 +88,7 @@ static const char *avro_sequence     = "sequence";
 static const char *avro_event_number = "event_number";
 static const char *avro_event_type   = "event_type";
 static const char *avro_timestamp    = "timestamp";
-static char *avro_client_ouput[]     = { "Undefined", "JSON", "Avro" };
+static char *avro_client_ouput[]     = { "Undefined", "JSON", "Avro", "Batch" };
 
 static inline bool is_reserved_word(const char* word)
 {
@@ -123,6 +129,12 @@ typedef enum avro_binlog_end
 /** How many bytes each thread tries to send */
 #define AVRO_DATA_BURST_SIZE (32 * 1024)
 
+/** Write queue limits for clients that stream batched frames. Streaming
+ * stops when the write queue grows above the high water mark and continues
+ * once it has drained below the low water mark. */
+#define AVRO_BATCH_HIGH_WATER (1024 * 1024)
+#define AVRO_BATCH_LOW_WATER  (256 * 1024)
+
 /** A CREATE TABLE abstraction */
 typedef struct table_create
 {
@@ -136,6 +148,18 @@ typedef struct table_create
     bool was_used; /**< Has this schema been persisted to disk */
 } TABLE_CREATE;
 
+/** Fields generated by the avrorouter for each record */
+enum avro_generated_field
+{
+    AVRO_FIELD_DOMAIN,
+    AVRO_FIELD_SERVER_ID,
+    AVRO_FIELD_SEQUENCE,
+    AVRO_FIELD_EVENT_NUMBER,
+    AVRO_FIELD_TIMESTAMP,
+    AVRO_FIELD_EVENT_TYPE,
+    AVRO_FIELD_GENERATED_COUNT
+};
+
 /** A representation of a table map event read from a binary log. A table map
  * maps a table to a unique ID which can be used to match row events to table map
  * events. The table map event tells us how the table is laid out and gives us
@@ -154,6 +178,10 @@ typedef struct table_map
     char version_string[TABLE_MAP_VERSION_DIGITS + 1];
     char *table;
     char *database;
+    int generated_fields[AVRO_FIELD_GENERATED_COUNT]; /*< Avro field indexes of
+                                                       * the generated fields */
+    int *column_fields; /*< Avro field index of each column or NULL if the
+                         * indexes are not resolved for this table version */
 } TABLE_MAP;
 
 /**
@@ -197,12 +225,19 @@ typedef struct avro_table_t
     avro_schema_t avro_schema; /*< Native Avro schema of the table */
 } AVRO_TABLE;
 
+/** Maximum number of row events queued for a single converter thread */
+#define AVRO_CONVERTER_QUEUE_MAX 1024
+
+/** Maximum number of converter threads */
+#define AVRO_CONVERTER_MAX_THREADS 64
+
 /** Data format used when streaming data to the clients */
 enum avro_data_format
 {
     AVRO_FORMAT_UNDEFINED,
     AVRO_FORMAT_JSON,
     AVRO_FORMAT_AVRO,
+    AVRO_FORMAT_BATCH,
 };
 
 typedef struct gtid_pos
@@ -217,6 +252,90 @@ typedef struct gtid_pos
                          * rebuild GTID events in the correct order. */
 } gtid_pos_t;
 
+/**
+ * The GTID index of an Avro file
+ *
+ * The index file consists of a header followed by one entry for each GTID in
+ * the Avro file in the order they appear in the file. The index is appended to
+ * by the indexing task and read by memory mapping it. The file is never shrunk
+ * in place, an index that has to be cut is replaced with a new file.
+ */
+typedef struct avro_gtid_index_header
+{
+    char     magic[8]; /*< AVRO_GTID_INDEX_MAGIC */
+    uint32_t version;  /*< AVRO_GTID_INDEX_VERSION */
+    uint32_t reserved;
+    uint64_t n_entries; /*< Number of complete entries, updated after they are written */
+    uint64_t n_sorted;  /*< Number of entries at the start of the index whose
+                         * sequence numbers never decrease */
+    uint64_t indexed_pos; /*< The data blocks before this position are indexed */
+} AVRO_GTID_INDEX_HEADER;
+
+typedef struct avro_gtid_index_entry
+{
+    uint64_t domain;    /*< Replication domain */
+    uint64_t server_id; /*< Server ID */
+    uint64_t seq;       /*< Sequence number */
+    uint64_t pos;       /*< Start of the data block with the first record of the GTID */
+    uint64_t record;    /*< Number of the first record inside the data block */
+} AVRO_GTID_INDEX_ENTRY;
+
+/**
+ * A transaction whose row events are converted by the converter threads. The
+ * event number of the GTID is shared by all converters that process rows of
+ * this transaction and it is only modified by one converter at a time.
+ */
+typedef struct avro_trx
+{
+    gtid_pos_t gtid; /*< GTID of the transaction */
+    int refcount;    /*< Number of references to this transaction */
+} AVRO_TRX;
+
+/** A row event waiting to be converted into Avro records */
+typedef struct avro_row_job
+{
+    GWBUF      *event;       /*< The replication event payload */
+    REP_HEADER  hdr;         /*< Replication header of the event */
+    uint64_t    pos;         /*< Binlog position of the event */
+    uint8_t    *rows;        /*< Start of the row data */
+    uint8_t    *col_present; /*< Bitmap of columns present in the rows */
+    TABLE_MAP  *map;         /*< Table map of the table */
+    AVRO_TABLE *table;       /*< Avro file where the rows are written */
+    AVRO_TRX   *trx;         /*< Transaction the event belongs to */
+    struct avro_row_job *next;
+} AVRO_ROW_JOB;
+
+/** Statistics of a single stage of the conversion pipeline */
+typedef struct avro_stage_stats
+{
+    uint64_t events;  /*< Number of events processed */
+    uint64_t records; /*< Number of Avro records written */
+    uint64_t bytes;   /*< Number of binlog bytes processed */
+    uint64_t busy_ns; /*< Time spent processing events */
+    uint64_t wait_ns; /*< Time spent waiting for the other stages */
+} AVRO_STAGE_STATS;
+
+/**
+ * A converter thread. Each converter owns the Avro files of the tables that
+ * are hashed to it which means that the rows of a table are always converted
+ * in the order they were read from the binlog.
+ */
+typedef struct avro_converter
+{
+    struct avro_instance *router;  /*< The owning router */
+    int                   id;      /*< Converter number */
+    THREAD                thread;  /*< The converter thread */
+    pthread_mutex_t       lock;    /*< Protects the queue */
+    pthread_cond_t        work;    /*< Signaled when new jobs are queued */
+    pthread_cond_t        done;    /*< Signaled when jobs have been processed */
+    AVRO_ROW_JOB         *head;    /*< First queued job */
+    AVRO_ROW_JOB         *tail;    /*< Last queued job */
+    int                   queued;  /*< Number of queued jobs */
+    bool                  busy;    /*< Whether a job is being processed */
+    bool                  shutdown; /*< Exit when the queue is empty */
+    AVRO_STAGE_STATS      stats;   /*< Converter statistics */
+} AVRO_CONVERTER;
+
 /**
  * The client structure used within this router.
  * This represents the clients that are requesting AVRO files from MaxScale.
@@ -294,6 +413,13 @@ typedef struct avro_instance
     uint64_t        row_target; /*< Minimum about of row events that will trigger
                                  * a flush of all tables */
     uint64_t        block_size; /**< Avro datablock size */
+    int             n_converters; /*< Number of converter threads, 0 for
+                                   * converting rows in the reading thread */
+    AVRO_CONVERTER *converters; /*< The converter threads */
+    AVRO_TRX       *current_trx; /*< Transaction currently being read */
+    int             last_converter; /*< Converter which received the latest
+                                     * row event of the current transaction */
+    AVRO_STAGE_STATS reader_stats; /*< Statistics of the binlog reading stage */
     struct avro_instance  *next;
 } AVRO_INSTANCE;
 
@@ -301,6 +427,8 @@ extern void read_table_info(uint8_t *ptr, uint8_t post_header_len, uint64_t *tab
                             char* dest, size_t len);
 extern TABLE_MAP *table_map_alloc(uint8_t *ptr, uint8_t hdr_len, TABLE_CREATE* create);
 extern void table_map_free(TABLE_MAP *map);
+extern void table_map_resolve_fields(TABLE_MAP *map, avro_schema_t schema);
+extern void table_map_invalidate_fields(TABLE_MAP *map);
 extern TABLE_CREATE* table_create_alloc(const char* sql, const char* db);
 extern TABLE_CREATE* table_create_copy(AVRO_INSTANCE *router, const char* sql, size_t len, const char* db);
 extern void table_create_free(TABLE_CREATE* value);
@@ -312,12 +440,23 @@ extern void avro_client_rotate(AVRO_INSTANCE *router, AVRO_CLIENT *client, uint8
 extern bool avro_open_binlog(const char *binlogdir, const char *file, int *fd);
 extern void avro_close_binlog(int fd);
 extern avro_binlog_end_t avro_read_all_events(AVRO_INSTANCE *router);
+extern bool avro_gtid_index_find(const char *avrofile, const gtid_pos_t *gtid, long *pos,
+                                 uint64_t *record);
 extern AVRO_TABLE* avro_table_alloc(const char* filepath, const char* json_schema, size_t block_size);
 extern void avro_table_free(AVRO_TABLE *table);
 extern char* json_new_schema_from_table(TABLE_MAP *map);
 extern void save_avro_schema(const char *path, const char* schema, TABLE_MAP *map);
 extern bool handle_table_map_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr);
-extern bool handle_row_event(AVRO_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr);
+extern bool handle_row_event(AVRO_INSTANCE *router, REP_HEADER *hdr, GWBUF *event);
+extern int convert_row_event(gtid_pos_t *gtid, REP_HEADER *hdr, uint64_t pos, TABLE_MAP *map,
+                             AVRO_TABLE *table, uint8_t *start, uint8_t *ptr,
+                             uint8_t *col_present);
+extern bool avro_converters_start(AVRO_INSTANCE *router);
+extern void avro_converter_dispatch(AVRO_INSTANCE *router, AVRO_ROW_JOB *job, const char *table_ident);
+extern void avro_converters_drain(AVRO_INSTANCE *router);
+extern void avro_converters_stop(AVRO_INSTANCE *router);
+extern void avro_converters_diagnostics(AVRO_INSTANCE *router, DCB *dcb);
+extern uint64_t avro_monotonic_ns();
 extern void table_map_remap(uint8_t *ptr, uint8_t hdr_len, TABLE_MAP *map);
 
 enum avrorouter_file_op
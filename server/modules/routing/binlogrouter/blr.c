@@ -137,6 +137,14 @@ static const MXS_ENUM_VALUE enc_algo_values[] =
     {NULL}
 };
 
+static const MXS_ENUM_VALUE binlog_sync_values[] =
+{
+    {"fsync", BLR_SYNC_FSYNC},
+    {"fdatasync", BLR_SYNC_FDATASYNC},
+    {"none", BLR_SYNC_NONE},
+    {NULL}
+};
+
 /**
  * The module entry point routine. It is this routine that
  * must populate the structure that is referred to as the
@@ -197,10 +205,18 @@ MXS_MODULE* MXS_CREATE_MODULE()
             {"shortburst", MXS_MODULE_PARAM_COUNT, DEF_SHORT_BURST},
             {"longburst", MXS_MODULE_PARAM_COUNT, DEF_LONG_BURST},
             {"burstsize", MXS_MODULE_PARAM_SIZE, DEF_BURST_SIZE},
+            {"slave_write_buffer", MXS_MODULE_PARAM_SIZE, "0"},
             {"heartbeat", MXS_MODULE_PARAM_COUNT, BLR_HEARTBEAT_DEFAULT_INTERVAL},
             {"send_slave_heartbeat", MXS_MODULE_PARAM_BOOL, "false"},
             {"binlogdir", MXS_MODULE_PARAM_PATH, NULL, MXS_MODULE_OPT_PATH_W_OK},
             {"ssl_cert_verification_depth", MXS_MODULE_PARAM_COUNT, "9"},
+            {"event_workers", MXS_MODULE_PARAM_COUNT, "0"},
+            {"binlog_write_buffer", MXS_MODULE_PARAM_SIZE, "0"},
+            {"binlog_sync", MXS_MODULE_PARAM_ENUM, "fsync", MXS_MODULE_OPT_NONE, binlog_sync_values},
+            {"binlog_checkpoint", MXS_MODULE_PARAM_SIZE, "0"},
+            {"binlog_compression", MXS_MODULE_PARAM_BOOL, "false"},
+            {"binlog_compression_keep", MXS_MODULE_PARAM_COUNT, "2"},
+            {"binlog_gtid_index", MXS_MODULE_PARAM_BOOL, "false"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -327,9 +343,17 @@ createInstance(SERVICE *service, char **options)
     inst->short_burst = config_get_integer(params, "shortburst");
     inst->long_burst = config_get_integer(params, "longburst");
     inst->burst_size = config_get_size(params, "burstsize");
+    inst->slave_write_buffer = config_get_size(params, "slave_write_buffer");
     inst->binlogdir = config_copy_string(params, "binlogdir");
     inst->heartbeat = config_get_integer(params, "heartbeat");
     inst->ssl_cert_verification_depth = config_get_integer(params, "ssl_cert_verification_depth");
+    inst->event_workers = config_get_integer(params, "event_workers");
+    inst->write_buffer_size = config_get_size(params, "binlog_write_buffer");
+    inst->binlog_sync = config_get_enum(params, "binlog_sync", binlog_sync_values);
+    inst->checkpoint_interval = config_get_size(params, "binlog_checkpoint");
+    inst->binlog_compression = config_get_bool(params, "binlog_compression");
+    inst->compression_keep = config_get_integer(params, "binlog_compression_keep");
+    inst->binlog_gtid_index = config_get_bool(params, "binlog_gtid_index");
     inst->mariadb10_compat = config_get_bool(params, "mariadb10-compatibility");
     inst->trx_safe = config_get_bool(params, "transaction_safety");
     inst->set_master_version = config_copy_string(params, "master_version");
@@ -609,6 +633,53 @@ createInstance(SERVICE *service, char **options)
                                     value, inst->ssl_cert_verification_depth);
                     }
                 }
+                else if (strcmp(options[i], "event_workers") == 0)
+                {
+                    inst->event_workers = atoi(value);
+                }
+                else if (strcmp(options[i], "binlog_write_buffer") == 0)
+                {
+                    inst->write_buffer_size = config_parse_size(value);
+                }
+                else if (strcmp(options[i], "slave_write_buffer") == 0)
+                {
+                    inst->slave_write_buffer = config_parse_size(value);
+                }
+                else if (strcmp(options[i], "binlog_checkpoint") == 0)
+                {
+                    inst->checkpoint_interval = config_parse_size(value);
+                }
+                else if (strcmp(options[i], "binlog_compression") == 0)
+                {
+                    inst->binlog_compression = config_truth_value(value);
+                }
+                else if (strcmp(options[i], "binlog_compression_keep") == 0)
+                {
+                    inst->compression_keep = atoi(value);
+                }
+                else if (strcmp(options[i], "binlog_gtid_index") == 0)
+                {
+                    inst->binlog_gtid_index = config_truth_value(value);
+                }
+                else if (strcmp(options[i], "binlog_sync") == 0)
+                {
+                    int j = 0;
+
+                    while (binlog_sync_values[j].name &&
+                           strcasecmp(binlog_sync_values[j].name, value) != 0)
+                    {
+                        j++;
+                    }
+
+                    if (binlog_sync_values[j].name)
+                    {
+                        inst->binlog_sync = binlog_sync_values[j].enum_value;
+                    }
+                    else
+                    {
+                        MXS_WARNING("Invalid binlog_sync value %s, using fsync.", value);
+                    }
+                }
                 else
                 {
                     MXS_WARNING("Unsupported router option %s for binlog router.",
@@ -854,6 +925,53 @@ createInstance(SERVICE *service, char **options)
      */
     blr_init_cache(inst);
 
+    /*
+     * Start the threads that check and encrypt the events from the master
+     */
+    if (inst->event_workers > 0)
+    {
+        blr_event_workers_start(inst);
+    }
+
+    /*
+     * Start the thread that compresses the closed binlog files
+     */
+    if (inst->binlog_compression)
+    {
+        if (inst->compression_keep < BINLOG_COMPRESSION_KEEP_MIN)
+        {
+            MXS_WARNING("%s: binlog_compression_keep must be at least %d, using %d.",
+                        service->name, BINLOG_COMPRESSION_KEEP_MIN, BINLOG_COMPRESSION_KEEP_MIN);
+            inst->compression_keep = BINLOG_COMPRESSION_KEEP_MIN;
+        }
+
+        blr_compress_start(inst);
+    }
+
+    /*
+     * The GTID index needs the MariaDB 10 GTID events from the master
+     */
+    if (inst->binlog_gtid_index)
+    {
+        if (inst->mariadb10_compat)
+        {
+            inst->gtid_index = blr_gtid_index_create();
+        }
+        else
+        {
+            MXS_WARNING("%s: binlog_gtid_index requires mariadb10-compatibility, "
+                        "the binlog files are not indexed by GTID.", service->name);
+        }
+    }
+
+    /*
+     * Allocate the buffer where the events from the master are gathered
+     */
+    if (inst->write_buffer_size > 0)
+    {
+        inst->write_buffer = MXS_MALLOC(inst->write_buffer_size);
+    }
+
     /*
      * Add tasks for statistic computation
      */
@@ -945,6 +1063,7 @@ free_instance(ROUTER_INSTANCE *instance)
     MXS_FREE(instance->ssl_cert);
     MXS_FREE(instance->ssl_key);
     MXS_FREE(instance->ssl_version);
+    MXS_FREE(instance->write_buffer);
 
     MXS_FREE(instance);
 }
@@ -989,6 +1108,7 @@ newSession(MXS_ROUTER *instance, MXS_SESSION *session)
     slave->pthread = 0;
     slave->overrun = 0;
     slave->uuid = NULL;
+    slave->mariadb_gtid = NULL;
     slave->hostname = NULL;
     spinlock_init(&slave->catch_lock);
     slave->dcb = session->client_dcb;
@@ -1086,6 +1206,11 @@ static void freeSession(MXS_ROUTER* router_instance,
     {
         MXS_FREE(slave->encryption_ctx);
     }
+    if (slave->batch)
+    {
+        gwbuf_free(slave->batch);
+    }
+    MXS_FREE(slave->mariadb_gtid);
     MXS_FREE(slave);
 }
 
@@ -1247,6 +1372,7 @@ diagnostics(MXS_ROUTER *router, DCB *dcb)
     int i = 0, j;
     int minno = 0;
     double min5, min10, min15, min30;
+    double bytes5, bytes10, bytes15, bytes30;
     char buf[40];
     struct tm tm;
 
@@ -1363,6 +1489,42 @@ diagnostics(MXS_ROUTER *router, DCB *dcb)
                router_inst->stats.n_binlogs);
     dcb_printf(dcb, "\tNo. of bad CRC received from master:         %u\n",
                router_inst->stats.n_badcrc);
+    dcb_printf(dcb, "\tNo. of writes to the binlog file:            %lu\n",
+               router_inst->stats.n_binlog_writes);
+    if (router_inst->write_buffer)
+    {
+        dcb_printf(dcb, "\tBinlog write buffer size:                    %lu\n",
+                   router_inst->write_buffer_size);
+    }
+    if (router_inst->slave_write_buffer)
+    {
+        dcb_printf(dcb, "\tSlave write buffer size:                     %lu\n",
+                   router_inst->slave_write_buffer);
+    }
+    if (router_inst->compressor)
+    {
+        dcb_printf(dcb, "\tNo. of binlog files compressed:              %lu\n",
+                   router_inst->stats.n_compressed);
+    }
+    if (router_inst->gtid_index)
+    {
+        dcb_printf(dcb, "\tNo. of replication domains in GTID index:    %d\n",
+                   router_inst->gtid_index->n_domains);
+    }
+    if (router_inst->checkpoint_interval)
+    {
+        dcb_printf(dcb, "\tLast binlog checkpoint position:             %lu\n",
+                   router_inst->checkpoint_pos);
+    }
+    if (router_inst->workers)
+    {
+        dcb_printf(dcb, "\tNumber of event worker threads:              %d\n",
+                   router_inst->workers->n_threads);
+        dcb_printf(dcb, "\tNo. of events processed by event workers:    %lu\n",
+                   router_inst->stats.n_offloaded);
+        dcb_printf(dcb, "\tNo. of events encrypted again by master:     %lu\n",
+                   router_inst->stats.n_reencrypted);
+    }
     minno = router_inst->stats.minno - 1;
     if (minno == -1)
     {
@@ -1494,6 +1656,10 @@ diagnostics(MXS_ROUTER *router, DCB *dcb)
             min15 = 0.0;
             min10 = 0.0;
             min5 = 0.0;
+            bytes30 = 0.0;
+            bytes15 = 0.0;
+            bytes10 = 0.0;
+            bytes5 = 0.0;
             for (j = 0; j < BLR_NSTATS_MINUTES; j++)
             {
                 minno--;
@@ -1502,23 +1668,31 @@ diagnostics(MXS_ROUTER *router, DCB *dcb)
                     minno += BLR_NSTATS_MINUTES;
                 }
                 min30 += session->stats.minavgs[minno];
+                bytes30 += session->stats.minbytes[minno];
                 if (j < 15)
                 {
                     min15 += session->stats.minavgs[minno];
+                    bytes15 += session->stats.minbytes[minno];
                 }
                 if (j < 10)
                 {
                     min10 += session->stats.minavgs[minno];
+                    bytes10 += session->stats.minbytes[minno];
                 }
                 if (j < 5)
                 {
                     min5 += session->stats.minavgs[minno];
+                    bytes5 += session->stats.minbytes[minno];
                 }
             }
             min30 /= 30.0;
             min15 /= 15.0;
             min10 /= 10.0;
             min5 /= 5.0;
+            bytes30 /= 30.0;
+            bytes15 /= 15.0;
+            bytes10 /= 10.0;
+            bytes5 /= 5.0;
             dcb_printf(dcb,
                        "\t\tServer-id:                               %d\n",
                        session->serverid);
@@ -1573,12 +1747,15 @@ diagnostics(MXS_ROUTER *router, DCB *dcb)
             dcb_printf(dcb,
                        "\t\tNo. bytes sent:                          %lu\n",
                        session->stats.n_bytes);
+            dcb_printf(dcb,
+                       "\t\tNo. buffers written:                     %lu\n",
+                       session->stats.n_writes);
             dcb_printf(dcb,
                        "\t\tNo. bursts sent:                         %u\n",
                        session->stats.n_bursts);
             dcb_printf(dcb,
                        "\t\tNo. transitions to follow mode:          %u\n",
-                       session->stats.n_bursts);
+                       session->stats.n_caughtup);
             if (router_inst->send_slave_heartbeat)
             {
                 dcb_printf(dcb,
@@ -1596,6 +1773,23 @@ diagnostics(MXS_ROUTER *router, DCB *dcb)
             dcb_printf(dcb, "\t\t %6d  %8.1f %8.1f %8.1f %8.1f\n",
                        session->stats.minavgs[minno], min5, min10,
                        min15, min30);
+            dcb_printf(dcb, "\t\tNumber of bytes sent per minute\n");
+            dcb_printf(dcb, "\t\tCurrent        5        10       15       30 Min Avg\n");
+            dcb_printf(dcb, "\t\t %6lu  %8.1f %8.1f %8.1f %8.1f\n",
+                       session->stats.minbytes[minno], bytes5, bytes10,
+                       bytes15, bytes30);
+            if (strcmp(session->binlogfile, router_inst->binlog_name) == 0)
+            {
+                dcb_printf(dcb, "\t\tBytes behind master binlog:              %lu\n",
+                           session->binlog_pos < router_inst->binlog_position ?
+                           router_inst->binlog_position - session->binlog_pos : 0);
+            }
+            else if (strrchr(session->binlogfile, '.') && strrchr(router_inst->binlog_name, '.'))
+            {
+                dcb_printf(dcb, "\t\tBinlog files behind master:              %d\n",
+                           atoi(strrchr(router_inst->binlog_name, '.') + 1) -
+                           atoi(strrchr(session->binlogfile, '.') + 1));
+            }
             dcb_printf(dcb, "\t\tNo. flow control:                        %u\n",
                        session->stats.n_flows);
             dcb_printf(dcb, "\t\tNo. up to date:                          %u\n",
@@ -1928,6 +2122,8 @@ stats_func(void *inst)
     slave = router->slaves;
     while (slave)
     {
+        slave->stats.minbytes[slave->stats.minno] = slave->stats.n_bytes - slave->stats.lastbytes;
+        slave->stats.lastbytes = slave->stats.n_bytes;
         slave->stats.minavgs[slave->stats.minno++] = slave->stats.n_events - slave->stats.lastsample;
         slave->stats.lastsample = slave->stats.n_events;
         if (slave->stats.minno == BLR_NSTATS_MINUTES)
@@ -2483,6 +2679,9 @@ destroyInstance(MXS_ROUTER *instance)
     }
 
     spinlock_release(&inst->lock);
+
+    blr_event_workers_stop(inst);
+    blr_compress_stop(inst);
 }
 
 /**
@@ -66,6 +66,12 @@ MXS_BEGIN_DECLS
 #define BINLOG_MAGIC_SIZE       4
 #define BINLOG_NAMEFMT          "%s.%06d"
 #define BINLOG_NAME_ROOT        "mysql-bin"
+#define BINLOG_CHECKPOINT_SUFFIX ".checkpoint"
+#define BINLOG_SCAN_BLOCK_SIZE  (1024 * 1024)
+#define BINLOG_COMPRESSED_SUFFIX ".compressed"
+#define BINLOG_COMPRESSED_BLOCK_SIZE (64 * 1024)
+#define BINLOG_COMPRESSED_CACHE_BLOCKS 4
+#define BINLOG_COMPRESSION_KEEP_MIN 2
 
 #define BINLOG_EVENT_HDR_LEN       19
 #define BINLOG_EVENT_CRC_ALGO_TYPE  1
@@ -104,6 +110,16 @@ enum blr_aes_mode
 /* Default encryption alogorithm is AES_CBC */
 #define BINLOG_DEFAULT_ENC_ALGO    BLR_AES_CBC
 
+/**
+ * How the binlog file is synced to disk after events have been written
+ */
+enum blr_binlog_sync
+{
+    BLR_SYNC_FSYNC,
+    BLR_SYNC_FDATASYNC,
+    BLR_SYNC_NONE
+};
+
 /**
  * Binlog event types
  */
@@ -248,6 +264,14 @@ enum blr_aes_mode
 #define MARIADB_FL_DDL                 32
 #define MARIADB_FL_STANDALONE           1
 
+/* Maximum length of a MariaDB 10 GTID, domain-server_id-sequence */
+#define BLR_GTID_MAXLEN                42
+
+/* The GTID index file of a replication domain is the prefix followed by the domain id */
+#define BLR_GTID_INDEX_PREFIX          "gtid_index."
+/* Maximum number of replication domains in the GTID index */
+#define BLR_GTID_INDEX_MAX_DOMAINS     16
+
 /* Saved credential file name's tail */
 static const char BLR_DBUSERS_DIR[] = "cache/users";
 static const char BLR_DBUSERS_FILE[] = "dbusers";
@@ -345,12 +369,41 @@ typedef struct
     SPINLOCK        lock;           /*< The spinlock for the cache */
 } BLCACHE;
 
+/**
+ * A decompressed block of a compressed binlog file
+ */
+typedef struct
+{
+    uint32_t        block;          /*< Number of the block in the file */
+    uint32_t        len;            /*< Length of the data, 0 if the slot is unused */
+    uint64_t        last_used;      /*< When the block was last used */
+    uint8_t         *data;          /*< The decompressed data */
+} BLR_COMPRESSED_BLOCK;
+
+/**
+ * A closed binlog file stored in blocks of BINLOG_COMPRESSED_BLOCK_SIZE bytes
+ * that are compressed separately. The index holds the file offset of every
+ * block so that any position in the binlog file can be read directly.
+ */
+typedef struct
+{
+    uint64_t        raw_size;       /*< Size of the uncompressed binlog file */
+    uint32_t        block_size;     /*< Uncompressed size of a block */
+    uint32_t        n_blocks;       /*< Number of blocks */
+    uint64_t        *index;         /*< File offsets of the blocks */
+    uint8_t         *stored;        /*< Buffer for a block as stored in the file */
+    uint64_t        n_reads;        /*< Number of block lookups, for the cache LRU */
+    pthread_mutex_t lock;           /*< Protects the block cache */
+    BLR_COMPRESSED_BLOCK cache[BINLOG_COMPRESSED_CACHE_BLOCKS]; /*< Recently used blocks */
+} BLR_COMPRESSED_FILE;
+
 typedef struct blfile
 {
     char            binlogname[BINLOG_FNAMELEN + 1]; /*< Name of the binlog file */
     int             fd;                             /*< Actual file descriptor */
     int             refcnt;                         /*< Reference count for file */
     BLCACHE         *cache;                         /*< Record cache for this file */
+    BLR_COMPRESSED_FILE *compressed;                /*< Block index of a compressed file or NULL */
     SPINLOCK        lock;                           /*< The file lock */
     struct blfile   *next;                          /*< Next file in list */
 } BLFILE;
@@ -362,6 +415,7 @@ typedef struct
 {
     int             n_events;       /*< Number of events sent */
     unsigned long   n_bytes;        /*< Number of bytes sent */
+    unsigned long   n_writes;       /*< Number of buffers written */
     int             n_bursts;       /*< Number of bursts sent */
     int             n_requests;     /*< Number of requests received */
     int             n_flows;        /*< Number of flow control restarts */
@@ -376,8 +430,10 @@ typedef struct
     int             n_caughtup;
     int             n_actions[3];
     uint64_t        lastsample;
+    unsigned long   lastbytes;      /*< Bytes sent at the last sample */
     int             minno;
     int             minavgs[BLR_NSTATS_MINUTES];
+    unsigned long   minbytes[BLR_NSTATS_MINUTES]; /*< Bytes sent per minute */
 } SLAVE_STATS;
 
 typedef enum blr_thread_role
@@ -407,6 +463,7 @@ typedef struct router_slave
     char            binlogfile[BINLOG_FNAMELEN + 1];
     /*< Current binlog file for this slave */
     char            *uuid;          /*< Slave UUID */
+    char            *mariadb_gtid;  /*< GTID requested with @slave_connect_state */
 #ifdef BLFILE_IN_SLAVE
     BLFILE          *file;          /*< Currently open binlog file */
 #endif
@@ -422,6 +479,12 @@ typedef struct router_slave
     uint32_t        lastEventTimestamp;/*< Last event timestamp sent */
     SPINLOCK        catch_lock;     /*< Event catchup lock */
     unsigned int    cstate;         /*< Catch up state */
+    long            burst_credit;   /*< Bytes the last burst sent beyond its budget,
+                                     * as a negative value */
+    GWBUF           *batch;         /*< Packed events not yet written */
+    unsigned int    batch_len;      /*< Number of bytes used in batch */
+    bool            batching;       /*< Events are packed into batch */
+    bool            corked;         /*< TCP_CORK is set on the slave socket */
     bool            mariadb10_compat;/*< MariaDB 10.0 compatibility */
     SPINLOCK        rses_lock;      /*< Protects rses_deleted */
     pthread_t       pthread;
@@ -468,6 +531,10 @@ typedef struct
     uint64_t        n_fakeevents;   /*< Fake events not written to disk */
     uint64_t        n_artificial;   /*< Artificial events not written to disk */
     int             n_badcrc;       /*< No. of bad CRC's from master */
+    uint64_t        n_offloaded;    /*< Events checked or encrypted by the event workers */
+    uint64_t        n_reencrypted;  /*< Offloaded encryptions redone by the master thread */
+    uint64_t        n_binlog_writes; /*< Number of writes to the binlog file */
+    uint64_t        n_compressed;    /*< Number of binlog files compressed */
     uint64_t        events[MAX_EVENT_TYPE_END + 1]; /*< Per event counters */
     uint64_t        lastsample;
     int             minno;
@@ -511,6 +578,86 @@ typedef struct binlog_encryption_setup
     uint8_t key_id;
 } BINLOG_ENCRYPTION_SETUP;
 
+/** Maximum number of events from the master that are processed as one batch */
+#define BLR_EVENT_BATCH_SIZE 64
+
+/**
+ * A complete replication event received from the master
+ *
+ * The event checksum is verified and the event is encrypted by an event
+ * worker while the master thread reads the following events. The master
+ * thread processes the events in the order they were received.
+ */
+typedef struct blr_event_job
+{
+    GWBUF                *event;      /*< Event with network header and OK byte */
+    REP_HEADER            hdr;        /*< Replication header of the event */
+    int                   semi_sync_send_ack; /*< Semi-sync ACK request of the event */
+    bool                  verify;     /*< Whether to verify the checksum */
+    bool                  encrypt;    /*< Whether to encrypt the event */
+    uint64_t              pos;        /*< Expected binlog position of the event */
+    uint8_t               nonce[AES_BLOCK_SIZE]; /*< Nonce used in encryption */
+    bool                  checksum_ok; /*< Result of the checksum verification */
+    GWBUF                *encrypted;  /*< The encrypted event */
+    bool                  done;       /*< Set when a worker has processed the job */
+    struct blr_event_job *next;       /*< Next job in the worker queue */
+} BLR_EVENT_JOB;
+
+/**
+ * The pool of event worker threads
+ */
+typedef struct blr_event_workers
+{
+    int              n_threads;       /*< Number of started threads */
+    THREAD          *threads;         /*< The worker threads */
+    pthread_mutex_t  lock;            /*< Protects the queue and job states */
+    pthread_cond_t   work;            /*< Signaled when jobs are queued */
+    pthread_cond_t   done;            /*< Signaled when a job is done */
+    BLR_EVENT_JOB   *head;            /*< First queued job */
+    BLR_EVENT_JOB   *tail;            /*< Last queued job */
+    bool             shutdown;        /*< Set when the threads should exit */
+} BLR_EVENT_WORKERS;
+
+/**
+ * The thread that compresses the closed binlog files
+ */
+typedef struct blr_compressor
+{
+    THREAD           thread;          /*< The compressor thread */
+    pthread_mutex_t  lock;            /*< Protects the request count */
+    pthread_cond_t   cond;            /*< Signaled when a binlog file is rotated */
+    int              requests;        /*< Number of unhandled requests */
+    bool             shutdown;        /*< Set when the thread should exit */
+} BLR_COMPRESSOR;
+
+/**
+ * A MariaDB 10 GTID and the position of its GTID event
+ */
+typedef struct blr_gtid_index_entry
+{
+    uint32_t         domain;          /*< Replication domain */
+    uint32_t         server_id;       /*< Server id */
+    uint64_t         seq;             /*< Sequence number */
+    uint32_t         file_no;         /*< Number of the binlog file */
+    uint64_t         pos;             /*< Position of the GTID event */
+} BLR_GTID_INDEX_ENTRY;
+
+/**
+ * The index from the MariaDB 10 GTIDs to the binlog positions
+ */
+typedef struct blr_gtid_index
+{
+    int              n_domains;       /*< Number of domains with an open index file */
+    uint32_t         domains[BLR_GTID_INDEX_MAX_DOMAINS]; /*< The domain ids */
+    int              fds[BLR_GTID_INDEX_MAX_DOMAINS];     /*< The index files */
+    uint64_t         n_entries[BLR_GTID_INDEX_MAX_DOMAINS]; /*< Entries in each file */
+    uint64_t         last_seq[BLR_GTID_INDEX_MAX_DOMAINS];  /*< Last sequence in each file */
+    BLR_GTID_INDEX_ENTRY *pending;    /*< Entries of the events not yet written */
+    int              n_pending;       /*< Number of pending entries */
+    int              pending_size;    /*< Allocated number of pending entries */
+    bool             full_warned;     /*< Too many domains has been logged */
+} BLR_GTID_INDEX;
+
 /**
  * The per instance data for the router.
  */
@@ -566,6 +713,8 @@ typedef struct router_instance
     unsigned int      short_burst;  /*< Short burst for slave catchup */
     unsigned int      long_burst;   /*< Long burst for slave catchup */
     unsigned long     burst_size;   /*< Maximum size of burst to send */
+    unsigned long     slave_write_buffer; /*< Size of the buffers the events for slaves
+                                           * are packed into, 0 if not used */
     unsigned long     heartbeat;    /*< Configured heartbeat value */
     ROUTER_STATS      stats;        /*< Statistics for this router */
     int               active_logs;
@@ -592,6 +741,22 @@ typedef struct router_instance
     int               master_semi_sync;     /*< Semi-Sync replication status of master server */
     BINLOG_ENCRYPTION_SETUP encryption;     /*< Binlog encryption setup */
     void              *encryption_ctx;      /*< Encryption context */
+    int               event_workers;        /*< Number of event worker threads */
+    BLR_EVENT_WORKERS *workers;             /*< Event workers, NULL if not used */
+    unsigned long     write_buffer_size;    /*< Size of the binlog write buffer */
+    uint8_t           *write_buffer;        /*< Events not yet written, NULL if not used */
+    unsigned long     write_buffer_len;     /*< Number of bytes in write_buffer */
+    int               binlog_sync;          /*< How the binlog file is synced */
+    uint64_t          publish_position;     /*< binlog_position after the next flush, 0 if unchanged */
+    uint64_t          publish_safe_event;   /*< current_safe_event after the next flush, 0 if unchanged */
+    unsigned long     checkpoint_interval;  /*< Bytes between binlog checkpoints, 0 if not used */
+    uint64_t          checkpoint_pos;       /*< Position of the last binlog checkpoint */
+    char              last_mariadb_gtid[BLR_GTID_MAXLEN + 1]; /*< Last MariaDB 10 GTID seen */
+    bool              binlog_compression;   /*< Compress the closed binlog files */
+    int               compression_keep;     /*< Newest binlog files left uncompressed */
+    BLR_COMPRESSOR    *compressor;          /*< Compressor thread, NULL if not used */
+    bool              binlog_gtid_index;    /*< Index the binlog files by MariaDB 10 GTID */
+    BLR_GTID_INDEX    *gtid_index;          /*< The GTID index, NULL if not used */
     struct router_instance  *next;
 } ROUTER_INSTANCE;
 
@@ -754,9 +919,14 @@ extern int blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool
 extern void blr_init_cache(ROUTER_INSTANCE *);
 
 extern int  blr_file_init(ROUTER_INSTANCE *);
-extern int  blr_write_binlog_record(ROUTER_INSTANCE *, REP_HEADER *, uint32_t pos, uint8_t *);
+extern int  blr_write_binlog_record(ROUTER_INSTANCE *, REP_HEADER *, uint32_t pos, uint8_t *,
+                                    BLR_EVENT_JOB *);
+extern GWBUF *blr_encrypt_event(ROUTER_INSTANCE *, uint8_t *, uint32_t, uint64_t, const uint8_t *);
 extern int  blr_file_rotate(ROUTER_INSTANCE *, char *, uint64_t);
-extern void blr_file_flush(ROUTER_INSTANCE *);
+extern bool blr_file_flush(ROUTER_INSTANCE *);
+extern int  blr_file_write(ROUTER_INSTANCE *, uint8_t *, uint32_t);
+extern bool blr_file_write_buffer(ROUTER_INSTANCE *);
+extern void blr_file_write_checkpoint(ROUTER_INSTANCE *);
 extern BLFILE *blr_open_binlog(ROUTER_INSTANCE *, char *);
 extern GWBUF *blr_read_binlog(ROUTER_INSTANCE *, BLFILE *, unsigned long, REP_HEADER *, char *,
                               const SLAVE_ENCRYPTION_CTX *);
@@ -766,6 +936,7 @@ extern int blr_statistics(ROUTER_INSTANCE *, ROUTER_SLAVE *, GWBUF *);
 extern int blr_ping(ROUTER_INSTANCE *, ROUTER_SLAVE *, GWBUF *);
 extern int blr_send_custom_error(DCB *, int, int, char *, char *, unsigned int);
 extern int blr_file_next_exists(ROUTER_INSTANCE *, ROUTER_SLAVE *);
+extern void blr_file_get_first(ROUTER_INSTANCE *, char *);
 uint32_t extract_field(uint8_t *src, int bits);
 void blr_cache_read_master_data(ROUTER_INSTANCE *router);
 int blr_read_events_all_events(ROUTER_INSTANCE *router, int fix, int debug);
@@ -776,6 +947,9 @@ void blr_cache_response(ROUTER_INSTANCE *router, char *response, GWBUF *buf);
 char * blr_last_event_description(ROUTER_INSTANCE *router);
 void blr_free_ssl_data(ROUTER_INSTANCE *inst);
 
+extern void blr_slave_batch_start(ROUTER_SLAVE *slave, bool cork);
+extern void blr_slave_batch_end(ROUTER_SLAVE *slave);
+extern void blr_slave_uncork(ROUTER_SLAVE *slave);
 extern bool blr_send_event(blr_thread_role_t role,
                            const char* binlog_name,
                            uint32_t binlog_pos,
@@ -783,6 +957,24 @@ extern bool blr_send_event(blr_thread_role_t role,
                            REP_HEADER *hdr,
                            uint8_t *buf);
 
+extern bool blr_event_workers_start(ROUTER_INSTANCE *);
+extern void blr_event_job_submit(ROUTER_INSTANCE *, BLR_EVENT_JOB *);
+extern void blr_event_job_wait(ROUTER_INSTANCE *, BLR_EVENT_JOB *);
+extern void blr_event_workers_stop(ROUTER_INSTANCE *);
+extern bool blr_event_checksum_ok(size_t, uint8_t *);
+
+extern bool blr_compress_start(ROUTER_INSTANCE *);
+extern void blr_compress_notify(ROUTER_INSTANCE *);
+extern void blr_compress_stop(ROUTER_INSTANCE *);
+extern BLR_COMPRESSED_FILE *blr_compressed_open(int, const char *);
+extern void blr_compressed_close(BLR_COMPRESSED_FILE *);
+extern ssize_t blr_compressed_pread(int, BLR_COMPRESSED_FILE *, uint8_t *, size_t, uint64_t);
+extern BLR_GTID_INDEX *blr_gtid_index_create(void);
+extern bool blr_gtid_index_add(ROUTER_INSTANCE *, uint32_t, uint32_t, uint64_t, uint64_t);
+extern void blr_gtid_index_flush(ROUTER_INSTANCE *);
+extern void blr_gtid_index_discard(ROUTER_INSTANCE *, uint64_t);
+extern bool blr_gtid_index_find(ROUTER_INSTANCE *, const char *, char *, uint64_t *, char *);
+
 extern const char *blr_get_encryption_algorithm(int);
 extern int blr_check_encryption_algorithm(char *);
 extern const char *blr_encryption_algorithm_list(void);
@@ -0,0 +1,824 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file blr_compress.c - Compressed storage of the closed binlog files
+ *
+ * When binlog compression is enabled, a thread compresses the binlog files
+ * that the router no longer writes to. The newest binlog files, the current
+ * one included, are left as they are.
+ *
+ * A compressed binlog file has the name of the binlog file followed by
+ * BINLOG_COMPRESSED_SUFFIX. All numbers are stored in little endian byte
+ * order and the file consists of:
+ *
+ * header   magic (4 bytes), version (1), unused (3), block size (4), unused (4)
+ * blocks   uncompressed length (4), stored length (4), CRC32 of the stored
+ *          bytes (4), compression (1) followed by the stored bytes
+ * index    file offset of each block (8 bytes per block)
+ * trailer  size of the binlog file (8), offset of the index (8),
+ *          number of blocks (4), magic (4)
+ *
+ * Every block except the last holds exactly block size bytes of the binlog
+ * file, so the block of a binlog position is found directly from the index.
+ * The slaves read the compressed files through a small cache of decompressed
+ * blocks, which keeps reading the events one after another cheap.
+ */
+
+#include "blr.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <maxscale/alloc.h>
+#include <maxscale/log_manager.h>
+
+#define BLR_COMPRESSED_MAGIC            "MXBZ"
+#define BLR_COMPRESSED_MAGIC_LEN        4
+#define BLR_COMPRESSED_VERSION          1
+#define BLR_COMPRESSED_HEADER_LEN       16
+#define BLR_COMPRESSED_BLOCK_HEADER_LEN 13
+#define BLR_COMPRESSED_TRAILER_LEN      24
+
+/** Largest block size accepted when a compressed file is opened */
+#define BLR_COMPRESSED_MAX_BLOCK_SIZE   (16 * 1024 * 1024)
+
+#define BLR_COMPRESSION_NONE            0
+#define BLR_COMPRESSION_ZLIB            1
+
+static inline void write_le32(uint8_t *ptr, uint32_t value)
+{
+    ptr[0] = value;
+    ptr[1] = value >> 8;
+    ptr[2] = value >> 16;
+    ptr[3] = value >> 24;
+}
+
+static inline uint32_t read_le32(const uint8_t *ptr)
+{
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+           ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+static inline void write_le64(uint8_t *ptr, uint64_t value)
+{
+    write_le32(ptr, value);
+    write_le32(ptr + 4, value >> 32);
+}
+
+static inline uint64_t read_le64(const uint8_t *ptr)
+{
+    return (uint64_t)read_le32(ptr) | ((uint64_t)read_le32(ptr + 4) << 32);
+}
+
+/**
+ * Write a buffer completely
+ *
+ * @return True if all bytes were written
+ */
+static bool write_all(int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        buf += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+/**
+ * Read from a file until the buffer is full or the end of the file is reached
+ *
+ * @return Number of bytes read or -1 on error
+ */
+static ssize_t read_full(int fd, uint8_t *buf, size_t len, uint64_t pos)
+{
+    size_t total = 0;
+
+    while (total < len)
+    {
+        ssize_t n = pread(fd, buf + total, len - total, pos + total);
+
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return -1;
+        }
+        else if (n == 0)
+        {
+            break;
+        }
+
+        total += n;
+    }
+
+    return total;
+}
+
+/**
+ * Compress one closed binlog file
+ *
+ * The compressed file is written under a temporary name and renamed when it
+ * is complete. The original file is removed only after that, so a slave that
+ * opens the binlog file always finds one of the two. Slaves that already have
+ * the original file open keep reading it.
+ *
+ * @param router The router instance
+ * @param binlog Name of the binlog file
+ * @return True if the file was compressed
+ */
+static bool compress_binlog(ROUTER_INSTANCE *router, const char *binlog)
+{
+    char path[PATH_MAX + 1];
+    char zpath[PATH_MAX + 1];
+    char tmp_path[PATH_MAX + 1];
+    char err_msg[MXS_STRERROR_BUFLEN];
+
+    snprintf(path, sizeof(path), "%s/%s", router->binlogdir, binlog);
+    snprintf(zpath, sizeof(zpath), "%s" BINLOG_COMPRESSED_SUFFIX, path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", zpath);
+
+    int in = open(path, O_RDONLY);
+
+    if (in == -1)
+    {
+        MXS_ERROR("%s: Failed to open binlog file %s for compression, %s.",
+                  router->service->name, path, strerror_r(errno, err_msg, sizeof(err_msg)));
+        return false;
+    }
+
+    int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (out == -1)
+    {
+        MXS_ERROR("%s: Failed to create compressed binlog file %s, %s.",
+                  router->service->name, tmp_path, strerror_r(errno, err_msg, sizeof(err_msg)));
+        close(in);
+        return false;
+    }
+
+    uLongf bound = compressBound(BINLOG_COMPRESSED_BLOCK_SIZE);
+    uint8_t *raw = MXS_MALLOC(BINLOG_COMPRESSED_BLOCK_SIZE);
+    uint8_t *stored = MXS_MALLOC(BLR_COMPRESSED_BLOCK_HEADER_LEN + bound);
+    uint8_t *index = NULL;
+    uint32_t n_blocks = 0;
+    uint32_t index_capacity = 0;
+    uint64_t raw_size = 0;
+    uint64_t offset = BLR_COMPRESSED_HEADER_LEN;
+    uint8_t header[BLR_COMPRESSED_HEADER_LEN] = "";
+    bool ok = raw && stored;
+
+    memcpy(header, BLR_COMPRESSED_MAGIC, BLR_COMPRESSED_MAGIC_LEN);
+    header[BLR_COMPRESSED_MAGIC_LEN] = BLR_COMPRESSED_VERSION;
+    write_le32(header + 8, BINLOG_COMPRESSED_BLOCK_SIZE);
+
+    ok = ok && write_all(out, header, sizeof(header));
+
+    while (ok)
+    {
+        ssize_t n = read_full(in, raw, BINLOG_COMPRESSED_BLOCK_SIZE, raw_size);
+
+        if (n <= 0)
+        {
+            ok = n == 0;
+            break;
+        }
+
+        if (n_blocks == index_capacity)
+        {
+            index_capacity = index_capacity ? index_capacity * 2 : 1024;
+            uint8_t *new_index = MXS_REALLOC(index, index_capacity * sizeof(uint64_t));
+
+            if (new_index == NULL)
+            {
+                ok = false;
+                break;
+            }
+
+            index = new_index;
+        }
+
+        write_le64(index + n_blocks * sizeof(uint64_t), offset);
+        n_blocks++;
+
+        uint8_t *data = stored + BLR_COMPRESSED_BLOCK_HEADER_LEN;
+        uLongf stored_len = bound;
+        uint8_t compression = BLR_COMPRESSION_ZLIB;
+
+        if (compress2(data, &stored_len, raw, n, Z_BEST_SPEED) != Z_OK ||
+            stored_len >= (uLongf)n)
+        {
+            // Not worth compressing
+            memcpy(data, raw, n);
+            stored_len = n;
+            compression = BLR_COMPRESSION_NONE;
+        }
+
+        write_le32(stored, n);
+        write_le32(stored + 4, stored_len);
+        write_le32(stored + 8, crc32(crc32(0L, Z_NULL, 0), data, stored_len));
+        stored[12] = compression;
+
+        ok = write_all(out, stored, BLR_COMPRESSED_BLOCK_HEADER_LEN + stored_len);
+        offset += BLR_COMPRESSED_BLOCK_HEADER_LEN + stored_len;
+        raw_size += n;
+
+        if (n < BINLOG_COMPRESSED_BLOCK_SIZE)
+        {
+            break;
+        }
+    }
+
+    if (ok)
+    {
+        uint8_t trailer[BLR_COMPRESSED_TRAILER_LEN];
+        write_le64(trailer, raw_size);
+        write_le64(trailer + 8, offset);
+        write_le32(trailer + 16, n_blocks);
+        memcpy(trailer + 20, BLR_COMPRESSED_MAGIC, BLR_COMPRESSED_MAGIC_LEN);
+
+        ok = (n_blocks == 0 || write_all(out, index, n_blocks * sizeof(uint64_t))) &&
+             write_all(out, trailer, sizeof(trailer)) &&
+             fsync(out) == 0;
+    }
+
+    if (!ok)
+    {
+        MXS_ERROR("%s: Failed to compress binlog file %s, %s.",
+                  router->service->name, path, strerror_r(errno, err_msg, sizeof(err_msg)));
+    }
+
+    MXS_FREE(raw);
+    MXS_FREE(stored);
+    MXS_FREE(index);
+    close(in);
+
+    if (close(out) != 0 || !ok || rename(tmp_path, zpath) != 0)
+    {
+        unlink(tmp_path);
+        return false;
+    }
+
+    if (unlink(path) != 0)
+    {
+        MXS_ERROR("%s: Failed to remove binlog file %s after compressing it, %s.",
+                  router->service->name, path, strerror_r(errno, err_msg, sizeof(err_msg)));
+    }
+
+    MXS_INFO("%s: Compressed binlog file %s from %lu to %lu bytes.",
+             router->service->name, binlog, raw_size,
+             offset + n_blocks * sizeof(uint64_t) + BLR_COMPRESSED_TRAILER_LEN);
+
+    return true;
+}
+
+/**
+ * Check whether a directory entry is a binlog file of the router
+ *
+ * @param router The router instance
+ * @param name   Name of the directory entry
+ * @return The number of the binlog file or 0 if it is not a binlog file
+ */
+static int binlog_file_number(ROUTER_INSTANCE *router, const char *name)
+{
+    size_t root_len = strlen(router->fileroot);
+
+    if (strncmp(name, router->fileroot, root_len) != 0 || name[root_len] != '.')
+    {
+        return 0;
+    }
+
+    const char *digits = name + root_len + 1;
+
+    if (*digits == '\0' || strspn(digits, "0123456789") != strlen(digits))
+    {
+        return 0;
+    }
+
+    return atoi(digits);
+}
+
+/**
+ * Check whether the compressor thread has been asked to stop
+ *
+ * @param router The router instance
+ * @return True if the thread should exit
+ */
+static bool compress_stopping(ROUTER_INSTANCE *router)
+{
+    BLR_COMPRESSOR *compressor = router->compressor;
+
+    pthread_mutex_lock(&compressor->lock);
+    bool rval = compressor->shutdown;
+    pthread_mutex_unlock(&compressor->lock);
+
+    return rval;
+}
+
+/**
+ * Compress the binlog files that are older than the newest
+ * router->compression_keep files
+ *
+ * @param router The router instance
+ */
+static void compress_closed_binlogs(ROUTER_INSTANCE *router)
+{
+    char current[BINLOG_FNAMELEN + 1];
+
+    spinlock_acquire(&router->binlog_lock);
+    strcpy(current, router->binlog_name);
+    spinlock_release(&router->binlog_lock);
+
+    char *sptr = strrchr(current, '.');
+
+    if (sptr == NULL)
+    {
+        return;
+    }
+
+    int last = atoi(sptr + 1) - router->compression_keep;
+    DIR *dirp = opendir(router->binlogdir);
+
+    if (dirp == NULL)
+    {
+        char err_msg[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("%s: Unable to read the binlog directory %s, %s.",
+                  router->service->name, router->binlogdir,
+                  strerror_r(errno, err_msg, sizeof(err_msg)));
+        return;
+    }
+
+    /** The files are compressed after the directory has been read */
+    int *files = NULL;
+    int n_files = 0;
+    int capacity = 0;
+    struct dirent *dp;
+
+    while ((dp = readdir(dirp)) != NULL)
+    {
+        int n = binlog_file_number(router, dp->d_name);
+
+        if (n > 0 && n <= last)
+        {
+            if (n_files == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 16;
+                int *new_files = MXS_REALLOC(files, capacity * sizeof(int));
+
+                if (new_files == NULL)
+                {
+                    break;
+                }
+
+                files = new_files;
+            }
+
+            files[n_files++] = n;
+        }
+    }
+
+    closedir(dirp);
+
+    for (int i = 0; i < n_files && !compress_stopping(router); i++)
+    {
+        char binlog[BINLOG_FNAMELEN + 1];
+        snprintf(binlog, sizeof(binlog), BINLOG_NAMEFMT, router->fileroot, files[i]);
+
+        if (compress_binlog(router, binlog))
+        {
+            atomic_add_uint64(&router->stats.n_compressed, 1);
+        }
+    }
+
+    MXS_FREE(files);
+}
+
+/**
+ * Remove the temporary files of compressions that were interrupted
+ *
+ * @param router The router instance
+ */
+static void remove_stale_files(ROUTER_INSTANCE *router)
+{
+    const char suffix[] = BINLOG_COMPRESSED_SUFFIX ".tmp";
+    const size_t suffix_len = sizeof(suffix) - 1;
+    DIR *dirp = opendir(router->binlogdir);
+
+    if (dirp == NULL)
+    {
+        return;
+    }
+
+    struct dirent *dp;
+
+    while ((dp = readdir(dirp)) != NULL)
+    {
+        size_t len = strlen(dp->d_name);
+        char binlog[BINLOG_FNAMELEN + 1];
+
+        if (len > suffix_len && len - suffix_len <= BINLOG_FNAMELEN &&
+            strcmp(dp->d_name + len - suffix_len, suffix) == 0)
+        {
+            memcpy(binlog, dp->d_name, len - suffix_len);
+            binlog[len - suffix_len] = '\0';
+
+            if (binlog_file_number(router, binlog) > 0)
+            {
+                char path[PATH_MAX + 1];
+                snprintf(path, sizeof(path), "%s/%s", router->binlogdir, dp->d_name);
+
+                if (unlink(path) == 0)
+                {
+                    MXS_NOTICE("%s: Removed the incomplete compressed file %s.",
+                               router->service->name, path);
+                }
+            }
+        }
+    }
+
+    closedir(dirp);
+}
+
+/**
+ * The compressor thread main loop
+ *
+ * @param data The router instance
+ */
+static void compressor_main(void *data)
+{
+    ROUTER_INSTANCE *router = (ROUTER_INSTANCE*)data;
+    BLR_COMPRESSOR *compressor = router->compressor;
+
+    pthread_mutex_lock(&compressor->lock);
+
+    while (true)
+    {
+        while (compressor->requests == 0 && !compressor->shutdown)
+        {
+            pthread_cond_wait(&compressor->cond, &compressor->lock);
+        }
+
+        if (compressor->shutdown)
+        {
+            break;
+        }
+
+        compressor->requests = 0;
+        pthread_mutex_unlock(&compressor->lock);
+
+        compress_closed_binlogs(router);
+
+        pthread_mutex_lock(&compressor->lock);
+    }
+
+    pthread_mutex_unlock(&compressor->lock);
+}
+
+/**
+ * @brief Start the binlog compressor thread
+ *
+ * The temporary files of interrupted compressions are removed and the closed
+ * binlog files found in the binlog directory are compressed right away.
+ *
+ * @param router The router instance with @c binlog_compression set
+ * @return True if the thread was started
+ */
+bool blr_compress_start(ROUTER_INSTANCE *router)
+{
+    BLR_COMPRESSOR *compressor = MXS_CALLOC(1, sizeof(BLR_COMPRESSOR));
+
+    if (compressor == NULL)
+    {
+        return false;
+    }
+
+    remove_stale_files(router);
+
+    pthread_mutex_init(&compressor->lock, NULL);
+    pthread_cond_init(&compressor->cond, NULL);
+    compressor->requests = 1;
+    router->compressor = compressor;
+
+    if (thread_start(&compressor->thread, compressor_main, router) == NULL)
+    {
+        MXS_ERROR("%s: Failed to start the binlog compressor thread, "
+                  "binlog files are not compressed.", router->service->name);
+        router->compressor = NULL;
+        pthread_mutex_destroy(&compressor->lock);
+        pthread_cond_destroy(&compressor->cond);
+        MXS_FREE(compressor);
+        return false;
+    }
+
+    MXS_NOTICE("%s: Compressing binlog files older than the newest %d files.",
+               router->service->name, router->compression_keep);
+
+    return true;
+}
+
+/**
+ * @brief Tell the compressor thread that a binlog file has been closed
+ *
+ * @param router The router instance
+ */
+void blr_compress_notify(ROUTER_INSTANCE *router)
+{
+    BLR_COMPRESSOR *compressor = router->compressor;
+
+    if (compressor)
+    {
+        pthread_mutex_lock(&compressor->lock);
+        compressor->requests++;
+        pthread_cond_signal(&compressor->cond);
+        pthread_mutex_unlock(&compressor->lock);
+    }
+}
+
+/**
+ * @brief Stop the compressor thread
+ *
+ * A binlog file that is being compressed is finished before the thread
+ * exits, the remaining ones are compressed when the router is started again.
+ *
+ * @param router The router instance
+ */
+void blr_compress_stop(ROUTER_INSTANCE *router)
+{
+    BLR_COMPRESSOR *compressor = router->compressor;
+
+    if (compressor)
+    {
+        pthread_mutex_lock(&compressor->lock);
+        compressor->shutdown = true;
+        pthread_cond_signal(&compressor->cond);
+        pthread_mutex_unlock(&compressor->lock);
+
+        thread_wait(compressor->thread);
+
+        router->compressor = NULL;
+        pthread_mutex_destroy(&compressor->lock);
+        pthread_cond_destroy(&compressor->cond);
+        MXS_FREE(compressor);
+    }
+}
+
+/**
+ * @brief Open a compressed binlog file for reading
+ *
+ * @param fd   Descriptor of the compressed file
+ * @param path Path of the compressed file, used in error messages
+ * @return The block index of the file or NULL if the file is not valid
+ */
+BLR_COMPRESSED_FILE *blr_compressed_open(int fd, const char *path)
+{
+    struct stat statb;
+    uint8_t header[BLR_COMPRESSED_HEADER_LEN];
+    uint8_t trailer[BLR_COMPRESSED_TRAILER_LEN];
+
+    if (fstat(fd, &statb) != 0 ||
+        statb.st_size < BLR_COMPRESSED_HEADER_LEN + BLR_COMPRESSED_TRAILER_LEN ||
+        read_full(fd, header, sizeof(header), 0) != sizeof(header) ||
+        read_full(fd, trailer, sizeof(trailer), statb.st_size - sizeof(trailer)) != sizeof(trailer) ||
+        memcmp(header, BLR_COMPRESSED_MAGIC, BLR_COMPRESSED_MAGIC_LEN) != 0 ||
+        memcmp(trailer + 20, BLR_COMPRESSED_MAGIC, BLR_COMPRESSED_MAGIC_LEN) != 0)
+    {
+        MXS_ERROR("%s is not a compressed binlog file.", path);
+        return NULL;
+    }
+
+    if (header[BLR_COMPRESSED_MAGIC_LEN] != BLR_COMPRESSED_VERSION)
+    {
+        MXS_ERROR("Unsupported compressed binlog file version %d in %s.",
+                  header[BLR_COMPRESSED_MAGIC_LEN], path);
+        return NULL;
+    }
+
+    uint32_t block_size = read_le32(header + 8);
+    uint64_t raw_size = read_le64(trailer);
+    uint64_t index_offset = read_le64(trailer + 8);
+    uint32_t n_blocks = read_le32(trailer + 16);
+
+    if (block_size == 0 || block_size > BLR_COMPRESSED_MAX_BLOCK_SIZE ||
+        n_blocks != (raw_size + block_size - 1) / block_size ||
+        index_offset + (uint64_t)n_blocks * sizeof(uint64_t) + sizeof(trailer) != (uint64_t)statb.st_size)
+    {
+        MXS_ERROR("The block index of compressed binlog file %s is corrupt.", path);
+        return NULL;
+    }
+
+    BLR_COMPRESSED_FILE *file = MXS_CALLOC(1, sizeof(BLR_COMPRESSED_FILE));
+
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_init(&file->lock, NULL);
+    file->index = MXS_MALLOC(n_blocks * sizeof(uint64_t) + 1);
+    file->stored = MXS_MALLOC(BLR_COMPRESSED_BLOCK_HEADER_LEN + compressBound(block_size));
+
+    bool ok = file->index && file->stored &&
+              read_full(fd, (uint8_t*)file->index, n_blocks * sizeof(uint64_t), index_offset) ==
+              (ssize_t)(n_blocks * sizeof(uint64_t));
+
+    for (int i = 0; ok && i < BINLOG_COMPRESSED_CACHE_BLOCKS; i++)
+    {
+        ok = (file->cache[i].data = MXS_MALLOC(block_size)) != NULL;
+    }
+
+    if (!ok)
+    {
+        MXS_ERROR("Failed to read the block index of compressed binlog file %s.", path);
+        blr_compressed_close(file);
+        return NULL;
+    }
+
+    /** The offsets are converted in place from their stored byte order */
+    for (uint32_t i = 0; i < n_blocks; i++)
+    {
+        file->index[i] = read_le64((uint8_t*)&file->index[i]);
+    }
+
+    file->raw_size = raw_size;
+    file->block_size = block_size;
+    file->n_blocks = n_blocks;
+
+    return file;
+}
+
+/**
+ * @brief Free the block index and the block cache of a compressed binlog file
+ *
+ * @param file The compressed file, may be NULL
+ */
+void blr_compressed_close(BLR_COMPRESSED_FILE *file)
+{
+    if (file)
+    {
+        pthread_mutex_destroy(&file->lock);
+
+        for (int i = 0; i < BINLOG_COMPRESSED_CACHE_BLOCKS; i++)
+        {
+            MXS_FREE(file->cache[i].data);
+        }
+
+        MXS_FREE(file->index);
+        MXS_FREE(file->stored);
+        MXS_FREE(file);
+    }
+}
+
+/**
+ * Get a decompressed block, from the cache if possible
+ *
+ * The least recently used block in the cache is replaced with the block.
+ *
+ * @param fd    Descriptor of the compressed file
+ * @param file  The compressed file, its lock must be held
+ * @param block Number of the block
+ * @return The cached block or NULL if the block could not be read
+ */
+static BLR_COMPRESSED_BLOCK *get_block(int fd, BLR_COMPRESSED_FILE *file, uint32_t block)
+{
+    BLR_COMPRESSED_BLOCK *slot = &file->cache[0];
+
+    file->n_reads++;
+
+    for (int i = 0; i < BINLOG_COMPRESSED_CACHE_BLOCKS; i++)
+    {
+        BLR_COMPRESSED_BLOCK *cached = &file->cache[i];
+
+        if (cached->len && cached->block == block)
+        {
+            cached->last_used = file->n_reads;
+            return cached;
+        }
+
+        if (cached->last_used < slot->last_used)
+        {
+            slot = cached;
+        }
+    }
+
+    uint8_t *header = file->stored;
+    uint64_t remaining = file->raw_size - (uint64_t)block * file->block_size;
+    uint32_t expected = MXS_MIN(remaining, file->block_size);
+    uLongf bound = compressBound(file->block_size);
+
+    if (read_full(fd, header, BLR_COMPRESSED_BLOCK_HEADER_LEN, file->index[block]) !=
+        BLR_COMPRESSED_BLOCK_HEADER_LEN)
+    {
+        return NULL;
+    }
+
+    uint32_t raw_len = read_le32(header);
+    uint32_t stored_len = read_le32(header + 4);
+    uint32_t crc = read_le32(header + 8);
+    uint8_t compression = header[12];
+    uint8_t *stored = header + BLR_COMPRESSED_BLOCK_HEADER_LEN;
+
+    if (raw_len != expected || stored_len > bound ||
+        (compression != BLR_COMPRESSION_ZLIB &&
+         (compression != BLR_COMPRESSION_NONE || stored_len != raw_len)) ||
+        read_full(fd, stored, stored_len, file->index[block] + BLR_COMPRESSED_BLOCK_HEADER_LEN) !=
+        (ssize_t)stored_len ||
+        crc32(crc32(0L, Z_NULL, 0), stored, stored_len) != crc)
+    {
+        return NULL;
+    }
+
+    /** The slot is reused, so it is invalid until the block has been decompressed */
+    slot->len = 0;
+
+    if (compression == BLR_COMPRESSION_ZLIB)
+    {
+        uLongf len = raw_len;
+
+        if (uncompress(slot->data, &len, stored, stored_len) != Z_OK || len != raw_len)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        memcpy(slot->data, stored, raw_len);
+    }
+
+    slot->block = block;
+    slot->len = raw_len;
+    slot->last_used = file->n_reads;
+
+    return slot;
+}
+
+/**
+ * @brief Read bytes of the original binlog file from a compressed binlog file
+ *
+ * This behaves like pread(2) on the original binlog file.
+ *
+ * @param fd   Descriptor of the compressed file
+ * @param file The compressed file
+ * @param dest Where to copy the bytes
+ * @param n    Number of bytes to read
+ * @param pos  Position in the original binlog file
+ * @return Number of bytes read, 0 at the end of the file or -1 on error
+ */
+ssize_t blr_compressed_pread(int fd, BLR_COMPRESSED_FILE *file, uint8_t *dest, size_t n, uint64_t pos)
+{
+    size_t copied = 0;
+
+    pthread_mutex_lock(&file->lock);
+
+    while (copied < n && pos < file->raw_size)
+    {
+        uint32_t block = pos / file->block_size;
+        BLR_COMPRESSED_BLOCK *cached = get_block(fd, file, block);
+
+        if (cached == NULL)
+        {
+            pthread_mutex_unlock(&file->lock);
+            MXS_ERROR("Failed to read block %u of a compressed binlog file.", block);
+            errno = EIO;
+            return -1;
+        }
+
+        uint32_t offset = pos - (uint64_t)block * file->block_size;
+        size_t len = MXS_MIN(n - copied, cached->len - offset);
+
+        memcpy(dest + copied, cached->data + offset, len);
+        copied += len;
+        pos += len;
+    }
+
+    pthread_mutex_unlock(&file->lock);
+
+    return copied;
+}
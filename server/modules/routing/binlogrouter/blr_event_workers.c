@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file blr_event_workers.c - Offloaded processing of events from the master
+ *
+ * The thread that reads the replication stream from the master hands the
+ * complete events over to a pool of event workers. The workers verify the
+ * event checksums and encrypt the events. The master thread then processes
+ * the events in the order they were received, writes them to the binlog
+ * and notifies the slaves.
+ */
+
+#include "blr.h"
+
+#include <maxscale/alloc.h>
+#include <maxscale/log_manager.h>
+
+/**
+ * Check that the stored event checksum matches the calculated checksum
+ *
+ * @param len Length of the event with the network header and the OK byte
+ * @param ptr Start of the event
+ * @return True if the checksum matches
+ */
+bool blr_event_checksum_ok(size_t len, uint8_t *ptr)
+{
+    uint32_t offset = MYSQL_HEADER_LEN + 1;
+    uint32_t size = len - (offset + MYSQL_CHECKSUM_LEN);
+
+    uint32_t checksum = crc32(0L, ptr + offset, size);
+    uint32_t pktsum = EXTRACT32(ptr + offset + size);
+
+    return pktsum == checksum;
+}
+
+/**
+ * Process one event
+ *
+ * @param router The router instance
+ * @param job    The event to process
+ */
+static void process_job(ROUTER_INSTANCE *router, BLR_EVENT_JOB *job)
+{
+    uint8_t *ptr = GWBUF_DATA(job->event);
+    size_t len = gwbuf_length(job->event);
+    uint32_t offset = MYSQL_HEADER_LEN + 1;
+
+    job->checksum_ok = !job->verify || blr_event_checksum_ok(len, ptr);
+
+    if (job->checksum_ok && job->encrypt)
+    {
+        job->encrypted = blr_encrypt_event(router, ptr + offset, len - offset,
+                                           job->pos, job->nonce);
+    }
+}
+
+/**
+ * The event worker main loop
+ *
+ * The queued events are processed before the thread exits so that nobody
+ * is left waiting for them.
+ *
+ * @param data The router instance
+ */
+static void event_worker_main(void *data)
+{
+    ROUTER_INSTANCE *router = (ROUTER_INSTANCE*)data;
+    BLR_EVENT_WORKERS *workers = router->workers;
+
+    pthread_mutex_lock(&workers->lock);
+
+    while (true)
+    {
+        while (workers->head == NULL && !workers->shutdown)
+        {
+            pthread_cond_wait(&workers->work, &workers->lock);
+        }
+
+        if (workers->head == NULL)
+        {
+            break;
+        }
+
+        BLR_EVENT_JOB *job = workers->head;
+        workers->head = job->next;
+
+        if (workers->head == NULL)
+        {
+            workers->tail = NULL;
+        }
+
+        pthread_mutex_unlock(&workers->lock);
+
+        process_job(router, job);
+
+        pthread_mutex_lock(&workers->lock);
+        job->done = true;
+        pthread_cond_broadcast(&workers->done);
+    }
+
+    pthread_mutex_unlock(&workers->lock);
+}
+
+/**
+ * @brief Start the event worker threads
+ *
+ * If no threads could be started, the master thread processes the events.
+ *
+ * @param router The router instance with @c event_workers set
+ * @return True if all worker threads were started
+ */
+bool blr_event_workers_start(ROUTER_INSTANCE *router)
+{
+    BLR_EVENT_WORKERS *workers = MXS_CALLOC(1, sizeof(BLR_EVENT_WORKERS));
+    THREAD *threads = MXS_CALLOC(router->event_workers, sizeof(THREAD));
+
+    if (workers == NULL || threads == NULL)
+    {
+        MXS_FREE(workers);
+        MXS_FREE(threads);
+        return false;
+    }
+
+    pthread_mutex_init(&workers->lock, NULL);
+    pthread_cond_init(&workers->work, NULL);
+    pthread_cond_init(&workers->done, NULL);
+    workers->threads = threads;
+    router->workers = workers;
+
+    for (int i = 0; i < router->event_workers; i++)
+    {
+        if (thread_start(&workers->threads[i], event_worker_main, router) == NULL)
+        {
+            MXS_ERROR("%s: Failed to start event worker thread %d, using %d "
+                      "event worker threads.", router->service->name, i, workers->n_threads);
+            break;
+        }
+
+        workers->n_threads++;
+    }
+
+    if (workers->n_threads == 0)
+    {
+        router->workers = NULL;
+        pthread_mutex_destroy(&workers->lock);
+        pthread_cond_destroy(&workers->work);
+        pthread_cond_destroy(&workers->done);
+        MXS_FREE(threads);
+        MXS_FREE(workers);
+    }
+    else
+    {
+        MXS_NOTICE("%s: Processing events from the master with %d event worker threads.",
+                   router->service->name, workers->n_threads);
+    }
+
+    return router->workers && workers->n_threads == router->event_workers;
+}
+
+/**
+ * @brief Stop the event worker threads
+ *
+ * The events that are still queued are processed before the threads exit.
+ * After this the master thread processes the events itself.
+ *
+ * @param router The router instance
+ */
+void blr_event_workers_stop(ROUTER_INSTANCE *router)
+{
+    BLR_EVENT_WORKERS *workers = router->workers;
+
+    if (workers)
+    {
+        pthread_mutex_lock(&workers->lock);
+        workers->shutdown = true;
+        pthread_cond_broadcast(&workers->work);
+        pthread_mutex_unlock(&workers->lock);
+
+        for (int i = 0; i < workers->n_threads; i++)
+        {
+            thread_wait(workers->threads[i]);
+        }
+
+        router->workers = NULL;
+        pthread_mutex_destroy(&workers->lock);
+        pthread_cond_destroy(&workers->work);
+        pthread_cond_destroy(&workers->done);
+        MXS_FREE(workers->threads);
+        MXS_FREE(workers);
+    }
+}
+
+/**
+ * @brief Queue an event for the event workers
+ *
+ * @param router The router instance
+ * @param job    The event, it must not be modified until blr_event_job_wait()
+ *               has returned
+ */
+void blr_event_job_submit(ROUTER_INSTANCE *router, BLR_EVENT_JOB *job)
+{
+    BLR_EVENT_WORKERS *workers = router->workers;
+    ss_dassert(workers);
+
+    job->done = false;
+    job->next = NULL;
+
+    pthread_mutex_lock(&workers->lock);
+
+    if (workers->tail)
+    {
+        workers->tail->next = job;
+    }
+    else
+    {
+        workers->head = job;
+    }
+
+    workers->tail = job;
+    pthread_cond_signal(&workers->work);
+    pthread_mutex_unlock(&workers->lock);
+}
+
+/**
+ * @brief Wait until an event has been processed
+ *
+ * @param router The router instance
+ * @param job    A job queued with blr_event_job_submit()
+ */
+void blr_event_job_wait(ROUTER_INSTANCE *router, BLR_EVENT_JOB *job)
+{
+    BLR_EVENT_WORKERS *workers = router->workers;
+
+    pthread_mutex_lock(&workers->lock);
+
+    while (!job->done)
+    {
+        pthread_cond_wait(&workers->done, &workers->lock);
+    }
+
+    pthread_mutex_unlock(&workers->lock);
+}
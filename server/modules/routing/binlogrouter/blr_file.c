@@ -163,6 +163,7 @@ static const char blr_encryption_algorithm_list_names[] = "aes_cbc";
 #endif
 
 static int  blr_file_create(ROUTER_INSTANCE *router, char *file);
+static void blr_file_checkpoint_path(ROUTER_INSTANCE *router, const char *binlog, char *path);
 static void blr_log_header(int priority, char *msg, uint8_t *ptr);
 void blr_cache_read_master_data(ROUTER_INSTANCE *router);
 int blr_file_get_next_binlogname(ROUTER_INSTANCE *router);
@@ -415,11 +416,23 @@ blr_file_create(ROUTER_INSTANCE *router, char *file)
 
     int fd = open(path, O_RDWR | O_CREAT, 0666);
 
+    /** The events of the previous file must have been written */
+    ss_dassert(router->write_buffer_len == 0);
+
     if (fd != -1)
     {
         if (blr_file_add_magic(fd))
         {
             close(router->binlog_fd);
+
+            /** Only the current binlog file is checked at startup */
+            if (router->checkpoint_interval && *router->binlog_name)
+            {
+                char chk_path[PATH_MAX + 1];
+                blr_file_checkpoint_path(router, router->binlog_name, chk_path);
+                unlink(chk_path);
+            }
+
             spinlock_acquire(&router->binlog_lock);
             strcpy(router->binlog_name, file);
             router->binlog_fd = fd;
@@ -427,9 +440,13 @@ blr_file_create(ROUTER_INSTANCE *router, char *file)
             router->binlog_position = BINLOG_MAGIC_SIZE;
             router->current_safe_event = BINLOG_MAGIC_SIZE;
             router->last_written = BINLOG_MAGIC_SIZE;
+            router->checkpoint_pos = BINLOG_MAGIC_SIZE;
             spinlock_release(&router->binlog_lock);
 
             created = 1;
+
+            /** The previous binlog file is now closed */
+            blr_compress_notify(router);
         }
         else
         {
@@ -517,10 +534,14 @@ blr_file_append(ROUTER_INSTANCE *router, char *file)
  * @param router The router instance
  * @param buf    The binlog record
  * @param len    The length of the binlog record
+ * @param job    The event job of the record or NULL. If an event worker has
+ *               already encrypted the record at the current position, the
+ *               encrypted record is written.
  * @return       Return the number of bytes written
  */
 int
-blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint32_t size, uint8_t *buf)
+blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint32_t size, uint8_t *buf,
+                        BLR_EVENT_JOB *job)
 {
     int n = 0;
     bool write_start_encryption_event = false;
@@ -550,9 +571,32 @@ blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint32_t size,
 
     if (router->encryption.enabled && router->encryption_ctx != NULL)
     {
-        GWBUF *encrypted;
+        GWBUF *encrypted = NULL;
         uint8_t *encr_ptr;
-        if ((encrypted = blr_prepare_encrypted_event(router,
+        BINLOG_ENCRYPTION_CTX *encryption_ctx = (BINLOG_ENCRYPTION_CTX *)(router->encryption_ctx);
+
+        if (job && job->encrypted)
+        {
+            /**
+             * The worker used the position and the nonce that were expected
+             * when the event was received. They differ if a hole was filled
+             * or the binlog file was rotated after that.
+             */
+            if (job->pos == router->current_pos &&
+                memcmp(job->nonce, encryption_ctx->nonce, BLRM_NONCE_LENGTH) == 0)
+            {
+                encrypted = job->encrypted;
+            }
+            else
+            {
+                gwbuf_free(job->encrypted);
+                router->stats.n_reencrypted++;
+            }
+            job->encrypted = NULL;
+        }
+
+        if (encrypted == NULL &&
+            (encrypted = blr_prepare_encrypted_event(router,
                                                      buf,
                                                      size,
                                                      router->current_pos,
@@ -564,7 +608,7 @@ blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint32_t size,
 
         encr_ptr = GWBUF_DATA(encrypted);
 
-        n = pwrite(router->binlog_fd, encr_ptr, size, router->last_written);
+        n = blr_file_write(router, encr_ptr, size);
 
         gwbuf_free(encrypted);
         encrypted = NULL;
@@ -572,7 +616,7 @@ blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint32_t size,
     else
     {
         /* Write current received event form master */
-        n = pwrite(router->binlog_fd, buf, size, router->last_written);
+        n = blr_file_write(router, buf, size);
     }
 
     /* Check write operation result*/
@@ -602,6 +646,26 @@ blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint32_t size,
     router->last_event_pos = hdr->next_pos - hdr->event_size;
     spinlock_release(&router->binlog_lock);
 
+    /* Index the position of the GTID event */
+    if (router->gtid_index && hdr->event_type == MARIADB10_GTID_EVENT &&
+        size >= BINLOG_EVENT_HDR_LEN + 12)
+    {
+        uint64_t n_sequence = extract_field(buf + BINLOG_EVENT_HDR_LEN, 64);
+        uint32_t domainid = extract_field(buf + BINLOG_EVENT_HDR_LEN + 8, 32);
+
+        if (!blr_gtid_index_add(router, domainid, hdr->serverid, n_sequence,
+                                router->last_event_pos))
+        {
+            MXS_ERROR("%s: Failed to allocate memory for the GTID index.",
+                      router->service->name);
+        }
+        else if (router->write_buffer == NULL)
+        {
+            /* The event has already been written */
+            blr_gtid_index_flush(router);
+        }
+    }
+
     /* Check whether adding the Start Encryption event into current binlog */
     if (router->encryption.enabled && write_start_encryption_event)
     {
@@ -626,15 +690,280 @@ blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint32_t size,
     return n;
 }
 
+/**
+ * Write data at the end of the current binlog file
+ *
+ * If the binlog writes are buffered, the data is appended to the write buffer.
+ * When the data does not fit into the buffer, the buffer is written first.
+ *
+ * @param router The router instance
+ * @param buf    The data to write
+ * @param size   Size of the data
+ * @return Number of bytes written or buffered, -1 on error
+ */
+int
+blr_file_write(ROUTER_INSTANCE *router, uint8_t *buf, uint32_t size)
+{
+    if (router->write_buffer)
+    {
+        if (router->write_buffer_len + size > router->write_buffer_size &&
+            !blr_file_write_buffer(router))
+        {
+            return -1;
+        }
+
+        if (size <= router->write_buffer_size)
+        {
+            memcpy(router->write_buffer + router->write_buffer_len, buf, size);
+            router->write_buffer_len += size;
+            return size;
+        }
+    }
+
+    router->stats.n_binlog_writes++;
+    return pwrite(router->binlog_fd, buf, size, router->last_written);
+}
+
+/**
+ * Write the buffered events to the binlog file
+ *
+ * The buffer holds complete events, so a crash in the middle of the write
+ * leaves at most one partial event at the end of the file, which is removed
+ * when the binlog file is checked at startup. If the write fails, the file is
+ * truncated to the last position seen by the slaves and the events after it
+ * are requested from the master again.
+ *
+ * @param router The router instance
+ * @return True if the buffer was written
+ */
+bool
+blr_file_write_buffer(ROUTER_INSTANCE *router)
+{
+    if (router->write_buffer_len == 0)
+    {
+        return true;
+    }
+
+    uint64_t offset = router->last_written - router->write_buffer_len;
+    ssize_t n = pwrite(router->binlog_fd, router->write_buffer, router->write_buffer_len, offset);
+
+    router->stats.n_binlog_writes++;
+
+    if (n != (ssize_t)router->write_buffer_len)
+    {
+        char err_msg[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("%s: Failed to write %lu bytes of binlog records at %lu of %s, %s. "
+                  "Truncating to %lu.",
+                  router->service->name, router->write_buffer_len, offset,
+                  router->binlog_name, strerror_r(errno, err_msg, sizeof(err_msg)),
+                  router->binlog_position);
+
+        if (ftruncate(router->binlog_fd, router->binlog_position))
+        {
+            MXS_ERROR("%s: Failed to truncate binlog record at %lu of %s, %s. ",
+                      router->service->name, router->binlog_position,
+                      router->binlog_name,
+                      strerror_r(errno, err_msg, sizeof(err_msg)));
+        }
+
+        spinlock_acquire(&router->binlog_lock);
+        router->current_pos = router->binlog_position;
+        router->last_written = router->binlog_position;
+        router->last_event_pos = router->current_safe_event;
+        router->pending_transaction = 0;
+        spinlock_release(&router->binlog_lock);
+
+        router->write_buffer_len = 0;
+        router->publish_position = 0;
+        router->publish_safe_event = 0;
+        blr_gtid_index_discard(router, router->binlog_position);
+        return false;
+    }
+
+    router->write_buffer_len = 0;
+    return true;
+}
+
 /**
  * Flush the content of the binlog file to disk.
  *
+ * Any buffered events are written first and the file is then synced as
+ * configured with the binlog_sync option.
+ *
  * @param   router  The binlog router
+ * @return True if the buffered events were written
  */
-void
+bool
 blr_file_flush(ROUTER_INSTANCE *router)
 {
-    fsync(router->binlog_fd);
+    bool rval = blr_file_write_buffer(router);
+
+    switch (router->binlog_sync)
+    {
+    case BLR_SYNC_FSYNC:
+        fsync(router->binlog_fd);
+        break;
+
+    case BLR_SYNC_FDATASYNC:
+        fdatasync(router->binlog_fd);
+        break;
+
+    default:
+        break;
+    }
+
+    /* The GTID index only refers to the events that have been written */
+    if (rval)
+    {
+        blr_gtid_index_flush(router);
+    }
+
+    return rval;
+}
+
+/**
+ * Get the path of the checkpoint file of a binlog file
+ *
+ * @param router    The router instance
+ * @param binlog    The binlog file name
+ * @param path      Buffer of PATH_MAX + 1 bytes for the path
+ */
+static void
+blr_file_checkpoint_path(ROUTER_INSTANCE *router, const char *binlog, char *path)
+{
+    snprintf(path, PATH_MAX + 1, "%s/%s" BINLOG_CHECKPOINT_SUFFIX, router->binlogdir, binlog);
+}
+
+/**
+ * Write a checkpoint of the current binlog file
+ *
+ * The checkpoint holds the last safe position of the binlog file, up to which
+ * the file has been written and checked, together with the last MariaDB 10
+ * GTID before it. When the router is started, the binlog file is checked from
+ * the checkpoint onwards instead of from the start of the file.
+ *
+ * A checkpoint is only written when no transaction is open, so the state of
+ * the transactions at the checkpoint is always known.
+ *
+ * @param router    The router instance
+ */
+void
+blr_file_write_checkpoint(ROUTER_INSTANCE *router)
+{
+    char path[PATH_MAX + 1];
+    char tmp_path[PATH_MAX + 1];
+    char gtid[BLR_GTID_MAXLEN + 1];
+    char err_msg[MXS_STRERROR_BUFLEN];
+    uint8_t hdbuf[BINLOG_EVENT_HDR_LEN];
+    uint64_t pos;
+    int pending_transaction;
+
+    spinlock_acquire(&router->binlog_lock);
+    pos = router->binlog_position;
+    pending_transaction = router->pending_transaction;
+    strcpy(gtid, router->last_mariadb_gtid);
+    spinlock_release(&router->binlog_lock);
+
+    if (pending_transaction || pos <= BINLOG_MAGIC_SIZE)
+    {
+        return;
+    }
+
+    /** The timestamp of the Format Description Event identifies the file */
+    if (pread(router->binlog_fd, hdbuf, BINLOG_EVENT_HDR_LEN, BINLOG_MAGIC_SIZE) != BINLOG_EVENT_HDR_LEN)
+    {
+        return;
+    }
+
+    router->checkpoint_pos = pos;
+
+    blr_file_checkpoint_path(router, router->binlog_name, path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *file = fopen(tmp_path, "w");
+
+    if (file == NULL)
+    {
+        MXS_ERROR("%s: Failed to create binlog checkpoint file %s, %s.",
+                  router->service->name, tmp_path,
+                  strerror_r(errno, err_msg, sizeof(err_msg)));
+        return;
+    }
+
+    fprintf(file, "%s %lu %u %s\n", router->binlog_name, pos,
+            (unsigned int)EXTRACT32(hdbuf), *gtid ? gtid : "-");
+
+    if (fclose(file) != 0 || rename(tmp_path, path) != 0)
+    {
+        MXS_ERROR("%s: Failed to write binlog checkpoint file %s, %s.",
+                  router->service->name, path,
+                  strerror_r(errno, err_msg, sizeof(err_msg)));
+        unlink(tmp_path);
+    }
+}
+
+/**
+ * Read the checkpoint of the current binlog file
+ *
+ * The checkpoint is only used if it belongs to the current binlog file and
+ * points either at the start of an event or at the end of the file.
+ *
+ * @param router    The router instance
+ * @param filelen   The size of the binlog file
+ * @param pos       The position of the checkpoint
+ * @param gtid      Buffer of BLR_GTID_MAXLEN + 1 bytes for the GTID
+ * @return True if a usable checkpoint was found
+ */
+static bool
+blr_file_read_checkpoint(ROUTER_INSTANCE *router, unsigned long filelen,
+                         uint64_t *pos, char *gtid)
+{
+    char path[PATH_MAX + 1];
+    char binlog[BINLOG_FNAMELEN + 1];
+    unsigned long chk_pos;
+    unsigned int fde_time;
+    uint8_t hdbuf[BINLOG_EVENT_HDR_LEN];
+    bool rval = false;
+
+    blr_file_checkpoint_path(router, router->binlog_name, path);
+
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    /** The field widths are BINLOG_FNAMELEN and BLR_GTID_MAXLEN */
+    if (fscanf(file, "%255s %lu %u %42s", binlog, &chk_pos, &fde_time, gtid) == 4 &&
+        strcmp(binlog, router->binlog_name) == 0 &&
+        chk_pos > BINLOG_MAGIC_SIZE && chk_pos <= filelen &&
+        pread(router->binlog_fd, hdbuf, BINLOG_EVENT_HDR_LEN, BINLOG_MAGIC_SIZE) == BINLOG_EVENT_HDR_LEN &&
+        EXTRACT32(hdbuf) == fde_time)
+    {
+        /** The event size is not encrypted, so it can always be checked */
+        if (chk_pos == filelen ||
+            (pread(router->binlog_fd, hdbuf, BINLOG_EVENT_HDR_LEN, chk_pos) == BINLOG_EVENT_HDR_LEN &&
+             EXTRACT32(hdbuf + BINLOG_EVENT_LEN_OFFSET) >= BINLOG_EVENT_HDR_LEN))
+        {
+            *pos = chk_pos;
+            rval = true;
+        }
+    }
+
+    fclose(file);
+
+    if (!rval)
+    {
+        MXS_WARNING("%s: Ignoring binlog checkpoint file %s, it does not match "
+                    "binlog file %s.", router->service->name, path, router->binlog_name);
+    }
+    else if (strcmp(gtid, "-") == 0)
+    {
+        *gtid = '\0';
+    }
+
+    return rval;
 }
 
 /**
@@ -696,10 +1025,26 @@ blr_open_binlog(ROUTER_INSTANCE *router, char *binlog)
 
     if ((file->fd = open(path, O_RDONLY, 0666)) == -1)
     {
-        MXS_ERROR("Failed to open binlog file %s", path);
-        MXS_FREE(file);
-        spinlock_release(&router->fileslock);
-        return NULL;
+        /** A closed binlog file may have been compressed */
+        if (errno == ENOENT && strlen(path) + strlen(BINLOG_COMPRESSED_SUFFIX) <= PATH_MAX)
+        {
+            strcat(path, BINLOG_COMPRESSED_SUFFIX);
+
+            if ((file->fd = open(path, O_RDONLY, 0666)) != -1 &&
+                (file->compressed = blr_compressed_open(file->fd, path)) == NULL)
+            {
+                close(file->fd);
+                file->fd = -1;
+            }
+        }
+
+        if (file->fd == -1)
+        {
+            MXS_ERROR("Failed to open binlog file %s", path);
+            MXS_FREE(file);
+            spinlock_release(&router->fileslock);
+            return NULL;
+        }
     }
 
     file->next = router->files;
@@ -709,6 +1054,26 @@ blr_open_binlog(ROUTER_INSTANCE *router, char *binlog)
     return file;
 }
 
+/**
+ * Read bytes from a binlog file opened with blr_open_binlog()
+ *
+ * @param file  The binlog file
+ * @param buf   Where to copy the bytes
+ * @param n     Number of bytes to read
+ * @param pos   Position in the binlog file
+ * @return Number of bytes read, 0 at the end of the file or -1 on error
+ */
+static ssize_t
+blr_file_pread(BLFILE *file, uint8_t *buf, size_t n, uint64_t pos)
+{
+    if (file->compressed)
+    {
+        return blr_compressed_pread(file->fd, file->compressed, buf, n, pos);
+    }
+
+    return pread(file->fd, buf, n, pos);
+}
+
 /**
  * Read a replication event into a GWBUF structure.
  *
@@ -748,7 +1113,11 @@ blr_read_binlog(ROUTER_INSTANCE *router,
     }
 
     spinlock_acquire(&file->lock);
-    if (fstat(file->fd, &statb) == 0)
+    if (file->compressed)
+    {
+        filelen = file->compressed->raw_size;
+    }
+    else if (fstat(file->fd, &statb) == 0)
     {
         filelen = statb.st_size;
     }
@@ -823,7 +1192,7 @@ blr_read_binlog(ROUTER_INSTANCE *router,
     spinlock_release(&router->binlog_lock);
 
     /* Read the header information from the file */
-    if ((n = pread(file->fd, hdbuf, BINLOG_EVENT_HDR_LEN, pos)) != BINLOG_EVENT_HDR_LEN)
+    if ((n = blr_file_pread(file, hdbuf, BINLOG_EVENT_HDR_LEN, pos)) != BINLOG_EVENT_HDR_LEN)
     {
         switch (n)
         {
@@ -887,7 +1256,7 @@ blr_read_binlog(ROUTER_INSTANCE *router,
                       pos, file->binlogname, filelen, router->binlog_position,
                       router->binlog_name);
 
-            if ((n = pread(file->fd, hdbuf, BINLOG_EVENT_HDR_LEN, pos)) != BINLOG_EVENT_HDR_LEN)
+            if ((n = blr_file_pread(file, hdbuf, BINLOG_EVENT_HDR_LEN, pos)) != BINLOG_EVENT_HDR_LEN)
             {
                 switch (n)
                 {
@@ -967,8 +1336,8 @@ blr_read_binlog(ROUTER_INSTANCE *router,
 
     memcpy(data, hdbuf, BINLOG_EVENT_HDR_LEN);  // Copy the header in the buffer
 
-    if ((n = pread(file->fd, &data[BINLOG_EVENT_HDR_LEN], hdr->event_size - BINLOG_EVENT_HDR_LEN,
-                   pos + BINLOG_EVENT_HDR_LEN))
+    if ((n = blr_file_pread(file, &data[BINLOG_EVENT_HDR_LEN], hdr->event_size - BINLOG_EVENT_HDR_LEN,
+                            pos + BINLOG_EVENT_HDR_LEN))
         != hdr->event_size - BINLOG_EVENT_HDR_LEN)  // Read the balance
     {
         if (n ==  0)
@@ -1111,6 +1480,7 @@ blr_close_binlog(ROUTER_INSTANCE *router, BLFILE *file)
     {
         close(file->fd);
         file->fd = -1;
+        blr_compressed_close(file->compressed);
         MXS_FREE(file);
     }
 }
@@ -1148,6 +1518,11 @@ blr_file_size(BLFILE *file)
 {
     struct stat statb;
 
+    if (file->compressed)
+    {
+        return file->compressed->raw_size;
+    }
+
     if (fstat(file->fd, &statb) == 0)
     {
         return statb.st_size;
@@ -1288,16 +1663,133 @@ blr_file_next_exists(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave)
     sprintf(bigbuf, "%s/%s", router->binlogdir, buf);
     if (access(bigbuf, R_OK) == -1)
     {
-        return 0;
+        /** The next file may already have been compressed */
+        strcat(bigbuf, BINLOG_COMPRESSED_SUFFIX);
+        if (access(bigbuf, R_OK) == -1)
+        {
+            return 0;
+        }
     }
     return 1;
 }
 
+/**
+ * Get the name of the oldest binlog file in the binlog directory
+ *
+ * @param router    The router instance
+ * @param binlog    Buffer of BINLOG_FNAMELEN + 1 bytes for the file name,
+ *                  the current binlog file is used if no file is found
+ */
+void
+blr_file_get_first(ROUTER_INSTANCE *router, char *binlog)
+{
+    int root_len = strlen(router->fileroot);
+    int first = 0;
+    DIR *dirp;
+    struct dirent *dp;
+
+    if ((dirp = opendir(router->binlogdir)) != NULL)
+    {
+        while ((dp = readdir(dirp)) != NULL)
+        {
+            /** Compressed files have the same number as the original ones */
+            if (strncmp(dp->d_name, router->fileroot, root_len) == 0 &&
+                dp->d_name[root_len] == '.')
+            {
+                int n = atoi(dp->d_name + root_len + 1);
+
+                if (n > 0 && (first == 0 || n < first))
+                {
+                    first = n;
+                }
+            }
+        }
+        closedir(dirp);
+    }
+
+    spinlock_acquire(&router->binlog_lock);
+
+    if (first > 0)
+    {
+        snprintf(binlog, BINLOG_FNAMELEN + 1, BINLOG_NAMEFMT, router->fileroot, first);
+    }
+    else
+    {
+        strcpy(binlog, router->binlog_name);
+    }
+
+    spinlock_release(&router->binlog_lock);
+}
+
+/**
+ * Block buffer used when scanning a binlog file
+ */
+typedef struct binlog_scan_buffer
+{
+    uint8_t  *data;     /*< The buffer, NULL if it could not be allocated */
+    uint64_t offset;    /*< File offset of the first byte in the buffer */
+    size_t   len;       /*< Number of bytes in the buffer */
+} BINLOG_SCAN_BUFFER;
+
+/**
+ * Read bytes from a binlog file through a block buffer
+ *
+ * This behaves like pread(2) but the file is read in blocks of
+ * BINLOG_SCAN_BLOCK_SIZE bytes, so that scanning a file takes one system
+ * call per block instead of two per event.
+ *
+ * @param fd      The binlog file descriptor
+ * @param scan    The block buffer
+ * @param dest    Where to copy the bytes
+ * @param n       Number of bytes to read
+ * @param pos     Position in the file
+ * @return Number of bytes read, 0 at the end of the file or -1 on error
+ */
+static ssize_t
+blr_scan_read(int fd, BINLOG_SCAN_BUFFER *scan, uint8_t *dest, size_t n, uint64_t pos)
+{
+    if (scan->data == NULL || n > BINLOG_SCAN_BLOCK_SIZE)
+    {
+        return pread(fd, dest, n, pos);
+    }
+
+    if (pos < scan->offset || pos + n > scan->offset + scan->len)
+    {
+        ssize_t rc = pread(fd, scan->data, BINLOG_SCAN_BLOCK_SIZE, pos);
+
+        if (rc == -1)
+        {
+            scan->len = 0;
+            return -1;
+        }
+
+        scan->offset = pos;
+        scan->len = rc;
+    }
+
+    size_t avail = scan->offset + scan->len - pos;
+
+    if (n > avail)
+    {
+        n = avail;
+    }
+
+    memcpy(dest, scan->data + (pos - scan->offset), n);
+
+    return n;
+}
+
+static int blr_read_events(ROUTER_INSTANCE *router, int fix, int debug,
+                           BINLOG_SCAN_BUFFER *scan);
+
 /**
  * Read all replication events from a binlog file.
  *
  * Routine detects errors and pending transactions
  *
+ * If binlog checkpoints are used, the part of the file before the
+ * checkpoint is not read again.
+ *
  * @param router  The router instance
  * @param fix     Whether to fix or not errors
  * @param debug   Whether to enable or not the debug for events
@@ -1305,6 +1797,27 @@ blr_file_next_exists(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave)
  */
 int
 blr_read_events_all_events(ROUTER_INSTANCE *router, int fix, int debug)
+{
+    BINLOG_SCAN_BUFFER scan = {MXS_MALLOC(BINLOG_SCAN_BLOCK_SIZE), 0, 0};
+
+    int rval = blr_read_events(router, fix, debug, &scan);
+
+    MXS_FREE(scan.data);
+
+    return rval;
+}
+
+/**
+ * Read the replication events of a binlog file through a block buffer.
+ *
+ * @param router  The router instance
+ * @param fix     Whether to fix or not errors
+ * @param debug   Whether to enable or not the debug for events
+ * @param scan    The block buffer
+ * @return        0 on success, >0 on failure
+ */
+static int
+blr_read_events(ROUTER_INSTANCE *router, int fix, int debug, BINLOG_SCAN_BUFFER *scan)
 {
     unsigned long filelen = 0;
     struct stat statb;
@@ -1338,6 +1851,8 @@ blr_read_events_all_events(ROUTER_INSTANCE *router, int fix, int debug)
     BINLOG_EVENT_DESC fde_event;
     int fde_seen = 0;
     int start_encryption_seen = 0;
+    uint64_t resume_pos = 0;
+    char resume_gtid[BLR_GTID_MAXLEN + 1] = "";
 
     memset(&first_event, '\0', sizeof(first_event));
     memset(&last_event, '\0', sizeof(last_event));
@@ -1359,11 +1874,22 @@ blr_read_events_all_events(ROUTER_INSTANCE *router, int fix, int debug)
     router->binlog_position = 4;
     router->current_safe_event = 4;
 
+    /**
+     * The events before the checkpoint are skipped once the header events,
+     * the Format Description Event and a possible Start Encryption Event,
+     * have been read.
+     */
+    if (router->checkpoint_interval &&
+        blr_file_read_checkpoint(router, filelen, &resume_pos, resume_gtid))
+    {
+        router->checkpoint_pos = resume_pos;
+    }
+
     while (1)
     {
 
         /* Read the header information from the file */
-        if ((n = pread(router->binlog_fd, hdbuf, BINLOG_EVENT_HDR_LEN, pos)) != BINLOG_EVENT_HDR_LEN)
+        if ((n = blr_scan_read(router->binlog_fd, scan, hdbuf, BINLOG_EVENT_HDR_LEN, pos)) != BINLOG_EVENT_HDR_LEN)
         {
             switch (n)
             {
@@ -1644,9 +2170,9 @@ blr_read_events_all_events(ROUTER_INSTANCE *router, int fix, int debug)
         memcpy(data, hdbuf, BINLOG_EVENT_HDR_LEN);// Copy the header in
 
         /* Read event data */
-        if ((n = pread(router->binlog_fd, &data[BINLOG_EVENT_HDR_LEN],
-                       hdr.event_size - BINLOG_EVENT_HDR_LEN,
-                       pos + BINLOG_EVENT_HDR_LEN)) != hdr.event_size - BINLOG_EVENT_HDR_LEN)
+        if ((n = blr_scan_read(router->binlog_fd, scan, &data[BINLOG_EVENT_HDR_LEN],
+                               hdr.event_size - BINLOG_EVENT_HDR_LEN,
+                               pos + BINLOG_EVENT_HDR_LEN)) != hdr.event_size - BINLOG_EVENT_HDR_LEN)
         {
             if (n == -1)
             {
@@ -1991,6 +2517,9 @@ blr_read_events_all_events(ROUTER_INSTANCE *router, int fix, int debug)
                 domainid = extract_field(ptr + 8, 32);
                 flags = *(ptr + 8 + 4);
 
+                snprintf(router->last_mariadb_gtid, sizeof(router->last_mariadb_gtid),
+                         "%u-%u-%lu", domainid, hdr.serverid, n_sequence);
+
                 if ((flags & (MARIADB_FL_DDL | MARIADB_FL_STANDALONE)) == 0)
                 {
                     if (pending_transaction > 0)
@@ -2215,6 +2744,26 @@ blr_read_events_all_events(ROUTER_INSTANCE *router, int fix, int debug)
             }
 
             pos = hdr.next_pos;
+
+            /* Skip the events already checked before the checkpoint */
+            if (resume_pos && hdr.event_type != FORMAT_DESCRIPTION_EVENT)
+            {
+                if (resume_pos > pos)
+                {
+                    MXS_NOTICE("Binlog file %s has been checked up to the checkpoint "
+                               "at %lu, continuing from there.",
+                               router->binlog_name, (unsigned long)resume_pos);
+
+                    pos = resume_pos;
+                    last_known_commit = resume_pos;
+                    pending_transaction = 0;
+                    transaction_events = 0;
+                    event_bytes = 0;
+                    strcpy(router->last_mariadb_gtid, resume_gtid);
+                }
+
+                resume_pos = 0;
+            }
         }
         else
         {
@@ -2648,7 +3197,7 @@ blr_write_special_event(ROUTER_INSTANCE *router, uint32_t file_offset, uint32_t
     }
 
     /* Write the event */
-    if ((n = pwrite(router->binlog_fd, new_event, event_size, router->last_written)) != event_size)
+    if ((n = blr_file_write(router, new_event, event_size)) != event_size)
     {
         char err_msg[MXS_STRERROR_BUFLEN];
         MXS_ERROR("%s: Failed to write %s special binlog record at %lu of %s, %s. "
@@ -2681,6 +3230,11 @@ blr_write_special_event(ROUTER_INSTANCE *router, uint32_t file_offset, uint32_t
     spinlock_release(&router->binlog_lock);
 
     // Force write
+    if (!blr_file_write_buffer(router))
+    {
+        return 0;
+    }
+
     fsync(router->binlog_fd);
 
     return 1;
@@ -2990,6 +3544,43 @@ static GWBUF *blr_prepare_encrypted_event(ROUTER_INSTANCE *router,
     return encrypted;
 }
 
+/**
+ * Encrypt a binlog event without modifying it
+ *
+ * This can be called by other threads than the one that writes the binlog
+ * file as it only uses the encryption setup of the router.
+ *
+ * @param router    The router instance
+ * @param buf       The binlog event
+ * @param size      The event size (CRC32 four bytes included)
+ * @param pos       The position of the event in binlog file
+ * @param nonce     The nonce of the binlog file
+ * @return          A GWBUF buffer with the encrypted event or NULL on error
+ */
+GWBUF *blr_encrypt_event(ROUTER_INSTANCE *router,
+                         uint8_t *buf,
+                         uint32_t size,
+                         uint64_t pos,
+                         const uint8_t *nonce)
+{
+    GWBUF *encrypted = blr_prepare_encrypted_event(router, buf, size, pos,
+                                                   nonce, BINLOG_FLAG_ENCRYPT);
+
+    /* Undo the move of the first 4 bytes, the event size is stored in clear */
+    memmove(buf, buf + BINLOG_EVENT_LEN_OFFSET, 4);
+
+    if (encrypted)
+    {
+        memcpy(buf + BINLOG_EVENT_LEN_OFFSET, GWBUF_DATA(encrypted) + BINLOG_EVENT_LEN_OFFSET, 4);
+    }
+    else
+    {
+        gw_mysql_set_byte4(buf + BINLOG_EVENT_LEN_OFFSET, size);
+    }
+
+    return encrypted;
+}
+
 /**
  * Return the encryption algorithm string
  *
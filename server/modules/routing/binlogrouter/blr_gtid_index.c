@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file blr_gtid_index.c - Index from the MariaDB 10 GTIDs to the binlog positions
+ *
+ * When the GTID index is enabled, the position of every MariaDB 10 GTID event
+ * written to the binlog files is stored in the index file of its replication
+ * domain, BLR_GTID_INDEX_PREFIX followed by the domain id, in the binlog
+ * directory. The file consists of fixed size entries in little endian byte
+ * order:
+ *
+ * entry    sequence number (8 bytes), server id (4), binlog file number (4),
+ *          position of the GTID event (8)
+ *
+ * The sequence numbers of a domain grow with each transaction, so the entries
+ * are sorted by the sequence number and a GTID is found with a binary search.
+ * If the master sends a sequence number that is not larger than the last one
+ * in the index, the entries from that sequence number onwards are removed
+ * before the new entry is added.
+ *
+ * The entries are written after the binlog events they refer to, so the index
+ * never points beyond the events that are in the binlog files.
+ */
+
+#include "blr.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <maxscale/alloc.h>
+#include <maxscale/log_manager.h>
+
+/** Size of an entry in the index file */
+#define BLR_GTID_INDEX_ENTRY_LEN 24
+
+/** Initial number of pending entries */
+#define BLR_GTID_INDEX_PENDING   64
+
+static inline void write_le32(uint8_t *ptr, uint32_t value)
+{
+    ptr[0] = value;
+    ptr[1] = value >> 8;
+    ptr[2] = value >> 16;
+    ptr[3] = value >> 24;
+}
+
+static inline uint32_t read_le32(const uint8_t *ptr)
+{
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+           ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+static inline void write_le64(uint8_t *ptr, uint64_t value)
+{
+    write_le32(ptr, value);
+    write_le32(ptr + 4, value >> 32);
+}
+
+static inline uint64_t read_le64(const uint8_t *ptr)
+{
+    return (uint64_t)read_le32(ptr) | ((uint64_t)read_le32(ptr + 4) << 32);
+}
+
+/**
+ * Get the number of a binlog file from its name
+ *
+ * @param binlog The binlog file name
+ * @return The number of the binlog file
+ */
+static uint32_t binlog_file_number(const char *binlog)
+{
+    const char *sptr = strrchr(binlog, '.');
+
+    return sptr ? atoi(sptr + 1) : 0;
+}
+
+/**
+ * Get the path of the index file of a replication domain
+ *
+ * @param router The router instance
+ * @param domain The replication domain
+ * @param path   Buffer of PATH_MAX + 1 bytes for the path
+ */
+static void gtid_index_path(ROUTER_INSTANCE *router, uint32_t domain, char *path)
+{
+    snprintf(path, PATH_MAX + 1, "%s/" BLR_GTID_INDEX_PREFIX "%u", router->binlogdir, domain);
+}
+
+/**
+ * Read an entry of an index file
+ *
+ * @param fd     The index file
+ * @param n      Number of the entry
+ * @param entry  The entry to fill, the domain is not set
+ * @return True if the entry was read
+ */
+static bool gtid_index_read(int fd, uint64_t n, BLR_GTID_INDEX_ENTRY *entry)
+{
+    uint8_t buf[BLR_GTID_INDEX_ENTRY_LEN];
+
+    if (pread(fd, buf, sizeof(buf), n * BLR_GTID_INDEX_ENTRY_LEN) != sizeof(buf))
+    {
+        return false;
+    }
+
+    entry->seq = read_le64(buf);
+    entry->server_id = read_le32(buf + 8);
+    entry->file_no = read_le32(buf + 12);
+    entry->pos = read_le64(buf + 16);
+    return true;
+}
+
+/**
+ * Find the first entry of an index file with a larger sequence number
+ *
+ * @param fd         The index file
+ * @param n_entries  Number of entries in the file
+ * @param seq        The sequence number
+ * @return Number of the first entry after @c seq, n_entries if there is none
+ *         and -1 if the file could not be read
+ */
+static int64_t gtid_index_search(int fd, uint64_t n_entries, uint64_t seq)
+{
+    uint64_t low = 0;
+    uint64_t high = n_entries;
+
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        BLR_GTID_INDEX_ENTRY entry;
+
+        if (!gtid_index_read(fd, mid, &entry))
+        {
+            return -1;
+        }
+
+        if (entry.seq <= seq)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * Get the slot of the index file of a replication domain, opening the file
+ * if needed
+ *
+ * @param router The router instance
+ * @param domain The replication domain
+ * @return The slot of the domain or -1 on error
+ */
+static int gtid_index_domain(ROUTER_INSTANCE *router, uint32_t domain)
+{
+    BLR_GTID_INDEX *index = router->gtid_index;
+    char path[PATH_MAX + 1];
+    char err_msg[MXS_STRERROR_BUFLEN];
+    struct stat st;
+
+    for (int i = 0; i < index->n_domains; i++)
+    {
+        if (index->domains[i] == domain)
+        {
+            return i;
+        }
+    }
+
+    if (index->n_domains == BLR_GTID_INDEX_MAX_DOMAINS)
+    {
+        if (!index->full_warned)
+        {
+            MXS_WARNING("%s: More than %d replication domains, the GTIDs of domain %u "
+                        "and the later domains are not indexed.",
+                        router->service->name, BLR_GTID_INDEX_MAX_DOMAINS, domain);
+            index->full_warned = true;
+        }
+        return -1;
+    }
+
+    gtid_index_path(router, domain, path);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0666);
+
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        MXS_ERROR("%s: Failed to open GTID index file %s: %s",
+                  router->service->name, path,
+                  strerror_r(errno, err_msg, sizeof(err_msg)));
+
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    uint64_t n_entries = st.st_size / BLR_GTID_INDEX_ENTRY_LEN;
+    BLR_GTID_INDEX_ENTRY last = {0};
+
+    /* Remove a partial entry left by a crash */
+    if ((st.st_size % BLR_GTID_INDEX_ENTRY_LEN &&
+         ftruncate(fd, n_entries * BLR_GTID_INDEX_ENTRY_LEN) == -1) ||
+        (n_entries > 0 && !gtid_index_read(fd, n_entries - 1, &last)))
+    {
+        MXS_ERROR("%s: Failed to read GTID index file %s: %s",
+                  router->service->name, path,
+                  strerror_r(errno, err_msg, sizeof(err_msg)));
+        close(fd);
+        return -1;
+    }
+
+    int slot = index->n_domains++;
+
+    index->domains[slot] = domain;
+    index->fds[slot] = fd;
+    index->n_entries[slot] = n_entries;
+    index->last_seq[slot] = last.seq;
+
+    return slot;
+}
+
+/**
+ * Remove the entries of an index file from a sequence number onwards
+ *
+ * @param router The router instance
+ * @param slot   Slot of the index file
+ * @param seq    The first sequence number to remove
+ * @return True if the entries were removed
+ */
+static bool gtid_index_rewind(ROUTER_INSTANCE *router, int slot, uint64_t seq)
+{
+    BLR_GTID_INDEX *index = router->gtid_index;
+    int fd = index->fds[slot];
+    int64_t n_entries = seq ? gtid_index_search(fd, index->n_entries[slot], seq - 1) : 0;
+    BLR_GTID_INDEX_ENTRY last = {0};
+
+    if (n_entries == -1 ||
+        ftruncate(fd, n_entries * BLR_GTID_INDEX_ENTRY_LEN) == -1 ||
+        (n_entries > 0 && !gtid_index_read(fd, n_entries - 1, &last)))
+    {
+        return false;
+    }
+
+    MXS_INFO("%s: Removed %lu entries after GTID sequence %lu of domain %u from the GTID index.",
+             router->service->name, index->n_entries[slot] - n_entries,
+             last.seq, index->domains[slot]);
+
+    index->n_entries[slot] = n_entries;
+    index->last_seq[slot] = last.seq;
+    return true;
+}
+
+/**
+ * Append entries to an index file
+ *
+ * @param index The GTID index
+ * @param slot  Slot of the index file
+ * @param buf   The encoded entries
+ * @param len   Length of the entries
+ * @return True if the entries were written
+ */
+static bool gtid_index_append(BLR_GTID_INDEX *index, int slot, uint8_t *buf, size_t len)
+{
+    if (len == 0)
+    {
+        return true;
+    }
+
+    ssize_t n = pwrite(index->fds[slot], buf, len,
+                       index->n_entries[slot] * BLR_GTID_INDEX_ENTRY_LEN);
+
+    if (n != (ssize_t)len)
+    {
+        /* Leave out the partial entry, if any */
+        if (n > 0)
+        {
+            index->n_entries[slot] += n / BLR_GTID_INDEX_ENTRY_LEN;
+        }
+        return false;
+    }
+
+    index->n_entries[slot] += len / BLR_GTID_INDEX_ENTRY_LEN;
+    return true;
+}
+
+/**
+ * Allocate the GTID index of a router instance
+ *
+ * @return The GTID index or NULL if memory allocation fails
+ */
+BLR_GTID_INDEX *
+blr_gtid_index_create(void)
+{
+    return (BLR_GTID_INDEX *)MXS_CALLOC(1, sizeof(BLR_GTID_INDEX));
+}
+
+/**
+ * Add the GTID event written at a position of the current binlog file
+ *
+ * The entry is written to the index file by blr_gtid_index_flush() once the
+ * event has been written to the binlog file.
+ *
+ * @param router    The router instance
+ * @param domain    Replication domain of the GTID
+ * @param server_id Server id of the GTID
+ * @param seq       Sequence number of the GTID
+ * @param pos       Position of the GTID event
+ * @return True if the entry was added
+ */
+bool
+blr_gtid_index_add(ROUTER_INSTANCE *router, uint32_t domain, uint32_t server_id,
+                   uint64_t seq, uint64_t pos)
+{
+    BLR_GTID_INDEX *index = router->gtid_index;
+
+    if (index->n_pending == index->pending_size)
+    {
+        int size = index->pending_size ? index->pending_size * 2 : BLR_GTID_INDEX_PENDING;
+        BLR_GTID_INDEX_ENTRY *pending = MXS_REALLOC(index->pending, size * sizeof(*pending));
+
+        if (pending == NULL)
+        {
+            return false;
+        }
+
+        index->pending = pending;
+        index->pending_size = size;
+    }
+
+    BLR_GTID_INDEX_ENTRY *entry = &index->pending[index->n_pending++];
+
+    entry->domain = domain;
+    entry->server_id = server_id;
+    entry->seq = seq;
+    entry->file_no = binlog_file_number(router->binlog_name);
+    entry->pos = pos;
+
+    return true;
+}
+
+/**
+ * Write the pending entries to the index files
+ *
+ * This must be called after the binlog events of the entries have been written.
+ *
+ * @param router The router instance
+ */
+void
+blr_gtid_index_flush(ROUTER_INSTANCE *router)
+{
+    BLR_GTID_INDEX *index = router->gtid_index;
+
+    if (index == NULL || index->n_pending == 0)
+    {
+        return;
+    }
+
+    uint8_t *buf = MXS_MALLOC(index->n_pending * BLR_GTID_INDEX_ENTRY_LEN);
+
+    for (int i = 0; buf && i < index->n_pending; i++)
+    {
+        uint32_t domain = index->pending[i].domain;
+        int j = 0;
+
+        /* The entries of each domain are written when it is first seen */
+        while (j < i && index->pending[j].domain != domain)
+        {
+            j++;
+        }
+
+        int slot;
+
+        if (j < i || (slot = gtid_index_domain(router, domain)) == -1)
+        {
+            continue;
+        }
+
+        bool ok = true;
+        size_t len = 0;
+
+        for (j = i; ok && j < index->n_pending; j++)
+        {
+            BLR_GTID_INDEX_ENTRY *entry = &index->pending[j];
+
+            if (entry->domain != domain)
+            {
+                continue;
+            }
+
+            if (index->n_entries[slot] + len / BLR_GTID_INDEX_ENTRY_LEN > 0 &&
+                entry->seq <= index->last_seq[slot])
+            {
+                ok = gtid_index_append(index, slot, buf, len) &&
+                     gtid_index_rewind(router, slot, entry->seq);
+                len = 0;
+            }
+
+            uint8_t *ptr = buf + len;
+
+            write_le64(ptr, entry->seq);
+            write_le32(ptr + 8, entry->server_id);
+            write_le32(ptr + 12, entry->file_no);
+            write_le64(ptr + 16, entry->pos);
+            len += BLR_GTID_INDEX_ENTRY_LEN;
+
+            index->last_seq[slot] = entry->seq;
+        }
+
+        if (!ok || !gtid_index_append(index, slot, buf, len))
+        {
+            char err_msg[MXS_STRERROR_BUFLEN];
+            MXS_ERROR("%s: Failed to write the GTID index of domain %u: %s",
+                      router->service->name, domain,
+                      strerror_r(errno, err_msg, sizeof(err_msg)));
+        }
+    }
+
+    MXS_FREE(buf);
+    index->n_pending = 0;
+}
+
+/**
+ * Remove the pending entries at or after a position of the current binlog
+ * file, when the events after it have not been written.
+ *
+ * @param router The router instance
+ * @param pos    The position where the binlog file was truncated
+ */
+void
+blr_gtid_index_discard(ROUTER_INSTANCE *router, uint64_t pos)
+{
+    BLR_GTID_INDEX *index = router->gtid_index;
+
+    if (index == NULL)
+    {
+        return;
+    }
+
+    uint32_t file_no = binlog_file_number(router->binlog_name);
+    int n = 0;
+
+    for (int i = 0; i < index->n_pending; i++)
+    {
+        if (index->pending[i].file_no != file_no || index->pending[i].pos < pos)
+        {
+            index->pending[n++] = index->pending[i];
+        }
+    }
+
+    index->n_pending = n;
+}
+
+/**
+ * Find the binlog position where a slave that has executed a GTID continues
+ *
+ * The position is that of the GTID event after the requested GTID or the
+ * current binlog position, if the slave has all of the events of the router.
+ *
+ * @param router  The router instance
+ * @param gtid    The GTID of the slave, domain-server_id-sequence
+ * @param binlog  Buffer of BINLOG_FNAMELEN + 1 bytes for the binlog file name
+ * @param pos     The binlog position
+ * @param errmsg  Buffer of BINLOG_ERROR_MSG_LEN + 1 bytes for the error message
+ * @return True if the position was found
+ */
+bool
+blr_gtid_index_find(ROUTER_INSTANCE *router, const char *gtid, char *binlog,
+                    uint64_t *pos, char *errmsg)
+{
+    uint32_t domain;
+    uint32_t server_id;
+    uint64_t seq;
+    int len = 0;
+
+    if (router->gtid_index == NULL)
+    {
+        snprintf(errmsg, BINLOG_ERROR_MSG_LEN, "The binlog files are not indexed by GTID, "
+                 "connecting with GTID requires binlog_gtid_index");
+        return false;
+    }
+
+    if (sscanf(gtid, "%u-%u-%" SCNu64 "%n", &domain, &server_id, &seq, &len) != 3 ||
+        gtid[len] != '\0')
+    {
+        snprintf(errmsg, BINLOG_ERROR_MSG_LEN, "Invalid GTID '%s', the binlog router "
+                 "accepts one GTID of the form domain-server_id-sequence", gtid);
+        return false;
+    }
+
+    char path[PATH_MAX + 1];
+    struct stat st;
+
+    gtid_index_path(router, domain, path);
+
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        snprintf(errmsg, BINLOG_ERROR_MSG_LEN, "GTID %s is not in the binlog files", gtid);
+
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    uint64_t n_entries = st.st_size / BLR_GTID_INDEX_ENTRY_LEN;
+    int64_t n = gtid_index_search(fd, n_entries, seq);
+    BLR_GTID_INDEX_ENTRY entry;
+    bool rval = false;
+
+    if (n == -1)
+    {
+        snprintf(errmsg, BINLOG_ERROR_MSG_LEN, "Failed to read GTID index file %s", path);
+    }
+    else if (n == 0 || !gtid_index_read(fd, n - 1, &entry) || entry.seq != seq)
+    {
+        snprintf(errmsg, BINLOG_ERROR_MSG_LEN, "GTID %s is not in the binlog files", gtid);
+    }
+    else if (entry.server_id != server_id)
+    {
+        snprintf(errmsg, BINLOG_ERROR_MSG_LEN, "GTID %s does not match GTID %u-%u-%" PRIu64
+                 " in the binlog files", gtid, domain, entry.server_id, seq);
+    }
+    else if ((uint64_t)n < n_entries && gtid_index_read(fd, n, &entry))
+    {
+        snprintf(binlog, BINLOG_FNAMELEN + 1, BINLOG_NAMEFMT, router->fileroot, entry.file_no);
+        *pos = entry.pos;
+        rval = true;
+    }
+    else
+    {
+        /* The slave has executed the last indexed transaction */
+        spinlock_acquire(&router->binlog_lock);
+        strcpy(binlog, router->binlog_name);
+        *pos = router->binlog_position;
+        spinlock_release(&router->binlog_lock);
+        rval = true;
+    }
+
+    close(fd);
+    return rval;
+}
@@ -73,6 +73,8 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include <maxscale/log_manager.h>
 
@@ -107,6 +109,7 @@ static int blr_get_master_semisync(GWBUF *buf);
 
 static void blr_terminate_master_replication(ROUTER_INSTANCE *router, uint8_t* ptr, int len);
 void blr_notify_all_slaves(ROUTER_INSTANCE *router);
+static bool blr_flush_events(ROUTER_INSTANCE *router);
 extern bool blr_notify_waiting_slave(ROUTER_SLAVE *slave);
 
 static int keepalive = 1;
@@ -986,31 +989,6 @@ encode_value(unsigned char *data, unsigned int value, int len)
     }
 }
 
-/**
- * Check that the stored event checksum matches the calculated checksum
- */
-static bool verify_checksum(ROUTER_INSTANCE *router, size_t len, uint8_t *ptr)
-{
-    bool rval = true;
-    uint32_t offset = MYSQL_HEADER_LEN + 1;
-    uint32_t size = len - (offset + MYSQL_CHECKSUM_LEN);
-
-    uint32_t checksum = crc32(0L, ptr + offset, size);
-    uint32_t pktsum = EXTRACT32(ptr + offset + size);
-
-    if (pktsum != checksum)
-    {
-        rval = false;
-        MXS_ERROR("%s: Checksum error in event from master, "
-                  "binlog %s @ %lu. Closing master connection.",
-                  router->service->name, router->binlog_name,
-                  router->current_pos);
-        router->stats.n_badcrc++;
-    }
-
-    return rval;
-}
-
 /**
  * @brief Reset router errors
  *
@@ -1043,6 +1021,482 @@ static void reset_errors(ROUTER_INSTANCE *router, REP_HEADER *hdr)
 #endif
 }
 
+/**
+ * @brief Prepare a complete event for processing
+ *
+ * The binlog position and the nonce that will most likely be used to
+ * encrypt the event are stored so that the event can be encrypted before
+ * it is written.
+ *
+ * @param router The router instance
+ * @param job    The job to initialize
+ * @param event  The complete event, the job takes ownership of it
+ * @param hdr    Replication header of the event
+ * @param semi_sync_send_ack Semi-sync ACK request of the event
+ */
+static void blr_event_job_init(ROUTER_INSTANCE *router, BLR_EVENT_JOB *job, GWBUF *event,
+                               REP_HEADER *hdr, int semi_sync_send_ack)
+{
+    memset(job, 0, sizeof(*job));
+    job->event = event;
+    job->hdr = *hdr;
+    job->semi_sync_send_ack = semi_sync_send_ack;
+    job->verify = router->master_chksum;
+
+    if (router->encryption.enabled && router->encryption_ctx &&
+        hdr->ok == 0 && hdr->next_pos >= hdr->event_size &&
+        hdr->flags != LOG_EVENT_ARTIFICIAL_F && hdr->event_type != HEARTBEAT_EVENT &&
+        hdr->event_type != FORMAT_DESCRIPTION_EVENT && hdr->event_type != ROTATE_EVENT)
+    {
+        BINLOG_ENCRYPTION_CTX *encryption_ctx = (BINLOG_ENCRYPTION_CTX *)(router->encryption_ctx);
+        memcpy(job->nonce, encryption_ctx->nonce, BLRM_NONCE_LENGTH);
+        job->pos = hdr->next_pos - hdr->event_size;
+        job->encrypt = true;
+    }
+}
+
+/**
+ * @brief Free the resources of processed or unprocessed events
+ *
+ * @param router The router instance
+ * @param jobs   The events
+ * @param n_jobs Number of events
+ */
+static void blr_event_jobs_free(ROUTER_INSTANCE *router, BLR_EVENT_JOB *jobs, int n_jobs)
+{
+    for (int i = 0; i < n_jobs; i++)
+    {
+        if (router->workers)
+        {
+            blr_event_job_wait(router, &jobs[i]);
+        }
+
+        gwbuf_free(jobs[i].encrypted);
+        gwbuf_free(jobs[i].event);
+    }
+}
+
+/**
+ * @brief Process a complete replication event
+ *
+ * The events must be processed in the order they were received from the
+ * master. If the event was queued for the event workers, this waits until
+ * the workers have processed it.
+ *
+ * @param router The router instance
+ * @param job    The event to process
+ * @return False if the master connection must be closed
+ */
+static bool blr_process_event(ROUTER_INSTANCE *router, BLR_EVENT_JOB *job)
+{
+    REP_HEADER hdr = job->hdr;
+    int semi_sync_send_ack = job->semi_sync_send_ack;
+    uint8_t *ptr = GWBUF_DATA(job->event);
+
+    /**
+     * len is the length of the complete event plus 4 bytes of network
+     * header and one OK byte. Semi-sync bytes are never stored.
+     */
+    unsigned int len = gwbuf_length(job->event);
+
+    if (router->workers)
+    {
+        blr_event_job_wait(router, job);
+        router->stats.n_offloaded++;
+    }
+    else
+    {
+        job->checksum_ok = !job->verify || blr_event_checksum_ok(len, ptr);
+    }
+
+    /**
+     * If checksums are enabled, verify that the stored checksum
+     * matches the one we calculated
+     */
+    if (!job->checksum_ok)
+    {
+        MXS_ERROR("%s: Checksum error in event from master, "
+                  "binlog %s @ %lu. Closing master connection.",
+                  router->service->name, router->binlog_name,
+                  router->current_pos);
+        router->stats.n_badcrc++;
+        return false;
+    }
+
+    if (hdr.ok == 0)
+    {
+        router->lastEventReceived = hdr.event_type;
+        router->lastEventTimestamp = hdr.timestamp;
+
+        /**
+         * Check for an open transaction, if the option is set
+         * Only complete transactions should be sent to sleves
+         *
+         * If a trasaction is pending router->binlog_position
+         * won't be updated to router->current_pos
+         */
+
+        spinlock_acquire(&router->binlog_lock);
+        if (router->trx_safe == 0 || (router->trx_safe && router->pending_transaction == BLRM_NO_TRANSACTION))
+        {
+            /* no pending transaction: set current_pos to binlog_position */
+            router->binlog_position = router->current_pos;
+            router->current_safe_event = router->current_pos;
+        }
+        spinlock_release(&router->binlog_lock);
+
+        /**
+         * Detect transactions in events
+         * Only complete transactions should be sent to sleves
+         */
+
+        /**
+         * If MariaDB 10 compatibility:
+         * check for MARIADB10_GTID_EVENT with flags = 0
+         * This marks the transaction starts instead of
+         * QUERY_EVENT with "BEGIN"
+         */
+        if (router->trx_safe)
+        {
+            if (router->mariadb10_compat)
+            {
+                if (hdr.event_type == MARIADB10_GTID_EVENT)
+                {
+                    uint64_t n_sequence;
+                    uint32_t domainid;
+                    unsigned int flags;
+                    n_sequence = extract_field(ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN, 64);
+                    domainid = extract_field(ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 8, 32);
+                    flags = *(ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 8 + 4);
+
+                    spinlock_acquire(&router->binlog_lock);
+                    snprintf(router->last_mariadb_gtid, sizeof(router->last_mariadb_gtid),
+                             "%u-%u-%lu", domainid, hdr.serverid, n_sequence);
+                    spinlock_release(&router->binlog_lock);
+
+                    if ((flags & (MARIADB_FL_DDL | MARIADB_FL_STANDALONE)) == 0)
+                    {
+                        spinlock_acquire(&router->binlog_lock);
+
+                        if (router->pending_transaction > 0)
+                        {
+                            MXS_ERROR("A MariaDB 10 transaction "
+                                      "is already open "
+                                      "@ %lu (GTID %u-%u-%lu) and "
+                                      "a new one starts @ %lu",
+                                      router->binlog_position,
+                                      domainid, hdr.serverid,
+                                      n_sequence,
+                                      router->current_pos);
+
+                            // An action should be taken here
+                        }
+
+                        router->pending_transaction = BLRM_TRANSACTION_START;
+
+                        spinlock_release(&router->binlog_lock);
+                    }
+                }
+            }
+
+            /**
+             * look for QUERY_EVENT [BEGIN / COMMIT] and XID_EVENT
+             */
+
+            if (hdr.event_type == QUERY_EVENT)
+            {
+                char *statement_sql;
+                int db_name_len, var_block_len, statement_len;
+                db_name_len = ptr[MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4];
+                var_block_len = ptr[MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4 + 1 + 2];
+
+                statement_len = len - (MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4 + 1 + 2 + 2 \
+                                       + var_block_len + 1 + db_name_len);
+                statement_sql = MXS_CALLOC(1, statement_len + 1);
+                MXS_ABORT_IF_NULL(statement_sql);
+                memcpy(statement_sql,
+                       (char *)ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4 + 1 + 2 + 2 \
+                       + var_block_len + 1 + db_name_len,
+                       statement_len);
+
+                spinlock_acquire(&router->binlog_lock);
+
+                /* Check for BEGIN (it comes for START TRANSACTION too) */
+                if (strncmp(statement_sql, "BEGIN", 5) == 0)
+                {
+                    if (router->pending_transaction > BLRM_NO_TRANSACTION)
+                    {
+                        MXS_ERROR("A transaction is already open "
+                                  "@ %lu and a new one starts @ %lu",
+                                  router->binlog_position,
+                                  router->current_pos);
+
+                        // An action should be taken here
+                    }
+
+                    router->pending_transaction = BLRM_TRANSACTION_START;
+                }
+
+                /* Check for COMMIT in non transactional store engines */
+                if (strncmp(statement_sql, "COMMIT", 6) == 0)
+                {
+                    router->pending_transaction = BLRM_COMMIT_SEEN;
+                }
+
+                spinlock_release(&router->binlog_lock);
+
+                MXS_FREE(statement_sql);
+            }
+
+            /* Check for COMMIT in Transactional engines, i.e InnoDB */
+            if (hdr.event_type == XID_EVENT)
+            {
+                spinlock_acquire(&router->binlog_lock);
+
+                if (router->pending_transaction)
+                {
+                    router->pending_transaction = BLRM_XID_EVENT_SEEN;
+                }
+                spinlock_release(&router->binlog_lock);
+            }
+        }
+
+        /** Gather statistics about the replication event types */
+        int event_limit = router->mariadb10_compat ?
+                          MAX_EVENT_TYPE_MARIADB10 : MAX_EVENT_TYPE;
+
+        if (hdr.event_type <= event_limit)
+        {
+            router->stats.events[hdr.event_type]++;
+        }
+
+        if (hdr.event_type == FORMAT_DESCRIPTION_EVENT && hdr.next_pos == 0)
+        {
+            // Fake format description message
+            MXS_DEBUG("Replication fake event. "
+                      "Binlog %s @ %lu.",
+                      router->binlog_name,
+                      router->current_pos);
+            router->stats.n_fakeevents++;
+
+            if (hdr.event_type == FORMAT_DESCRIPTION_EVENT)
+            {
+                uint8_t *new_fde;
+                unsigned int new_fde_len;
+                /*
+                 * We need to save this to replay to new
+                 * slaves that attach later.
+                 */
+                new_fde_len = hdr.event_size;
+                new_fde = MXS_MALLOC(hdr.event_size);
+
+                if (new_fde)
+                {
+                    memcpy(new_fde, ptr + MYSQL_HEADER_LEN + 1, hdr.event_size);
+                    if (router->saved_master.fde_event)
+                    {
+                        MXS_FREE(router->saved_master.fde_event);
+                    }
+                    router->saved_master.fde_event = new_fde;
+                    router->saved_master.fde_len = new_fde_len;
+                }
+            }
+        }
+        else
+        {
+            if (hdr.event_type == HEARTBEAT_EVENT)
+            {
+#ifdef SHOW_EVENTS
+                printf("Replication heartbeat\n");
+#endif
+                MXS_DEBUG("Replication heartbeat. "
+                          "Binlog %s @ %lu.",
+                          router->binlog_name,
+                          router->current_pos);
+
+                router->stats.n_heartbeats++;
+
+                if (router->pending_transaction)
+                {
+                    router->stats.lastReply = time(0);
+                }
+            }
+            else if (hdr.flags != LOG_EVENT_ARTIFICIAL_F)
+            {
+                if (hdr.event_type == ROTATE_EVENT)
+                {
+                    spinlock_acquire(&router->binlog_lock);
+                    router->rotating = 1;
+                    spinlock_release(&router->binlog_lock);
+                }
+
+                uint32_t offset = MYSQL_HEADER_LEN + 1; // Skip header and OK byte
+
+                /**
+                 * Write the raw event data to disk without the network
+                 * header or the OK byte
+                 */
+                if (blr_write_binlog_record(router, &hdr, len - offset, ptr + offset, job) == 0)
+                {
+                    return false;
+                }
+
+                /* Check for rotate event */
+                if (hdr.event_type == ROTATE_EVENT)
+                {
+                    if (!blr_rotate_event(router, ptr + offset, &hdr))
+                    {
+                        return false;
+                    }
+                }
+
+                /* Handle semi-sync request from master */
+                if (router->master_semi_sync != MASTER_SEMISYNC_NOT_AVAILABLE &&
+                    semi_sync_send_ack == BLR_MASTER_SEMI_SYNC_ACK_REQ)
+                {
+
+                    MXS_DEBUG("%s: binlog record in file %s, pos %lu has "
+                              "SEMI_SYNC_ACK_REQ and needs a Semi-Sync ACK packet to "
+                              "be sent to the master server [%s]:%d",
+                              router->service->name, router->binlog_name,
+                              router->current_pos,
+                              router->service->dbref->server->name,
+                              router->service->dbref->server->port);
+
+                    /* The event must be in the binlog file before it is acknowledged */
+                    if (!blr_file_write_buffer(router))
+                    {
+                        return false;
+                    }
+
+                    /* Send Semi-Sync ACK packet to master server */
+                    blr_send_semisync_ack(router, hdr.next_pos);
+
+                    /* Reset ACK sending */
+                    semi_sync_send_ack = 0;
+                }
+
+                /**
+                 * Distributing binlog events to slaves
+                 * may depend on pending transaction
+                 */
+
+                spinlock_acquire(&router->binlog_lock);
+
+                if (router->write_buffer)
+                {
+                    /**
+                     * The events are buffered: the slaves are notified once
+                     * the buffer has been written to the binlog file.
+                     */
+                    if (router->trx_safe == 0 || router->pending_transaction == BLRM_NO_TRANSACTION)
+                    {
+                        router->publish_position = router->current_pos;
+                        router->publish_safe_event = router->last_event_pos;
+                    }
+                    else if (router->pending_transaction > BLRM_TRANSACTION_START)
+                    {
+                        router->publish_position = router->current_pos;
+                        router->pending_transaction = BLRM_NO_TRANSACTION;
+                    }
+
+                    spinlock_release(&router->binlog_lock);
+                }
+                else if (router->trx_safe == 0 || (router->trx_safe && router->pending_transaction == BLRM_NO_TRANSACTION))
+                {
+                    router->binlog_position = router->current_pos;
+                    router->current_safe_event = router->last_event_pos;
+
+                    spinlock_release(&router->binlog_lock);
+
+                    /* Notify clients events can be read */
+                    blr_notify_all_slaves(router);
+                }
+                else
+                {
+                    /**
+                     * If transaction is closed:
+                     *
+                     * 1) set router->binlog_position to
+                     *    router->current_pos
+                     * 2) Notify clients events can be read
+                     *
+                     * The slaves waiting for data are only woken up
+                     * after the position has moved, otherwise they
+                     * would go back to waiting without a new notification.
+                     */
+
+                    if (router->pending_transaction > BLRM_TRANSACTION_START)
+                    {
+                        router->binlog_position = router->current_pos;
+                        router->pending_transaction = BLRM_NO_TRANSACTION;
+
+                        spinlock_release(&router->binlog_lock);
+
+                        /* Notify clients events can be read */
+                        blr_notify_all_slaves(router);
+                    }
+                    else
+                    {
+                        spinlock_release(&router->binlog_lock);
+                    }
+                }
+            }
+            else
+            {
+                router->stats.n_artificial++;
+                MXS_DEBUG("Artificial event not written "
+                          "to disk or distributed. "
+                          "Type 0x%x, Length %d, Binlog "
+                          "%s @ %lu.",
+                          hdr.event_type,
+                          hdr.event_size,
+                          router->binlog_name,
+                          router->current_pos);
+                ptr += MYSQL_HEADER_LEN + 1;
+                if (hdr.event_type == ROTATE_EVENT)
+                {
+                    spinlock_acquire(&router->binlog_lock);
+                    router->rotating = 1;
+                    spinlock_release(&router->binlog_lock);
+                    if (!blr_rotate_event(router, ptr, &hdr))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        blr_terminate_master_replication(router, ptr, len);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Process a batch of events in the order they were received
+ *
+ * @param router The router instance
+ * @param jobs   The events
+ * @param n_jobs Number of events
+ * @return False if the master connection must be closed
+ */
+static bool blr_process_events(ROUTER_INSTANCE *router, BLR_EVENT_JOB *jobs, int n_jobs)
+{
+    bool rval = true;
+
+    for (int i = 0; i < n_jobs && rval; i++)
+    {
+        rval = blr_process_event(router, &jobs[i]);
+    }
+
+    blr_event_jobs_free(router, jobs, n_jobs);
+
+    return rval;
+}
+
 /**
  * blr_handle_binlog_record - we have received binlog records from
  * the master and we must now work out what to do with them.
@@ -1061,6 +1515,8 @@ blr_handle_binlog_record(ROUTER_INSTANCE *router, GWBUF *pkt)
     int check_packet_len;
     int semisync_bytes;
     int semi_sync_send_ack = 0;
+    BLR_EVENT_JOB jobs[BLR_EVENT_BATCH_SIZE];
+    int n_jobs = 0;
 
     /*
      * Loop over all the packets while we still have some data
@@ -1173,6 +1629,17 @@ blr_handle_binlog_record(ROUTER_INSTANCE *router, GWBUF *pkt)
                 }
                 else
                 {
+                    /* Process the events received before the error */
+                    if (!blr_process_events(router, jobs, n_jobs))
+                    {
+                        blr_flush_events(router);
+                        gwbuf_free(pkt);
+                        blr_master_close(router);
+                        blr_master_delayed_connect(router);
+                        return;
+                    }
+                    n_jobs = 0;
+
                     /* Terminate replication and exit from main loop */
                     blr_terminate_master_replication(router, ptr, len);
 
@@ -1257,369 +1724,91 @@ blr_handle_binlog_record(ROUTER_INSTANCE *router, GWBUF *pkt)
             router->stored_event = gwbuf_make_contiguous(router->stored_event);
             MXS_ABORT_IF_NULL(router->stored_event);
 
-            ptr = GWBUF_DATA(router->stored_event);
-
-            /**
-             * len is now the length of the complete event plus 4 bytes of network
-             * header and one OK byte. Semi-sync bytes are never stored.
-             */
-            len = gwbuf_length(router->stored_event);
+            /** Hand the event over to the event workers */
+            BLR_EVENT_JOB *job = &jobs[n_jobs++];
+            blr_event_job_init(router, job, router->stored_event, &hdr, semi_sync_send_ack);
+            router->stored_event = NULL;
 
-            /**
-             * If checksums are enabled, verify that the stored checksum
-             * matches the one we calculated
-             */
-            if (router->master_chksum && !verify_checksum(router, len, ptr))
+            if (router->workers)
             {
-                MXS_FREE(msg);
-                blr_master_close(router);
-                blr_master_delayed_connect(router);
-                return;
+                blr_event_job_submit(router, job);
             }
 
-            if (hdr.ok == 0)
+            if (n_jobs == BLR_EVENT_BATCH_SIZE || router->workers == NULL)
             {
-                router->lastEventReceived = hdr.event_type;
-                router->lastEventTimestamp = hdr.timestamp;
-
-                /**
-                 * Check for an open transaction, if the option is set
-                 * Only complete transactions should be sent to sleves
-                 *
-                 * If a trasaction is pending router->binlog_position
-                 * won't be updated to router->current_pos
-                 */
-
-                spinlock_acquire(&router->binlog_lock);
-                if (router->trx_safe == 0 || (router->trx_safe && router->pending_transaction == BLRM_NO_TRANSACTION))
-                {
-                    /* no pending transaction: set current_pos to binlog_position */
-                    router->binlog_position = router->current_pos;
-                    router->current_safe_event = router->current_pos;
-                }
-                spinlock_release(&router->binlog_lock);
-
-                /**
-                 * Detect transactions in events
-                 * Only complete transactions should be sent to sleves
-                 */
-
-                /**
-                 * If MariaDB 10 compatibility:
-                 * check for MARIADB10_GTID_EVENT with flags = 0
-                 * This marks the transaction starts instead of
-                 * QUERY_EVENT with "BEGIN"
-                 */
-                if (router->trx_safe)
-                {
-                    if (router->mariadb10_compat)
-                    {
-                        if (hdr.event_type == MARIADB10_GTID_EVENT)
-                        {
-                            uint64_t n_sequence;
-                            uint32_t domainid;
-                            unsigned int flags;
-                            n_sequence = extract_field(ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN, 64);
-                            domainid = extract_field(ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 8, 32);
-                            flags = *(ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 8 + 4);
-
-                            if ((flags & (MARIADB_FL_DDL | MARIADB_FL_STANDALONE)) == 0)
-                            {
-                                spinlock_acquire(&router->binlog_lock);
-
-                                if (router->pending_transaction > 0)
-                                {
-                                    MXS_ERROR("A MariaDB 10 transaction "
-                                              "is already open "
-                                              "@ %lu (GTID %u-%u-%lu) and "
-                                              "a new one starts @ %lu",
-                                              router->binlog_position,
-                                              domainid, hdr.serverid,
-                                              n_sequence,
-                                              router->current_pos);
-
-                                    // An action should be taken here
-                                }
-
-                                router->pending_transaction = BLRM_TRANSACTION_START;
-
-                                spinlock_release(&router->binlog_lock);
-                            }
-                        }
-                    }
-
-                    /**
-                     * look for QUERY_EVENT [BEGIN / COMMIT] and XID_EVENT
-                     */
-
-                    if (hdr.event_type == QUERY_EVENT)
-                    {
-                        char *statement_sql;
-                        int db_name_len, var_block_len, statement_len;
-                        db_name_len = ptr[MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4];
-                        var_block_len = ptr[MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4 + 1 + 2];
-
-                        statement_len = len - (MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4 + 1 + 2 + 2 \
-                                               + var_block_len + 1 + db_name_len);
-                        statement_sql = MXS_CALLOC(1, statement_len + 1);
-                        MXS_ABORT_IF_NULL(statement_sql);
-                        memcpy(statement_sql,
-                               (char *)ptr + MYSQL_HEADER_LEN + 1 + BINLOG_EVENT_HDR_LEN + 4 + 4 + 1 + 2 + 2 \
-                               + var_block_len + 1 + db_name_len,
-                               statement_len);
-
-                        spinlock_acquire(&router->binlog_lock);
-
-                        /* Check for BEGIN (it comes for START TRANSACTION too) */
-                        if (strncmp(statement_sql, "BEGIN", 5) == 0)
-                        {
-                            if (router->pending_transaction > BLRM_NO_TRANSACTION)
-                            {
-                                MXS_ERROR("A transaction is already open "
-                                          "@ %lu and a new one starts @ %lu",
-                                          router->binlog_position,
-                                          router->current_pos);
-
-                                // An action should be taken here
-                            }
-
-                            router->pending_transaction = BLRM_TRANSACTION_START;
-                        }
-
-                        /* Check for COMMIT in non transactional store engines */
-                        if (strncmp(statement_sql, "COMMIT", 6) == 0)
-                        {
-                            router->pending_transaction = BLRM_COMMIT_SEEN;
-                        }
-
-                        spinlock_release(&router->binlog_lock);
-
-                        MXS_FREE(statement_sql);
-                    }
-
-                    /* Check for COMMIT in Transactional engines, i.e InnoDB */
-                    if (hdr.event_type == XID_EVENT)
-                    {
-                        spinlock_acquire(&router->binlog_lock);
-
-                        if (router->pending_transaction)
-                        {
-                            router->pending_transaction = BLRM_XID_EVENT_SEEN;
-                        }
-                        spinlock_release(&router->binlog_lock);
-                    }
-                }
-
-                /** Gather statistics about the replication event types */
-                int event_limit = router->mariadb10_compat ?
-                                  MAX_EVENT_TYPE_MARIADB10 : MAX_EVENT_TYPE;
-
-                if (hdr.event_type <= event_limit)
-                {
-                    router->stats.events[hdr.event_type]++;
-                }
-
-                if (hdr.event_type == FORMAT_DESCRIPTION_EVENT && hdr.next_pos == 0)
+                if (!blr_process_events(router, jobs, n_jobs))
                 {
-                    // Fake format description message
-                    MXS_DEBUG("Replication fake event. "
-                              "Binlog %s @ %lu.",
-                              router->binlog_name,
-                              router->current_pos);
-                    router->stats.n_fakeevents++;
-
-                    if (hdr.event_type == FORMAT_DESCRIPTION_EVENT)
-                    {
-                        uint8_t *new_fde;
-                        unsigned int new_fde_len;
-                        /*
-                         * We need to save this to replay to new
-                         * slaves that attach later.
-                         */
-                        new_fde_len = hdr.event_size;
-                        new_fde = MXS_MALLOC(hdr.event_size);
-
-                        if (new_fde)
-                        {
-                            memcpy(new_fde, ptr + MYSQL_HEADER_LEN + 1, hdr.event_size);
-                            if (router->saved_master.fde_event)
-                            {
-                                MXS_FREE(router->saved_master.fde_event);
-                            }
-                            router->saved_master.fde_event = new_fde;
-                            router->saved_master.fde_len = new_fde_len;
-                        }
-                    }
+                    blr_flush_events(router);
+                    gwbuf_free(pkt);
+                    blr_master_close(router);
+                    blr_master_delayed_connect(router);
+                    return;
                 }
-                else
-                {
-                    if (hdr.event_type == HEARTBEAT_EVENT)
-                    {
-#ifdef SHOW_EVENTS
-                        printf("Replication heartbeat\n");
-#endif
-                        MXS_DEBUG("Replication heartbeat. "
-                                  "Binlog %s @ %lu.",
-                                  router->binlog_name,
-                                  router->current_pos);
-
-                        router->stats.n_heartbeats++;
-
-                        if (router->pending_transaction)
-                        {
-                            router->stats.lastReply = time(0);
-                        }
-                    }
-                    else if (hdr.flags != LOG_EVENT_ARTIFICIAL_F)
-                    {
-                        if (hdr.event_type == ROTATE_EVENT)
-                        {
-                            spinlock_acquire(&router->binlog_lock);
-                            router->rotating = 1;
-                            spinlock_release(&router->binlog_lock);
-                        }
-
-                        uint32_t offset = MYSQL_HEADER_LEN + 1; // Skip header and OK byte
-
-                        /**
-                         * Write the raw event data to disk without the network
-                         * header or the OK byte
-                         */
-                        if (blr_write_binlog_record(router, &hdr, len - offset, ptr + offset) == 0)
-                        {
-                            gwbuf_free(pkt);
-                            blr_master_close(router);
-                            blr_master_delayed_connect(router);
-                            return;
-                        }
-
-                        /* Check for rotate event */
-                        if (hdr.event_type == ROTATE_EVENT)
-                        {
-                            if (!blr_rotate_event(router, ptr + offset, &hdr))
-                            {
-                                gwbuf_free(pkt);
-                                blr_master_close(router);
-                                blr_master_delayed_connect(router);
-                                return;
-                            }
-                        }
+                n_jobs = 0;
+            }
+        }
 
-                        /* Handle semi-sync request from master */
-                        if (router->master_semi_sync != MASTER_SEMISYNC_NOT_AVAILABLE &&
-                            semi_sync_send_ack == BLR_MASTER_SEMI_SYNC_ACK_REQ)
-                        {
+        if (msg)
+        {
+            MXS_FREE(msg);
+            msg = NULL;
+        }
+    }
 
-                            MXS_DEBUG("%s: binlog record in file %s, pos %lu has "
-                                      "SEMI_SYNC_ACK_REQ and needs a Semi-Sync ACK packet to "
-                                      "be sent to the master server [%s]:%d",
-                                      router->service->name, router->binlog_name,
-                                      router->current_pos,
-                                      router->service->dbref->server->name,
-                                      router->service->dbref->server->port);
+    bool processed = blr_process_events(router, jobs, n_jobs);
 
-                            /* Send Semi-Sync ACK packet to master server */
-                            blr_send_semisync_ack(router, hdr.next_pos);
+    /**
+     * The events received in one read from the master are written to the
+     * binlog file, and the slaves notified, as one group.
+     */
+    if (!blr_flush_events(router) || !processed)
+    {
+        blr_master_close(router);
+        blr_master_delayed_connect(router);
+        return;
+    }
+}
 
-                            /* Reset ACK sending */
-                            semi_sync_send_ack = 0;
-                        }
+/**
+ * @brief Write the buffered events to the binlog file and notify the slaves
+ *
+ * The position up to which the slaves can read is only moved after the events
+ * before it have been written.
+ *
+ * @param router The router instance
+ * @return True if the events were written
+ */
+static bool blr_flush_events(ROUTER_INSTANCE *router)
+{
+    bool rval = blr_file_flush(router);
 
-                        /**
-                         * Distributing binlog events to slaves
-                         * may depend on pending transaction
-                         */
+    if (rval && router->publish_position)
+    {
+        spinlock_acquire(&router->binlog_lock);
 
-                        spinlock_acquire(&router->binlog_lock);
+        router->binlog_position = router->publish_position;
 
-                        if (router->trx_safe == 0 || (router->trx_safe && router->pending_transaction == BLRM_NO_TRANSACTION))
-                        {
-                            router->binlog_position = router->current_pos;
-                            router->current_safe_event = router->last_event_pos;
+        if (router->publish_safe_event)
+        {
+            router->current_safe_event = router->publish_safe_event;
+        }
 
-                            spinlock_release(&router->binlog_lock);
+        spinlock_release(&router->binlog_lock);
 
-                            /* Notify clients events can be read */
-                            blr_notify_all_slaves(router);
-                        }
-                        else
-                        {
-                            /**
-                             * If transaction is closed:
-                             *
-                             * 1) Notify clients events can be read
-                             *  from router->binlog_position
-                             * 2) set router->binlog_position to
-                             *    router->current_pos
-                             */
-
-                            if (router->pending_transaction > BLRM_TRANSACTION_START)
-                            {
-                                spinlock_release(&router->binlog_lock);
-
-                                /* Notify clients events can be read */
-                                blr_notify_all_slaves(router);
-
-                                /* update binlog_position and set pending to 0 */
-                                spinlock_acquire(&router->binlog_lock);
-
-                                router->binlog_position = router->current_pos;
-                                router->pending_transaction = BLRM_NO_TRANSACTION;
-
-                                spinlock_release(&router->binlog_lock);
-                            }
-                            else
-                            {
-                                spinlock_release(&router->binlog_lock);
-                            }
-                        }
-                    }
-                    else
-                    {
-                        router->stats.n_artificial++;
-                        MXS_DEBUG("Artificial event not written "
-                                  "to disk or distributed. "
-                                  "Type 0x%x, Length %d, Binlog "
-                                  "%s @ %lu.",
-                                  hdr.event_type,
-                                  hdr.event_size,
-                                  router->binlog_name,
-                                  router->current_pos);
-                        ptr += MYSQL_HEADER_LEN + 1;
-                        if (hdr.event_type == ROTATE_EVENT)
-                        {
-                            spinlock_acquire(&router->binlog_lock);
-                            router->rotating = 1;
-                            spinlock_release(&router->binlog_lock);
-                            if (!blr_rotate_event(router, ptr, &hdr))
-                            {
-                                gwbuf_free(pkt);
-                                blr_master_close(router);
-                                blr_master_delayed_connect(router);
-                                return;
-                            }
-                        }
-                    }
-                }
-            }
-            else
-            {
-                blr_terminate_master_replication(router, ptr, len);
-            }
+        router->publish_position = 0;
+        router->publish_safe_event = 0;
 
-            /** Finished processing the event */
-            gwbuf_free(router->stored_event);
-            router->stored_event = NULL;
-        }
+        /* Notify clients events can be read */
+        blr_notify_all_slaves(router);
+    }
 
-        if (msg)
-        {
-            MXS_FREE(msg);
-            msg = NULL;
-        }
+    if (rval && router->checkpoint_interval &&
+        router->binlog_position >= router->checkpoint_pos + router->checkpoint_interval)
+    {
+        blr_file_write_checkpoint(router);
     }
 
-    blr_file_flush(router);
+    return rval;
 }
 
 /**
@@ -1694,7 +1883,9 @@ blr_rotate_event(ROUTER_INSTANCE *router, uint8_t *ptr, REP_HEADER *hdr)
     {
         remove_encrytion_ctx = 1;
         router->stats.n_rotates++;
-        if (blr_file_rotate(router, file, pos) == 0)
+
+        /* The buffered events belong to the file that is closed */
+        if (!blr_flush_events(router) || blr_file_rotate(router, file, pos) == 0)
         {
             rotated = 0;
         }
@@ -2243,8 +2434,7 @@ blr_write_data_into_binlog(ROUTER_INSTANCE *router, uint32_t data_len, uint8_t *
 {
     int n;
 
-    if ((n = pwrite(router->binlog_fd, buf, data_len,
-                    router->last_written)) != data_len)
+    if ((n = blr_file_write(router, buf, data_len)) != data_len)
     {
         char err_msg[MXS_STRERROR_BUFLEN];
         MXS_ERROR("%s: Failed to write binlog record at %lu of %s, %s. "
@@ -2267,6 +2457,89 @@ blr_write_data_into_binlog(ROUTER_INSTANCE *router, uint32_t data_len, uint8_t *
     return n;
 }
 
+/**
+ * Write the events packed for a slave
+ *
+ * @param slave The slave
+ */
+static void blr_slave_batch_flush(ROUTER_SLAVE *slave)
+{
+    if (slave->batch)
+    {
+        /* Remove the unused end of the buffer */
+        GWBUF *batch = gwbuf_rtrim(slave->batch, GWBUF_LENGTH(slave->batch) - slave->batch_len);
+
+        slave->batch = NULL;
+        slave->batch_len = 0;
+
+        if (batch)
+        {
+            slave->stats.n_writes++;
+            slave->dcb->func.write(slave->dcb, batch);
+        }
+    }
+}
+
+/**
+ * Start packing the events sent to a slave into large buffers
+ *
+ * This is used for the bursts of events sent to a slave in catchup mode. The
+ * slave socket can also be corked so that the kernel only sends full segments
+ * while the slave is behind.
+ *
+ * @param slave The slave
+ * @param cork  Set TCP_CORK on the slave socket
+ */
+void blr_slave_batch_start(ROUTER_SLAVE *slave, bool cork)
+{
+    if (slave->router->slave_write_buffer)
+    {
+        slave->batching = true;
+
+        if (cork && !slave->corked)
+        {
+            int optval = 1;
+
+            if (setsockopt(slave->dcb->fd, IPPROTO_TCP, TCP_CORK, &optval, sizeof(optval)) == 0)
+            {
+                slave->corked = true;
+            }
+        }
+    }
+}
+
+/**
+ * Write the events packed for a slave and stop packing them
+ *
+ * The socket stays corked, as the next burst usually follows right away.
+ *
+ * @param slave The slave
+ */
+void blr_slave_batch_end(ROUTER_SLAVE *slave)
+{
+    blr_slave_batch_flush(slave);
+    slave->batching = false;
+}
+
+/**
+ * Send the data corked in the slave socket
+ *
+ * This is called when the slave has been sent all the events, so that the
+ * last events are not delayed.
+ *
+ * @param slave The slave
+ */
+void blr_slave_uncork(ROUTER_SLAVE *slave)
+{
+    if (slave->corked)
+    {
+        int optval = 0;
+
+        setsockopt(slave->dcb->fd, IPPROTO_TCP, TCP_CORK, &optval, sizeof(optval));
+        slave->corked = false;
+    }
+}
+
 /**
  * Send a replication event packet to a slave
  *
@@ -2276,6 +2549,10 @@ blr_write_data_into_binlog(ROUTER_INSTANCE *router, uint32_t data_len, uint8_t *
  * and part of the replication event is already sent, @c first must be set to
  * false so that the first status byte is not sent again.
  *
+ * Between blr_slave_batch_start() and blr_slave_batch_end() the packets are
+ * appended to a buffer of slave_write_buffer bytes, which is written when the
+ * next packet does not fit into it.
+ *
  * @param slave Slave where the packet is sent to
  * @param buf Buffer containing the data
  * @param len Length of the data
@@ -2286,10 +2563,43 @@ bool blr_send_packet(ROUTER_SLAVE *slave, uint8_t *buf, uint32_t len, bool first
 {
     bool rval = true;
     unsigned int datalen = len + (first ? 1 : 0);
-    GWBUF *buffer = gwbuf_alloc(datalen + MYSQL_HEADER_LEN);
-    if (buffer)
+    unsigned int packet_len = datalen + MYSQL_HEADER_LEN;
+    unsigned long batch_size = slave->batching ? slave->router->slave_write_buffer : 0;
+    GWBUF *buffer = NULL;
+    uint8_t *data = NULL;
+
+    if (packet_len <= batch_size)
+    {
+        if (slave->batch && slave->batch_len + packet_len > batch_size)
+        {
+            blr_slave_batch_flush(slave);
+        }
+
+        if (slave->batch == NULL)
+        {
+            slave->batch = gwbuf_alloc(batch_size);
+            slave->batch_len = 0;
+        }
+
+        if (slave->batch)
+        {
+            data = GWBUF_DATA(slave->batch) + slave->batch_len;
+            slave->batch_len += packet_len;
+        }
+    }
+    else
+    {
+        /* The packed events are sent first to keep the packets in order */
+        blr_slave_batch_flush(slave);
+
+        if ((buffer = gwbuf_alloc(packet_len)))
+        {
+            data = GWBUF_DATA(buffer);
+        }
+    }
+
+    if (data)
     {
-        uint8_t *data = GWBUF_DATA(buffer);
         encode_value(data, datalen, 24);
         data += 3;
         *data++ = slave->seqno++;
@@ -2304,13 +2614,18 @@ bool blr_send_packet(ROUTER_SLAVE *slave, uint8_t *buf, uint32_t len, bool first
             memcpy(data, buf, len);
         }
 
-        slave->stats.n_bytes += GWBUF_LENGTH(buffer);
-        slave->dcb->func.write(slave->dcb, buffer);
+        slave->stats.n_bytes += packet_len;
+
+        if (buffer)
+        {
+            slave->stats.n_writes++;
+            slave->dcb->func.write(slave->dcb, buffer);
+        }
     }
     else
     {
-        MXS_ERROR("failed to allocate %u bytes of memory when writing an "
-                  "event.", datalen + MYSQL_HEADER_LEN);
+        MXS_ERROR("failed to allocate %lu bytes of memory when writing an "
+                  "event.", packet_len <= batch_size ? batch_size : packet_len);
         rval = false;
     }
     return rval;
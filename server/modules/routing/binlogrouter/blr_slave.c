@@ -106,6 +106,7 @@ static int blr_slave_send_timestamp(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave
 static int blr_slave_register(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, GWBUF *queue);
 static int blr_slave_binlog_dump(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, GWBUF *queue);
 int blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large);
+static bool blr_slave_park(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave);
 uint8_t *blr_build_header(GWBUF *pkt, REP_HEADER *hdr);
 int blr_slave_callback(DCB *dcb, DCB_REASON reason, void *data);
 static int blr_slave_fake_rotate(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, BLFILE** filep);
@@ -536,6 +537,20 @@ blr_slave_query(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, GWBUF *queue)
 
             return blr_slave_send_var_value(router, slave, heading, server_id, BLR_TYPE_INT);
         }
+        else if (strcasecmp(word, "@@GLOBAL.gtid_domain_id") == 0)
+        {
+            char    domain_id[40];
+            char    heading[40]; /* to ensure we match the case in query and response */
+
+            spinlock_acquire(&router->binlog_lock);
+            sprintf(domain_id, "%u", (unsigned int)strtoul(router->last_mariadb_gtid, NULL, 10));
+            spinlock_release(&router->binlog_lock);
+            strcpy(heading, word);
+
+            MXS_FREE(query_text);
+
+            return blr_slave_send_var_value(router, slave, heading, domain_id, BLR_TYPE_INT);
+        }
         else if (strcasestr(word, "binlog_gtid_pos"))
         {
             unexpected = false;
@@ -785,6 +800,33 @@ blr_slave_query(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, GWBUF *queue)
             MXS_FREE(query_text);
             return blr_slave_replay(router, slave, router->saved_master.chksum1);
         }
+        else if (strcasecmp(word, "@slave_connect_state") == 0)
+        {
+            /* The value is the rest of the statement, a list of GTIDs can have commas */
+            char *value = brkb + strspn(brkb, " \t=");
+            int len = strlen(value);
+
+            while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\''))
+            {
+                value[--len] = '\0';
+            }
+            if (value[0] == '\'')
+            {
+                value++;
+            }
+
+            MXS_FREE(slave->mariadb_gtid);
+            slave->mariadb_gtid = MXS_STRDUP_A(value);
+
+            MXS_FREE(query_text);
+            return blr_slave_send_ok(router, slave);
+        }
+        else if ((strcasecmp(word, "@slave_gtid_strict_mode") == 0) ||
+                 (strcasecmp(word, "@slave_gtid_ignore_duplicates") == 0))
+        {
+            MXS_FREE(query_text);
+            return blr_slave_send_ok(router, slave);
+        }
         else if (strcasecmp(word, "@slave_uuid") == 0)
         {
             if ((word = strtok_r(NULL, sep, &brkb)) != NULL)
@@ -2031,6 +2073,65 @@ blr_slave_binlog_dump(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, GWBUF *queue
     memcpy(slave->binlogfile, (char *)ptr, binlognamelen);
     slave->binlogfile[binlognamelen] = 0;
 
+    /* A slave with an empty GTID state starts from the requested position or,
+     * if it didn't request one, from the beginning of the first binlog file */
+    if (slave->mariadb_gtid && slave->mariadb_gtid[0] == '\0')
+    {
+        if (slave->binlogfile[0] == '\0')
+        {
+            blr_file_get_first(router, slave->binlogfile);
+            slave->binlog_pos = BINLOG_MAGIC_SIZE;
+            binlognamelen = strlen(slave->binlogfile);
+        }
+
+        MXS_INFO("%s: Slave %s:%i, server-id %d, empty GTID state, starting from binlog '%s', "
+                 "position %lu",
+                 router->service->name,
+                 slave->dcb->remote,
+                 dcb_get_port(slave->dcb),
+                 slave->serverid,
+                 slave->binlogfile,
+                 (unsigned long)slave->binlog_pos);
+    }
+    /* A slave connecting with GTID starts after the GTID it has executed */
+    else if (slave->mariadb_gtid)
+    {
+        char err_msg[BINLOG_ERROR_MSG_LEN + 1];
+        uint64_t pos;
+
+        err_msg[BINLOG_ERROR_MSG_LEN] = '\0';
+
+        if (!blr_gtid_index_find(router, slave->mariadb_gtid, slave->binlogfile, &pos, err_msg))
+        {
+            MXS_ERROR("%s: Slave %s:%i, server-id %d, blr_slave_binlog_dump failure: %s",
+                      router->service->name,
+                      slave->dcb->remote,
+                      dcb_get_port(slave->dcb),
+                      slave->serverid,
+                      err_msg);
+
+            slave->state = BLRS_ERRORED;
+
+            /* Send error that stops slave replication */
+            blr_send_custom_error(slave->dcb, 1, 0, err_msg, "HY000", 1236);
+
+            dcb_close(slave->dcb);
+            return 1;
+        }
+
+        slave->binlog_pos = pos;
+        binlognamelen = strlen(slave->binlogfile);
+
+        MXS_INFO("%s: Slave %s:%i, server-id %d, GTID %s is followed by binlog '%s', position %lu",
+                 router->service->name,
+                 slave->dcb->remote,
+                 dcb_get_port(slave->dcb),
+                 slave->serverid,
+                 slave->mariadb_gtid,
+                 slave->binlogfile,
+                 (unsigned long)slave->binlog_pos);
+    }
+
     if (router->trx_safe)
     {
         /**
@@ -2285,32 +2386,56 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
         burst = router->short_burst;
     }
 
-    burst_size = router->burst_size;
+    /* An overrun of the previous burst is paid back from this one */
+    burst_size = router->burst_size + slave->burst_credit;
+    slave->burst_credit = 0;
 
-    int do_return;
+    /* Nothing can be sent before the master publishes new events */
+    if (blr_slave_park(router, slave))
+    {
+        return 0;
+    }
 
-    spinlock_acquire(&router->binlog_lock);
+    unsigned long lag = 0;
 
-    do_return = 0;
+    spinlock_acquire(&router->binlog_lock);
 
-    /* check for a pending transaction and safe position */
-    if (router->pending_transaction && strcmp(router->binlog_name, slave->binlogfile) == 0 &&
-        (slave->binlog_pos > router->binlog_position))
+    if (strcmp(router->binlog_name, slave->binlogfile) == 0 &&
+        router->binlog_position > slave->binlog_pos)
     {
-        do_return = 1;
+        lag = router->binlog_position - slave->binlog_pos;
     }
 
     spinlock_release(&router->binlog_lock);
 
-    if (do_return)
+    bool nearly_caught_up = lag && lag <= router->burst_size;
+
+    if (nearly_caught_up)
     {
+        /**
+         * The slave is nearly caught up: send all of the remaining events
+         * now so that it can wait for new events instead of taking another
+         * turn behind the lagging slaves.
+         */
+        burst = lag / BINLOG_EVENT_HDR_LEN + 1;
+
+        if (burst_size < (long)lag)
+        {
+            burst_size = lag;
+        }
+    }
+    else if (burst_size <= 0)
+    {
+        /* Let the other slaves use this turn */
+        slave->burst_credit = burst_size;
+
         spinlock_acquire(&slave->catch_lock);
         slave->cstate &= ~CS_BUSY;
         slave->cstate |= CS_EXPECTCB;
         spinlock_release(&slave->catch_lock);
         poll_fake_write_event(slave->dcb);
 
-        return 0;
+        return rval;
     }
 
     BLFILE *file;
@@ -2363,6 +2488,9 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
 #endif
     int events_before = slave->stats.n_events;
 
+    /* A slave that is nearly caught up gets its events without delay */
+    blr_slave_batch_start(slave, !nearly_caught_up);
+
     while (burst-- && burst_size > 0 &&
            (record = blr_read_binlog(router, file, slave->binlog_pos, &hdr, read_errmsg, slave->encryption_ctx)) != NULL)
     {
@@ -2454,6 +2582,8 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
                 err_msg[BINLOG_ERROR_MSG_LEN] = '\0';
                 if (rotating)
                 {
+                    blr_slave_batch_end(slave);
+
                     spinlock_acquire(&slave->catch_lock);
                     slave->cstate |= CS_EXPECTCB;
                     slave->cstate &= ~CS_BUSY;
@@ -2469,6 +2599,7 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
                           slave->binlogfile);
 
                 slave->state = BLRS_ERRORED;
+                blr_slave_batch_end(slave);
 
                 snprintf(err_msg, BINLOG_ERROR_MSG_LEN,
                          "Failed to open binlog '%s' in rotate event", slave->binlogfile);
@@ -2510,6 +2641,7 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
 #ifndef BLFILE_IN_SLAVE
             blr_close_binlog(router, file);
 #endif
+            blr_slave_batch_end(slave);
             slave->state = BLRS_ERRORED;
             dcb_close(slave->dcb);
             return 0;
@@ -2525,6 +2657,19 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
         }
     }
 
+    /* The burst is written before another thread can start the next one */
+    blr_slave_batch_end(slave);
+
+    if (nearly_caught_up)
+    {
+        blr_slave_uncork(slave);
+    }
+
+    if (burst_size < 0)
+    {
+        slave->burst_credit = burst_size;
+    }
+
     /**
      * End of while reading
      * Checking last buffer first
@@ -2623,37 +2768,9 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
         /* force slave to read events via catchup routine */
         poll_fake_write_event(slave->dcb);
     }
-    else if (slave->binlog_pos == router->binlog_position &&
-             strcmp(slave->binlogfile, router->binlog_name) == 0)
+    else if (blr_slave_park(router, slave))
     {
-        spinlock_acquire(&router->binlog_lock);
-        spinlock_acquire(&slave->catch_lock);
-
-        /*
-         * Now check again since we hold the router->binlog_lock
-         * and slave->catch_lock.
-         */
-        if (slave->binlog_pos != router->binlog_position ||
-            strcmp(slave->binlogfile, router->binlog_name) != 0)
-        {
-            slave->cstate |= CS_EXPECTCB;
-            spinlock_release(&slave->catch_lock);
-            spinlock_release(&router->binlog_lock);
-
-            /* force slave to read events via catchup routine */
-            poll_fake_write_event(slave->dcb);
-        }
-        else
-        {
-            /* set the CS_WAIT_DATA that allows notification
-             * when new events are received form master server
-             * call back routine will be called later.
-             */
-            slave->cstate |= CS_WAIT_DATA;
-
-            spinlock_release(&slave->catch_lock);
-            spinlock_release(&router->binlog_lock);
-        }
+        /* The slave is woken up when the master publishes new events */
     }
     else
     {
@@ -2720,6 +2837,49 @@ blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
     return rval;
 }
 
+/**
+ * Park a slave that has been sent all the events the router can safely send.
+ *
+ * Instead of polling the binlog with fake write events, the slave is marked with
+ * CS_WAIT_DATA and blr_notify_waiting_slave() restarts the catchup when the
+ * master publishes new events. The check is done while holding both the
+ * router->binlog_lock and the slave->catch_lock so that a notification
+ * can not be missed.
+ *
+ * @param router    The router instance
+ * @param slave     The slave
+ * @return True if the slave was parked, false if there are events to send
+ */
+static bool
+blr_slave_park(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave)
+{
+    bool parked = false;
+
+    spinlock_acquire(&router->binlog_lock);
+    spinlock_acquire(&slave->catch_lock);
+
+    if (slave->binlog_pos >= router->binlog_position &&
+        strcmp(slave->binlogfile, router->binlog_name) == 0)
+    {
+        slave->cstate &= ~CS_BUSY;
+        slave->cstate |= CS_WAIT_DATA;
+        slave->burst_credit = 0;
+        slave->stats.n_caughtup++;
+        parked = true;
+    }
+
+    spinlock_release(&slave->catch_lock);
+    spinlock_release(&router->binlog_lock);
+
+    if (parked)
+    {
+        /* Send the last events without waiting for more data */
+        blr_slave_uncork(slave);
+    }
+
+    return parked;
+}
+
 /**
  * The DCB callback used by the slave to obtain DCB_REASON_LOW_WATER callbacks
  * when the server sends all the the queue data for a DCB. This is the mechanism
@@ -45,6 +45,8 @@
 #include <ini.h>
 #include <sys/stat.h>
 #include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include <maxscale/version.h>
 
@@ -68,6 +70,179 @@ static struct option long_options[] =
     {0, 0, 0, 0}
 };
 
+/** Number of events written by the event worker test */
+#define TEST_EVENTS 200
+
+/**
+ * Create the event number @c i as it is received from the master
+ *
+ * Every 50th event has a wrong checksum.
+ *
+ * @param i   The event number
+ * @param pos Binlog position of the event
+ * @param hdr The replication header of the event
+ * @return The event with the network header and the OK byte
+ */
+static GWBUF *make_test_event(int i, uint64_t pos, REP_HEADER *hdr)
+{
+    uint32_t event_size = BINLOG_EVENT_HDR_LEN + 20 + (i * 37) % 500 + BINLOG_EVENT_CRC_SIZE;
+    GWBUF *event = gwbuf_alloc(MYSQL_HEADER_LEN + 1 + event_size);
+    uint8_t *ptr = GWBUF_DATA(event) + MYSQL_HEADER_LEN + 1;
+
+    memset(GWBUF_DATA(event), 0, MYSQL_HEADER_LEN + 1);
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->timestamp = 1490000000 + i;
+    hdr->event_type = QUERY_EVENT;
+    hdr->serverid = 1;
+    hdr->event_size = event_size;
+    hdr->next_pos = pos + event_size;
+
+    gw_mysql_set_byte4(ptr, hdr->timestamp);
+    ptr[4] = hdr->event_type;
+    gw_mysql_set_byte4(ptr + 5, hdr->serverid);
+    gw_mysql_set_byte4(ptr + 9, hdr->event_size);
+    gw_mysql_set_byte4(ptr + 13, hdr->next_pos);
+    ptr[17] = ptr[18] = 0;
+
+    for (uint32_t j = BINLOG_EVENT_HDR_LEN; j < event_size - BINLOG_EVENT_CRC_SIZE; j++)
+    {
+        ptr[j] = (i + j) % 251;
+    }
+
+    uint32_t chksum = crc32(0L, ptr, event_size - BINLOG_EVENT_CRC_SIZE);
+    gw_mysql_set_byte4(ptr + event_size - BINLOG_EVENT_CRC_SIZE, i % 50 == 49 ? ~chksum : chksum);
+
+    return event;
+}
+
+/**
+ * Verify and write the test events into a binlog file
+ *
+ * The events are processed like the master thread does it. If event workers
+ * are configured, all events are first queued for the workers.
+ *
+ * @param inst     The router instance
+ * @param path     The binlog file to write
+ * @param checksum The checksum results of the events
+ * @return True if the events were processed
+ */
+static bool write_test_events(ROUTER_INSTANCE *inst, const char *path, bool *checksum)
+{
+    BLR_EVENT_JOB *jobs = MXS_CALLOC(TEST_EVENTS, sizeof(BLR_EVENT_JOB));
+    BINLOG_ENCRYPTION_CTX *encryption_ctx = (BINLOG_ENCRYPTION_CTX *)(inst->encryption_ctx);
+    bool rval = jobs != NULL;
+    uint64_t pos = 4;
+
+    if ((inst->binlog_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1 ||
+        (inst->event_workers && !blr_event_workers_start(inst)))
+    {
+        rval = false;
+    }
+
+    inst->current_pos = pos;
+    inst->last_written = pos;
+
+    for (int i = 0; rval && i < TEST_EVENTS; i++)
+    {
+        jobs[i].event = make_test_event(i, pos, &jobs[i].hdr);
+        jobs[i].verify = true;
+        jobs[i].encrypt = true;
+        jobs[i].pos = pos;
+        memcpy(jobs[i].nonce, encryption_ctx->nonce, BLRM_NONCE_LENGTH);
+
+        if (inst->workers)
+        {
+            blr_event_job_submit(inst, &jobs[i]);
+        }
+
+        /** Events with a wrong checksum are not written */
+        if (i % 50 != 49)
+        {
+            pos = jobs[i].hdr.next_pos;
+        }
+    }
+
+    for (int i = 0; rval && i < TEST_EVENTS; i++)
+    {
+        uint8_t *ptr = GWBUF_DATA(jobs[i].event);
+        size_t len = gwbuf_length(jobs[i].event);
+
+        if (inst->workers)
+        {
+            blr_event_job_wait(inst, &jobs[i]);
+        }
+        else
+        {
+            jobs[i].checksum_ok = blr_event_checksum_ok(len, ptr);
+        }
+
+        checksum[i] = jobs[i].checksum_ok;
+
+        if (jobs[i].checksum_ok &&
+            blr_write_binlog_record(inst, &jobs[i].hdr, jobs[i].hdr.event_size,
+                                    ptr + MYSQL_HEADER_LEN + 1, &jobs[i]) == 0)
+        {
+            rval = false;
+        }
+    }
+
+    blr_event_workers_stop(inst);
+
+    for (int i = 0; jobs && i < TEST_EVENTS; i++)
+    {
+        gwbuf_free(jobs[i].encrypted);
+        gwbuf_free(jobs[i].event);
+    }
+
+    MXS_FREE(jobs);
+
+    if (inst->binlog_fd != -1)
+    {
+        close(inst->binlog_fd);
+        inst->binlog_fd = -1;
+    }
+
+    return rval && inst->workers == NULL;
+}
+
+/**
+ * Compare the contents of two files
+ *
+ * @return True if the files are identical
+ */
+static bool files_equal(const char *path1, const char *path2)
+{
+    FILE *file1 = fopen(path1, "rb");
+    FILE *file2 = fopen(path2, "rb");
+    bool rval = file1 && file2;
+
+    while (rval)
+    {
+        int c = fgetc(file1);
+
+        if (c != fgetc(file2))
+        {
+            rval = false;
+        }
+        else if (c == EOF)
+        {
+            break;
+        }
+    }
+
+    if (file1)
+    {
+        fclose(file1);
+    }
+
+    if (file2)
+    {
+        fclose(file2);
+    }
+
+    return rval;
+}
+
 int main(int argc, char **argv)
 {
     ROUTER_INSTANCE *inst;
@@ -700,6 +875,356 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    tests++;
+
+    printf("--------- GTID index tests ---------\n");
+
+    char dir_template[] = "/tmp/testbinlog_XXXXXX";
+    char binlog[BINLOG_FNAMELEN + 1];
+    char path[PATH_MAX + 1];
+    uint64_t pos;
+
+    if ((inst->binlogdir = mkdtemp(dir_template)) == NULL ||
+        (inst->gtid_index = blr_gtid_index_create()) == NULL)
+    {
+        printf("Test %d: creating the GTID index FAILED\n", tests);
+        return 1;
+    }
+
+    spinlock_init(&inst->binlog_lock);
+    strcpy(inst->binlog_name, "file.100506");
+    inst->binlog_position = 123456;
+
+    for (uint64_t seq = 1; seq <= 1000; seq++)
+    {
+        blr_gtid_index_add(inst, 0, 1, seq, seq * 100);
+    }
+    blr_gtid_index_flush(inst);
+
+    /**
+     * Test 24: find a GTID in the middle of the index
+     *
+     * Expected the position of the next GTID event
+     */
+    if (blr_gtid_index_find(inst, "0-1-500", binlog, &pos, error_string) &&
+        strcmp(binlog, "file.100506") == 0 && pos == 50100)
+    {
+        printf("Test %d PASSED, GTID 0-1-500 is followed by [%s] %lu\n", tests, binlog,
+               (unsigned long)pos);
+    }
+    else
+    {
+        printf("Test %d: find GTID 0-1-500 FAILED, [%s] %lu, Message [%s]\n", tests, binlog,
+               (unsigned long)pos, error_string);
+        return 1;
+    }
+
+    tests++;
+
+    /**
+     * Test 25: find the last GTID of the index
+     *
+     * Expected the current binlog position
+     */
+    if (blr_gtid_index_find(inst, "0-1-1000", binlog, &pos, error_string) &&
+        strcmp(binlog, "file.100506") == 0 && pos == 123456)
+    {
+        printf("Test %d PASSED, GTID 0-1-1000 is followed by the current position\n", tests);
+    }
+    else
+    {
+        printf("Test %d: find GTID 0-1-1000 FAILED, [%s] %lu, Message [%s]\n", tests, binlog,
+               (unsigned long)pos, error_string);
+        return 1;
+    }
+
+    tests++;
+
+    /**
+     * Test 26: find GTIDs that are not in the index
+     *
+     * Expected an error for a too large sequence, a wrong server id and an unknown domain
+     */
+    if (!blr_gtid_index_find(inst, "0-1-1001", binlog, &pos, error_string) &&
+        !blr_gtid_index_find(inst, "0-2-500", binlog, &pos, error_string) &&
+        !blr_gtid_index_find(inst, "1-1-500", binlog, &pos, error_string) &&
+        !blr_gtid_index_find(inst, "0-1-", binlog, &pos, error_string))
+    {
+        printf("Test %d PASSED, unknown GTIDs are not found\n", tests);
+    }
+    else
+    {
+        printf("Test %d: unknown GTID FAILED, [%s] %lu\n", tests, binlog, (unsigned long)pos);
+        return 1;
+    }
+
+    tests++;
+
+    /**
+     * Test 27: add a sequence number that is already in the index
+     *
+     * Expected the entries from that sequence number onwards to be replaced
+     */
+    strcpy(inst->binlog_name, "file.100507");
+    blr_gtid_index_add(inst, 0, 2, 600, 4);
+    blr_gtid_index_add(inst, 0, 2, 601, 500);
+    blr_gtid_index_flush(inst);
+
+    if (blr_gtid_index_find(inst, "0-1-599", binlog, &pos, error_string) &&
+        strcmp(binlog, "file.100507") == 0 && pos == 4 &&
+        blr_gtid_index_find(inst, "0-2-600", binlog, &pos, error_string) &&
+        strcmp(binlog, "file.100507") == 0 && pos == 500 &&
+        !blr_gtid_index_find(inst, "0-1-601", binlog, &pos, error_string) &&
+        !blr_gtid_index_find(inst, "0-1-700", binlog, &pos, error_string))
+    {
+        printf("Test %d PASSED, the index was rewound to GTID 0-1-599\n", tests);
+    }
+    else
+    {
+        printf("Test %d: rewind of the GTID index FAILED, [%s] %lu, Message [%s]\n", tests, binlog,
+               (unsigned long)pos, error_string);
+        return 1;
+    }
+
+    tests++;
+
+    /**
+     * Test 28: rewind the whole index of a domain
+     *
+     * Expected only the new entries to be found
+     */
+    blr_gtid_index_add(inst, 0, 3, 1, 1000);
+    blr_gtid_index_add(inst, 0, 3, 2, 2000);
+    blr_gtid_index_flush(inst);
+
+    if (blr_gtid_index_find(inst, "0-3-1", binlog, &pos, error_string) && pos == 2000 &&
+        !blr_gtid_index_find(inst, "0-1-500", binlog, &pos, error_string))
+    {
+        printf("Test %d PASSED, the index was rewound to its beginning\n", tests);
+    }
+    else
+    {
+        printf("Test %d: rewind to the beginning FAILED, [%s] %lu, Message [%s]\n", tests, binlog,
+               (unsigned long)pos, error_string);
+        return 1;
+    }
+
+    tests++;
+
+    /**
+     * Test 29: find the first binlog file for a slave with an empty GTID state
+     *
+     * Expected the file with the smallest number
+     */
+    const int binlog_files[] = {100507, 100505, 100506};
+
+    for (int i = 0; i < 3; i++)
+    {
+        snprintf(path, sizeof(path), "%s/file.%06d", inst->binlogdir, binlog_files[i]);
+        FILE *file = fopen(path, "w");
+
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+
+    blr_file_get_first(inst, binlog);
+
+    if (strcmp(binlog, "file.100505") == 0)
+    {
+        printf("Test %d PASSED, the first binlog file is [%s]\n", tests, binlog);
+    }
+    else
+    {
+        printf("Test %d: find the first binlog file FAILED, [%s]\n", tests, binlog);
+        return 1;
+    }
+
+    tests++;
+
+    printf("--------- Binlog compression tests ---------\n");
+
+    /**
+     * Test 30: compress a closed binlog file and stop the compressor thread
+     *
+     * The first block is not compressible and the rest of the file is.
+     * Expected the binlog file to be replaced by the compressed file.
+     */
+    const uint64_t raw_size = 3 * BINLOG_COMPRESSED_BLOCK_SIZE + 1000;
+    uint8_t *raw = MXS_MALLOC(raw_size);
+    uint8_t *readbuf = MXS_MALLOC(raw_size);
+    uint32_t seed = 1;
+
+    for (uint64_t i = 0; i < raw_size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        raw[i] = i < BINLOG_COMPRESSED_BLOCK_SIZE ? seed >> 16 : i % 251;
+    }
+
+    snprintf(path, sizeof(path), "%s/file.100504", inst->binlogdir);
+    FILE *binlog_file = fopen(path, "w");
+
+    if (binlog_file == NULL || fwrite(raw, 1, raw_size, binlog_file) != raw_size)
+    {
+        printf("Test %d: writing the binlog file FAILED\n", tests);
+        return 1;
+    }
+
+    fclose(binlog_file);
+
+    /** A leftover of an interrupted compression */
+    char stale_path[PATH_MAX + 1];
+    snprintf(stale_path, sizeof(stale_path), "%s/file.100503" BINLOG_COMPRESSED_SUFFIX ".tmp",
+             inst->binlogdir);
+    fclose(fopen(stale_path, "w"));
+
+    /** Only file.100504 is older than the newest three files */
+    inst->compression_keep = 3;
+
+    if (!blr_compress_start(inst))
+    {
+        printf("Test %d: starting the compressor thread FAILED\n", tests);
+        return 1;
+    }
+
+    for (int i = 0; i < 1000 && inst->stats.n_compressed == 0; i++)
+    {
+        usleep(10000);
+    }
+
+    blr_compress_stop(inst);
+
+    char zpath[PATH_MAX + 1];
+    snprintf(zpath, sizeof(zpath), "%s" BINLOG_COMPRESSED_SUFFIX, path);
+
+    if (inst->stats.n_compressed == 1 && inst->compressor == NULL &&
+        access(path, F_OK) != 0 && access(zpath, R_OK) == 0 && access(stale_path, F_OK) != 0)
+    {
+        printf("Test %d PASSED, the binlog file was compressed\n", tests);
+    }
+    else
+    {
+        printf("Test %d: binlog compression FAILED, %lu files compressed\n", tests,
+               (unsigned long)inst->stats.n_compressed);
+        return 1;
+    }
+
+    tests++;
+
+    /**
+     * Test 31: read the compressed file across block boundaries
+     *
+     * Expected the same data as in the original file
+     */
+    const struct
+    {
+        uint64_t pos;
+        size_t   len;
+        ssize_t  expected;
+    } reads[] =
+    {
+        {0, raw_size, raw_size},
+        {BINLOG_COMPRESSED_BLOCK_SIZE - 10, 20, 20},
+        {BINLOG_COMPRESSED_BLOCK_SIZE, BINLOG_COMPRESSED_BLOCK_SIZE, BINLOG_COMPRESSED_BLOCK_SIZE},
+        {2 * BINLOG_COMPRESSED_BLOCK_SIZE - 1, 2, 2},
+        {BINLOG_COMPRESSED_BLOCK_SIZE / 2, 2 * BINLOG_COMPRESSED_BLOCK_SIZE, 2 * BINLOG_COMPRESSED_BLOCK_SIZE},
+        {4, 19, 19},
+        {raw_size - 5, 100, 5},
+        {raw_size, 10, 0}
+    };
+
+    int fd = open(zpath, O_RDONLY);
+    BLR_COMPRESSED_FILE *compressed = fd != -1 ? blr_compressed_open(fd, zpath) : NULL;
+
+    if (compressed == NULL || compressed->raw_size != raw_size)
+    {
+        printf("Test %d: opening the compressed binlog file FAILED\n", tests);
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(reads) / sizeof(reads[0]); i++)
+    {
+        ssize_t n = blr_compressed_pread(fd, compressed, readbuf, reads[i].len, reads[i].pos);
+
+        if (n != reads[i].expected || memcmp(readbuf, raw + reads[i].pos, n) != 0)
+        {
+            printf("Test %d: reading %lu bytes at %lu FAILED, read %ld bytes\n", tests,
+                   (unsigned long)reads[i].len, (unsigned long)reads[i].pos, (long)n);
+            return 1;
+        }
+    }
+
+    printf("Test %d PASSED, the compressed binlog file was read correctly\n", tests);
+
+    blr_compressed_close(compressed);
+    close(fd);
+    unlink(zpath);
+    MXS_FREE(raw);
+    MXS_FREE(readbuf);
+
+    tests++;
+
+    printf("--------- Event worker tests ---------\n");
+
+    /**
+     * Test 32: write encrypted events with and without event workers
+     *
+     * Expected the same checksum results and identical binlog files. No
+     * event encrypted by the workers should be encrypted again.
+     */
+    BINLOG_ENCRYPTION_CTX encryption_ctx;
+    char worker_path[PATH_MAX + 1];
+    bool checksum[TEST_EVENTS];
+    bool worker_checksum[TEST_EVENTS];
+
+    memset(&encryption_ctx, 0, sizeof(encryption_ctx));
+    memset(encryption_ctx.nonce, 0xab, BLRM_NONCE_LENGTH);
+    inst->encryption_ctx = &encryption_ctx;
+    inst->encryption.enabled = true;
+    inst->encryption.encryption_algorithm = BLR_AES_CBC;
+    inst->encryption.key_len = 32;
+
+    for (int i = 0; i < 32; i++)
+    {
+        inst->encryption.key_value[i] = i * 7;
+    }
+
+    snprintf(path, sizeof(path), "%s/events.0", inst->binlogdir);
+    snprintf(worker_path, sizeof(worker_path), "%s/events.4", inst->binlogdir);
+
+    inst->event_workers = 0;
+    bool written = write_test_events(inst, path, checksum);
+    inst->event_workers = 4;
+    written = write_test_events(inst, worker_path, worker_checksum) && written;
+
+    if (written && inst->stats.n_reencrypted == 0 &&
+        memcmp(checksum, worker_checksum, sizeof(checksum)) == 0 &&
+        !checksum[49] && checksum[50] && files_equal(path, worker_path))
+    {
+        printf("Test %d PASSED, the event workers wrote identical events\n", tests);
+    }
+    else
+    {
+        printf("Test %d: event workers FAILED, the binlog files differ\n", tests);
+        return 1;
+    }
+
+    unlink(path);
+    unlink(worker_path);
+    inst->encryption.enabled = false;
+    inst->encryption_ctx = NULL;
+
+    for (int i = 0; i < 3; i++)
+    {
+        snprintf(path, sizeof(path), "%s/file.%06d", inst->binlogdir, binlog_files[i]);
+        unlink(path);
+    }
+
+    snprintf(path, sizeof(path), "%s/" BLR_GTID_INDEX_PREFIX "0", inst->binlogdir);
+    unlink(path);
+    rmdir(inst->binlogdir);
+
     mxs_log_flush_sync();
     mxs_log_finish();
 
@@ -54,6 +54,7 @@
 #include "../../../core/maxscale/monitor.h"
 #include "../../../core/maxscale/session.h"
 #include "../../../core/maxscale/poll.h"
+#include "../../../core/maxscale/topqueries.h"
 
 extern char *create_hex_sha1_sha1_passwd(char *passwd);
 
@@ -689,6 +690,7 @@ static struct uri_table
     { "/variables", maxinfo_variables },
     { "/status", maxinfo_status },
     { "/event/times", eventTimesGetList },
+    { "/top/queries", topQueriesGetList },
     { NULL, NULL }
 };
 
@@ -50,6 +50,7 @@
 #include "../../../core/maxscale/monitor.h"
 #include "../../../core/maxscale/poll.h"
 #include "../../../core/maxscale/session.h"
+#include "../../../core/maxscale/topqueries.h"
 
 static void exec_show(DCB *dcb, MAXINFO_TREE *tree);
 static void exec_select(DCB *dcb, MAXINFO_TREE *tree);
@@ -267,6 +268,26 @@ exec_show_eventTimes(DCB *dcb, MAXINFO_TREE *tree)
     resultset_free(set);
 }
 
+/**
+ * Fetch the heaviest statements collected by the topfilter instances
+ *
+ * @param dcb   DCB to which to stream result set
+ * @param tree  Potential like clause (currently unused)
+ */
+static void
+exec_show_topQueries(DCB *dcb, MAXINFO_TREE *tree)
+{
+    RESULTSET *set;
+
+    if ((set = topQueriesGetList()) == NULL)
+    {
+        return;
+    }
+
+    resultset_stream_mysql(set, dcb);
+    resultset_free(set);
+}
+
 /**
  * The table of show commands that are supported
  */
@@ -286,6 +307,7 @@ static struct
     { "modules", exec_show_modules },
     { "monitors", exec_show_monitors },
     { "eventTimes", exec_show_eventTimes },
+    { "topQueries", exec_show_topQueries },
     { NULL, NULL }
 };
 
@@ -196,6 +196,8 @@ MXS_MODULE *MXS_CREATE_MODULE()
             {"max_sescmd_history", MXS_MODULE_PARAM_COUNT, "0"},
             {"strict_multi_stmt",  MXS_MODULE_PARAM_BOOL, "true"},
             {"master_accept_reads", MXS_MODULE_PARAM_BOOL, "false"},
+            {"lazy_connect", MXS_MODULE_PARAM_BOOL, "false"},
+            {"backend_idle_timeout", MXS_MODULE_PARAM_COUNT, "0"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -278,6 +280,8 @@ static MXS_ROUTER *createInstance(SERVICE *service, char **options)
     router->rwsplit_config.disable_sescmd_history = config_get_bool(params, "disable_sescmd_history");
     router->rwsplit_config.max_sescmd_history = config_get_integer(params, "max_sescmd_history");
     router->rwsplit_config.master_accept_reads = config_get_bool(params, "master_accept_reads");
+    router->rwsplit_config.lazy_connect = config_get_bool(params, "lazy_connect");
+    router->rwsplit_config.backend_idle_timeout = config_get_integer(params, "backend_idle_timeout");
 
     if (!handle_max_slaves(router, config_get_string(params, "max_slave_connections")) ||
         (options && !rwsplit_process_router_options(router, options)))
@@ -293,6 +297,14 @@ static MXS_ROUTER *createInstance(SERVICE *service, char **options)
         router->rwsplit_config.max_sescmd_history = 0;
     }
 
+    if (router->rwsplit_config.lazy_connect && router->rwsplit_config.disable_sescmd_history)
+    {
+        MXS_WARNING("[%s] 'lazy_connect' can only connect slaves before the first "
+                    "session command when the session command history is disabled. "
+                    "Add 'disable_sescmd_history=false' to the service to use it "
+                    "for the whole session.", service->name);
+    }
+
     return (MXS_ROUTER *)router;
 }
 
@@ -359,11 +371,25 @@ static MXS_ROUTER_SESSION *newSession(MXS_ROUTER *router_inst, MXS_SESSION *sess
     client_rses->rses_backend_ref = backend_ref;
     client_rses->rses_nbackends = router_nservers; /*< # of backend servers */
 
+    /** In lazy mode only the master is connected here, the slaves are
+     * connected when the first read needs one */
+    int initial_nslaves = client_rses->rses_config.lazy_connect ? 0 : max_nslaves;
     backend_ref_t *master_ref = NULL; /*< pointer to selected master */
-    if (!select_connect_backend_servers(&master_ref, backend_ref, router_nservers,
-                                        max_nslaves, max_slave_rlag,
-                                        client_rses->rses_config.slave_selection_criteria,
-                                        session, router, false))
+    bool succp = select_connect_backend_servers(&master_ref, backend_ref, router_nservers,
+                                                initial_nslaves, max_slave_rlag,
+                                                client_rses->rses_config.slave_selection_criteria,
+                                                session, router, false);
+
+    if (succp && master_ref == NULL && initial_nslaves < max_nslaves)
+    {
+        /** A session without a master needs its slaves from the start */
+        succp = select_connect_backend_servers(&master_ref, backend_ref, router_nservers,
+                                               max_nslaves, max_slave_rlag,
+                                               client_rses->rses_config.slave_selection_criteria,
+                                               session, router, true);
+    }
+
+    if (!succp)
     {
         /**
          * Master and at least <min_nslaves> slaves must be found if the router is
@@ -612,6 +638,10 @@ static void diagnostics(MXS_ROUTER *instance, DCB *dcb)
                router->rwsplit_config.max_sescmd_history);
     dcb_printf(dcb, "\tmaster_accept_reads:       %s\n",
                router->rwsplit_config.master_accept_reads ? "true" : "false");
+    dcb_printf(dcb, "\tlazy_connect:              %s\n",
+               router->rwsplit_config.lazy_connect ? "true" : "false");
+    dcb_printf(dcb, "\tbackend_idle_timeout:      %d\n",
+               router->rwsplit_config.backend_idle_timeout);
     dcb_printf(dcb, "\n");
 
     if (router->stats.n_queries > 0)
@@ -634,6 +664,14 @@ static void diagnostics(MXS_ROUTER *instance, DCB *dcb)
     dcb_printf(dcb, "\tNumber of queries forwarded to all:   	%" PRIu64 " (%.2f%%)\n",
                router->stats.n_all, all_pct);
 
+    if (router->rwsplit_config.lazy_connect)
+    {
+        dcb_printf(dcb, "\tNumber of slaves connected on first use:	%" PRIu64 "\n",
+                   router->stats.n_lazy_connects);
+        dcb_printf(dcb, "\tNumber of idle slave connections closed:	%" PRIu64 "\n",
+                   router->stats.n_idle_closes);
+    }
+
     if ((weightby = serviceGetWeightingParameter(router->service)) != NULL)
     {
         dcb_printf(dcb, "\tConnection distribution based on %s "
@@ -1191,6 +1229,14 @@ static bool rwsplit_process_router_options(ROUTER_INSTANCE *router,
             {
                 router->rwsplit_config.retry_failed_reads = config_truth_value(value);
             }
+            else if (strcmp(options[i], "lazy_connect") == 0)
+            {
+                router->rwsplit_config.lazy_connect = config_truth_value(value);
+            }
+            else if (strcmp(options[i], "backend_idle_timeout") == 0)
+            {
+                router->rwsplit_config.backend_idle_timeout = atoi(value);
+            }
             else if (strcmp(options[i], "master_failure_mode") == 0)
             {
                 if (strcasecmp(value, "fail_instantly") == 0)
@@ -1569,8 +1615,10 @@ static bool handle_error_new_connection(ROUTER_INSTANCE *inst,
      * Try to get replacement slave or at least the minimum
      * number of slave connections for router session.
      */
-    if (inst->rwsplit_config.disable_sescmd_history)
+    if (inst->rwsplit_config.disable_sescmd_history ||
+        (inst->rwsplit_config.lazy_connect && bref != myrses->rses_master_ref))
     {
+        /** In lazy mode the next read connects a replacement slave */
         succp = have_enough_servers(myrses, 1, myrses->rses_nbackends, inst) ? true : false;
     }
     else
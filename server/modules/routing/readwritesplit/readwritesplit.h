@@ -252,6 +252,7 @@ typedef struct backend_ref_st
     GWBUF*          bref_pending_cmd; /**< For stmt which can't be routed due active sescmd execution */
     unsigned char   reply_cmd;  /**< The reply the backend server sent to a session command.
                                  * Used to detect slaves that fail to execute session command. */
+    time_t          last_used;  /**< When a statement was last routed to this backend */
 #if defined(SS_DEBUG)
     skygw_chk_t     bref_chk_tail;
 #endif
@@ -275,6 +276,8 @@ typedef struct rwsplit_config_st
     enum failure_mode master_failure_mode; /**< Master server failure handling mode.
                                                * @see enum failure_mode */
     bool              retry_failed_reads; /**< Retry failed reads on other servers */
+    bool              lazy_connect; /**< Connect slaves only when a read needs one */
+    int               backend_idle_timeout; /**< Close slaves idle for this many seconds */
 } rwsplit_config_t;
 
 #if defined(PREP_STMT_CACHING)
@@ -340,6 +343,8 @@ typedef struct
     uint64_t n_master;   /*< Number of stmts sent to master */
     uint64_t n_slave;    /*< Number of stmts sent to slave */
     uint64_t n_all;      /*< Number of stmts sent to all */
+    uint64_t n_lazy_connects; /*< Number of slaves connected on first use */
+    uint64_t n_idle_closes;   /*< Number of idle slave connections closed */
 } ROUTER_STATS;
 
 /**
@@ -133,6 +133,8 @@ bool select_connect_backend_servers(backend_ref_t **p_master_ref,
                                     MXS_SESSION *session,
                                     ROUTER_INSTANCE *router,
                                     bool active_session);
+bool connect_slave_on_demand(ROUTER_CLIENT_SES *rses);
+void close_idle_slaves(ROUTER_CLIENT_SES *rses);
 
 /*
  * The following are implemented in rwsplit_tmp_table_multi.c
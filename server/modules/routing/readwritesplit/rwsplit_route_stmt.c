@@ -67,6 +67,8 @@ bool route_single_stmt(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
     ss_dassert(querybuf->next == NULL); // The buffer must be contiguous.
     ss_dassert(!GWBUF_IS_TYPE_UNDEFINED(querybuf));
 
+    close_idle_slaves(rses);
+
     /* packet_type is a problem as it is MySQL specific */
     packet_type = determine_packet_type(querybuf, &non_empty_packet);
     qtype = determine_query_type(querybuf, packet_type, non_empty_packet);
@@ -527,6 +529,9 @@ bool rwsplit_get_dcb(DCB **p_dcb, ROUTER_CLIENT_SES *rses, backend_type_t btype,
     {
         backend_ref_t *candidate_bref = NULL;
 
+        /** In lazy mode the first read connects a slave */
+        connect_slave_on_demand(rses);
+
         for (i = 0; i < rses->rses_nbackends; i++)
         {
             SERVER_REF *b = backend_ref[i].ref;
@@ -1227,6 +1232,7 @@ handle_got_target(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
     }
 
     scur = &bref->bref_sescmd_cur;
+    bref->last_used = time(NULL);
 
     ss_dassert(target_dcb != NULL);
 
@@ -313,6 +313,143 @@ bool select_connect_backend_servers(backend_ref_t **p_master_ref,
     return succp;
 }
 
+/**
+ * @brief Check whether a new slave can be given the session state
+ *
+ * The state can be restored if the complete session command history is stored
+ * or if no session commands have been executed.
+ *
+ * @param rses Router session
+ * @return True if a slave connected now would have a consistent session state
+ */
+static bool rses_can_replay_history(const ROUTER_CLIENT_SES *rses)
+{
+    return !rses->rses_config.disable_sescmd_history || rses->rses_nsescmd == 0;
+}
+
+/**
+ * @brief Connect a slave when a read needs one
+ *
+ * In lazy mode the session is created with only the master connected. When a
+ * read is routed and no slave is in use, the best slave candidate is connected
+ * and the session command history is replayed on it. The read is queued until
+ * the history has been executed. If all connected slaves are busy, another
+ * slave is connected until the session has the maximum number of slaves.
+ *
+ * @param rses Router session
+ * @return True if a new slave was connected
+ */
+bool connect_slave_on_demand(ROUTER_CLIENT_SES *rses)
+{
+    if (!rses->rses_config.lazy_connect || !rses_can_replay_history(rses))
+    {
+        return false;
+    }
+
+    SERVER_REF *master = get_root_master(rses->rses_backend_ref, rses->rses_nbackends);
+    int n_slaves = 0;
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        backend_ref_t *bref = &rses->rses_backend_ref[i];
+
+        if (BREF_IS_IN_USE(bref) && bref != rses->rses_master_ref)
+        {
+            if (!BREF_IS_WAITING_RESULT(bref) && !sescmd_cursor_is_active(&bref->bref_sescmd_cur))
+            {
+                /** An idle slave can serve the read */
+                return false;
+            }
+
+            /** Counted the same way as when the slaves are connected */
+            if (bref_valid_for_connect(bref) && bref_valid_for_slave(bref, master ? master->server : NULL))
+            {
+                n_slaves++;
+            }
+        }
+    }
+
+    if (n_slaves >= rses_get_max_slavecount(rses, rses->rses_nbackends))
+    {
+        return false;
+    }
+
+    bool in_use[rses->rses_nbackends];
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        in_use[i] = BREF_IS_IN_USE(&rses->rses_backend_ref[i]);
+    }
+
+    select_connect_backend_servers(&rses->rses_master_ref, rses->rses_backend_ref,
+                                   rses->rses_nbackends, n_slaves + 1,
+                                   rses_get_max_replication_lag(rses),
+                                   rses->rses_config.slave_selection_criteria,
+                                   rses->client_dcb->session, rses->router, true);
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        if (!in_use[i] && BREF_IS_IN_USE(&rses->rses_backend_ref[i]))
+        {
+            MXS_INFO("Connected to slave '%s' on demand, %d slaves were busy.",
+                     rses->rses_backend_ref[i].ref->server->unique_name, n_slaves);
+            atomic_add_uint64(&rses->router->stats.n_lazy_connects, 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Close slave connections that have not been used recently
+ *
+ * Only slaves that are not executing anything are closed. The master is
+ * never closed. A closed slave is connected again when a read needs it, which
+ * is why nothing is closed if the session state could not be restored or if
+ * a transaction is open.
+ *
+ * @param rses Router session
+ */
+void close_idle_slaves(ROUTER_CLIENT_SES *rses)
+{
+    int timeout = rses->rses_config.backend_idle_timeout;
+
+    if (!rses->rses_config.lazy_connect || timeout <= 0 || !rses_can_replay_history(rses) ||
+        session_trx_is_active(rses->client_dcb->session))
+    {
+        return;
+    }
+
+    time_t now = time(NULL);
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        backend_ref_t *bref = &rses->rses_backend_ref[i];
+
+        if (BREF_IS_IN_USE(bref) && bref != rses->rses_master_ref &&
+            bref != rses->forced_node && !BREF_IS_WAITING_RESULT(bref) &&
+            !sescmd_cursor_is_active(&bref->bref_sescmd_cur) &&
+            bref->bref_pending_cmd == NULL &&
+            difftime(now, bref->last_used) >= timeout)
+        {
+            MXS_INFO("Closing connection to slave '%s', idle for %.0f seconds.",
+                     bref->ref->server->unique_name, difftime(now, bref->last_used));
+
+            bref_clear_state(bref, BREF_QUERY_ACTIVE);
+            bref_clear_state(bref, BREF_IN_USE);
+            bref_set_state(bref, BREF_CLOSED);
+            RW_CHK_DCB(bref, bref->bref_dcb);
+            dcb_close(bref->bref_dcb);
+            RW_CLOSE_BREF(bref);
+            /** The address of the closed DCB can be reused by a new DCB */
+            bref->bref_dcb = NULL;
+            atomic_add(&bref->ref->connections, -1);
+            atomic_add_uint64(&rses->router->stats.n_idle_closes, 1);
+        }
+    }
+}
+
 /** Compare number of connections from this router in backend servers */
 static int bref_cmp_router_conn(const void *bref1, const void *bref2)
 {
@@ -430,6 +567,7 @@ static bool connect_server(backend_ref_t *bref, MXS_SESSION *session, bool execu
     {
         bref_clear_state(bref, BREF_CLOSED);
         bref->closed_at = 0;
+        bref->last_used = time(NULL);
 
         if (!execute_history || execute_sescmd_history(bref))
         {
@@ -81,11 +81,18 @@ static route_target_t get_shard_route_target(qc_query_type_t qtype,
                                              HINT*           hint);
 
 static uint64_t getCapabilities(MXS_ROUTER* instance);
+static void destroyInstance(MXS_ROUTER* instance);
 
 static bool connect_backend_servers(backend_ref_t*   backend_ref,
                                     int              router_nservers,
                                     MXS_SESSION*     session,
                                     ROUTER_INSTANCE* router);
+static bool connect_backend(backend_ref_t* bref, MXS_SESSION* session);
+static bool connect_backend_on_demand(ROUTER_CLIENT_SES* rses, backend_ref_t* bref);
+static bool connect_first_backend(ROUTER_CLIENT_SES* rses, MXS_SESSION* session, const char* db);
+static void close_idle_backends(ROUTER_CLIENT_SES* rses);
+static bool rses_can_replay_history(ROUTER_CLIENT_SES* rses);
+static bool refresh_shard_map_from_snapshot(ROUTER_CLIENT_SES* rses);
 
 static bool get_shard_dcb(DCB**              dcb,
                           ROUTER_CLIENT_SES* rses,
@@ -152,6 +159,7 @@ int inspect_backend_mapping_states(ROUTER_CLIENT_SES *router_cli_ses,
 bool handle_default_db(ROUTER_CLIENT_SES *router_cli_ses);
 void route_queued_query(ROUTER_CLIENT_SES *router_cli_ses);
 void synchronize_shard_map(ROUTER_CLIENT_SES *client);
+void apply_ddl_to_shard_map(ROUTER_CLIENT_SES *client, backend_ref_t *bref);
 
 static int hashkeyfun(const void* key)
 {
@@ -199,6 +207,7 @@ shard_map_t* shard_map_alloc()
             spinlock_init(&rval->lock);
             rval->last_updated = 0;
             rval->state = SHMAP_UNINIT;
+            rval->version = 0;
         }
         else
         {
@@ -609,7 +618,7 @@ MXS_MODULE* MXS_CREATE_MODULE()
         clientReply,
         handleError,
         getCapabilities,
-        NULL
+        destroyInstance
     };
 
     static MXS_MODULE info =
@@ -632,6 +641,9 @@ MXS_MODULE* MXS_CREATE_MODULE()
             {"refresh_databases", MXS_MODULE_PARAM_BOOL, "true"},
             {"refresh_interval", MXS_MODULE_PARAM_COUNT, DEFAULT_REFRESH_INTERVAL},
             {"debug", MXS_MODULE_PARAM_BOOL, "false"},
+            {"shared_shard_map", MXS_MODULE_PARAM_BOOL, "false"},
+            {"lazy_connect", MXS_MODULE_PARAM_BOOL, "false"},
+            {"backend_idle_timeout", MXS_MODULE_PARAM_COUNT, "0"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -700,6 +712,9 @@ static MXS_ROUTER* createInstance(SERVICE *service, char **options)
     router->schemarouter_config.max_sescmd_hist = config_get_integer(conf, "max_sescmd_history");
     router->schemarouter_config.disable_sescmd_hist = config_get_bool(conf, "disable_sescmd_history");
     router->schemarouter_config.debug = config_get_bool(conf, "debug");
+    router->schemarouter_config.shared_shard_map = config_get_bool(conf, "shared_shard_map");
+    router->schemarouter_config.lazy_connect = config_get_bool(conf, "lazy_connect");
+    router->schemarouter_config.backend_idle_timeout = config_get_integer(conf, "backend_idle_timeout");
 
     if ((config_get_param(conf, "auth_all_servers")) == NULL)
     {
@@ -794,6 +809,18 @@ static MXS_ROUTER* createInstance(SERVICE *service, char **options)
         {
             router->schemarouter_config.debug = config_truth_value(value);
         }
+        else if (strcmp(options[i], "shared_shard_map") == 0)
+        {
+            router->schemarouter_config.shared_shard_map = config_truth_value(value);
+        }
+        else if (strcmp(options[i], "lazy_connect") == 0)
+        {
+            router->schemarouter_config.lazy_connect = config_truth_value(value);
+        }
+        else if (strcmp(options[i], "backend_idle_timeout") == 0)
+        {
+            router->schemarouter_config.backend_idle_timeout = atoi(value);
+        }
         else
         {
             MXS_ERROR("Unknown router options for %s", options[i]);
@@ -808,11 +835,26 @@ static MXS_ROUTER* createInstance(SERVICE *service, char **options)
         router->schemarouter_config.max_sescmd_hist = 0;
     }
 
+    /** Mapping the databases needs a connection to every server */
+    if (router->schemarouter_config.lazy_connect && !router->schemarouter_config.shared_shard_map)
+    {
+        MXS_WARNING("'lazy_connect' requires 'shared_shard_map', all servers of "
+                    "service '%s' are connected when a session is created.", service->name);
+        router->schemarouter_config.lazy_connect = false;
+    }
+
     if (failure)
     {
         MXS_FREE(router);
         router = NULL;
     }
+    else if (router->schemarouter_config.shared_shard_map && !shard_snapshot_start(router))
+    {
+        MXS_WARNING("The shared shard map of service '%s' is disabled, the "
+                    "sessions map the databases themselves.", service->name);
+        router->schemarouter_config.shared_shard_map = false;
+        router->schemarouter_config.lazy_connect = false;
+    }
 
     return (MXS_ROUTER *)router;
 }
@@ -836,6 +878,25 @@ enum shard_map_state shard_map_update_state(shard_map_t *self, ROUTER_INSTANCE*
     return state;
 }
 
+/**
+ * Check if the shard map was built from an older shared shard map and mark it
+ * as stale if it was.
+ * @param self Shard map to check
+ * @param snapshot Current shared shard map
+ * @return Current state of the shard map
+ */
+enum shard_map_state shard_map_check_version(shard_map_t *self, shard_snapshot_t *snapshot)
+{
+    spinlock_acquire(&self->lock);
+    if (self->version != snapshot->version)
+    {
+        self->state = SHMAP_STALE;
+    }
+    enum shard_map_state state = self->state;
+    spinlock_release(&self->lock);
+    return state;
+}
+
 /**
  * Associate a new session with this instance of the router.
  *
@@ -892,6 +953,13 @@ static MXS_ROUTER_SESSION* newSession(MXS_ROUTER* router_inst, MXS_SESSION* sess
     client_rses->rses_mysql_session = (MYSQL_session*)session->client_dcb->data;
     client_rses->rses_client_dcb = (DCB*)session->client_dcb;
 
+    shard_snapshot_t *snapshot = NULL;
+
+    if (router->schemarouter_config.shared_shard_map)
+    {
+        snapshot = shard_snapshot_acquire(router);
+    }
+
     spinlock_acquire(&router->lock);
 
     shard_map_t *map = hashtable_fetch(router->shard_maps, session->client_dcb->user);
@@ -899,29 +967,43 @@ static MXS_ROUTER_SESSION* newSession(MXS_ROUTER* router_inst, MXS_SESSION* sess
 
     if (map)
     {
-        state = shard_map_update_state(map, router);
+        state = snapshot ? shard_map_check_version(map, snapshot) :
+                shard_map_update_state(map, router);
     }
 
     spinlock_release(&router->lock);
 
     if (map == NULL || state != SHMAP_READY)
     {
-        if ((map = shard_map_alloc()) == NULL)
+        if (snapshot &&
+            (client_rses->shardmap = shard_snapshot_filter(snapshot, session->client_dcb->user)))
+        {
+            /** The databases of this user are taken from the shared shard map */
+            synchronize_shard_map(client_rses);
+            client_rses->init = INIT_READY;
+        }
+        else if ((client_rses->shardmap = shard_map_alloc()) == NULL)
         {
             MXS_ERROR("Failed to allocate enough memory to create"
                       "new shard mapping. Session will be closed.");
+            shard_snapshot_release(snapshot);
             MXS_FREE(client_rses);
             return NULL;
         }
-        client_rses->init = INIT_UNINT;
+        else
+        {
+            client_rses->init = INIT_UNINT;
+        }
     }
     else
     {
+        client_rses->shardmap = map;
         client_rses->init = INIT_READY;
         atomic_add(&router->stats.shmap_cache_hit, 1);
     }
 
-    client_rses->shardmap = map;
+    shard_snapshot_release(snapshot);
+
     memcpy(&client_rses->rses_config, &router->schemarouter_config, sizeof(schemarouter_config_t));
     client_rses->n_sescmd = 0;
     client_rses->rses_config.last_refresh = time(NULL);
@@ -1003,10 +1085,18 @@ static MXS_ROUTER_SESSION* newSession(MXS_ROUTER* router_inst, MXS_SESSION* sess
         MXS_FREE(client_rses);
         return NULL;
     }
-    /**
-     * Connect to all backend servers
-     */
-    succp = connect_backend_servers(backend_ref, router_nservers, session, router);
+    if (client_rses->rses_config.lazy_connect && !(client_rses->init & INIT_UNINT))
+    {
+        /** The other servers are connected when queries are routed to them */
+        succp = connect_first_backend(client_rses, session, db);
+    }
+    else
+    {
+        /**
+         * Connect to all backend servers
+         */
+        succp = connect_backend_servers(backend_ref, router_nservers, session, router);
+    }
 
     rses_end_locked_router_action(client_rses);
 
@@ -1164,6 +1254,7 @@ static void freeSession(MXS_ROUTER* router_instance, MXS_ROUTER_SESSION* router_
      * all the memory and other resources associated
      * to the client session.
      */
+    MXS_FREE(router_cli_ses->ddl_db);
     MXS_FREE(router_cli_ses->rses_backend_ref);
     MXS_FREE(router_cli_ses);
     return;
@@ -1206,12 +1297,13 @@ static bool get_shard_dcb(DCB**              p_dcb,
         SERVER_REF* b = backend_ref[i].bref_backend;
         /**
          * To become chosen:
-         * backend must be in use, name must match, and
-         * the backend state must be RUNNING
+         * name must match, the backend state must be RUNNING and
+         * the backend must be in use or connected on demand
          */
-        if (BREF_IS_IN_USE((&backend_ref[i])) &&
-            (strncasecmp(name, b->server->unique_name, PATH_MAX) == 0) &&
-            SERVER_IS_RUNNING(b->server))
+        if ((strncasecmp(name, b->server->unique_name, PATH_MAX) == 0) &&
+            SERVER_IS_RUNNING(b->server) &&
+            (BREF_IS_IN_USE((&backend_ref[i])) ||
+             connect_backend_on_demand(rses, &backend_ref[i])))
         {
             *p_dcb = backend_ref[i].bref_dcb;
             succp = true;
@@ -1697,6 +1789,7 @@ static int routeQuery(MXS_ROUTER* instance,
             return init_rval;
         }
 
+        close_idle_backends(router_cli_ses);
     }
 
     rses_end_locked_router_action(router_cli_ses);
@@ -1823,9 +1916,26 @@ static int routeQuery(MXS_ROUTER* instance,
         if (!change_successful)
         {
             time_t now = time(NULL);
-            if (router_cli_ses->rses_config.refresh_databases &&
+            if (router_cli_ses->rses_config.lazy_connect &&
+                router_cli_ses->rses_config.refresh_databases &&
                 difftime(now, router_cli_ses->rses_config.last_refresh) >
                 router_cli_ses->rses_config.refresh_min_interval)
+            {
+                /** Not all servers are connected, use the shared shard map instead */
+                router_cli_ses->rses_config.last_refresh = now;
+
+                if (refresh_shard_map_from_snapshot(router_cli_ses))
+                {
+                    spinlock_acquire(&router_cli_ses->shardmap->lock);
+                    change_successful = change_current_db(router_cli_ses->current_db,
+                                                          router_cli_ses->shardmap->hash,
+                                                          querybuf);
+                    spinlock_release(&router_cli_ses->shardmap->lock);
+                }
+            }
+            else if (router_cli_ses->rses_config.refresh_databases &&
+                     difftime(now, router_cli_ses->rses_config.last_refresh) >
+                     router_cli_ses->rses_config.refresh_min_interval)
             {
                 spinlock_acquire(&router_cli_ses->shardmap->lock);
                 router_cli_ses->shardmap->state = SHMAP_STALE;
@@ -1848,23 +1958,27 @@ static int routeQuery(MXS_ROUTER* instance,
                 rses_end_locked_router_action(router_cli_ses);
                 return rc_refresh;
             }
-            extract_database(querybuf, db);
-            snprintf(errbuf, 25 + MYSQL_DATABASE_MAXLEN, "Unknown database: %s", db);
-            if (router_cli_ses->rses_config.debug)
+
+            if (!change_successful)
             {
-                sprintf(errbuf + strlen(errbuf),
-                        " ([%lu]: DB change failed)",
-                        router_cli_ses->rses_client_dcb->session->ses_id);
-            }
+                extract_database(querybuf, db);
+                snprintf(errbuf, 25 + MYSQL_DATABASE_MAXLEN, "Unknown database: %s", db);
+                if (router_cli_ses->rses_config.debug)
+                {
+                    sprintf(errbuf + strlen(errbuf),
+                            " ([%lu]: DB change failed)",
+                            router_cli_ses->rses_client_dcb->session->ses_id);
+                }
 
-            write_error_to_client(router_cli_ses->rses_client_dcb,
-                                  SCHEMA_ERR_DBNOTFOUND,
-                                  SCHEMA_ERRSTR_DBNOTFOUND,
-                                  errbuf);
+                write_error_to_client(router_cli_ses->rses_client_dcb,
+                                      SCHEMA_ERR_DBNOTFOUND,
+                                      SCHEMA_ERRSTR_DBNOTFOUND,
+                                      errbuf);
 
-            MXS_ERROR("Changing database failed.");
-            ret = 1;
-            goto retblock;
+                MXS_ERROR("Changing database failed.");
+                ret = 1;
+                goto retblock;
+            }
         }
     }
 
@@ -2013,7 +2127,20 @@ static int routeQuery(MXS_ROUTER* instance,
 
     if (TARGET_IS_ANY(route_target))
     {
-        for (int i = 0; i < router_cli_ses->rses_nbackends; i++)
+        /** With lazy connections, prefer a server that is already connected */
+        for (int i = 0; router_cli_ses->rses_config.lazy_connect &&
+             i < router_cli_ses->rses_nbackends; i++)
+        {
+            backend_ref_t *bref = &router_cli_ses->rses_backend_ref[i];
+            if (BREF_IS_IN_USE(bref) && SERVER_IS_RUNNING(bref->bref_backend->server))
+            {
+                route_target = TARGET_NAMED_SERVER;
+                targetserver = MXS_STRDUP_A(bref->bref_backend->server->unique_name);
+                break;
+            }
+        }
+
+        for (int i = 0; TARGET_IS_ANY(route_target) && i < router_cli_ses->rses_nbackends; i++)
         {
             SERVER *server = router_cli_ses->rses_backend_ref[i].bref_backend->server;
             if (SERVER_IS_RUNNING(server))
@@ -2095,6 +2222,17 @@ static int routeQuery(MXS_ROUTER* instance,
             bref = get_bref_from_dcb(router_cli_ses, target_dcb);
             bref_set_state(bref, BREF_QUERY_ACTIVE);
             bref_set_state(bref, BREF_WAITING_RESULT);
+            bref->last_used = time(NULL);
+
+            if (inst->schemarouter_config.shared_shard_map &&
+                (packet_type == MYSQL_COM_CREATE_DB || packet_type == MYSQL_COM_DROP_DB ||
+                 (op & (QUERY_OP_CREATE | QUERY_OP_DROP))))
+            {
+                /** The shard map is updated once the server has executed it */
+                MXS_FREE(router_cli_ses->ddl_db);
+                router_cli_ses->ddl_db = extract_ddl_database(querybuf, &router_cli_ses->ddl_drop);
+                router_cli_ses->ddl_bref = bref;
+            }
         }
         else
         {
@@ -2223,6 +2361,31 @@ static void diagnostic(MXS_ROUTER *instance, DCB *dcb)
     }
     dcb_printf(dcb, "Shard map cache hits: %d\n", router->stats.shmap_cache_hit);
     dcb_printf(dcb, "Shard map cache misses: %d\n", router->stats.shmap_cache_miss);
+
+    if (router->schemarouter_config.shared_shard_map)
+    {
+        shard_snapshot_t *snapshot = shard_snapshot_acquire(router);
+
+        dcb_printf(dcb, "Shared shard map loads: %d\n", router->stats.shmap_loads);
+        dcb_printf(dcb, "Shared shard map updates: %d\n", router->stats.shmap_updates);
+
+        if (snapshot)
+        {
+            dcb_printf(dcb, "Shared shard map version: %d\n", snapshot->version);
+            dcb_printf(dcb, "Databases in shared shard map: %d\n",
+                       hashtable_size(snapshot->databases));
+            dcb_printf(dcb, "Shared shard map is filtered by grants: %s\n",
+                       snapshot->grants ? "yes" : "no");
+        }
+
+        shard_snapshot_release(snapshot);
+    }
+
+    if (router->schemarouter_config.lazy_connect)
+    {
+        dcb_printf(dcb, "Backends connected on demand: %d\n", router->stats.n_lazy_connects);
+        dcb_printf(dcb, "Idle backend connections closed: %d\n", router->stats.n_idle_closes);
+    }
     dcb_printf(dcb, "\n");
 }
 
@@ -2459,6 +2622,17 @@ static void clientReply(MXS_ROUTER* instance,
     {
         unsigned char* cmd = (unsigned char*) writebuf->start;
         int state = router_cli_ses->init;
+
+        if (router_cli_ses->ddl_db && router_cli_ses->ddl_bref == bref)
+        {
+            if (PTR_IS_OK(cmd))
+            {
+                apply_ddl_to_shard_map(router_cli_ses, bref);
+            }
+            MXS_FREE(router_cli_ses->ddl_db);
+            router_cli_ses->ddl_db = NULL;
+        }
+
         /** Write reply to client DCB */
         MXS_INFO("returning reply [%s] "
                  "state [%s]  session [%p]",
@@ -2741,41 +2915,9 @@ static bool connect_backend_servers(backend_ref_t*   backend_ref,
             /** New server connection */
             else
             {
-                backend_ref[i].bref_dcb = dcb_connect(b->server,
-                                                      session,
-                                                      b->server->protocol);
-
-                if (backend_ref[i].bref_dcb != NULL)
+                if (connect_backend(&backend_ref[i], session))
                 {
                     servers_connected += 1;
-                    /**
-                     * Start executing session command
-                     * history.
-                     */
-                    execute_sescmd_history(&backend_ref[i]);
-                    /**
-                     * When server fails, this callback
-                     * is called.
-                     * !!! Todo, routine which removes
-                     * corresponding entries from the hash
-                     * table.
-                     */
-
-                    backend_ref[i].bref_state = 0;
-                    bref_set_state(&backend_ref[i], BREF_IN_USE);
-                    /**
-                     * Increase backend connection counter.
-                     * Server's stats are _increased_ in
-                     * dcb.c:dcb_alloc !
-                     * But decreased in the calling function
-                     * of dcb_close.
-                     */
-                    atomic_add(&b->connections, 1);
-
-                    dcb_add_callback(backend_ref[i].bref_dcb,
-                                     DCB_REASON_NOT_RESPONDING,
-                                     &router_handle_state_switch,
-                                     (void *)&backend_ref[i]);
                 }
                 else
                 {
@@ -2833,6 +2975,231 @@ static bool connect_backend_servers(backend_ref_t*   backend_ref,
     return succp;
 }
 
+/**
+ * Connect a backend of a session and start executing the session command
+ * history on it. Router session must be locked.
+ *
+ * @param bref    Backend reference to connect
+ * @param session MaxScale session
+ *
+ * @return True if the connection was created
+ */
+static bool connect_backend(backend_ref_t* bref, MXS_SESSION* session)
+{
+    SERVER_REF* b = bref->bref_backend;
+
+    bref->bref_dcb = dcb_connect(b->server, session, b->server->protocol);
+
+    if (bref->bref_dcb == NULL)
+    {
+        return false;
+    }
+
+    /**
+     * The state is reset before the history is executed as a closed
+     * backend would not accept the session commands.
+     */
+    bref->bref_state = 0;
+    bref_set_state(bref, BREF_IN_USE);
+    bref->last_used = time(NULL);
+
+    /**
+     * Start executing session command
+     * history.
+     */
+    execute_sescmd_history(bref);
+
+    /**
+     * Increase backend connection counter.
+     * Server's stats are _increased_ in
+     * dcb.c:dcb_alloc !
+     * But decreased in the calling function
+     * of dcb_close.
+     */
+    atomic_add(&b->connections, 1);
+
+    /**
+     * When server fails, this callback
+     * is called.
+     */
+    dcb_add_callback(bref->bref_dcb,
+                     DCB_REASON_NOT_RESPONDING,
+                     &router_handle_state_switch,
+                     (void *)bref);
+    return true;
+}
+
+/**
+ * Check if a backend that isn't connected can be taken into use later. This
+ * requires that the whole session command history is still stored.
+ *
+ * @param rses Router client session
+ *
+ * @return True if the session command history can be executed on a new connection
+ */
+static bool rses_can_replay_history(ROUTER_CLIENT_SES* rses)
+{
+    return !rses->rses_config.disable_sescmd_hist || rses->n_sescmd == 0;
+}
+
+/**
+ * Connect a backend when the first query is routed to it. Router session
+ * must be locked.
+ *
+ * @param rses Router client session
+ * @param bref Backend reference that isn't in use
+ *
+ * @return True if the backend was connected
+ */
+static bool connect_backend_on_demand(ROUTER_CLIENT_SES* rses, backend_ref_t* bref)
+{
+    bool rval = false;
+
+    if (rses->rses_config.lazy_connect && rses_can_replay_history(rses))
+    {
+        SERVER* server = bref->bref_backend->server;
+
+        if (connect_backend(bref, rses->rses_client_dcb->session))
+        {
+            MXS_INFO("Connected to [%s]:%d on demand", server->name, server->port);
+            atomic_add(&rses->router->stats.n_lazy_connects, 1);
+            rval = true;
+        }
+        else
+        {
+            MXS_ERROR("Unable to establish connection with [%s]:%d",
+                      server->name, server->port);
+        }
+    }
+
+    return rval;
+}
+
+/**
+ * Connect only the backend that a new session uses first. This is the server
+ * of the default database or the first running server if the client didn't
+ * connect with a default database. Router session must be locked.
+ *
+ * @param rses    Router client session
+ * @param session MaxScale session
+ * @param db      Default database of the client, empty if none
+ *
+ * @return True if a backend was connected
+ */
+static bool connect_first_backend(ROUTER_CLIENT_SES* rses, MXS_SESSION* session, const char* db)
+{
+    backend_ref_t* target = NULL;
+
+    if (*db)
+    {
+        spinlock_acquire(&rses->shardmap->lock);
+        char* name = hashtable_fetch(rses->shardmap->hash, (void*)db);
+
+        for (int i = 0; name && i < rses->rses_nbackends; i++)
+        {
+            SERVER* server = rses->rses_backend_ref[i].bref_backend->server;
+
+            if (strcmp(name, server->unique_name) == 0 && SERVER_IS_RUNNING(server))
+            {
+                target = &rses->rses_backend_ref[i];
+                break;
+            }
+        }
+        spinlock_release(&rses->shardmap->lock);
+    }
+
+    for (int i = 0; target == NULL && i < rses->rses_nbackends; i++)
+    {
+        if (SERVER_IS_RUNNING(rses->rses_backend_ref[i].bref_backend->server))
+        {
+            target = &rses->rses_backend_ref[i];
+        }
+    }
+
+    if (target == NULL)
+    {
+        MXS_ERROR("Unable to find a running server for the session.");
+        return false;
+    }
+
+    if (!connect_backend(target, session))
+    {
+        MXS_ERROR("Unable to establish connection with [%s]:%d",
+                  target->bref_backend->server->name,
+                  target->bref_backend->server->port);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Close the connections that haven't been used for backend_idle_timeout
+ * seconds. The server of the current database is never closed and at least
+ * one connection is always kept open. Nothing is closed while a transaction
+ * is open as that would roll back its changes on the closed server. Router
+ * session must be locked.
+ *
+ * @param rses Router client session
+ */
+static void close_idle_backends(ROUTER_CLIENT_SES* rses)
+{
+    if (!rses->rses_config.lazy_connect ||
+        rses->rses_config.backend_idle_timeout <= 0 ||
+        !rses_can_replay_history(rses) ||
+        session_trx_is_active(rses->rses_client_dcb->session))
+    {
+        return;
+    }
+
+    time_t now = time(NULL);
+    char* current = NULL;
+    int n_in_use = 0;
+
+    if (rses->current_db[0])
+    {
+        spinlock_acquire(&rses->shardmap->lock);
+        char* name = hashtable_fetch(rses->shardmap->hash, rses->current_db);
+        current = name ? MXS_STRDUP_A(name) : NULL;
+        spinlock_release(&rses->shardmap->lock);
+    }
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        if (BREF_IS_IN_USE(&rses->rses_backend_ref[i]))
+        {
+            n_in_use++;
+        }
+    }
+
+    for (int i = 0; i < rses->rses_nbackends && n_in_use > 1; i++)
+    {
+        backend_ref_t* bref = &rses->rses_backend_ref[i];
+        SERVER* server = bref->bref_backend->server;
+
+        if (BREF_IS_IN_USE(bref) &&
+            !BREF_IS_WAITING_RESULT(bref) &&
+            !BREF_IS_QUERY_ACTIVE(bref) &&
+            !sescmd_cursor_is_active(&bref->bref_sescmd_cur) &&
+            bref->bref_pending_cmd == NULL &&
+            (current == NULL || strcmp(current, server->unique_name) != 0) &&
+            difftime(now, bref->last_used) > rses->rses_config.backend_idle_timeout)
+        {
+            MXS_INFO("Closing idle connection to [%s]:%d", server->name, server->port);
+            bref_clear_state(bref, BREF_IN_USE);
+            bref_set_state(bref, BREF_CLOSED);
+            dcb_close(bref->bref_dcb);
+            /** The address of the closed DCB can be reused by a new DCB */
+            bref->bref_dcb = NULL;
+            atomic_add(&bref->bref_backend->connections, -1);
+            atomic_add(&rses->router->stats.n_idle_closes, 1);
+            n_in_use--;
+        }
+    }
+
+    MXS_FREE(current);
+}
+
 /**
  * Create a generic router session property strcture.
  */
@@ -3323,7 +3690,22 @@ static rses_property_t* mysql_sescmd_get_property(mysql_sescmd_t* scmd)
  */
 static uint64_t getCapabilities(MXS_ROUTER* instance)
 {
-    return RCAP_TYPE_CONTIGUOUS_INPUT;
+    return RCAP_TYPE_CONTIGUOUS_INPUT | RCAP_TYPE_TRANSACTION_TRACKING;
+}
+
+/**
+ * @brief Stop the thread that loads the shared shard map
+ *
+ * @param instance The router instance
+ */
+static void destroyInstance(MXS_ROUTER* instance)
+{
+    ROUTER_INSTANCE* router = (ROUTER_INSTANCE*)instance;
+
+    if (router->loader)
+    {
+        shard_snapshot_stop(router);
+    }
 }
 
 /**
@@ -3428,6 +3810,17 @@ static bool route_session_write(ROUTER_CLIENT_SES* router_cli_ses,
         goto return_succp;
     }
 
+    if (router_cli_ses->rses_config.lazy_connect &&
+        router_cli_ses->rses_config.disable_sescmd_hist &&
+        router_cli_ses->n_sescmd == 0)
+    {
+        /** The history isn't stored so the other servers can't be connected later */
+        connect_backend_servers(backend_ref,
+                                router_cli_ses->rses_nbackends,
+                                router_cli_ses->rses_client_dcb->session,
+                                inst);
+    }
+
     if (router_cli_ses->rses_config.disable_sescmd_hist)
     {
         rses_property_t *prop, *tmp;
@@ -3529,7 +3922,7 @@ static bool route_session_write(ROUTER_CLIENT_SES* router_cli_ses,
                 }
             }
         }
-        else
+        else if (!router_cli_ses->rses_config.lazy_connect)
         {
             succp = false;
         }
@@ -3761,14 +4154,22 @@ static bool handle_error_new_connection(ROUTER_INSTANCE*   inst,
                         &router_handle_state_switch,
                         (void *)bref);
 
-    /**
-     * Try to get replacement slave or at least the minimum
-     * number of slave connections for router session.
-     */
-    succp = connect_backend_servers(rses->rses_backend_ref,
-                                    rses->rses_nbackends,
-                                    ses,
-                                    inst);
+    if (rses->rses_config.lazy_connect && rses_can_replay_history(rses))
+    {
+        /** The server is connected again when a query is routed to it */
+        succp = have_servers(rses) || connect_first_backend(rses, ses, "");
+    }
+    else
+    {
+        /**
+         * Try to get replacement slave or at least the minimum
+         * number of slave connections for router session.
+         */
+        succp = connect_backend_servers(rses->rses_backend_ref,
+                                        rses->rses_nbackends,
+                                        ses,
+                                        inst);
+    }
 
     if (!have_servers(rses))
     {
@@ -4214,6 +4615,7 @@ void replace_shard_map(shard_map_t **target, shard_map_t **source)
     shard_map_t *src = *source;
     tgt->last_updated = src->last_updated;
     tgt->state = src->state;
+    tgt->version = src->version;
     hashtable_free(tgt->hash);
     tgt->hash = src->hash;
     MXS_FREE(src);
@@ -4273,3 +4675,54 @@ void synchronize_shard_map(ROUTER_CLIENT_SES *client)
     }
     spinlock_release(&client->router->lock);
 }
+
+/**
+ * Add or remove the database of a successful CREATE DATABASE or DROP DATABASE
+ * to the shard map of the client and to the shared shard map.
+ * @param client Router session
+ * @param bref Backend which executed the statement
+ */
+void apply_ddl_to_shard_map(ROUTER_CLIENT_SES *client, backend_ref_t *bref)
+{
+    char *server = bref->bref_backend->server->unique_name;
+
+    spinlock_acquire(&client->shardmap->lock);
+    if (client->ddl_drop)
+    {
+        hashtable_delete(client->shardmap->hash, client->ddl_db);
+    }
+    else
+    {
+        hashtable_add(client->shardmap->hash, client->ddl_db, server);
+    }
+    spinlock_release(&client->shardmap->lock);
+
+    shard_snapshot_update(client->router, client->ddl_db, client->ddl_drop ? NULL : server);
+}
+
+/**
+ * Rebuild the shard map of the session from the shared shard map. If the
+ * shared shard map hasn't changed since the session map was built, the loader
+ * thread is asked to load it again.
+ * @param rses Router session
+ * @return True if the shard map of the session was rebuilt
+ */
+static bool refresh_shard_map_from_snapshot(ROUTER_CLIENT_SES *rses)
+{
+    shard_snapshot_t *snapshot = shard_snapshot_acquire(rses->router);
+    shard_map_t *map = NULL;
+
+    if (snapshot == NULL || shard_map_check_version(rses->shardmap, snapshot) != SHMAP_STALE)
+    {
+        shard_snapshot_reload(rses->router);
+    }
+    else if ((map = shard_snapshot_filter(snapshot, rses->rses_client_dcb->user)))
+    {
+        rses->shardmap = map;
+        synchronize_shard_map(rses);
+    }
+
+    shard_snapshot_release(snapshot);
+
+    return map != NULL;
+}
@@ -32,6 +32,7 @@
 #include <maxscale/hashtable.h>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/pcre2.h>
+#include <maxscale/thread.h>
 
 MXS_BEGIN_DECLS
 
@@ -73,8 +74,67 @@ typedef struct shard_map
     SPINLOCK lock;
     time_t last_updated;
     enum shard_map_state state; /*< State of the shard map */
+    int version; /*< Version of the shared shard map this map was built from */
 } shard_map_t;
 
+/**
+ * A grant of a user on one server. Only the name of the user is used, the
+ * host part of the account is ignored.
+ */
+typedef struct shard_grant
+{
+    char *server; /*< Unique name of the server where the grant is */
+    char *db; /*< Database name pattern or NULL for a global grant */
+    struct shard_grant *next;
+} shard_grant_t;
+
+/**
+ * The grants of all users, shared by consecutive shard map snapshots
+ */
+typedef struct shard_grants
+{
+    HASHTABLE *users; /*< Lists of shard_grant_t hashed by user name */
+    int refcount;
+} shard_grants_t;
+
+/**
+ * A service-wide map of all databases. A snapshot is never modified after it
+ * has been published, a new snapshot replaces it instead. Sessions filter it
+ * with the grants of the user to build their own shard map.
+ */
+typedef struct shard_snapshot
+{
+    HASHTABLE *databases; /*< Database names and the servers which have them */
+    HASHTABLE *duplicates; /*< Databases found on more than one server and the
+                            * comma separated names of the other servers */
+    shard_grants_t *grants; /*< Grants of the users or NULL if all databases are visible */
+    int version; /*< Incremented every time a new snapshot is published */
+    int refcount;
+    time_t created;
+} shard_snapshot_t;
+
+/**
+ * A database that was created or dropped while the shared shard map was loaded
+ */
+typedef struct shard_change
+{
+    char *db;
+    char *server; /*< Server of a created database, NULL if it was dropped */
+    struct shard_change *next;
+} shard_change_t;
+
+/**
+ * The thread that loads the shared shard map
+ */
+typedef struct shard_loader
+{
+    THREAD thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond; /*< Signaled to reload the map or to stop the thread */
+    bool reload; /*< Load the map without waiting for the refresh interval */
+    bool shutdown; /*< Stop the thread */
+} shard_loader_t;
+
 /**
  * The state of the backend server reference
  */
@@ -271,6 +331,7 @@ typedef struct backend_ref_st
     int             bref_num_result_wait; /*< Number of not yet received results */
     sescmd_cursor_t bref_sescmd_cur; /*< Session command cursor */
     GWBUF*          bref_pending_cmd; /*< For stmt which can't be routed due active sescmd execution */
+    time_t          last_used; /*< Last time a query was routed to the backend */
 #if defined(SS_DEBUG)
     skygw_chk_t     bref_chk_tail;
 #endif
@@ -290,6 +351,9 @@ typedef struct schemarouter_config_st
     double refresh_min_interval; /*< Minimum required interval between refreshes of databases */
     bool refresh_databases; /*< Are databases refreshed when they are not found in the hashtable */
     bool debug; /*< Enable verbose debug messages to clients */
+    bool shared_shard_map; /*< Build the shard maps from a service-wide map */
+    bool lazy_connect; /*< Connect to the servers only when they are needed */
+    int backend_idle_timeout; /*< Close unused connections after this many seconds */
 } schemarouter_config_t;
 
 /**
@@ -308,6 +372,10 @@ typedef struct
     double          ses_average; /*< Average session length */
     int             shmap_cache_hit; /*< Shard map was found from the cache */
     int             shmap_cache_miss;/*< No shard map found from the cache */
+    int             shmap_loads;     /*< Shared shard map loads from the servers */
+    int             shmap_updates;   /*< Shared shard map updates by CREATE/DROP DATABASE */
+    int             n_lazy_connects; /*< Backend connections created on demand */
+    int             n_idle_closes;   /*< Idle backend connections closed */
 } ROUTER_STATS;
 
 /**
@@ -344,6 +412,9 @@ struct router_client_session
     ROUTER_STATS    stats;     /*< Statistics for this router         */
     int             n_sescmd;
     int             pos_generator;
+    char*           ddl_db; /*< Database being created or dropped */
+    bool            ddl_drop; /*< True if ddl_db is being dropped */
+    backend_ref_t*  ddl_bref; /*< Backend executing the CREATE/DROP DATABASE */
 #if defined(SS_DEBUG)
     skygw_chk_t      rses_chk_tail;
 #endif
@@ -373,12 +444,25 @@ typedef struct router_instance
                                            * not cause the session to be terminated
                                            * if they are found on more than one server. */
     pcre2_match_data*             ignore_match_data;
+    shard_snapshot_t*       snapshot;    /*< Shared shard map, protected by lock */
+    bool                    snapshot_loading; /*< The shared shard map is being loaded */
+    shard_change_t*         snapshot_changes; /*< Changes published during the load */
+    shard_loader_t*         loader;      /*< Thread that loads the shared shard map */
 
 } ROUTER_INSTANCE;
 
 #define BACKEND_TYPE(b) (SERVER_IS_MASTER((b)->backend_server) ? BE_MASTER :    \
         (SERVER_IS_SLAVE((b)->backend_server) ? BE_SLAVE :  BE_UNDEFINED));
 
+shard_map_t* shard_map_alloc();
+bool shard_snapshot_start(ROUTER_INSTANCE *router);
+void shard_snapshot_stop(ROUTER_INSTANCE *router);
+void shard_snapshot_reload(ROUTER_INSTANCE *router);
+shard_snapshot_t* shard_snapshot_acquire(ROUTER_INSTANCE *router);
+void shard_snapshot_release(shard_snapshot_t *snapshot);
+shard_map_t* shard_snapshot_filter(shard_snapshot_t *snapshot, const char *user);
+void shard_snapshot_update(ROUTER_INSTANCE *router, const char *db, const char *server);
+
 MXS_END_DECLS
 
 #endif /*< _SCHEMAROUTER_H */
@@ -0,0 +1,894 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file shard_snapshot.c - The service-wide shard map of the schemarouter
+ *
+ * The databases of all servers are loaded by a thread of the router with the
+ * credentials of the service. The result is published as an immutable
+ * snapshot which the sessions filter with the grants of their user. This
+ * removes the need to send SHOW DATABASES to all servers for each new user.
+ *
+ * CREATE and DROP DATABASE statements publish a modified copy of the current
+ * snapshot. The changes published while a load is in progress are applied to
+ * the loaded snapshot before it replaces the current one, as the servers may
+ * have been queried before the change.
+ */
+
+#include "schemarouter.h"
+
+#include <string.h>
+#include <time.h>
+#include <mysql.h>
+#include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/mysql_utils.h>
+#include <maxscale/paths.h>
+#include <maxscale/secrets.h>
+#include <maxscale/service.h>
+
+/** Connect, read and write timeout used when loading the shard map */
+#define SHARD_SNAPSHOT_TIMEOUT 10
+
+/** Interval between load attempts until the first load succeeds */
+#define SHARD_SNAPSHOT_RETRY 5
+
+/** How often the loader thread checks if the refresh interval has passed */
+#define SHARD_SNAPSHOT_POLL 1
+
+/** Hashtable size used for the databases and the users */
+#define SHARD_SNAPSHOT_HASHSIZE 101
+
+/** Users with these global privileges see all databases of a server */
+#define SHARD_GLOBAL_GRANTS_QUERY "SELECT user FROM mysql.user " \
+    "WHERE Select_priv = 'Y' OR Show_db_priv = 'Y'"
+
+/** Users see the databases they have database or table level grants on */
+#define SHARD_DB_GRANTS_QUERY "SELECT user, db FROM mysql.db " \
+    "UNION SELECT user, db FROM mysql.tables_priv"
+
+static void shard_grant_free(void *data)
+{
+    shard_grant_t *grant = (shard_grant_t*)data;
+
+    while (grant)
+    {
+        shard_grant_t *next = grant->next;
+        MXS_FREE(grant->server);
+        MXS_FREE(grant->db);
+        MXS_FREE(grant);
+        grant = next;
+    }
+}
+
+static shard_grants_t* shard_grants_alloc()
+{
+    shard_grants_t *rval = MXS_MALLOC(sizeof(shard_grants_t));
+
+    if (rval)
+    {
+        if ((rval->users = hashtable_alloc(SHARD_SNAPSHOT_HASHSIZE, hashtable_item_strhash,
+                                           hashtable_item_strcmp)))
+        {
+            hashtable_memory_fns(rval->users, hashtable_item_strdup, NULL,
+                                 hashtable_item_free, shard_grant_free);
+            rval->refcount = 1;
+        }
+        else
+        {
+            MXS_FREE(rval);
+            rval = NULL;
+        }
+    }
+
+    return rval;
+}
+
+static void shard_grants_release(shard_grants_t *grants)
+{
+    if (grants && atomic_add(&grants->refcount, -1) == 1)
+    {
+        hashtable_free(grants->users);
+        MXS_FREE(grants);
+    }
+}
+
+/**
+ * Add a grant to the list of grants of a user
+ * @param grants Grants of all users
+ * @param user Name of the user
+ * @param server Server where the grant was found
+ * @param db Database name pattern or NULL for a global grant
+ * @return True if the grant was added
+ */
+static bool shard_grants_add(shard_grants_t *grants, const char *user,
+                             const char *server, const char *db)
+{
+    shard_grant_t *grant = MXS_MALLOC(sizeof(shard_grant_t));
+
+    if (grant == NULL)
+    {
+        return false;
+    }
+
+    grant->server = MXS_STRDUP_A(server);
+    grant->db = db ? MXS_STRDUP_A(db) : NULL;
+    grant->next = NULL;
+
+    shard_grant_t *head = hashtable_fetch(grants->users, (void*)user);
+
+    if (head)
+    {
+        /** The list head is owned by the hashtable, insert after it */
+        grant->next = head->next;
+        head->next = grant;
+    }
+    else if (!hashtable_add(grants->users, (void*)user, grant))
+    {
+        shard_grant_free(grant);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Match a database name against a grant pattern. The pattern uses the
+ * wildcards of the LIKE operator, the same as the Db column of mysql.db.
+ * @param pattern Database name pattern
+ * @param db Database name
+ * @return True if the pattern matches the database name
+ */
+static bool shard_grant_matches(const char *pattern, const char *db)
+{
+    while (*pattern)
+    {
+        if (*pattern == '%')
+        {
+            pattern++;
+
+            do
+            {
+                if (shard_grant_matches(pattern, db))
+                {
+                    return true;
+                }
+            }
+            while (*db++);
+
+            return false;
+        }
+        else if (*pattern == '\\' && pattern[1])
+        {
+            pattern++;
+
+            if (*pattern != *db)
+            {
+                return false;
+            }
+        }
+        else if (*pattern == '_')
+        {
+            if (*db == '\0')
+            {
+                return false;
+            }
+        }
+        else if (*pattern != *db)
+        {
+            return false;
+        }
+
+        pattern++;
+        db++;
+    }
+
+    return *db == '\0';
+}
+
+/**
+ * Check if a user can see a database
+ * @param grant List of grants of the user
+ * @param server Server where the database is
+ * @param db Database name
+ * @return True if one of the grants is global or matches the database
+ */
+static bool shard_grant_allows(shard_grant_t *grant, const char *server, const char *db)
+{
+    for (; grant; grant = grant->next)
+    {
+        if (strcmp(grant->server, server) == 0 &&
+            (grant->db == NULL || shard_grant_matches(grant->db, db)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static shard_snapshot_t* shard_snapshot_alloc()
+{
+    shard_snapshot_t *rval = MXS_CALLOC(1, sizeof(shard_snapshot_t));
+
+    if (rval)
+    {
+        if ((rval->databases = hashtable_alloc(SHARD_SNAPSHOT_HASHSIZE, hashtable_item_strhash,
+                                               hashtable_item_strcmp)) &&
+            (rval->duplicates = hashtable_alloc(SHARD_SNAPSHOT_HASHSIZE, hashtable_item_strhash,
+                                                hashtable_item_strcmp)))
+        {
+            hashtable_memory_fns(rval->databases, hashtable_item_strdup, hashtable_item_strdup,
+                                 hashtable_item_free, hashtable_item_free);
+            hashtable_memory_fns(rval->duplicates, hashtable_item_strdup, hashtable_item_strdup,
+                                 hashtable_item_free, hashtable_item_free);
+            rval->refcount = 1;
+            rval->created = time(NULL);
+        }
+        else
+        {
+            hashtable_free(rval->databases);
+            MXS_FREE(rval);
+            rval = NULL;
+        }
+    }
+
+    return rval;
+}
+
+/**
+ * Get a reference to the current shared shard map
+ * @param router Router instance
+ * @return The current snapshot or NULL if no snapshot has been loaded yet. The
+ * reference must be released with shard_snapshot_release.
+ */
+shard_snapshot_t* shard_snapshot_acquire(ROUTER_INSTANCE *router)
+{
+    spinlock_acquire(&router->lock);
+    shard_snapshot_t *rval = router->snapshot;
+
+    if (rval)
+    {
+        atomic_add(&rval->refcount, 1);
+    }
+
+    spinlock_release(&router->lock);
+    return rval;
+}
+
+/**
+ * Release a reference to a snapshot, freeing it if it was the last one
+ * @param snapshot Snapshot to release, can be NULL
+ */
+void shard_snapshot_release(shard_snapshot_t *snapshot)
+{
+    if (snapshot && atomic_add(&snapshot->refcount, -1) == 1)
+    {
+        hashtable_free(snapshot->databases);
+        hashtable_free(snapshot->duplicates);
+        shard_grants_release(snapshot->grants);
+        MXS_FREE(snapshot);
+    }
+}
+
+static void shard_changes_free(shard_change_t *change)
+{
+    while (change)
+    {
+        shard_change_t *next = change->next;
+        MXS_FREE(change->db);
+        MXS_FREE(change->server);
+        MXS_FREE(change);
+        change = next;
+    }
+}
+
+/**
+ * Apply a database change to a snapshot that hasn't been published yet
+ * @param snapshot Snapshot to modify
+ * @param db Database that was created or dropped
+ * @param server Server where the database was created or NULL if it was dropped
+ */
+static void shard_snapshot_apply(shard_snapshot_t *snapshot, const char *db, const char *server)
+{
+    hashtable_delete(snapshot->databases, (void*)db);
+
+    if (server)
+    {
+        hashtable_add(snapshot->databases, (void*)db, (void*)server);
+    }
+}
+
+/**
+ * Publish a new snapshot if the current one is still the expected one
+ * @param router Router instance
+ * @param snapshot New snapshot
+ * @param expected The snapshot that @c snapshot was derived from
+ * @param change The change made to @c expected. If a load is in progress, the
+ * change is stored for it and the pointer is set to NULL.
+ * @return True if the snapshot was published. The reference to @c snapshot is
+ * taken over by the router and the reference of the router to the old snapshot
+ * is released.
+ */
+static bool shard_snapshot_publish(ROUTER_INSTANCE *router, shard_snapshot_t *snapshot,
+                                   shard_snapshot_t *expected, shard_change_t **change)
+{
+    spinlock_acquire(&router->lock);
+    shard_snapshot_t *old = router->snapshot;
+    bool rval = old == expected;
+
+    if (rval)
+    {
+        snapshot->version = old ? old->version + 1 : 1;
+        router->snapshot = snapshot;
+
+        if (router->snapshot_loading)
+        {
+            shard_change_t **tail = &router->snapshot_changes;
+
+            while (*tail)
+            {
+                tail = &(*tail)->next;
+            }
+
+            *tail = *change;
+            *change = NULL;
+        }
+    }
+
+    spinlock_release(&router->lock);
+
+    if (rval)
+    {
+        shard_snapshot_release(old);
+    }
+
+    return rval;
+}
+
+/**
+ * Check if a user can see a database on another server than the one in the
+ * snapshot
+ * @param snapshot Snapshot
+ * @param grant List of grants of the user
+ * @param db Database name
+ * @return True if the user sees the database on more than one server
+ */
+static bool shard_snapshot_is_duplicate(shard_snapshot_t *snapshot, shard_grant_t *grant,
+                                        const char *db)
+{
+    char *servers = hashtable_fetch(snapshot->duplicates, (void*)db);
+    bool rval = false;
+
+    if (servers)
+    {
+        char list[strlen(servers) + 1];
+        char *saveptr;
+        strcpy(list, servers);
+
+        for (char *tok = strtok_r(list, ",", &saveptr); tok && !rval;
+             tok = strtok_r(NULL, ",", &saveptr))
+        {
+            rval = snapshot->grants == NULL || shard_grant_allows(grant, tok, db);
+        }
+    }
+
+    return rval;
+}
+
+/**
+ * Build the shard map of a user from a snapshot
+ * @param snapshot Snapshot to filter
+ * @param user Name of the user
+ * @return A ready shard map with the databases visible to the user or NULL if
+ * memory allocation failed or the user sees the same database on more than one
+ * server. In the latter case the session maps the databases itself and fails
+ * the same way as without the shared shard map.
+ */
+shard_map_t* shard_snapshot_filter(shard_snapshot_t *snapshot, const char *user)
+{
+    shard_map_t *map = shard_map_alloc();
+
+    if (map)
+    {
+        HASHITERATOR *iter = hashtable_iterator(snapshot->databases);
+
+        if (iter == NULL)
+        {
+            hashtable_free(map->hash);
+            MXS_FREE(map);
+            return NULL;
+        }
+
+        shard_grant_t *grant = snapshot->grants ?
+                               hashtable_fetch(snapshot->grants->users, (void*)user) : NULL;
+        char *db;
+        bool duplicate = false;
+
+        while (!duplicate && (db = hashtable_next(iter)))
+        {
+            char *server = hashtable_fetch(snapshot->databases, db);
+
+            if (snapshot->grants == NULL || strcmp(db, "information_schema") == 0 ||
+                shard_grant_allows(grant, server, db))
+            {
+                hashtable_add(map->hash, db, server);
+                duplicate = shard_snapshot_is_duplicate(snapshot, grant, db);
+            }
+        }
+
+        hashtable_iterator_free(iter);
+
+        if (duplicate)
+        {
+            MXS_INFO("User '%s' sees database '%s' on more than one server.", user, db);
+            hashtable_free(map->hash);
+            MXS_FREE(map);
+            return NULL;
+        }
+
+        map->state = SHMAP_READY;
+        map->last_updated = snapshot->created;
+        map->version = snapshot->version;
+    }
+
+    return map;
+}
+
+/**
+ * Load the databases of one server into a snapshot
+ * @param router Router instance
+ * @param snapshot Snapshot being loaded
+ * @param con Connection to the server
+ * @param server The server
+ * @param match_data Match data for the ignored databases regex
+ * @return True if the databases were loaded
+ */
+static bool shard_snapshot_load_databases(ROUTER_INSTANCE *router, shard_snapshot_t *snapshot,
+                                          MYSQL *con, SERVER *server,
+                                          pcre2_match_data *match_data)
+{
+    MYSQL_RES *result;
+
+    if (mysql_query(con, "SHOW DATABASES") != 0 || (result = mysql_store_result(con)) == NULL)
+    {
+        MXS_ERROR("[%s] Failed to load the databases of '%s': %s",
+                  router->service->name, server->unique_name, mysql_error(con));
+        return false;
+    }
+
+    MYSQL_ROW row;
+
+    while ((row = mysql_fetch_row(result)))
+    {
+        if (row[0] == NULL)
+        {
+            continue;
+        }
+
+        if (hashtable_add(snapshot->databases, row[0], server->unique_name))
+        {
+            MXS_INFO("<%s, %s>", server->unique_name, row[0]);
+        }
+        else if (!(hashtable_fetch(router->ignored_dbs, row[0]) ||
+                   (router->ignore_regex &&
+                    pcre2_match(router->ignore_regex, (PCRE2_SPTR)row[0],
+                                PCRE2_ZERO_TERMINATED, 0, 0, match_data, NULL) >= 0)))
+        {
+            /** Sessions of the users that see both copies fail */
+            char *others = hashtable_fetch(snapshot->duplicates, row[0]);
+            char servers[(others ? strlen(others) + 1 : 0) + strlen(server->unique_name) + 1];
+            sprintf(servers, "%s%s%s", others ? others : "", others ? "," : "", server->unique_name);
+
+            hashtable_delete(snapshot->duplicates, row[0]);
+            hashtable_add(snapshot->duplicates, row[0], servers);
+
+            MXS_ERROR("[%s] Database '%s' found on servers '%s' and '%s'.",
+                      router->service->name, row[0],
+                      (char*)hashtable_fetch(snapshot->databases, row[0]),
+                      server->unique_name);
+        }
+    }
+
+    mysql_free_result(result);
+    return true;
+}
+
+/**
+ * Load the grants of one server
+ * @param router Router instance
+ * @param grants Grants being loaded
+ * @param con Connection to the server
+ * @param server The server
+ * @return True if the grants were loaded
+ */
+static bool shard_snapshot_load_grants(ROUTER_INSTANCE *router, shard_grants_t *grants,
+                                       MYSQL *con, SERVER *server)
+{
+    const char *queries[] = {SHARD_GLOBAL_GRANTS_QUERY, SHARD_DB_GRANTS_QUERY};
+    bool rval = true;
+
+    for (int i = 0; rval && i < (int)(sizeof(queries) / sizeof(queries[0])); i++)
+    {
+        MYSQL_RES *result;
+
+        if (mysql_query(con, queries[i]) != 0 || (result = mysql_store_result(con)) == NULL)
+        {
+            MXS_WARNING("[%s] Failed to load the grants of '%s', all databases "
+                        "will be visible to all users: %s", router->service->name,
+                        server->unique_name, mysql_error(con));
+            rval = false;
+            break;
+        }
+
+        MYSQL_ROW row;
+
+        while (rval && (row = mysql_fetch_row(result)))
+        {
+            if (row[0] && (i == 0 || row[1]))
+            {
+                rval = shard_grants_add(grants, row[0], server->unique_name,
+                                        i == 0 ? NULL : row[1]);
+            }
+        }
+
+        mysql_free_result(result);
+    }
+
+    return rval;
+}
+
+/**
+ * Load a new snapshot from the servers of the service
+ * @param router Router instance
+ * @return The new snapshot or NULL if one of the running servers could not
+ * be queried
+ */
+static shard_snapshot_t* shard_snapshot_load(ROUTER_INSTANCE *router)
+{
+    SERVICE *service = router->service;
+    char *user, *password;
+
+    if (serviceGetUser(service, &user, &password) == 0)
+    {
+        MXS_ERROR("[%s] Service is missing the user credentials needed "
+                  "to load the shard map.", service->name);
+        return NULL;
+    }
+
+    shard_snapshot_t *snapshot = shard_snapshot_alloc();
+    shard_grants_t *grants = shard_grants_alloc();
+    pcre2_match_data *match_data = router->ignore_regex ?
+                                   pcre2_match_data_create_from_pattern(router->ignore_regex, NULL) :
+                                   NULL;
+    char *dpwd = decrypt_password(password);
+    bool ok = snapshot && grants && dpwd && (router->ignore_regex == NULL || match_data);
+    int timeout = SHARD_SNAPSHOT_TIMEOUT;
+
+    for (SERVER_REF *ref = service->dbref; ok && ref; ref = ref->next)
+    {
+        if (!ref->active || !SERVER_IS_RUNNING(ref->server))
+        {
+            continue;
+        }
+
+        MYSQL *con = mysql_init(NULL);
+
+        if (con == NULL)
+        {
+            ok = false;
+            break;
+        }
+
+        mysql_optionsv(con, MYSQL_OPT_CONNECT_TIMEOUT, (void *)&timeout);
+        mysql_optionsv(con, MYSQL_OPT_READ_TIMEOUT, (void *)&timeout);
+        mysql_optionsv(con, MYSQL_OPT_WRITE_TIMEOUT, (void *)&timeout);
+        mysql_optionsv(con, MYSQL_PLUGIN_DIR, get_connector_plugindir());
+
+        if (mxs_mysql_real_connect(con, ref->server, user, dpwd) == NULL)
+        {
+            MXS_ERROR("[%s] Failed to connect to '%s' when loading the shard map: %s",
+                      service->name, ref->server->unique_name, mysql_error(con));
+            ok = false;
+        }
+        else if (!shard_snapshot_load_databases(router, snapshot, con, ref->server, match_data))
+        {
+            ok = false;
+        }
+        else if (grants && !shard_snapshot_load_grants(router, grants, con, ref->server))
+        {
+            /** Without complete grants the map can't be filtered per user */
+            shard_grants_release(grants);
+            grants = NULL;
+        }
+
+        mysql_close(con);
+    }
+
+    MXS_FREE(dpwd);
+    pcre2_match_data_free(match_data);
+
+    if (ok)
+    {
+        snapshot->grants = grants;
+    }
+    else
+    {
+        shard_grants_release(grants);
+        shard_snapshot_release(snapshot);
+        snapshot = NULL;
+    }
+
+    return snapshot;
+}
+
+/**
+ * Load the shared shard map and replace the current one with it. The changes
+ * published during the load are applied to the new map first.
+ * @param router Router instance
+ */
+static void shard_snapshot_refresh(ROUTER_INSTANCE *router)
+{
+    spinlock_acquire(&router->lock);
+    router->snapshot_loading = true;
+    spinlock_release(&router->lock);
+
+    shard_snapshot_t *snapshot = shard_snapshot_load(router);
+    shard_snapshot_t *old = NULL;
+
+    spinlock_acquire(&router->lock);
+    shard_change_t *changes = router->snapshot_changes;
+    router->snapshot_changes = NULL;
+    router->snapshot_loading = false;
+
+    if (snapshot)
+    {
+        for (shard_change_t *change = changes; change; change = change->next)
+        {
+            shard_snapshot_apply(snapshot, change->db, change->server);
+        }
+
+        old = router->snapshot;
+        snapshot->version = old ? old->version + 1 : 1;
+        router->snapshot = snapshot;
+    }
+
+    spinlock_release(&router->lock);
+
+    shard_snapshot_release(old);
+    shard_changes_free(changes);
+
+    if (snapshot)
+    {
+        atomic_add(&router->stats.shmap_loads, 1);
+        MXS_INFO("[%s] Loaded shard map with %d databases.",
+                 router->service->name, hashtable_size(snapshot->databases));
+    }
+}
+
+/**
+ * The main loop of the loader thread. The shard map is loaded when the refresh
+ * interval has passed since the last load or when a reload is requested.
+ * Until the first load succeeds, it is retried every SHARD_SNAPSHOT_RETRY seconds.
+ * @param data Router instance
+ */
+static void shard_loader_main(void *data)
+{
+    ROUTER_INSTANCE *router = (ROUTER_INSTANCE*)data;
+    shard_loader_t *loader = router->loader;
+    time_t last_load = 0;
+
+    pthread_mutex_lock(&loader->lock);
+
+    while (!loader->shutdown)
+    {
+        shard_snapshot_t *current = shard_snapshot_acquire(router);
+        double interval = current ? router->schemarouter_config.refresh_min_interval :
+                          SHARD_SNAPSHOT_RETRY;
+        shard_snapshot_release(current);
+
+        if (loader->reload || difftime(time(NULL), last_load) >= interval)
+        {
+            loader->reload = false;
+            pthread_mutex_unlock(&loader->lock);
+
+            last_load = time(NULL);
+            shard_snapshot_refresh(router);
+
+            pthread_mutex_lock(&loader->lock);
+        }
+        else
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += SHARD_SNAPSHOT_POLL;
+            pthread_cond_timedwait(&loader->cond, &loader->lock, &ts);
+        }
+    }
+
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/**
+ * Start the thread that loads the shared shard map. The connections to the
+ * servers block, so the map is not loaded by the housekeeper or the workers.
+ * @param router Router instance
+ * @return True if the thread was started
+ */
+bool shard_snapshot_start(ROUTER_INSTANCE *router)
+{
+    shard_loader_t *loader = MXS_CALLOC(1, sizeof(shard_loader_t));
+
+    if (loader == NULL)
+    {
+        return false;
+    }
+
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->cond, NULL);
+    router->loader = loader;
+
+    if (thread_start(&loader->thread, shard_loader_main, router) == NULL)
+    {
+        MXS_ERROR("[%s] Failed to start the thread that loads the shared shard map.",
+                  router->service->name);
+        router->loader = NULL;
+        pthread_mutex_destroy(&loader->lock);
+        pthread_cond_destroy(&loader->cond);
+        MXS_FREE(loader);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Stop the loader thread and release the shared shard map
+ * @param router Router instance
+ */
+void shard_snapshot_stop(ROUTER_INSTANCE *router)
+{
+    shard_loader_t *loader = router->loader;
+
+    if (loader)
+    {
+        pthread_mutex_lock(&loader->lock);
+        loader->shutdown = true;
+        pthread_cond_signal(&loader->cond);
+        pthread_mutex_unlock(&loader->lock);
+
+        thread_wait(loader->thread);
+
+        router->loader = NULL;
+        pthread_mutex_destroy(&loader->lock);
+        pthread_cond_destroy(&loader->cond);
+        MXS_FREE(loader);
+    }
+
+    spinlock_acquire(&router->lock);
+    shard_snapshot_t *snapshot = router->snapshot;
+    router->snapshot = NULL;
+    spinlock_release(&router->lock);
+
+    shard_snapshot_release(snapshot);
+}
+
+/**
+ * Load the shared shard map without waiting for the refresh interval
+ * @param router Router instance
+ */
+void shard_snapshot_reload(ROUTER_INSTANCE *router)
+{
+    shard_loader_t *loader = router->loader;
+
+    if (loader)
+    {
+        pthread_mutex_lock(&loader->lock);
+        loader->reload = true;
+        pthread_cond_signal(&loader->cond);
+        pthread_mutex_unlock(&loader->lock);
+    }
+}
+
+/**
+ * Publish a copy of the current snapshot with one database added or removed
+ * @param router Router instance
+ * @param db Database that was created or dropped
+ * @param server Server where the database was created or NULL if it was dropped
+ */
+void shard_snapshot_update(ROUTER_INSTANCE *router, const char *db, const char *server)
+{
+    shard_snapshot_t *current;
+    bool published = false;
+    shard_change_t *change = MXS_CALLOC(1, sizeof(shard_change_t));
+
+    if (change)
+    {
+        change->db = MXS_STRDUP(db);
+        change->server = server ? MXS_STRDUP(server) : NULL;
+    }
+
+    if (change == NULL || change->db == NULL || (server && change->server == NULL))
+    {
+        shard_changes_free(change);
+        MXS_ERROR("[%s] Failed to update the shard map after a change to "
+                  "database '%s'.", router->service->name, db);
+        return;
+    }
+
+    while (!published && (current = shard_snapshot_acquire(router)))
+    {
+        shard_snapshot_t *snapshot = shard_snapshot_alloc();
+        HASHITERATOR *iter = snapshot ? hashtable_iterator(current->databases) : NULL;
+        HASHITERATOR *dup_iter = iter ? hashtable_iterator(current->duplicates) : NULL;
+
+        if (dup_iter == NULL)
+        {
+            hashtable_iterator_free(iter);
+            shard_snapshot_release(snapshot);
+            shard_snapshot_release(current);
+            shard_changes_free(change);
+            MXS_ERROR("[%s] Failed to update the shard map after a change to "
+                      "database '%s'.", router->service->name, db);
+            return;
+        }
+
+        char *key;
+
+        while ((key = hashtable_next(iter)))
+        {
+            if (server || strcmp(key, db) != 0)
+            {
+                hashtable_add(snapshot->databases, key,
+                              hashtable_fetch(current->databases, key));
+            }
+        }
+
+        hashtable_iterator_free(iter);
+
+        while ((key = hashtable_next(dup_iter)))
+        {
+            hashtable_add(snapshot->duplicates, key,
+                          hashtable_fetch(current->duplicates, key));
+        }
+
+        hashtable_iterator_free(dup_iter);
+
+        if (server)
+        {
+            hashtable_add(snapshot->databases, (void*)db, (void*)server);
+        }
+
+        if ((snapshot->grants = current->grants))
+        {
+            atomic_add(&snapshot->grants->refcount, 1);
+        }
+
+        if (!(published = shard_snapshot_publish(router, snapshot, current, &change)))
+        {
+            shard_snapshot_release(snapshot);
+        }
+
+        shard_snapshot_release(current);
+    }
+
+    shard_changes_free(change);
+
+    if (published)
+    {
+        atomic_add(&router->stats.shmap_updates, 1);
+        MXS_INFO("[%s] Database '%s' %s, shard map updated.", router->service->name,
+                 db, server ? "created" : "dropped");
+    }
+}
@@ -149,3 +149,64 @@ bool change_current_db(char* dest,
 retblock:
     return succp;
 }
+
+/**
+ * Extract the database name from a CREATE DATABASE or DROP DATABASE statement.
+ * @param buf Buffer with a COM_QUERY, COM_CREATE_DB or COM_DROP_DB packet
+ * @param drop Set to true if the database is dropped
+ * @return The name of the database or NULL if the statement is not a database
+ * creation or removal. The caller must free the returned value.
+ */
+char* extract_ddl_database(GWBUF* buf, bool* drop)
+{
+    uint8_t* packet = GWBUF_DATA(buf);
+    unsigned int plen = gw_mysql_get_byte3(packet) - 1;
+    char *saved, *tok, *query;
+    char* rval = NULL;
+
+    if (packet[4] == MYSQL_COM_CREATE_DB || packet[4] == MYSQL_COM_DROP_DB)
+    {
+        *drop = packet[4] == MYSQL_COM_DROP_DB;
+        return plen > 0 ? MXS_STRNDUP_A((char*)packet + 5, plen) : NULL;
+    }
+
+    if ((query = modutil_get_SQL(buf)) == NULL)
+    {
+        return NULL;
+    }
+
+    const char *delim = "` \n\t;";
+    tok = strtok_r(query, delim, &saved);
+
+    if (tok && (strcasecmp(tok, "create") == 0 || strcasecmp(tok, "drop") == 0))
+    {
+        *drop = strcasecmp(tok, "drop") == 0;
+        tok = strtok_r(NULL, delim, &saved);
+
+        if (tok && (strcasecmp(tok, "database") == 0 || strcasecmp(tok, "schema") == 0))
+        {
+            tok = strtok_r(NULL, delim, &saved);
+
+            /** Skip IF EXISTS and IF NOT EXISTS */
+            if (tok && strcasecmp(tok, "if") == 0)
+            {
+                tok = strtok_r(NULL, delim, &saved);
+
+                if (tok && strcasecmp(tok, "not") == 0)
+                {
+                    tok = strtok_r(NULL, delim, &saved);
+                }
+
+                tok = tok ? strtok_r(NULL, delim, &saved) : NULL;
+            }
+
+            if (tok && strlen(tok) <= MYSQL_DATABASE_MAXLEN)
+            {
+                rval = MXS_STRDUP_A(tok);
+            }
+        }
+    }
+
+    MXS_FREE(query);
+    return rval;
+}
@@ -28,6 +28,7 @@ MXS_BEGIN_DECLS
 bool extract_database(GWBUF* buf, char* str);
 void create_error_reply(char* fail_str, DCB* dcb);
 bool change_current_db(char* dest, HASHTABLE* dbhash, GWBUF* buf);
+char* extract_ddl_database(GWBUF* buf, bool* drop);
 
 MXS_END_DECLS
 
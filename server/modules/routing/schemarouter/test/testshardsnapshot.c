@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file testshardsnapshot.c - Tests of the shared shard map of schemarouter
+ *
+ * The grant patterns, the filtering of the shared map with the grants of a
+ * user and the copy-on-write updates done by CREATE and DROP DATABASE are
+ * tested without connecting to any servers.
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+
+#include "../shard_snapshot.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <maxscale/log_manager.h>
+
+static void free_map(shard_map_t *map)
+{
+    hashtable_free(map->hash);
+    MXS_FREE(map);
+}
+
+static int test_grant_matches()
+{
+    ss_dfprintf(stderr, "testshardsnapshot : Grant patterns.");
+    ss_info_dassert(shard_grant_matches("db1", "db1"), "Exact name should match");
+    ss_info_dassert(!shard_grant_matches("db1", "db12"), "Longer name should not match");
+    ss_info_dassert(!shard_grant_matches("db12", "db1"), "Shorter name should not match");
+    ss_info_dassert(shard_grant_matches("db%", "db"), "% should match an empty string");
+    ss_info_dassert(shard_grant_matches("db%", "db_test"), "% should match any string");
+    ss_info_dassert(shard_grant_matches("%", ""), "% should match an empty name");
+    ss_info_dassert(shard_grant_matches("%b%1", "db_sub1"), "Multiple % should match");
+    ss_info_dassert(!shard_grant_matches("%b%1", "db_sub2"), "Multiple % should not match");
+    ss_info_dassert(shard_grant_matches("db_", "db1"), "_ should match one character");
+    ss_info_dassert(!shard_grant_matches("db_", "db"), "_ should not match an empty string");
+    ss_info_dassert(!shard_grant_matches("db_", "db12"), "_ should not match two characters");
+    ss_info_dassert(shard_grant_matches("db\\_1", "db_1"), "Escaped _ should match _");
+    ss_info_dassert(!shard_grant_matches("db\\_1", "dbx1"), "Escaped _ should only match _");
+    ss_info_dassert(shard_grant_matches("db\\%", "db%"), "Escaped % should match %");
+    ss_info_dassert(!shard_grant_matches("db\\%", "db1"), "Escaped % should only match %");
+    ss_dfprintf(stderr, "\t..done\n");
+
+    return 0;
+}
+
+static int test_filter()
+{
+    ss_dfprintf(stderr, "testshardsnapshot : Filtering with grants.");
+    shard_snapshot_t *snapshot = shard_snapshot_alloc();
+    ss_info_dassert(snapshot, "Snapshot should be allocated");
+
+    hashtable_add(snapshot->databases, "information_schema", "server1");
+    hashtable_add(snapshot->databases, "db1", "server1");
+    hashtable_add(snapshot->databases, "db2", "server2");
+    hashtable_add(snapshot->databases, "shared", "server1");
+    hashtable_add(snapshot->duplicates, "shared", "server2");
+
+    snapshot->grants = shard_grants_alloc();
+    ss_info_dassert(snapshot->grants, "Grants should be allocated");
+    shard_grants_add(snapshot->grants, "alice", "server1", "db%");
+    shard_grants_add(snapshot->grants, "bob", "server1", NULL);
+    shard_grants_add(snapshot->grants, "bob", "server2", "db2");
+    shard_grants_add(snapshot->grants, "carol", "server1", "shared");
+    shard_grants_add(snapshot->grants, "carol", "server2", "shared");
+
+    shard_map_t *map = shard_snapshot_filter(snapshot, "alice");
+    ss_info_dassert(map && map->state == SHMAP_READY, "Map of alice should be ready");
+    ss_info_dassert(hashtable_fetch(map->hash, "db1"), "alice should see db1");
+    ss_info_dassert(hashtable_fetch(map->hash, "information_schema"),
+                    "alice should see information_schema");
+    ss_info_dassert(!hashtable_fetch(map->hash, "db2"), "alice should not see db2 on server2");
+    ss_info_dassert(!hashtable_fetch(map->hash, "shared"), "alice should not see shared");
+    free_map(map);
+
+    map = shard_snapshot_filter(snapshot, "bob");
+    ss_info_dassert(map, "bob sees only one copy of shared and should get a map");
+    ss_info_dassert(strcmp(hashtable_fetch(map->hash, "shared"), "server1") == 0,
+                    "shared should be on server1");
+    ss_info_dassert(strcmp(hashtable_fetch(map->hash, "db2"), "server2") == 0,
+                    "db2 should be on server2");
+    free_map(map);
+
+    map = shard_snapshot_filter(snapshot, "dave");
+    ss_info_dassert(map && hashtable_size(map->hash) == 1,
+                    "A user without grants should only see information_schema");
+    free_map(map);
+
+    ss_info_dassert(shard_snapshot_filter(snapshot, "carol") == NULL,
+                    "carol sees both copies of shared and should not get a map");
+
+    /** Without grants all databases are visible, including both copies */
+    shard_grants_t *grants = snapshot->grants;
+    snapshot->grants = NULL;
+    ss_info_dassert(shard_snapshot_filter(snapshot, "alice") == NULL,
+                    "Duplicates should fail the filtering without grants");
+    snapshot->grants = grants;
+
+    shard_snapshot_release(snapshot);
+    ss_dfprintf(stderr, "\t..done\n");
+
+    return 0;
+}
+
+static int test_update()
+{
+    ss_dfprintf(stderr, "testshardsnapshot : Copy-on-write updates.");
+    static SERVICE service;
+    ROUTER_INSTANCE router;
+    memset(&router, 0, sizeof(router));
+    service.name = "test_service";
+    service.credentials.name = "user";
+    service.credentials.authdata = "password";
+    router.service = &service;
+    spinlock_init(&router.lock);
+
+    shard_snapshot_update(&router, "db1", "server1");
+    ss_info_dassert(router.snapshot == NULL, "Nothing should be published without a snapshot");
+
+    router.snapshot = shard_snapshot_alloc();
+    router.snapshot->version = 1;
+    hashtable_add(router.snapshot->databases, "db1", "server1");
+    hashtable_add(router.snapshot->duplicates, "db1", "server2");
+
+    shard_snapshot_t *first = shard_snapshot_acquire(&router);
+    shard_snapshot_update(&router, "db2", "server2");
+    shard_snapshot_t *second = shard_snapshot_acquire(&router);
+
+    ss_info_dassert(second != first && second->version == 2, "A new version should be published");
+    ss_info_dassert(hashtable_fetch(first->databases, "db2") == NULL,
+                    "The old snapshot should not be modified");
+    ss_info_dassert(strcmp(hashtable_fetch(second->databases, "db2"), "server2") == 0,
+                    "The new snapshot should have the created database");
+    ss_info_dassert(hashtable_fetch(second->databases, "db1") &&
+                    hashtable_fetch(second->duplicates, "db1"),
+                    "The new snapshot should keep the old databases and duplicates");
+    ss_info_dassert(router.snapshot_changes == NULL, "Changes should not be stored without a load");
+
+    shard_snapshot_update(&router, "db1", NULL);
+    ss_info_dassert(hashtable_fetch(second->databases, "db1"),
+                    "The old snapshot should keep the dropped database");
+    ss_info_dassert(hashtable_fetch(router.snapshot->databases, "db1") == NULL,
+                    "The new snapshot should not have the dropped database");
+
+    shard_snapshot_release(first);
+    shard_snapshot_release(second);
+    ss_dfprintf(stderr, "\t..done\n");
+
+    /** The service has no servers so the load returns an empty snapshot. The
+     * changes published during the load must be applied to it. */
+    ss_dfprintf(stderr, "testshardsnapshot : Changes during a load.");
+    int version = router.snapshot->version;
+    router.snapshot_loading = true;
+    shard_snapshot_update(&router, "db3", "server1");
+    shard_snapshot_update(&router, "db4", "server2");
+    shard_snapshot_update(&router, "db3", NULL);
+    ss_info_dassert(router.snapshot_changes && router.snapshot_changes->next &&
+                    router.snapshot_changes->next->next,
+                    "Three changes should be stored during the load");
+
+    shard_snapshot_refresh(&router);
+    ss_info_dassert(!router.snapshot_loading && router.snapshot_changes == NULL,
+                    "The load should be done and the changes consumed");
+    ss_info_dassert(router.snapshot->version == version + 4, "The loaded snapshot should be newer");
+    ss_info_dassert(hashtable_fetch(router.snapshot->databases, "db2") == NULL,
+                    "Databases not found by the load should not be in the snapshot");
+    ss_info_dassert(strcmp(hashtable_fetch(router.snapshot->databases, "db4"), "server2") == 0,
+                    "A database created during the load should be in the snapshot");
+    ss_info_dassert(hashtable_fetch(router.snapshot->databases, "db3") == NULL,
+                    "A database dropped during the load should not be in the snapshot");
+
+    shard_snapshot_stop(&router);
+    ss_info_dassert(router.snapshot == NULL, "The snapshot should be released");
+    ss_dfprintf(stderr, "\t..done\n");
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    mxs_log_init(NULL, NULL, MXS_LOG_TARGET_DEFAULT);
+
+    result += test_grant_matches();
+    result += test_filter();
+    result += test_update();
+
+    mxs_log_finish();
+    exit(result);
+}